@@ -1,7 +1,13 @@
 #include "Algorithms.h"
+#include "Kernels.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <sqlite3.h>
 #include <cmath>
+#include <limits>
 
 namespace {
 
@@ -31,7 +37,7 @@ SELECT COALESCE(SUM(BuySell.NumberOfShares), 0) FROM Transactions
   INNER JOIN
     (SELECT TransactionId, SecurityId, NumberOfShares FROM BuyTransactions UNION ALL SELECT TransactionId, SecurityId, -NumberOfShares FROM SellTransactions) BuySell
     ON Transactions.Id = BuySell.TransactionId  AND BuySell.SecurityId = :SecurityId
-WHERE Transactions.Date <= :Date AND Transaction.AccountId = :AccountId
+WHERE Transactions.Date <= :Date AND Transactions.AccountId = :AccountId
 )";
 
 const char* sharesSoldQuery = R"(
@@ -45,7 +51,7 @@ const char* sharesSoldByAccountQuery = R"(
 SELECT COALESCE(SUM(SellTransactions.NumberOfShares), 0) FROM Transactions
   INNER JOIN SellTransactions
     ON Transactions.Id = SellTransactions.TransactionId  AND SellTransactions.SecurityId = :SecurityId
-WHERE Transactions.Date <= :Date AND Transaction.AccountId = :AccountId
+WHERE Transactions.Date <= :Date AND Transactions.AccountId = :AccountId
 )";
 
 const char* dividendIncomeQuery = R"(
@@ -107,12 +113,133 @@ WHERE Transactions.Date <= :Date AND Transactions.AccountId = :AccountId
 const char* sharePriceQuery =
     "SELECT Price FROM SecurityPrices WHERE SecurityId = ? AND Date <= ? ORDER BY Date DESC LIMIT 1";
 
+// The latest price from either the data file or the quote cache, the data file's winning a tie. Each side is a single
+// seek on its primary key.
+const char* sharePriceReadThroughQuery = R"(
+SELECT Price FROM (
+  SELECT * FROM (SELECT Date, Price, 1 AS Own FROM SecurityPrices WHERE SecurityId = ?1 AND Date <= ?2
+                 ORDER BY Date DESC LIMIT 1)
+  UNION ALL
+  SELECT * FROM (SELECT Date, Price, 0 AS Own FROM QuoteCache.Quotes
+                 WHERE Symbol = (SELECT Symbol FROM Securities WHERE Id = ?1) AND Date <= ?2
+                 ORDER BY Date DESC LIMIT 1)
+) ORDER BY Date DESC, Own DESC LIMIT 1
+)";
+
+/// \internal The sums of the transactions of a security in a ledger, before any averages are taken.
+struct LedgerTotals {
+  pv::i64 sharesBought = 0;
+  pv::i64 buyCost = 0; // sum of SharePrice * NumberOfShares over every buy, like the average price queries
+  pv::i64 sharesSold = 0;
+  pv::i64 sellProceeds = 0;
+  pv::i64 dividendIncome = 0;
+  pv::i64 interestIncome = 0;
+};
+
+/// \internal Passed to ledgerTotals() instead of an account to include every account.
+constexpr pv::i64 allAccounts = std::numeric_limits<pv::i64>::min();
+
+/// \internal Sums the transactions of \c security in \c account dated on or before \c date.
+
+LedgerTotals ledgerTotals(pv::Ledger& ledger, pv::i64 security, pv::i64 account, pv::i64 date) {
+  const auto& rows = ledger.securityRows(security);
+  const auto& dates = ledger.dates();
+  const auto& accounts = ledger.accounts();
+  const auto& actions = ledger.actions();
+  const auto& numbersOfShares = ledger.numbersOfShares();
+  const auto& sharePrices = ledger.sharePrices();
+  const auto& amounts = ledger.amounts();
+
+  LedgerTotals totals;
+  for (auto row : rows) {
+    if (dates[row] > date) {
+      break; // The rows are sorted by date
+    }
+    if (account != allAccounts && accounts[row] != account) {
+      continue;
+    }
+    switch (actions[row]) {
+    case pv::Action::BUY:
+      totals.sharesBought += numbersOfShares[row];
+      totals.buyCost += numbersOfShares[row] * sharePrices[row];
+      break;
+    case pv::Action::SELL:
+      totals.sharesSold += numbersOfShares[row];
+      totals.sellProceeds += numbersOfShares[row] * sharePrices[row];
+      break;
+    case pv::Action::DIVIDEND: totals.dividendIncome += amounts[row]; break;
+    case pv::Action::INTEREST: totals.interestIncome += amounts[row]; break;
+    default: break;
+    }
+  }
+  return totals;
+}
+
+/// \internal Integer division, and no average without shares, like the average price queries.
+std::optional<pv::i64> average(pv::i64 total, pv::i64 shares) {
+  if (shares == 0) {
+    return std::nullopt;
+  }
+  return total / shares;
+}
+
+/// \internal Returns the running total of \c changes at \c rows on each of \c dates.
+std::vector<pv::i64> balancesAt(pv::Ledger& ledger, const std::vector<pv::Ledger::Row>& rows,
+                                const std::vector<pv::i64>& changes, const std::vector<pv::i64>& dates) {
+  const auto& ledgerDates = ledger.dates();
+  std::vector<pv::i64> rowDates(rows.size());
+  std::vector<pv::i64> balances(rows.size());
+  for (std::size_t i = 0; i < rows.size(); ++i) {
+    rowDates[i] = ledgerDates[rows[i]];
+    balances[i] = changes[rows[i]];
+  }
+  pv::kernels::prefixSum(balances.data(), balances.data(), balances.size());
+
+  std::vector<pv::i64> result(dates.size(), 0);
+  for (std::size_t i = 0; i < dates.size(); ++i) {
+    auto count = std::upper_bound(rowDates.cbegin(), rowDates.cend(), dates[i]) - rowDates.cbegin();
+    if (count != 0) {
+      result[i] = balances[static_cast<std::size_t>(count - 1)];
+    }
+  }
+  return result;
+}
+
+/// \internal Looks up the result of a function in the data file's memo, and stores the result once it has been
+/// calculated if it wasn't there.
+class Memoized {
+private:
+  pv::DataFile& dataFile;
+  pv::Memo::Key key;
+  std::uint64_t version;
+  const std::optional<pv::i64>* result_;
+public:
+  Memoized(pv::DataFile& dataFile, pv::Memo::Function function, pv::i64 security, pv::i64 account, pv::i64 date)
+      : dataFile(dataFile), key{function, security, account, date},
+        version(std::max(security != pv::Memo::none ? dataFile.securityVersion(security) : 0,
+                         account != pv::Memo::none ? dataFile.accountVersion(account) : 0)),
+        result_(dataFile.memo().find(key, version)) {}
+
+  /// \brief Returns the remembered result, or \c nullptr if it needs to be calculated.
+  const std::optional<pv::i64>* result() const noexcept { return result_; }
+
+  template <typename T> T store(T result) {
+    dataFile.memo().store(key, version, result);
+    return result;
+  }
+};
+
 } // namespace
 
 namespace pv {
 namespace algorithms {
 
 i64 cashBalance(DataFile& dataFile, i64 account, i64 date) {
+  trace::Span span("cashBalance", "algorithms");
+  Memoized memo(dataFile, Memo::Function::CashBalance, Memo::none, account, date);
+  if (const auto* result = memo.result()) {
+    return **result;
+  }
   auto* stmt = dataFile.cachedQuery(cashBalanceQuery);
   if (!stmt) {
     return 0;
@@ -121,10 +248,15 @@ i64 cashBalance(DataFile& dataFile, i64 account, i64 date) {
   sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(date));
   sqlite3_step(stmt);
   auto result = sqlite3_column_int64(stmt, 0);
-  return result;
+  return memo.store(result);
 }
 
 i64 sharesHeld(DataFile& dataFile, i64 security, i64 date) {
+  trace::Span span("sharesHeld", "algorithms");
+  Memoized memo(dataFile, Memo::Function::SharesHeld, security, Memo::none, date);
+  if (const auto* result = memo.result()) {
+    return **result;
+  }
   auto* stmt = dataFile.cachedQuery(sharesHeldQuery);
   if (!stmt) {
     return 0;
@@ -133,10 +265,15 @@ i64 sharesHeld(DataFile& dataFile, i64 security, i64 date) {
   sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(date));
   sqlite3_step(stmt);
   auto result = sqlite3_column_int64(stmt, 0);
-  return result;
+  return memo.store(result);
 }
 
 i64 sharesHeld(DataFile& dataFile, i64 security, i64 account, i64 date) {
+  trace::Span span("sharesHeld", "algorithms");
+  Memoized memo(dataFile, Memo::Function::SharesHeld, security, account, date);
+  if (const auto* result = memo.result()) {
+    return **result;
+  }
   auto* stmt = dataFile.cachedQuery(sharesHeldByAccountQuery);
   if (!stmt) {
     return 0;
@@ -146,10 +283,15 @@ i64 sharesHeld(DataFile& dataFile, i64 security, i64 account, i64 date) {
   sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(account));
   sqlite3_step(stmt);
   auto result = sqlite3_column_int64(stmt, 0);
-  return result;
+  return memo.store(result);
 }
 
 i64 sharesSold(DataFile& dataFile, i64 security, i64 date) {
+  trace::Span span("sharesSold", "algorithms");
+  Memoized memo(dataFile, Memo::Function::SharesSold, security, Memo::none, date);
+  if (const auto* result = memo.result()) {
+    return **result;
+  }
   auto* stmt = dataFile.cachedQuery(sharesSoldQuery);
   if (!stmt) {
     return 0;
@@ -158,10 +300,15 @@ i64 sharesSold(DataFile& dataFile, i64 security, i64 date) {
   sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(date));
   sqlite3_step(stmt);
   auto result = sqlite3_column_int64(stmt, 0);
-  return result;
+  return memo.store(result);
 }
 
 i64 sharesSold(DataFile& dataFile, i64 security, i64 account, i64 date) {
+  trace::Span span("sharesSold", "algorithms");
+  Memoized memo(dataFile, Memo::Function::SharesSold, security, account, date);
+  if (const auto* result = memo.result()) {
+    return **result;
+  }
   auto* stmt = dataFile.cachedQuery(sharesSoldByAccountQuery);
   if (!stmt) {
     return 0;
@@ -171,18 +318,25 @@ i64 sharesSold(DataFile& dataFile, i64 security, i64 account, i64 date) {
   sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(account));
   sqlite3_step(stmt);
   auto result = sqlite3_column_int64(stmt, 0);
-  return result;
+  return memo.store(result);
 }
 
 i64 cashGained(DataFile& dataFile, i64 security, i64 date) {
+  trace::Span span("cashGained", "algorithms");
   return sharesSold(dataFile, security, date) * (averageSellPrice(dataFile, security, date).value_or(0) - averageBuyPrice(dataFile, security, date).value_or(0));
 }
 
 i64 cashGained(DataFile& dataFile, i64 security, i64 account, i64 date) {
-  return sharesSold(dataFile, security, date) * (averageSellPrice(dataFile, security, account, date).value_or(0) - averageBuyPrice(dataFile, security, account, date).value_or(0));
+  trace::Span span("cashGained", "algorithms");
+  return sharesSold(dataFile, security, account, date) * (averageSellPrice(dataFile, security, account, date).value_or(0) - averageBuyPrice(dataFile, security, account, date).value_or(0));
 }
 
 i64 dividendIncome(DataFile& dataFile, i64 security, i64 date) {
+  trace::Span span("dividendIncome", "algorithms");
+  Memoized memo(dataFile, Memo::Function::DividendIncome, security, Memo::none, date);
+  if (const auto* result = memo.result()) {
+    return **result;
+  }
   auto* stmt = dataFile.cachedQuery(dividendIncomeQuery);
   if (!stmt) {
     return 0;
@@ -191,10 +345,15 @@ i64 dividendIncome(DataFile& dataFile, i64 security, i64 date) {
   sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(date));
   sqlite3_step(stmt);
   auto result = sqlite3_column_int64(stmt, 0);
-  return result;
+  return memo.store(result);
 }
 
 i64 dividendIncome(DataFile& dataFile, i64 security, i64 account, i64 date) {
+  trace::Span span("dividendIncome", "algorithms");
+  Memoized memo(dataFile, Memo::Function::DividendIncome, security, account, date);
+  if (const auto* result = memo.result()) {
+    return **result;
+  }
   auto* stmt = dataFile.cachedQuery(dividendIncomeByAccountQuery);
   if (!stmt) {
     return 0;
@@ -204,10 +363,15 @@ i64 dividendIncome(DataFile& dataFile, i64 security, i64 account, i64 date) {
   sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(account));
   sqlite3_step(stmt);
   auto result = sqlite3_column_int64(stmt, 0);
-  return result;
+  return memo.store(result);
 }
 
 i64 interestIncome(DataFile& dataFile, i64 security, i64 date) {
+  trace::Span span("interestIncome", "algorithms");
+  Memoized memo(dataFile, Memo::Function::InterestIncome, security, Memo::none, date);
+  if (const auto* result = memo.result()) {
+    return **result;
+  }
   auto* stmt = dataFile.cachedQuery(interestIncomeQuery);
   if (!stmt) {
     return 0;
@@ -216,10 +380,15 @@ i64 interestIncome(DataFile& dataFile, i64 security, i64 date) {
   sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(date));
   sqlite3_step(stmt);
   auto result = sqlite3_column_int64(stmt, 0);
-  return result;
+  return memo.store(result);
 }
 
 i64 interestIncome(DataFile& dataFile, i64 security, i64 account, i64 date) {
+  trace::Span span("interestIncome", "algorithms");
+  Memoized memo(dataFile, Memo::Function::InterestIncome, security, account, date);
+  if (const auto* result = memo.result()) {
+    return **result;
+  }
   auto* stmt = dataFile.cachedQuery(interestIncomeByAccountQuery);
   if (!stmt) {
     return 0;
@@ -229,43 +398,54 @@ i64 interestIncome(DataFile& dataFile, i64 security, i64 account, i64 date) {
   sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(account));
   sqlite3_step(stmt);
   auto result = sqlite3_column_int64(stmt, 0);
-  return result;
+  return memo.store(result);
 }
 
 i64 costBasis(DataFile& dataFile, i64 security, i64 date) {
+  trace::Span span("costBasis", "algorithms");
   return sharesHeld(dataFile, security, date) * averageBuyPrice(dataFile, security, date).value_or(0);
 }
 
 i64 costBasis(DataFile& dataFile, i64 security, i64 account, i64 date) {
+  trace::Span span("costBasis", "algorithms");
   return sharesHeld(dataFile, security, account, date) * averageBuyPrice(dataFile, security, account, date).value_or(0);
 }
 
 i64 totalIncome(DataFile& dataFile, i64 security, i64 date) {
+  trace::Span span("totalIncome", "algorithms");
   return unrealizedCashGained(dataFile, security, date).value_or(0) + cashGained(dataFile, security, date) + dividendIncome(dataFile, security, date) + interestIncome(dataFile, security, date);
 }
 
 i64 totalIncome(DataFile& dataFile, i64 security, i64 account, i64 date) {
-  return unrealizedCashGained(dataFile, security, account, date).value_or(0) + cashGained(dataFile, security, account, date) + dividendIncome(dataFile, security, account, date) + interestIncome(dataFile, security, date);
+  trace::Span span("totalIncome", "algorithms");
+  return unrealizedCashGained(dataFile, security, account, date).value_or(0) + cashGained(dataFile, security, account, date) + dividendIncome(dataFile, security, account, date) + interestIncome(dataFile, security, account, date);
 }
 
 std::optional<i64> sharePrice(DataFile& dataFile, i64 security, i64 date) {
-  auto* stmt = dataFile.cachedQuery(sharePriceQuery);
+  trace::Span span("sharePrice", "algorithms");
+  // The quote cache can change without the data file knowing, so prices read through it aren't memoized
+  bool readThrough = dataFile.hasQuoteCache();
+  Memoized memo(dataFile, Memo::Function::SharePrice, security, Memo::none, date);
+  if (const auto* result = memo.result(); result != nullptr && !readThrough) {
+    return *result;
+  }
+  auto* stmt = dataFile.cachedQuery(readThrough ? sharePriceReadThroughQuery : sharePriceQuery);
   if (!stmt) {
     return 0;
   }
   sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(security));
   sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(date));
-  sqlite3_step(stmt);
   std::optional<i64> result = std::nullopt;
 
-  if (sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+  if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
     result = sqlite3_column_int64(stmt, 0);
   }
 
-  return result;
+  return readThrough ? result : memo.store(result);
 }
 
 std::optional<i64> unrealizedCashGained(DataFile& dataFile, i64 security, i64 date) {
+  trace::Span span("unrealizedCashGained", "algorithms");
   auto sharePrice_ = sharePrice(dataFile, security, date);
   auto averageBuyPrice_ = averageBuyPrice(dataFile, security, date);
   if (!sharePrice_.has_value() || !averageBuyPrice_.has_value()) {
@@ -275,6 +455,7 @@ std::optional<i64> unrealizedCashGained(DataFile& dataFile, i64 security, i64 da
 }
 
 std::optional<i64> unrealizedCashGained(DataFile& dataFile, i64 security, i64 account, i64 date) {
+  trace::Span span("unrealizedCashGained", "algorithms");
   auto sharePrice_ = sharePrice(dataFile, security, date);
   auto averageBuyPrice_ = averageBuyPrice(dataFile, security, account, date);
   if (!sharePrice_.has_value() || !averageBuyPrice_.has_value()) {
@@ -284,6 +465,11 @@ std::optional<i64> unrealizedCashGained(DataFile& dataFile, i64 security, i64 ac
 }
 
 std::optional<i64> averageBuyPrice(DataFile& dataFile, i64 security, i64 date) {
+  trace::Span span("averageBuyPrice", "algorithms");
+  Memoized memo(dataFile, Memo::Function::AverageBuyPrice, security, Memo::none, date);
+  if (const auto* result = memo.result()) {
+    return *result;
+  }
   auto* stmt = dataFile.cachedQuery(averageBuyPriceQuery);
   if (!stmt) {
     return 0;
@@ -297,10 +483,15 @@ std::optional<i64> averageBuyPrice(DataFile& dataFile, i64 security, i64 date) {
     result = std::llround(sqlite3_column_double(stmt, 0));
   }
 
-  return result;
+  return memo.store(result);
 }
 
 std::optional<i64> averageBuyPrice(DataFile& dataFile, i64 security, i64 account, i64 date) {
+  trace::Span span("averageBuyPrice", "algorithms");
+  Memoized memo(dataFile, Memo::Function::AverageBuyPrice, security, account, date);
+  if (const auto* result = memo.result()) {
+    return *result;
+  }
   auto* stmt = dataFile.cachedQuery(averageBuyPriceByAccountQuery);
   if (!stmt) {
     return 0;
@@ -315,10 +506,15 @@ std::optional<i64> averageBuyPrice(DataFile& dataFile, i64 security, i64 account
     result = std::llround(sqlite3_column_double(stmt, 0));
   }
 
-  return result;
+  return memo.store(result);
 }
 
 std::optional<i64> averageSellPrice(DataFile& dataFile, i64 security, i64 date) {
+  trace::Span span("averageSellPrice", "algorithms");
+  Memoized memo(dataFile, Memo::Function::AverageSellPrice, security, Memo::none, date);
+  if (const auto* result = memo.result()) {
+    return *result;
+  }
   auto* stmt = dataFile.cachedQuery(averageSellPriceQuery);
   if (!stmt) {
     return 0;
@@ -332,10 +528,15 @@ std::optional<i64> averageSellPrice(DataFile& dataFile, i64 security, i64 date)
     result = std::llround(sqlite3_column_double(stmt, 0));
   }
 
-  return result;
+  return memo.store(result);
 }
 
 std::optional<i64> averageSellPrice(DataFile& dataFile, i64 security, i64 account, i64 date) {
+  trace::Span span("averageSellPrice", "algorithms");
+  Memoized memo(dataFile, Memo::Function::AverageSellPrice, security, account, date);
+  if (const auto* result = memo.result()) {
+    return *result;
+  }
   auto* stmt = dataFile.cachedQuery(averageSellPriceByAccountQuery);
   if (!stmt) {
     return 0;
@@ -350,10 +551,11 @@ std::optional<i64> averageSellPrice(DataFile& dataFile, i64 security, i64 accoun
     result = std::llround(sqlite3_column_double(stmt, 0));
   }
 
-  return result;
+  return memo.store(result);
 }
 
 std::optional<i64> marketValue(DataFile& dataFile, i64 security, i64 date) {
+  trace::Span span("marketValue", "algorithms");
   auto sharePrice_ = sharePrice(dataFile, security, date);
   if (!sharePrice_.has_value()) {
     return std::nullopt;
@@ -362,6 +564,7 @@ std::optional<i64> marketValue(DataFile& dataFile, i64 security, i64 date) {
 }
 
 std::optional<i64> marketValue(DataFile& dataFile, i64 security, i64 account, i64 date) {
+  trace::Span span("marketValue", "algorithms");
   auto sharePrice_ = sharePrice(dataFile, security, date);
   if (!sharePrice_.has_value()) {
     return std::nullopt;
@@ -369,6 +572,166 @@ std::optional<i64> marketValue(DataFile& dataFile, i64 security, i64 account, i6
   return (*sharePrice_) * sharesHeld(dataFile, security, account, date);
 }
 
+i64 cashBalance(Ledger& ledger, i64 account, i64 date) {
+  trace::Span span("cashBalance", "algorithms");
+  const auto& rows = ledger.accountRows(account);
+  const auto& dates = ledger.dates();
+  const auto& cashChanges = ledger.cashChanges();
+
+  i64 result = 0;
+  for (auto row : rows) {
+    if (dates[row] > date) {
+      break;
+    }
+    result += cashChanges[row];
+  }
+  return result;
+}
+
+i64 sharesHeld(Ledger& ledger, i64 security, i64 date) {
+  trace::Span span("sharesHeld", "algorithms");
+  auto totals = ledgerTotals(ledger, security, allAccounts, date);
+  return totals.sharesBought - totals.sharesSold;
+}
+
+i64 sharesHeld(Ledger& ledger, i64 security, i64 account, i64 date) {
+  trace::Span span("sharesHeld", "algorithms");
+  auto totals = ledgerTotals(ledger, security, account, date);
+  return totals.sharesBought - totals.sharesSold;
+}
+
+i64 sharesSold(Ledger& ledger, i64 security, i64 date) {
+  trace::Span span("sharesSold", "algorithms");
+  return ledgerTotals(ledger, security, allAccounts, date).sharesSold;
+}
+
+i64 sharesSold(Ledger& ledger, i64 security, i64 account, i64 date) {
+  trace::Span span("sharesSold", "algorithms");
+  return ledgerTotals(ledger, security, account, date).sharesSold;
+}
+
+i64 cashGained(Ledger& ledger, i64 security, i64 date) {
+  trace::Span span("cashGained", "algorithms");
+  auto totals = ledgerTotals(ledger, security, allAccounts, date);
+  return totals.sharesSold * (average(totals.sellProceeds, totals.sharesSold).value_or(0) -
+                              average(totals.buyCost, totals.sharesBought).value_or(0));
+}
+
+i64 cashGained(Ledger& ledger, i64 security, i64 account, i64 date) {
+  trace::Span span("cashGained", "algorithms");
+  auto totals = ledgerTotals(ledger, security, account, date);
+  return totals.sharesSold * (average(totals.sellProceeds, totals.sharesSold).value_or(0) -
+                              average(totals.buyCost, totals.sharesBought).value_or(0));
+}
+
+i64 dividendIncome(Ledger& ledger, i64 security, i64 date) {
+  trace::Span span("dividendIncome", "algorithms");
+  return ledgerTotals(ledger, security, allAccounts, date).dividendIncome;
+}
+
+i64 dividendIncome(Ledger& ledger, i64 security, i64 account, i64 date) {
+  trace::Span span("dividendIncome", "algorithms");
+  return ledgerTotals(ledger, security, account, date).dividendIncome;
+}
+
+i64 interestIncome(Ledger& ledger, i64 security, i64 date) {
+  trace::Span span("interestIncome", "algorithms");
+  return ledgerTotals(ledger, security, allAccounts, date).interestIncome;
+}
+
+i64 interestIncome(Ledger& ledger, i64 security, i64 account, i64 date) {
+  trace::Span span("interestIncome", "algorithms");
+  return ledgerTotals(ledger, security, account, date).interestIncome;
+}
+
+i64 costBasis(Ledger& ledger, i64 security, i64 date) {
+  trace::Span span("costBasis", "algorithms");
+  auto totals = ledgerTotals(ledger, security, allAccounts, date);
+  return (totals.sharesBought - totals.sharesSold) * average(totals.buyCost, totals.sharesBought).value_or(0);
+}
+
+i64 costBasis(Ledger& ledger, i64 security, i64 account, i64 date) {
+  trace::Span span("costBasis", "algorithms");
+  auto totals = ledgerTotals(ledger, security, account, date);
+  return (totals.sharesBought - totals.sharesSold) * average(totals.buyCost, totals.sharesBought).value_or(0);
+}
+
+std::optional<i64> averageBuyPrice(Ledger& ledger, i64 security, i64 date) {
+  trace::Span span("averageBuyPrice", "algorithms");
+  auto totals = ledgerTotals(ledger, security, allAccounts, date);
+  return average(totals.buyCost, totals.sharesBought);
+}
+
+std::optional<i64> averageBuyPrice(Ledger& ledger, i64 security, i64 account, i64 date) {
+  trace::Span span("averageBuyPrice", "algorithms");
+  auto totals = ledgerTotals(ledger, security, account, date);
+  return average(totals.buyCost, totals.sharesBought);
+}
+
+std::optional<i64> averageSellPrice(Ledger& ledger, i64 security, i64 date) {
+  trace::Span span("averageSellPrice", "algorithms");
+  auto totals = ledgerTotals(ledger, security, allAccounts, date);
+  return average(totals.sellProceeds, totals.sharesSold);
+}
+
+std::optional<i64> averageSellPrice(Ledger& ledger, i64 security, i64 account, i64 date) {
+  trace::Span span("averageSellPrice", "algorithms");
+  auto totals = ledgerTotals(ledger, security, account, date);
+  return average(totals.sellProceeds, totals.sharesSold);
+}
+
+std::vector<i64> cashBalances(Ledger& ledger, const std::vector<i64>& dates) {
+  trace::Span span("cashBalances", "algorithms");
+  const auto& cashChanges = ledger.cashChanges();
+
+  // Every transaction counts, so the balances are sums of consecutive runs of the whole column
+  std::vector<std::size_t> order(dates.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) { return dates[lhs] < dates[rhs]; });
+  std::vector<std::size_t> ends(dates.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    ends[i] = ledger.rowsUntil(dates[order[i]]);
+  }
+  std::vector<i64> sums(dates.size());
+  kernels::segmentedSum(cashChanges.data(), ends.data(), ends.size(), sums.data());
+
+  std::vector<i64> result(dates.size());
+  i64 balance = 0;
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    balance += sums[i];
+    result[order[i]] = balance;
+  }
+  return result;
+}
+
+std::vector<i64> cashBalances(Ledger& ledger, i64 account, const std::vector<i64>& dates) {
+  trace::Span span("cashBalances", "algorithms");
+  const auto& rows = ledger.accountRows(account);
+  return balancesAt(ledger, rows, ledger.cashChanges(), dates);
+}
+
+std::vector<i64> sharesHeld(Ledger& ledger, i64 security, const std::vector<i64>& dates) {
+  trace::Span span("sharesHeld", "algorithms");
+  const auto& rows = ledger.securityRows(security);
+  return balancesAt(ledger, rows, ledger.sharesChanges(), dates);
+}
+
+std::optional<i64> sharePrice(PriceIndex& prices, i64 security, i64 date) {
+  trace::Span span("sharePrice", "algorithms");
+  return prices.price(security, date);
+}
+
+std::optional<i64> marketValue(Ledger& ledger, PriceIndex& prices, i64 security, i64 date) {
+  trace::Span span("marketValue", "algorithms");
+  auto sharePrice_ = prices.price(security, date);
+  if (!sharePrice_.has_value()) {
+    return std::nullopt;
+  }
+  return (*sharePrice_) * sharesHeld(ledger, security, date);
+}
+
 } // namespace algorithms
 
 } // namespace pv
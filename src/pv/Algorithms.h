@@ -2,7 +2,10 @@
 #define PV_ALGORITHMS_ALGORITHMS_H
 
 #include "pv/DataFile.h"
+#include "pv/Ledger.h"
+#include "pv/PriceIndex.h"
 #include <optional>
+#include <vector>
 #include "pv/Integer64.h"
 
 namespace pv {
@@ -14,7 +17,7 @@ i64 sharesHeld(DataFile& dataFile, i64 security, i64 date);
 
 i64 sharesHeld(DataFile& dataFile, i64 security, i64 account, i64 date);
 
-i64 sharesSold(DataFile& dataFile, i64 security, i64 account);
+i64 sharesSold(DataFile& dataFile, i64 security, i64 date);
 
 i64 sharesSold(DataFile& dataFile, i64 security, i64 account, i64 date);
 
@@ -56,6 +59,61 @@ std::optional<i64> marketValue(DataFile& dataFile, i64 security, i64 date);
 
 std::optional<i64> marketValue(DataFile& dataFile, i64 security, i64 account, i64 date);
 
+// The overloads below calculate the same things from a ledger, without any SQL. The ones with an account only include
+// the transactions of that account. Functions that need share prices aren't included, since the ledger doesn't have
+// them.
+
+i64 cashBalance(Ledger& ledger, i64 account, i64 date);
+
+i64 sharesHeld(Ledger& ledger, i64 security, i64 date);
+
+i64 sharesHeld(Ledger& ledger, i64 security, i64 account, i64 date);
+
+i64 sharesSold(Ledger& ledger, i64 security, i64 date);
+
+i64 sharesSold(Ledger& ledger, i64 security, i64 account, i64 date);
+
+i64 cashGained(Ledger& ledger, i64 security, i64 date);
+
+i64 cashGained(Ledger& ledger, i64 security, i64 account, i64 date);
+
+i64 dividendIncome(Ledger& ledger, i64 security, i64 date);
+
+i64 dividendIncome(Ledger& ledger, i64 security, i64 account, i64 date);
+
+i64 interestIncome(Ledger& ledger, i64 security, i64 date);
+
+i64 interestIncome(Ledger& ledger, i64 security, i64 account, i64 date);
+
+i64 costBasis(Ledger& ledger, i64 security, i64 date);
+
+i64 costBasis(Ledger& ledger, i64 security, i64 account, i64 date);
+
+std::optional<i64> averageBuyPrice(Ledger& ledger, i64 security, i64 date);
+
+std::optional<i64> averageBuyPrice(Ledger& ledger, i64 security, i64 account, i64 date);
+
+std::optional<i64> averageSellPrice(Ledger& ledger, i64 security, i64 date);
+
+std::optional<i64> averageSellPrice(Ledger& ledger, i64 security, i64 account, i64 date);
+
+// These return the value on each of \c dates (which may be in any order), with a single pass over the transactions
+// and a binary search per date, instead of summing the transactions again for every date.
+
+/// \brief Returns the sum of the cash balances of every account on each of \c dates.
+std::vector<i64> cashBalances(Ledger& ledger, const std::vector<i64>& dates);
+
+std::vector<i64> cashBalances(Ledger& ledger, i64 account, const std::vector<i64>& dates);
+
+std::vector<i64> sharesHeld(Ledger& ledger, i64 security, const std::vector<i64>& dates);
+
+/// \brief Returns the most recent price of \c security on or before \c date from a price index, without any SQL (see
+/// \c PriceIndex::prices() for many securities and dates at once).
+std::optional<i64> sharePrice(PriceIndex& prices, i64 security, i64 date);
+
+/// \brief Returns the market value of \c security on \c date from a ledger and a price index of the same data file.
+std::optional<i64> marketValue(Ledger& ledger, PriceIndex& prices, i64 security, i64 date);
+
 } // namespace algorithms
 } // namespace pv
 
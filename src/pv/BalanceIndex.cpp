@@ -0,0 +1,168 @@
+#include "BalanceIndex.h"
+#include <algorithm>
+#include <limits>
+
+namespace pv {
+
+namespace {
+
+// The range of dates covered by a RunningBalance. Dates outside of this range are clamped to it.
+constexpr i64 lowestDate = std::numeric_limits<std::int32_t>::min();
+constexpr i64 highestDate = std::numeric_limits<std::int32_t>::max();
+
+constexpr int maximumDepth = 34; // 32 levels for a 2^32 date range, plus the leaf and some room
+
+i64 clampDate(i64 date) noexcept { return std::clamp(date, lowestDate, highestDate); }
+
+i64 midpoint(i64 low, i64 high) noexcept { return low + (high - low) / 2; }
+
+} // namespace
+
+void RunningBalance::add(i64 date, i64 delta) {
+  date = clampDate(date);
+  if (nodes.empty()) {
+    nodes.emplace_back();
+  }
+
+  std::int32_t path[maximumDepth];
+  int depth = 0;
+
+  std::int32_t node = 0;
+  i64 low = lowestDate;
+  i64 high = highestDate;
+
+  // Walk down to the leaf for date, creating nodes as needed
+  while (true) {
+    path[depth++] = node;
+    if (low == high) {
+      break;
+    }
+
+    i64 mid = midpoint(low, high);
+    bool right = date > mid;
+    std::int32_t child = right ? nodes[node].right : nodes[node].left;
+    if (child < 0) {
+      child = static_cast<std::int32_t>(nodes.size());
+      nodes.emplace_back(); // Don't hold references to nodes across this, it may reallocate
+      (right ? nodes[node].right : nodes[node].left) = child;
+    }
+    node = child;
+    if (right) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  nodes[node].sum += delta;
+  nodes[node].minimum = nodes[node].sum;
+
+  // Walk back up, recalculating the aggregates
+  for (int i = depth - 2; i >= 0; --i) {
+    Node& parent = nodes[path[i]];
+    Aggregate left = parent.left < 0 ? Aggregate{0, 0} : Aggregate{nodes[parent.left].sum, nodes[parent.left].minimum};
+    Aggregate right =
+        parent.right < 0 ? Aggregate{0, 0} : Aggregate{nodes[parent.right].sum, nodes[parent.right].minimum};
+    parent.sum = left.sum + right.sum;
+    parent.minimum = std::min(left.minimum, left.sum + right.minimum);
+  }
+}
+
+RunningBalance::Aggregate RunningBalance::aggregateFrom(std::int32_t node, i64 low, i64 high,
+                                                        i64 date) const noexcept {
+  if (node < 0) {
+    return {0, 0};
+  }
+  const Node& n = nodes[node];
+  if (date <= low) {
+    return {n.sum, n.minimum};
+  }
+
+  i64 mid = midpoint(low, high);
+  if (date > mid) {
+    return aggregateFrom(n.right, mid + 1, high, date);
+  }
+
+  Aggregate left = aggregateFrom(n.left, low, mid, date);
+  Aggregate right = n.right < 0 ? Aggregate{0, 0} : Aggregate{nodes[n.right].sum, nodes[n.right].minimum};
+  return {left.sum + right.sum, std::min(left.minimum, left.sum + right.minimum)};
+}
+
+i64 RunningBalance::balance(i64 date) const noexcept {
+  if (nodes.empty()) {
+    return 0;
+  }
+  date = clampDate(date);
+  i64 total = nodes[0].sum;
+  if (date == highestDate) {
+    return total;
+  }
+  return total - aggregateFrom(0, lowestDate, highestDate, date + 1).sum;
+}
+
+i64 RunningBalance::minimumFrom(i64 date) const noexcept {
+  if (nodes.empty()) {
+    return 0;
+  }
+  Aggregate from = aggregateFrom(0, lowestDate, highestDate, clampDate(date));
+  i64 before = nodes[0].sum - from.sum;
+  return before + from.minimum;
+}
+
+void BalanceIndex::addCash(i64 account, i64 date, i64 delta) { cash_[account].add(date, delta); }
+
+void BalanceIndex::addShares(i64 security, i64 account, i64 date, i64 delta) {
+  shares_[{security, account}].add(date, delta);
+}
+
+void BalanceIndex::apply(const BalanceChange& change, int sign) {
+  if (change.cash != 0) {
+    addCash(change.account, change.date, sign * change.cash);
+    journal.push_back({std::nullopt, change.account, change.date, sign * change.cash});
+  }
+  if (change.security.has_value() && change.shares != 0) {
+    addShares(*change.security, change.account, change.date, sign * change.shares);
+    journal.push_back({change.security, change.account, change.date, sign * change.shares});
+  }
+}
+
+bool BalanceIndex::cashNegativeFrom(i64 account, i64 date) const noexcept {
+  auto iter = cash_.find(account);
+  return iter != cash_.cend() && iter->second.minimumFrom(date) < 0;
+}
+
+bool BalanceIndex::sharesNegativeFrom(i64 security, i64 account, i64 date) const noexcept {
+  auto iter = shares_.find({security, account});
+  return iter != shares_.cend() && iter->second.minimumFrom(date) < 0;
+}
+
+i64 BalanceIndex::cashBalance(i64 account, i64 date) const noexcept {
+  auto iter = cash_.find(account);
+  return iter == cash_.cend() ? 0 : iter->second.balance(date);
+}
+
+i64 BalanceIndex::sharesHeld(i64 security, i64 account, i64 date) const noexcept {
+  auto iter = shares_.find({security, account});
+  return iter == shares_.cend() ? 0 : iter->second.balance(date);
+}
+
+void BalanceIndex::rollback(std::size_t mark) noexcept {
+  // Undo in reverse order. Every entry refers to a date that already has a node, so this never allocates.
+  while (journal.size() > mark) {
+    const JournalEntry& entry = journal.back();
+    if (entry.security.has_value()) {
+      addShares(*entry.security, entry.account, entry.date, -entry.delta);
+    } else {
+      addCash(entry.account, entry.date, -entry.delta);
+    }
+    journal.pop_back();
+  }
+}
+
+void BalanceIndex::clear() noexcept {
+  cash_.clear();
+  shares_.clear();
+  journal.clear();
+}
+
+} // namespace pv
@@ -0,0 +1,112 @@
+#ifndef PV_BALANCEINDEX_H
+#define PV_BALANCEINDEX_H
+
+#include "Integer64.h"
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pv {
+
+/// \internal
+/// \brief A running balance over time, built from changes (deltas) that occur on specific dates.
+///
+/// The balance on a date is the sum of all deltas on or before that date. Internally, this is a
+/// sparse segment tree over the range of possible dates, so updates and queries take O(log D) time
+/// (where D is the size of the date range), and memory is only used for dates that have deltas.
+class RunningBalance {
+private:
+  struct Node {
+    i64 sum = 0;
+    /// The lowest running balance (relative to the start of this node's range) within this node's range
+    i64 minimum = 0;
+    std::int32_t left = -1;
+    std::int32_t right = -1;
+  };
+
+  std::vector<Node> nodes;
+
+  struct Aggregate {
+    i64 sum;
+    i64 minimum;
+  };
+
+  Aggregate aggregateFrom(std::int32_t node, i64 low, i64 high, i64 date) const noexcept;
+public:
+  void add(i64 date, i64 delta);
+
+  /// \brief Returns the balance on \c date (inclusive).
+  i64 balance(i64 date) const noexcept;
+
+  /// \brief Returns the lowest balance on any date on or after \c date.
+  i64 minimumFrom(i64 date) const noexcept;
+
+  bool empty() const noexcept { return nodes.empty(); }
+};
+
+/// \internal
+/// \brief The effect that a single transaction has on cash and shares balances.
+struct BalanceChange {
+  i64 account;
+  i64 date;
+  std::optional<i64> security;
+  i64 cash;
+  i64 shares;
+};
+
+/// \internal
+/// \brief Maintains the running cash balance of each account and the running number of shares held
+/// for each (security, account) pair, so that \c DataFile can check for negative balances without
+/// re-aggregating the whole ledger.
+///
+/// Every change is recorded in a journal, so that changes can be undone when a savepoint is rolled back.
+class BalanceIndex {
+private:
+  std::unordered_map<i64, RunningBalance> cash_;
+  std::map<std::pair<i64, i64>, RunningBalance> shares_;
+  //       ^ security, account
+
+  struct JournalEntry {
+    std::optional<i64> security; // If this has a value, this entry is for shares, otherwise it is for cash
+    i64 account;
+    i64 date;
+    i64 delta;
+  };
+
+  std::vector<JournalEntry> journal;
+
+  void addCash(i64 account, i64 date, i64 delta);
+  void addShares(i64 security, i64 account, i64 date, i64 delta);
+public:
+  /// \brief Applies \c change to the balances. Use a negative \c sign to remove the change.
+  void apply(const BalanceChange& change, int sign = 1);
+
+  /// \brief Checks if the cash balance of \c account is negative on any date on or after \c date.
+  bool cashNegativeFrom(i64 account, i64 date) const noexcept;
+
+  /// \brief Checks if the number of shares of \c security held in \c account is negative on any date on or after
+  /// \c date.
+  bool sharesNegativeFrom(i64 security, i64 account, i64 date) const noexcept;
+
+  i64 cashBalance(i64 account, i64 date) const noexcept;
+  i64 sharesHeld(i64 security, i64 account, i64 date) const noexcept;
+
+  /// \brief Returns a position in the journal which can later be passed to \c rollback().
+  std::size_t mark() const noexcept { return journal.size(); }
+
+  /// \brief Undoes every change made since \c mark was obtained.
+  void rollback(std::size_t mark) noexcept;
+
+  /// \brief Forgets the journal, making every change so far permanent.
+  void commit() noexcept { journal.clear(); }
+
+  void clear() noexcept;
+};
+
+} // namespace pv
+
+#endif // PV_BALANCEINDEX_H
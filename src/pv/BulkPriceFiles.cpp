@@ -0,0 +1,327 @@
+#include "BulkPriceFiles.h"
+#include "PriceCsvParser.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+/// \internal A file mapped into memory, read-only. On Windows it is read into memory instead.
+class MappedFile {
+private:
+#ifdef _WIN32
+  std::string contents;
+#else
+  void* address = nullptr;
+#endif
+  std::string_view view_;
+  bool open_ = false;
+public:
+  explicit MappedFile(const std::filesystem::path& path) {
+#ifdef _WIN32
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      return;
+    }
+    contents.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    view_ = contents;
+    open_ = true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return;
+    }
+    struct stat info;
+    if (::fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+      auto size = static_cast<std::size_t>(info.st_size);
+      if (size == 0) {
+        open_ = true; // mmap() can't map nothing
+      } else if (void* mapped = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0); mapped != MAP_FAILED) {
+        ::madvise(mapped, size, MADV_SEQUENTIAL);
+        address = mapped;
+        view_ = std::string_view(static_cast<const char*>(mapped), size);
+        open_ = true;
+      }
+    }
+    ::close(fd); // The mapping stays valid without it
+#endif
+  }
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (address != nullptr) {
+      ::munmap(address, view_.size());
+    }
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  bool isOpen() const noexcept { return open_; }
+  std::string_view view() const noexcept { return view_; }
+};
+
+unsigned int resolveJobs(unsigned int jobs) {
+  return jobs != 0 ? jobs : std::max(1u, std::thread::hardware_concurrency());
+}
+
+/// \internal Calls \c function with each index below \c count, on up to \c jobs threads (including this one).
+template <typename Function> void parallelFor(std::size_t count, unsigned int jobs, Function function) {
+  std::atomic<std::size_t> next{0};
+  auto worker = [&] {
+    for (std::size_t i = next++; i < count; i = next++) {
+      function(i);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (std::size_t i = 1; i < std::min<std::size_t>(jobs, count); ++i) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : workers) {
+    thread.join();
+  }
+}
+
+/// \internal Returns the first line of \c text, and removes it from \c text.
+std::string_view takeLine(std::string_view& text) {
+  auto newline = text.find('\n');
+  auto line = text.substr(0, newline);
+  text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+  if (!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+  return line;
+}
+
+/// \internal Splits a header line into its column names, without surrounding spaces or quotes.
+std::vector<std::string_view> splitHeader(std::string_view header) {
+  std::vector<std::string_view> names;
+  while (true) {
+    auto comma = header.find(',');
+    auto name = header.substr(0, comma);
+    while (!name.empty() && (name.front() == ' ' || name.front() == '"')) {
+      name.remove_prefix(1);
+    }
+    while (!name.empty() && (name.back() == ' ' || name.back() == '"')) {
+      name.remove_suffix(1);
+    }
+    names.push_back(name);
+    if (comma == std::string_view::npos) {
+      return names;
+    }
+    header.remove_prefix(comma + 1);
+  }
+}
+
+bool equalsIgnoringCase(std::string_view lhs, std::string_view rhs) {
+  return lhs.size() == rhs.size() && std::equal(lhs.cbegin(), lhs.cend(), rhs.cbegin(), [](char l, char r) {
+           return std::tolower(static_cast<unsigned char>(l)) == std::tolower(static_cast<unsigned char>(r));
+         });
+}
+
+std::optional<std::size_t> findColumn(const std::vector<std::string_view>& names, std::string_view name) {
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    if (equalsIgnoringCase(names[i], name)) {
+      return i;
+    }
+  }
+  return std::nullopt;
+}
+
+/// \internal Checks that \c symbol names a file in the directory, rather than somewhere else.
+bool validFileName(const std::string& symbol) {
+  return !symbol.empty() && symbol != "." && symbol != ".." && symbol.find_first_of("/\\") == std::string::npos;
+}
+
+void keepRange(pv::PriceHistory& history, pv::i64 begin, pv::i64 end) {
+  history.eraseFrom(end);
+  history.eraseBefore(begin);
+}
+
+std::optional<pv::PriceHistory> parseSymbolFile(const std::filesystem::path& path) {
+  MappedFile file(path);
+  if (!file.isOpen()) {
+    return std::nullopt;
+  }
+  auto text = file.view();
+  auto header = text;
+  auto names = splitHeader(takeLine(header));
+  auto dateColumn = findColumn(names, "Date").value_or(0);
+  auto priceColumn = findColumn(names, "Close").value_or(findColumn(names, "Price").value_or(names.size() - 1));
+
+  pv::PriceCsvParser parser(dateColumn, priceColumn, 1);
+  parser.feed(text);
+  return parser.finish();
+}
+
+/// \internal Parses the lines of a wide file, appending the price in each column with a slot to that slot's history.
+void parseWideLines(std::string_view text, const std::vector<int>& slotOfColumn, std::size_t lastColumn,
+                    std::vector<pv::PriceHistory>& histories) {
+  while (!text.empty()) {
+    auto line = takeLine(text);
+    auto comma = line.find(',');
+    auto date = pv::parseCsvDate(line.substr(0, comma));
+    if (!date || comma == std::string_view::npos) {
+      continue;
+    }
+    line.remove_prefix(comma + 1);
+    for (std::size_t column = 1; column <= lastColumn; ++column) {
+      comma = line.find(',');
+      auto field = line.substr(0, comma);
+      auto slot = slotOfColumn[column];
+      if (slot >= 0 && !field.empty()) {
+        if (auto price = pv::parseCsvPrice(field)) {
+          histories[static_cast<std::size_t>(slot)].dates.push_back(*date);
+          histories[static_cast<std::size_t>(slot)].prices.push_back(*price);
+        }
+      }
+      if (comma == std::string_view::npos) {
+        break;
+      }
+      line.remove_prefix(comma + 1);
+    }
+  }
+}
+
+/// \internal Splits \c text into about \c parts ranges of whole lines.
+std::vector<std::string_view> splitLines(std::string_view text, std::size_t parts) {
+  std::vector<std::string_view> ranges;
+  std::size_t start = 0;
+  for (std::size_t part = 1; part <= parts && start < text.size(); ++part) {
+    auto cut = text.size();
+    if (part < parts) {
+      cut = text.find('\n', std::max(start, text.size() / parts * part));
+      cut = cut == std::string_view::npos ? text.size() : cut + 1;
+    }
+    ranges.push_back(text.substr(start, cut - start));
+    start = cut;
+  }
+  return ranges;
+}
+
+// Smaller ranges than this aren't worth a thread
+constexpr std::size_t minimumRangeSize = 64 * 1024;
+
+} // namespace
+
+namespace pv {
+
+PriceDirectoryProvider::PriceDirectoryProvider(std::filesystem::path directory, unsigned int jobs)
+    : directory(std::move(directory)), jobs(resolveJobs(jobs)) {}
+
+std::vector<std::optional<PriceHistory>> PriceDirectoryProvider::prices(const std::vector<PriceQuery>& queries) {
+  trace::Span span("PriceDirectoryProvider::prices", "prices");
+  std::vector<std::optional<PriceHistory>> results(queries.size());
+  parallelFor(queries.size(), jobs, [&](std::size_t i) {
+    const auto& query = queries[i];
+    if (!validFileName(query.symbol)) {
+      return;
+    }
+    results[i] = parseSymbolFile(directory / (query.symbol + ".csv"));
+    if (results[i].has_value()) {
+      keepRange(*results[i], query.begin, query.end);
+    }
+  });
+  return results;
+}
+
+WidePriceFileProvider::WidePriceFileProvider(std::filesystem::path file, unsigned int jobs)
+    : file(std::move(file)), jobs(resolveJobs(jobs)) {}
+
+std::vector<std::optional<PriceHistory>> WidePriceFileProvider::prices(const std::vector<PriceQuery>& queries) {
+  trace::Span span("WidePriceFileProvider::prices", "prices");
+  std::vector<std::optional<PriceHistory>> results(queries.size());
+  MappedFile mapped(file);
+  if (!mapped.isOpen()) {
+    return results;
+  }
+  auto body = mapped.view();
+  auto names = splitHeader(takeLine(body));
+
+  // Each symbol asked for gets a slot, which only its column is parsed into
+  std::unordered_map<std::string_view, std::size_t> columns;
+  for (std::size_t column = 1; column < names.size(); ++column) {
+    columns.emplace(names[column], column);
+  }
+  std::vector<int> slotOfColumn(names.size(), -1);
+  std::vector<int> slotOfQuery(queries.size(), -1);
+  int slots = 0;
+  std::size_t lastColumn = 0;
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    auto column = columns.find(queries[i].symbol);
+    if (column == columns.end()) {
+      continue;
+    }
+    if (slotOfColumn[column->second] < 0) {
+      slotOfColumn[column->second] = slots++;
+      lastColumn = std::max(lastColumn, column->second);
+    }
+    slotOfQuery[i] = slotOfColumn[column->second];
+  }
+  if (slots == 0) {
+    return results;
+  }
+
+  auto ranges = splitLines(body, std::min<std::size_t>(jobs, body.size() / minimumRangeSize + 1));
+  std::vector<std::vector<PriceHistory>> rangeHistories(ranges.size(),
+                                                        std::vector<PriceHistory>(static_cast<std::size_t>(slots)));
+  parallelFor(ranges.size(), jobs,
+              [&](std::size_t i) { parseWideLines(ranges[i], slotOfColumn, lastColumn, rangeHistories[i]); });
+
+  std::vector<PriceHistory> histories(static_cast<std::size_t>(slots));
+  parallelFor(histories.size(), jobs, [&](std::size_t slot) {
+    auto& history = histories[slot];
+    std::size_t size = 0;
+    for (const auto& range : rangeHistories) {
+      size += range[slot].size();
+    }
+    history.dates.reserve(size);
+    history.prices.reserve(size);
+    for (auto& range : rangeHistories) {
+      history.dates.insert(history.dates.end(), range[slot].dates.cbegin(), range[slot].dates.cend());
+      history.prices.insert(history.prices.end(), range[slot].prices.cbegin(), range[slot].prices.cend());
+      range[slot] = PriceHistory();
+    }
+    history.sort();
+  });
+
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    if (slotOfQuery[i] >= 0) {
+      results[i] = histories[static_cast<std::size_t>(slotOfQuery[i])];
+      keepRange(*results[i], queries[i].begin, queries[i].end);
+    }
+  }
+  return results;
+}
+
+std::unique_ptr<PriceProvider> openPriceFiles(const std::filesystem::path& path, unsigned int jobs) {
+  std::error_code error;
+  if (std::filesystem::is_directory(path, error)) {
+    return std::make_unique<PriceDirectoryProvider>(path, jobs);
+  }
+  if (std::filesystem::is_regular_file(path, error)) {
+    return std::make_unique<WidePriceFileProvider>(path, jobs);
+  }
+  return nullptr;
+}
+
+} // namespace pv
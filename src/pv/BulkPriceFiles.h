@@ -0,0 +1,53 @@
+#ifndef PV_BULKPRICEFILES_H
+#define PV_BULKPRICEFILES_H
+
+#include "PriceProvider.h"
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace pv {
+
+/// \brief Provides prices from a directory with a CSV file of each symbol's prices, named after the symbol (such as
+/// \c AAPL.csv), like a directory of Yahoo Finance's downloads.
+///
+/// The header of each file names its columns. Dates are read from the \c Date column, and prices from the \c Close
+/// column, or the \c Price column, or otherwise the last one. Files are memory-mapped and parsed in place, a file per
+/// thread.
+class PriceDirectoryProvider : public PriceProvider {
+private:
+  std::filesystem::path directory;
+  unsigned int jobs;
+public:
+  /// \param jobs the number of files to parse at once (0 for the number of cores)
+  explicit PriceDirectoryProvider(std::filesystem::path directory, unsigned int jobs = 0);
+
+  std::vector<std::optional<PriceHistory>> prices(const std::vector<PriceQuery>& queries) override;
+};
+
+/// \brief Provides prices from a single CSV file with a column of dates followed by a column for each symbol, named
+/// by the header, such as a dump of a market data database. Prices that are missing may be left empty.
+///
+/// The file is memory-mapped and split into ranges of lines that are parsed in parallel, only reading the columns
+/// of the symbols asked for. It is read again by each call to \c prices(), so it can be replaced between calls, and
+/// \c importPrices() asks for every symbol in one call.
+class WidePriceFileProvider : public PriceProvider {
+private:
+  std::filesystem::path file;
+  unsigned int jobs;
+public:
+  /// \param jobs the number of threads to parse with (0 for the number of cores)
+  explicit WidePriceFileProvider(std::filesystem::path file, unsigned int jobs = 0);
+
+  std::vector<std::optional<PriceHistory>> prices(const std::vector<PriceQuery>& queries) override;
+  bool readsEverything() const noexcept override { return true; }
+};
+
+/// \brief Returns a \c PriceDirectoryProvider if \c path is a directory, or a \c WidePriceFileProvider if it is a
+/// file, or \c nullptr if it is neither.
+std::unique_ptr<PriceProvider> openPriceFiles(const std::filesystem::path& path, unsigned int jobs = 0);
+
+} // namespace pv
+
+#endif // PV_BULKPRICEFILES_H
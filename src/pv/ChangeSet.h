@@ -0,0 +1,37 @@
+#ifndef PV_CHANGESET_H
+#define PV_CHANGESET_H
+
+#include "Integer64.h"
+#include <limits>
+#include <set>
+#include <utility>
+
+namespace pv {
+
+/// \brief Everything that was modified by a single committed SQL transaction.
+///
+/// \c DataFile collects these while a transaction is open and emits them once the outermost transaction
+/// (or savepoint) commits. Changes that are rolled back are never emitted.
+///
+/// A removed security is only listed in \c securities, even though its prices are removed too.
+struct ChangeSet {
+  std::set<i64> accounts;
+  std::set<i64> transactions;
+  std::set<i64> securities;
+  std::set<std::pair<i64, i64>> securityPrices;
+  //                 ^ security, date
+
+  bool empty() const noexcept {
+    return accounts.empty() && transactions.empty() && securities.empty() && securityPrices.empty();
+  }
+
+  /// \brief Checks if any price of \c security was added, changed, or removed.
+  bool hasSecurityPrices(i64 security) const noexcept {
+    auto iter = securityPrices.lower_bound({security, std::numeric_limits<i64>::min()});
+    return iter != securityPrices.cend() && iter->first == security;
+  }
+};
+
+} // namespace pv
+
+#endif // PV_CHANGESET_H
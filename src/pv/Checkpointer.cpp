@@ -0,0 +1,77 @@
+#include "Checkpointer.h"
+#include "Trace.h"
+#include <sqlite3.h>
+#include <utility>
+
+namespace pv {
+
+Checkpointer::Checkpointer(std::string location, int pages)
+    : location(std::move(location)), pages(pages), thread([this] { run(); }) {}
+
+Checkpointer::~Checkpointer() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  condition.notify_all();
+  thread.join();
+}
+
+void Checkpointer::committed(int logPages) {
+  if (logPages < pages) {
+    return;
+  }
+  std::unique_lock lock(mutex);
+  requested = true;
+  condition.notify_all();
+  if (logPages >= 4 * pages) {
+    trace::Span span("Checkpointer::wait", "datafile");
+    auto checkpoint = started + 1;
+    condition.wait(lock, [&] { return checkpoints_ >= checkpoint || stopping; });
+  }
+}
+
+std::uint64_t Checkpointer::checkpoints() {
+  std::lock_guard lock(mutex);
+  return checkpoints_;
+}
+
+void Checkpointer::run() {
+  trace::setThreadName("Checkpointer");
+  // Opened on the first checkpoint, so that opening a data file doesn't have to wait for it
+  sqlite3* db = nullptr;
+  std::unique_lock lock(mutex);
+  while (true) {
+    condition.wait(lock, [this] { return requested || stopping; });
+    if (stopping) {
+      break;
+    }
+    requested = false;
+    ++started;
+    lock.unlock();
+
+    {
+      trace::Span span("Checkpointer::checkpoint", "datafile");
+      if (db == nullptr) {
+        // A connection only finds out that the file uses write-ahead logging once it reads it, and until then its
+        // checkpoints do nothing
+        if (sqlite3_open_v2(location.c_str(), &db, SQLITE_OPEN_READWRITE, nullptr) != SQLITE_OK ||
+            sqlite3_exec(db, "SELECT COUNT(*) FROM sqlite_master", nullptr, nullptr, nullptr) != SQLITE_OK) {
+          sqlite3_close_v2(db);
+          db = nullptr;
+        }
+      }
+      if (db != nullptr) {
+        sqlite3_wal_checkpoint_v2(db, nullptr, SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr);
+      }
+    }
+
+    lock.lock();
+    ++checkpoints_;
+    condition.notify_all();
+  }
+  lock.unlock();
+  sqlite3_close_v2(db);
+}
+
+} // namespace pv
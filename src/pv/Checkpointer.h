@@ -0,0 +1,57 @@
+#ifndef PV_CHECKPOINTER_H
+#define PV_CHECKPOINTER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace pv {
+
+/// \brief Copies a data file's write-ahead log back into the file (a checkpoint) on a background thread.
+///
+/// SQLite normally checkpoints during the commit that makes the log long enough, so every so often a commit takes
+/// much longer than the rest. A data file with background checkpoints turned on (see \c DataFileOptions) tells its
+/// checkpointer about each commit instead, and the checkpointer checkpoints from its own connection once the log
+/// reaches \c pages pages. Checkpoints are passive, so they never block the data file's connections; pages that are
+/// still being read are left for a later checkpoint. Only a connection that commits faster than the checkpointer can
+/// keep up waits for it (see \c committed()).
+class Checkpointer {
+private:
+  std::string location;
+  int pages;
+
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool requested = false;
+  bool stopping = false;
+  std::uint64_t started = 0;
+  std::uint64_t checkpoints_ = 0;
+
+  std::thread thread;
+
+  void run();
+public:
+  Checkpointer(std::string location, int pages);
+  ~Checkpointer();
+
+  Checkpointer(const Checkpointer&) = delete;
+  Checkpointer& operator=(const Checkpointer&) = delete;
+
+  /// \brief Tells the checkpointer that a commit left \c logPages pages in the log. This doesn't wait for the
+  /// checkpoint, unless the log has grown to several times \c pages pages anyway.
+  ///
+  /// The log only starts over from the beginning when a commit finds it completely checkpointed, which never happens
+  /// while commits keep coming faster than the checkpoints. Once the log is that long, the committing connection
+  /// waits for a checkpoint that starts after its commit, which checkpoints the whole log unless it is being read.
+  /// (The connection can't checkpoint the log itself, since the checkpointer's checkpoint keeps it locked.)
+  void committed(int logPages);
+
+  /// \brief Returns the number of checkpoints run so far.
+  std::uint64_t checkpoints();
+};
+
+} // namespace pv
+
+#endif // PV_CHECKPOINTER_H
@@ -0,0 +1,175 @@
+#include "DailyValuations.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstddef>
+#include <sqlite3.h>
+#include <unordered_map>
+
+namespace {
+
+// Nothing is held and there is no cash before the first transaction, so there is nothing to store either
+const char* firstTransactionDateQuery = "SELECT MIN(Date) FROM Transactions";
+
+const char* dailyValuationsSecuritiesQuery = "SELECT Id FROM Securities ORDER BY Id";
+
+const char* dailyValuationsAccountsQuery = "SELECT Id FROM Accounts";
+
+const char* storedValuationsQuery =
+    "SELECT SecurityId, SharesHeld, MarketValue, CostBasis FROM DailyValuations WHERE Date = ?";
+
+const char* storedCashBalanceQuery = "SELECT CashBalance FROM DailyCashBalances WHERE Date = ?";
+
+std::vector<pv::i64> readIds(pv::DataFile& dataFile, const char* query) {
+  std::vector<pv::i64> ids;
+  auto* stmt = dataFile.cachedQuery(query);
+  if (stmt != nullptr) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      ids.push_back(sqlite3_column_int64(stmt, 0));
+    }
+    sqlite3_reset(stmt);
+  }
+  return ids;
+}
+
+/// \internal Keeps everything read while it exists in a single SQL transaction, so that the state of the daily
+/// valuations matches the rest of the data, even if another connection commits in between.
+class ReadTransaction {
+private:
+  pv::DataFile& dataFile;
+  bool open;
+public:
+  explicit ReadTransaction(pv::DataFile& dataFile)
+      : dataFile(dataFile), open(!dataFile.hasTransaction() && dataFile.beginTransaction() == pv::ResultCode::Ok) {}
+
+  ReadTransaction(const ReadTransaction&) = delete;
+  ReadTransaction& operator=(const ReadTransaction&) = delete;
+
+  ~ReadTransaction() {
+    if (open) {
+      dataFile.commitTransaction();
+    }
+  }
+};
+
+} // namespace
+
+namespace pv {
+namespace algorithms {
+
+std::optional<DailyValuationsRepair> calculateDailyValuationsRepair(DataFile& dataFile, i64 through) {
+  trace::Span span("calculateDailyValuationsRepair", "algorithms");
+  ReadTransaction transaction(dataFile);
+
+  DailyValuationsRepair repair;
+  repair.state = dataFile.dailyValuationsState();
+  repair.through = through;
+  if (repair.state.validThrough.has_value() && *repair.state.validThrough >= through) {
+    return std::nullopt;
+  }
+
+  std::optional<i64> from;
+  auto* stmt = dataFile.cachedQuery(firstTransactionDateQuery);
+  if (stmt == nullptr) {
+    return std::nullopt;
+  }
+  if (sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+    from = sqlite3_column_int64(stmt, 0);
+  }
+  sqlite3_reset(stmt);
+  if (!from.has_value()) {
+    return repair; // No transactions, so every day is empty
+  }
+  if (repair.state.validThrough.has_value()) {
+    from = std::max(*from, *repair.state.validThrough + 1);
+  }
+
+  std::vector<i64> dates;
+  for (i64 date = *from; date <= through; ++date) {
+    dates.push_back(date);
+  }
+  auto series = timeSeries(dataFile, readIds(dataFile, dailyValuationsSecuritiesQuery),
+                           readIds(dataFile, dailyValuationsAccountsQuery), std::move(dates));
+
+  // Stored by date, then security, which is the order of the table's primary key
+  for (std::size_t i = 0; i < series.dates.size(); ++i) {
+    for (const auto& security : series.securities) {
+      if (security.sharesHeld[i] != 0) {
+        repair.valuations.push_back({series.dates[i], security.security, security.sharesHeld[i],
+                                     security.marketValue[i], security.costBasis[i]});
+      }
+    }
+    if (series.cashBalance[i] != 0) {
+      repair.cashBalances.emplace_back(series.dates[i], series.cashBalance[i]);
+    }
+  }
+  return repair;
+}
+
+ResultCode storeDailyValuationsRepair(DataFile& dataFile, const DailyValuationsRepair& repair) {
+  trace::Span span("storeDailyValuationsRepair", "algorithms");
+  return dataFile.storeDailyValuations(repair.state, repair.through, repair.valuations, repair.cashBalances);
+}
+
+ResultCode repairDailyValuations(DataFile& dataFile, i64 through) {
+  auto repair = calculateDailyValuationsRepair(dataFile, through);
+  return repair.has_value() ? storeDailyValuationsRepair(dataFile, *repair) : ResultCode::Ok;
+}
+
+std::optional<TimeSeries> storedTimeSeries(DataFile& dataFile, const std::vector<i64>& securities,
+                                           std::vector<i64> dates) {
+  trace::Span span("storedTimeSeries", "algorithms");
+  ReadTransaction transaction(dataFile);
+
+  std::sort(dates.begin(), dates.end());
+  dates.erase(std::unique(dates.begin(), dates.end()), dates.end());
+  auto validThrough = dataFile.dailyValuationsState().validThrough;
+  if (!dates.empty() && (!validThrough.has_value() || dates.back() > *validThrough)) {
+    return std::nullopt;
+  }
+
+  TimeSeries result;
+  result.dates = std::move(dates);
+  const std::size_t dateCount = result.dates.size();
+
+  result.cashBalance.assign(dateCount, 0);
+  result.securities.reserve(securities.size());
+  std::unordered_map<i64, std::size_t> securityIndices;
+  for (auto security : securities) {
+    if (securityIndices.try_emplace(security, result.securities.size()).second) {
+      result.securities.push_back(
+          {security, std::vector<i64>(dateCount, 0), std::vector<i64>(dateCount, 0), std::vector<i64>(dateCount, 0)});
+    }
+  }
+
+  auto* valuationsStmt = dataFile.cachedQuery(storedValuationsQuery);
+  auto* cashStmt = dataFile.cachedQuery(storedCashBalanceQuery);
+  if (valuationsStmt == nullptr || cashStmt == nullptr) {
+    return std::nullopt;
+  }
+
+  // Missing rows are days where nothing was held, or the cash balance was 0
+  for (std::size_t i = 0; i < dateCount; ++i) {
+    sqlite3_bind_int64(valuationsStmt, 1, static_cast<sqlite3_int64>(result.dates[i]));
+    while (sqlite3_step(valuationsStmt) == SQLITE_ROW) {
+      auto iter = securityIndices.find(sqlite3_column_int64(valuationsStmt, 0));
+      if (iter != securityIndices.cend()) {
+        auto& security = result.securities[iter->second];
+        security.sharesHeld[i] = sqlite3_column_int64(valuationsStmt, 1);
+        security.marketValue[i] = sqlite3_column_int64(valuationsStmt, 2);
+        security.costBasis[i] = sqlite3_column_int64(valuationsStmt, 3);
+      }
+    }
+    sqlite3_reset(valuationsStmt);
+
+    sqlite3_bind_int64(cashStmt, 1, static_cast<sqlite3_int64>(result.dates[i]));
+    if (sqlite3_step(cashStmt) == SQLITE_ROW) {
+      result.cashBalance[i] = sqlite3_column_int64(cashStmt, 0);
+    }
+    sqlite3_reset(cashStmt);
+  }
+
+  return result;
+}
+
+} // namespace algorithms
+} // namespace pv
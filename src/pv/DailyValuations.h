@@ -0,0 +1,55 @@
+#ifndef PV_ALGORITHMS_DAILYVALUATIONS_H
+#define PV_ALGORITHMS_DAILYVALUATIONS_H
+
+#include "pv/DataFile.h"
+#include "pv/Integer64.h"
+#include "pv/TimeSeries.h"
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace pv {
+namespace algorithms {
+
+/// \brief Daily valuations calculated by \c calculateDailyValuationsRepair(), ready to be stored with
+/// \c storeDailyValuationsRepair().
+struct DailyValuationsRepair {
+  /// \brief The state of the daily valuations when the repair was calculated.
+  DailyValuationsState state;
+  /// \brief The last date that was calculated.
+  i64 through = 0;
+  /// \brief The holdings of each day after \c state.validThrough, by date, then security.
+  std::vector<DailyValuation> valuations;
+  /// \brief (date, cash balance) pairs for each day after \c state.validThrough with a non-zero cash balance.
+  std::vector<std::pair<i64, i64>> cashBalances;
+};
+
+/// \brief Calculates the daily valuations that are out of date, up to and including \c through.
+///
+/// Only the days after \c DataFile::dailyValuationsState() are calculated (and none before the first transaction),
+/// so after modifying a recent transaction or price this is much less work than starting over. Since this only
+/// reads from \c dataFile, it may be called on a read-only connection, with the result stored on the main one.
+///
+/// \returns \c std::nullopt if the daily valuations are already up to date through \c through
+std::optional<DailyValuationsRepair> calculateDailyValuationsRepair(DataFile& dataFile, i64 through);
+
+/// \brief Stores a repair calculated by \c calculateDailyValuationsRepair() (see \c DataFile::storeDailyValuations()).
+///
+/// \returns \c ResultCode::Outdated if \c dataFile was modified after the repair was calculated, in which case it
+/// should be calculated again
+ResultCode storeDailyValuationsRepair(DataFile& dataFile, const DailyValuationsRepair& repair);
+
+/// \brief Calculates and stores the daily valuations that are out of date, up to and including \c through.
+ResultCode repairDailyValuations(DataFile& dataFile, i64 through);
+
+/// \brief Reads a \c TimeSeries for \c securities and every account from the stored daily valuations, the same as
+/// calling \c timeSeries() with every account.
+///
+/// \returns \c std::nullopt if the daily valuations aren't up to date for every one of \c dates
+std::optional<TimeSeries> storedTimeSeries(DataFile& dataFile, const std::vector<i64>& securities,
+                                           std::vector<i64> dates);
+
+} // namespace algorithms
+} // namespace pv
+
+#endif // PV_ALGORITHMS_DAILYVALUATIONS_H
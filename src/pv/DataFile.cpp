@@ -1,11 +1,17 @@
 #include "DataFile.h"
-#include "Transaction.h"
-#include "Algorithms.h"
+#include "Checkpointer.h"
 #include <optional>
 #include <sqlite3.h>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <map>
 #include <stdexcept>
 #include <string>
+#include <system_error>
+#include <utility>
 
 namespace pv {
 
@@ -16,7 +22,7 @@ StatementPointer createStatementPointer(sqlite3_stmt* stmt) { return StatementPo
 constexpr char initializationSQL[] = R"(
 PRAGMA foreign_keys = ON;
 PRAGMA application_id = 1347831366;
-PRAGMA user_version = 3;
+PRAGMA user_version = 4;
 
 CREATE TABLE IF NOT EXISTS Accounts(
   Id INTEGER NOT NULL PRIMARY KEY,
@@ -124,12 +130,102 @@ CREATE TABLE IF NOT EXISTS InterestTransactions(
 );
 
 CREATE INDEX IF NOT EXISTS TransactionsIndex ON Transactions(Date, AccountId);
+CREATE INDEX IF NOT EXISTS TransactionsAccountIndex ON Transactions(AccountId, Date);
 CREATE INDEX IF NOT EXISTS BuyTransactionsSecurityIndex ON BuyTransactions(SecurityId);
 CREATE INDEX IF NOT EXISTS SellTransactionsSecurityIndex ON SellTransactions(SecurityId);
 CREATE INDEX IF NOT EXISTS DepositTransactionsSecurityIndex ON DepositTransactions(SecurityId);
 CREATE INDEX IF NOT EXISTS WithdrawTransactionsSecurityIndex ON WithdrawTransactions(SecurityId);
 CREATE INDEX IF NOT EXISTS DividendTransactionsSecurityIndex ON DividendTransactions(SecurityId);
 CREATE INDEX IF NOT EXISTS InterestTransactionsSecurityIndex ON InterestTransactions(SecurityId);
+
+-- The holdings and cash balance at the end of every day, calculated from the tables above and stored by
+-- DataFile::storeDailyValuations(). Rows are only kept for securities that are held and for non-zero cash balances.
+-- These tables are WITHOUT ROWID so that the update hook doesn't mistake them for transactions.
+CREATE TABLE IF NOT EXISTS DailyValuations(
+  Date INTEGER NOT NULL,
+  SecurityId INTEGER NOT NULL,
+  SharesHeld INTEGER NOT NULL,
+  MarketValue INTEGER NOT NULL,
+  CostBasis INTEGER NOT NULL,
+
+  FOREIGN KEY(SecurityId) REFERENCES Securities(Id) ON DELETE CASCADE,
+  PRIMARY KEY(Date, SecurityId)
+) WITHOUT ROWID;
+
+CREATE TABLE IF NOT EXISTS DailyCashBalances(
+  Date INTEGER NOT NULL PRIMARY KEY,
+  CashBalance INTEGER NOT NULL
+) WITHOUT ROWID;
+
+-- ValidThrough is the last date whose daily valuations are up to date (NULL if none are), and Generation changes
+-- whenever a modification lowers it
+CREATE TABLE IF NOT EXISTS DailyValuationsState(
+  Id INTEGER NOT NULL PRIMARY KEY,
+  ValidThrough INTEGER,
+  Generation INTEGER NOT NULL,
+
+  CHECK(Id = 0)
+) WITHOUT ROWID;
+
+INSERT OR IGNORE INTO DailyValuationsState(Id, ValidThrough, Generation) VALUES (0, NULL, 0);
+
+-- When each security's prices were last downloaded: Through is the last date requested, and At is when (in seconds
+-- since 1970-01-01 UTC), so that refreshing prices only downloads the ones that are missing. Like the tables above,
+-- it is WITHOUT ROWID so that the update hook doesn't mistake it for transactions.
+CREATE TABLE IF NOT EXISTS SecurityPriceFetches(
+  SecurityId INTEGER NOT NULL PRIMARY KEY,
+  Through INTEGER NOT NULL,
+  At INTEGER NOT NULL,
+
+  FOREIGN KEY(SecurityId) REFERENCES Securities(Id) ON DELETE CASCADE
+) WITHOUT ROWID;
+
+-- Modifying a transaction or a price invalidates the daily valuations from its date onwards. MIN() is NULL if any
+-- argument is, so nothing becomes valid here.
+CREATE TRIGGER IF NOT EXISTS TransactionsInsertTrigger AFTER INSERT ON Transactions BEGIN
+  UPDATE DailyValuationsState SET ValidThrough = MIN(ValidThrough, NEW.Date - 1), Generation = Generation + 1;
+END;
+CREATE TRIGGER IF NOT EXISTS TransactionsUpdateTrigger AFTER UPDATE ON Transactions BEGIN
+  UPDATE DailyValuationsState SET ValidThrough = MIN(ValidThrough, OLD.Date - 1, NEW.Date - 1),
+    Generation = Generation + 1;
+END;
+CREATE TRIGGER IF NOT EXISTS TransactionsDeleteTrigger AFTER DELETE ON Transactions BEGIN
+  UPDATE DailyValuationsState SET ValidThrough = MIN(ValidThrough, OLD.Date - 1), Generation = Generation + 1;
+END;
+
+-- Rows of the action-specific tables are inserted and deleted along with their transaction, so only updates matter
+-- (and interest isn't part of the cash balance, so it has no trigger)
+CREATE TRIGGER IF NOT EXISTS BuyTransactionsUpdateTrigger AFTER UPDATE ON BuyTransactions BEGIN
+  UPDATE DailyValuationsState SET ValidThrough = MIN(ValidThrough,
+    (SELECT Date FROM Transactions WHERE Id = NEW.TransactionId) - 1), Generation = Generation + 1;
+END;
+CREATE TRIGGER IF NOT EXISTS SellTransactionsUpdateTrigger AFTER UPDATE ON SellTransactions BEGIN
+  UPDATE DailyValuationsState SET ValidThrough = MIN(ValidThrough,
+    (SELECT Date FROM Transactions WHERE Id = NEW.TransactionId) - 1), Generation = Generation + 1;
+END;
+CREATE TRIGGER IF NOT EXISTS DepositTransactionsUpdateTrigger AFTER UPDATE ON DepositTransactions BEGIN
+  UPDATE DailyValuationsState SET ValidThrough = MIN(ValidThrough,
+    (SELECT Date FROM Transactions WHERE Id = NEW.TransactionId) - 1), Generation = Generation + 1;
+END;
+CREATE TRIGGER IF NOT EXISTS WithdrawTransactionsUpdateTrigger AFTER UPDATE ON WithdrawTransactions BEGIN
+  UPDATE DailyValuationsState SET ValidThrough = MIN(ValidThrough,
+    (SELECT Date FROM Transactions WHERE Id = NEW.TransactionId) - 1), Generation = Generation + 1;
+END;
+CREATE TRIGGER IF NOT EXISTS DividendTransactionsUpdateTrigger AFTER UPDATE ON DividendTransactions BEGIN
+  UPDATE DailyValuationsState SET ValidThrough = MIN(ValidThrough,
+    (SELECT Date FROM Transactions WHERE Id = NEW.TransactionId) - 1), Generation = Generation + 1;
+END;
+
+CREATE TRIGGER IF NOT EXISTS SecurityPricesInsertTrigger AFTER INSERT ON SecurityPrices BEGIN
+  UPDATE DailyValuationsState SET ValidThrough = MIN(ValidThrough, NEW.Date - 1), Generation = Generation + 1;
+END;
+CREATE TRIGGER IF NOT EXISTS SecurityPricesUpdateTrigger AFTER UPDATE ON SecurityPrices BEGIN
+  UPDATE DailyValuationsState SET ValidThrough = MIN(ValidThrough, OLD.Date - 1, NEW.Date - 1),
+    Generation = Generation + 1;
+END;
+CREATE TRIGGER IF NOT EXISTS SecurityPricesDeleteTrigger AFTER DELETE ON SecurityPrices BEGIN
+  UPDATE DailyValuationsState SET ValidThrough = MIN(ValidThrough, OLD.Date - 1), Generation = Generation + 1;
+END;
 )";
 
 /// \internal Maps and SQLite result code to it's pv::ResultCode equivalant.
@@ -138,29 +234,173 @@ ResultCode dataBaseResult(int code) {
     ResultCode::Ok : ResultCode::DbError;
 }
 
-ResultCode validityCheck(pv::DataFile& dataFile, i64 account, i64 startDate, std::optional<i64> security1 = std::nullopt, std::optional<i64> security2 = std::nullopt) {
-  sqlite3_stmt* stmt;
-  stmt = dataFile.cachedQuery("SELECT Date FROM Transactions WHERE AccountId = ? AND Date >= ?");
-  sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(account));
-  sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(startDate));
-  while (sqlite3_step(stmt) == SQLITE_ROW) {
-    pv::i64 date = sqlite3_column_int64(stmt, 0);
-    if (algorithms::cashBalance(dataFile, account, date) < 0) {
-      return ResultCode::NegativeCashBalance;
-    }
-    if (security1 && algorithms::sharesHeld(dataFile, *security1, date) < 0) {
-      return ResultCode::NegativeSharesHeld;
-    }
-    if (security2 && algorithms::sharesHeld(dataFile, *security2, date) < 0) {
-      return ResultCode::NegativeSharesHeld;
+// The balance change queries select the account, date, security (for buys and sells), change in the number of
+// shares held, and change in the cash balance of transactions. The cash balance is calculated the same way as
+// algorithms::cashBalance().
+
+const char* balanceChangesQuery = R"(
+SELECT Transactions.AccountId, Transactions.Date, COALESCE(BuyTransactions.SecurityId, SellTransactions.SecurityId),
+  COALESCE(BuyTransactions.NumberOfShares, 0) - COALESCE(SellTransactions.NumberOfShares, 0),
+  -COALESCE(BuyTransactions.Amount, 0) + COALESCE(SellTransactions.Amount, 0)
+  + COALESCE(DepositTransactions.Amount, 0) - COALESCE(WithdrawTransactions.Amount, 0)
+  + COALESCE(DividendTransactions.Amount, 0)
+FROM Transactions
+  LEFT JOIN BuyTransactions ON Transactions.Id = BuyTransactions.TransactionId
+  LEFT JOIN SellTransactions ON Transactions.Id = SellTransactions.TransactionId
+  LEFT JOIN DepositTransactions ON Transactions.Id = DepositTransactions.TransactionId
+  LEFT JOIN WithdrawTransactions ON Transactions.Id = WithdrawTransactions.TransactionId
+  LEFT JOIN DividendTransactions ON Transactions.Id = DividendTransactions.TransactionId
+)";
+
+const char* balanceChangeQuery = R"(
+SELECT Transactions.AccountId, Transactions.Date, COALESCE(BuyTransactions.SecurityId, SellTransactions.SecurityId),
+  COALESCE(BuyTransactions.NumberOfShares, 0) - COALESCE(SellTransactions.NumberOfShares, 0),
+  -COALESCE(BuyTransactions.Amount, 0) + COALESCE(SellTransactions.Amount, 0)
+  + COALESCE(DepositTransactions.Amount, 0) - COALESCE(WithdrawTransactions.Amount, 0)
+  + COALESCE(DividendTransactions.Amount, 0)
+FROM Transactions
+  LEFT JOIN BuyTransactions ON Transactions.Id = BuyTransactions.TransactionId
+  LEFT JOIN SellTransactions ON Transactions.Id = SellTransactions.TransactionId
+  LEFT JOIN DepositTransactions ON Transactions.Id = DepositTransactions.TransactionId
+  LEFT JOIN WithdrawTransactions ON Transactions.Id = WithdrawTransactions.TransactionId
+  LEFT JOIN DividendTransactions ON Transactions.Id = DividendTransactions.TransactionId
+WHERE Transactions.Id = ?
+)";
+
+const char* transactionSubjectsQuery = R"(
+SELECT Transactions.AccountId,
+  COALESCE(BuyTransactions.SecurityId, SellTransactions.SecurityId, DepositTransactions.SecurityId,
+    WithdrawTransactions.SecurityId, DividendTransactions.SecurityId, InterestTransactions.SecurityId)
+FROM Transactions
+  LEFT JOIN BuyTransactions ON Transactions.Id = BuyTransactions.TransactionId
+  LEFT JOIN SellTransactions ON Transactions.Id = SellTransactions.TransactionId
+  LEFT JOIN DepositTransactions ON Transactions.Id = DepositTransactions.TransactionId
+  LEFT JOIN WithdrawTransactions ON Transactions.Id = WithdrawTransactions.TransactionId
+  LEFT JOIN DividendTransactions ON Transactions.Id = DividendTransactions.TransactionId
+  LEFT JOIN InterestTransactions ON Transactions.Id = InterestTransactions.TransactionId
+WHERE Transactions.Id = ?
+)";
+
+const char* setPriceFetchQuery =
+    "INSERT INTO SecurityPriceFetches(SecurityId, Through, At) VALUES (?, ?, ?) ON CONFLICT DO UPDATE SET "
+    "Through = excluded.Through, At = excluded.At";
+
+BalanceChange readBalanceChange(sqlite3_stmt* stmt) {
+  BalanceChange change;
+  change.account = sqlite3_column_int64(stmt, 0);
+  change.date = sqlite3_column_int64(stmt, 1);
+  if (sqlite3_column_type(stmt, 2) != SQLITE_NULL) {
+    change.security = sqlite3_column_int64(stmt, 2);
+  }
+  change.shares = sqlite3_column_int64(stmt, 3);
+  change.cash = sqlite3_column_int64(stmt, 4);
+  return change;
+}
+
+/// \internal Calculates the balance change of a transaction that has not been inserted yet.
+/// This must agree with the balance change queries.
+BalanceChange recordBalanceChange(const TransactionRecord& record) {
+  BalanceChange change{record.account, record.date, std::nullopt, 0, 0};
+  switch (record.action) {
+  case Action::BUY:
+    change.security = record.security;
+    change.shares = record.numberOfShares;
+    change.cash = -(record.numberOfShares * record.sharePrice + record.commission);
+    break;
+  case Action::SELL:
+    change.security = record.security;
+    change.shares = -record.numberOfShares;
+    change.cash = record.numberOfShares * record.sharePrice - record.commission;
+    break;
+  case Action::DEPOSIT:
+  case Action::DIVIDEND:
+    change.cash = record.amount;
+    break;
+  case Action::WITHDRAW:
+    change.cash = -record.amount;
+    break;
+  case Action::INTEREST:
+    break;
+  }
+  return change;
+}
+
+/// \internal A change of \c delta to a balance on \c date.
+struct BalanceEvent {
+  i64 date;
+  i64 delta;
+};
+
+/// \internal Checks if taking away \c removed and putting in \c added lowers a balance on any date.
+///
+/// \returns the earliest date of the two events if the balance is lowered, \c std::nullopt otherwise
+std::optional<i64> lowersBalanceFrom(std::optional<BalanceEvent> removed, std::optional<BalanceEvent> added) {
+  if (removed.has_value()) {
+    removed->delta = -removed->delta;
+  }
+  if (!removed.has_value()) {
+    std::swap(removed, added);
+  }
+  if (!removed.has_value()) {
+    return std::nullopt;
+  }
+
+  BalanceEvent first = *removed;
+  if (added.has_value()) {
+    if (added->date == first.date) {
+      first.delta += added->delta;
+      added.reset();
+    } else if (added->date < first.date) {
+      std::swap(first, *added);
     }
   }
-  return ResultCode::Ok;
+
+  if (first.delta < 0 || (added.has_value() && first.delta + added->delta < 0)) {
+    return first.date;
+  }
+  return std::nullopt;
+}
+
+/// \internal The PRAGMA statements that apply \c options to a connection, except for the journal mode.
+std::string configurationSQL(const DataFileOptions& options) {
+  constexpr const char* synchronous[] = {"OFF", "NORMAL", "FULL"};
+  constexpr const char* tempStore[] = {"DEFAULT", "FILE", "MEMORY"};
+  return std::string("PRAGMA synchronous = ") + synchronous[static_cast<int>(options.synchronous)] +
+         ";\nPRAGMA cache_size = " + std::to_string(-options.cacheSize) + // Negative sizes are in KiB
+         ";\nPRAGMA mmap_size = " + std::to_string(options.mmapSize) +
+         ";\nPRAGMA temp_store = " + tempStore[static_cast<int>(options.tempStore)] + ";";
+}
+
+/// \internal Checks if a connection is using write-ahead logging.
+bool walEnabled(sqlite3* db) {
+  sqlite3_stmt* stmt = nullptr;
+  sqlite3_prepare_v2(db, "PRAGMA journal_mode", -1, &stmt, nullptr);
+  bool wal = stmt != nullptr && sqlite3_step(stmt) == SQLITE_ROW &&
+             std::strcmp(reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0)), "wal") == 0;
+  sqlite3_finalize(stmt);
+  return wal;
+}
+
+/// \internal Attaches the quote cache at \c location as the \c QuoteCache schema, if it is one.
+void attachQuoteCache(sqlite3* db, const std::string& location) {
+  // Attaching a file that doesn't exist would create it
+  std::error_code error;
+  if (!std::filesystem::is_regular_file(location, error)) {
+    return;
+  }
+  sqlite3_stmt* stmt = nullptr;
+  sqlite3_prepare_v2(db, "ATTACH DATABASE ? AS QuoteCache", -1, &stmt, nullptr);
+  sqlite3_bind_text(stmt, 1, location.c_str(), static_cast<int>(location.size()), SQLITE_STATIC);
+  bool attached = stmt != nullptr && sqlite3_step(stmt) == SQLITE_DONE;
+  sqlite3_finalize(stmt);
+  if (attached && sqlite3_exec(db, "SELECT 1 FROM QuoteCache.Quotes LIMIT 0", nullptr, nullptr, nullptr) != SQLITE_OK) {
+    sqlite3_exec(db, "DETACH DATABASE QuoteCache", nullptr, nullptr, nullptr);
+  }
 }
 
 } // namespace
 
-DataFile::DataFile(std::string location, int flags) {
+DataFile::DataFile(std::string location, int flags, DataFileOptions options) : options_(std::move(options)) {
   if (flags == -1) {
     flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
   }
@@ -171,13 +411,36 @@ DataFile::DataFile(std::string location, int flags) {
                              std::to_string((static_cast<int>(result))));
   }
 
-  result = sqlite3_exec(db, initializationSQL, nullptr, nullptr, nullptr);
+  // These only affect performance, so failing to apply them isn't worth failing to open the file over
+  sqlite3_busy_timeout(db, static_cast<int>(options_.busyTimeout.count()));
+  sqlite3_exec(db, configurationSQL(options_).c_str(), nullptr, nullptr, nullptr);
+
+  bool readOnly = (flags & SQLITE_OPEN_READONLY) != 0;
+  if (readOnly) {
+    // The schema can't be created (or the user version set) by a read-only connection, and the hooks are never
+    // called since nothing is modified
+    memo_.setEnabled(false); // Other connections' modifications don't touch its versions
+
+  } else {
+    if (filePath().has_value()) {
+      sqlite3_exec(db,
+                   options_.journalMode == DataFileOptions::JournalMode::Wal ? "PRAGMA journal_mode = WAL"
+                                                                             : "PRAGMA journal_mode = DELETE",
+                   nullptr, nullptr, nullptr);
+    }
+    result = sqlite3_exec(db, initializationSQL, nullptr, nullptr, nullptr);
+  }
 
   if (result != SQLITE_OK) {
     throw std::runtime_error(std::string("Failed to initialize DataFile: SQLite Error Code ") +
                              std::to_string((static_cast<int>(result))));
   }
 
+  // Like the configuration, the cache only saves work, so the file is opened without it if it can't be attached
+  if (!options_.quoteCache.empty()) {
+    attachQuoteCache(db, options_.quoteCache);
+  }
+
   //// Accounts & Securities
 
   stmt_addAccount = prepare("INSERT INTO Accounts(Name) VALUES(?)", SQLITE_PREPARE_PERSISTENT);
@@ -252,6 +515,28 @@ DataFile::DataFile(std::string location, int flags) {
                                   SQLITE_PREPARE_PERSISTENT);
   stmt_removeSecurityPrice =
       prepare("DELETE FROM SecurityPrices WHERE SecurityId = ? AND Date = ?", SQLITE_PREPARE_PERSISTENT);
+  // Existing prices are replaced if they're dated on or after the fourth parameter, and changed
+  stmt_upsertSecurityPrice = prepare("INSERT INTO SecurityPrices(SecurityId, Date, Price) VALUES (?1, ?2, ?3) ON "
+                                     "CONFLICT DO UPDATE SET Price = excluded.Price WHERE Date >= ?4 AND "
+                                     "Price != excluded.Price",
+                                     SQLITE_PREPARE_PERSISTENT);
+
+  //// Daily Valuations
+
+  stmt_dailyValuationsState =
+      prepare("SELECT ValidThrough, Generation FROM DailyValuationsState WHERE Id = 0", SQLITE_PREPARE_PERSISTENT);
+  stmt_setDailyValuationsValidThrough =
+      prepare("UPDATE DailyValuationsState SET ValidThrough = ? WHERE Id = 0", SQLITE_PREPARE_PERSISTENT);
+  // Deleting everything when nothing is valid needs the separate "IS NULL" case, since no date is greater than NULL
+  stmt_clearDailyValuations =
+      prepare("DELETE FROM DailyValuations WHERE ?1 IS NULL OR Date > ?1", SQLITE_PREPARE_PERSISTENT);
+  stmt_clearDailyCashBalances =
+      prepare("DELETE FROM DailyCashBalances WHERE ?1 IS NULL OR Date > ?1", SQLITE_PREPARE_PERSISTENT);
+  stmt_addDailyValuation = prepare("INSERT INTO DailyValuations(Date, SecurityId, SharesHeld, MarketValue, CostBasis) "
+                                   "VALUES (?, ?, ?, ?, ?)",
+                                   SQLITE_PREPARE_PERSISTENT);
+  stmt_addDailyCashBalance =
+      prepare("INSERT INTO DailyCashBalances(Date, CashBalance) VALUES (?, ?)", SQLITE_PREPARE_PERSISTENT);
 
   //// SQL Transactions and Savepoints
 
@@ -265,6 +550,14 @@ DataFile::DataFile(std::string location, int flags) {
   stmt_rollbackSavepoint = prepare("ROLLBACK TO PVSavepoint", SQLITE_PREPARE_PERSISTENT);
   stmt_releaseSavepoint = prepare("RELEASE PVSavepoint", SQLITE_PREPARE_PERSISTENT);
 
+  if (!readOnly && walEnabled(db)) {
+    if (options_.backgroundCheckpoints) {
+      checkpointer = std::make_unique<Checkpointer>(*filePath(), options_.checkpointPages);
+    } else {
+      sqlite3_wal_autocheckpoint(db, options_.checkpointPages);
+    }
+  }
+
   updateSQLiteHooks();
 }
 
@@ -279,6 +572,13 @@ DataFile& DataFile::operator=(DataFile&& other) noexcept {
 DataFile::~DataFile() noexcept {
   if (db == nullptr) return;
 
+  if (groupTransaction) {
+    // Without delivering the changes, since whatever would receive them may already be gone
+    sqlite3_step(stmt_commitTransaction);
+    sqlite3_reset(stmt_commitTransaction);
+  }
+  checkpointer.reset(); // Closing the last connection checkpoints the whole log, which is then removed
+
   // Close/finalize everything
 
   clearQueryCache();
@@ -310,6 +610,13 @@ DataFile::~DataFile() noexcept {
   sqlite3_finalize(stmt_removeTransaction);
   sqlite3_finalize(stmt_setSecurityPrice);
   sqlite3_finalize(stmt_removeSecurityPrice);
+  sqlite3_finalize(stmt_upsertSecurityPrice);
+  sqlite3_finalize(stmt_dailyValuationsState);
+  sqlite3_finalize(stmt_setDailyValuationsValidThrough);
+  sqlite3_finalize(stmt_clearDailyValuations);
+  sqlite3_finalize(stmt_clearDailyCashBalances);
+  sqlite3_finalize(stmt_addDailyValuation);
+  sqlite3_finalize(stmt_addDailyCashBalance);
   sqlite3_finalize(stmt_beginTransaction);
   sqlite3_finalize(stmt_rollbackTransaction);
   sqlite3_finalize(stmt_commitTransaction);
@@ -324,20 +631,45 @@ DataFile::~DataFile() noexcept {
 void swap(DataFile& lhs, DataFile& rhs) noexcept {
   using std::swap;
 
+  swap(lhs.options_, rhs.options_);
+  swap(lhs.checkpointer, rhs.checkpointer);
   swap(lhs.changedSignal, rhs.changedSignal);
+  swap(lhs.changeSetSignal, rhs.changeSetSignal);
   swap(lhs.accountAddedSignal, rhs.accountAddedSignal);
   swap(lhs.accountUpdatedSignal, rhs.accountUpdatedSignal);
   swap(lhs.accountRemovedSignal, rhs.accountRemovedSignal);
   swap(lhs.transactionAddedSignal, rhs.transactionAddedSignal);
   swap(lhs.transactionUpdatedSignal, rhs.transactionUpdatedSignal);
   swap(lhs.transactionRemovedSignal, rhs.transactionRemovedSignal);
+  swap(lhs.transactionsAddedSignal, rhs.transactionsAddedSignal);
   swap(lhs.securityAddedSignal, rhs.securityAddedSignal);
   swap(lhs.securityUpdatedSignal, rhs.securityUpdatedSignal);
   swap(lhs.securityRemovedSignal, rhs.securityRemovedSignal);
   swap(lhs.securityPriceUpdatedSignal, rhs.securityPriceUpdatedSignal);
   swap(lhs.securityPriceRemovedSignal, rhs.securityPriceRemovedSignal);
+  swap(lhs.securityPricesUpdatedSignal, rhs.securityPricesUpdatedSignal);
   swap(lhs.rollbackSignal, rhs.rollbackSignal);
   swap(lhs.suppressRollbackSignal, rhs.suppressRollbackSignal);
+  swap(lhs.pendingChanges, rhs.pendingChanges);
+  swap(lhs.changesCommitted, rhs.changesCommitted);
+  swap(lhs.balances, rhs.balances);
+  swap(lhs.balancesLoaded, rhs.balancesLoaded);
+  swap(lhs.savepointMarks, rhs.savepointMarks);
+  swap(lhs.groupCommit_, rhs.groupCommit_);
+  swap(lhs.groupTransaction, rhs.groupTransaction);
+  swap(lhs.groupStart, rhs.groupStart);
+  swap(lhs.lastWrite, rhs.lastWrite);
+  swap(lhs.flushPendingSignal, rhs.flushPendingSignal);
+  swap(lhs.countingStatements, rhs.countingStatements);
+  swap(lhs.statementCount_, rhs.statementCount_);
+  swap(lhs.profiler_, rhs.profiler_);
+  swap(lhs.modificationCounter, rhs.modificationCounter);
+  swap(lhs.globalVersion, rhs.globalVersion);
+  swap(lhs.securityVersions, rhs.securityVersions);
+  swap(lhs.accountVersions, rhs.accountVersions);
+  swap(lhs.memo_, rhs.memo_);
+  swap(lhs.profiledStatements, rhs.profiledStatements);
+  swap(lhs.profiledStatementIds, rhs.profiledStatementIds);
 
   swap(lhs.db, rhs.db);
   swap(lhs.queryCache, rhs.queryCache);
@@ -369,6 +701,13 @@ void swap(DataFile& lhs, DataFile& rhs) noexcept {
   swap(lhs.stmt_removeTransaction, rhs.stmt_removeTransaction);
   swap(lhs.stmt_setSecurityPrice, rhs.stmt_setSecurityPrice);
   swap(lhs.stmt_removeSecurityPrice, rhs.stmt_removeSecurityPrice);
+  swap(lhs.stmt_upsertSecurityPrice, rhs.stmt_upsertSecurityPrice);
+  swap(lhs.stmt_dailyValuationsState, rhs.stmt_dailyValuationsState);
+  swap(lhs.stmt_setDailyValuationsValidThrough, rhs.stmt_setDailyValuationsValidThrough);
+  swap(lhs.stmt_clearDailyValuations, rhs.stmt_clearDailyValuations);
+  swap(lhs.stmt_clearDailyCashBalances, rhs.stmt_clearDailyCashBalances);
+  swap(lhs.stmt_addDailyValuation, rhs.stmt_addDailyValuation);
+  swap(lhs.stmt_addDailyCashBalance, rhs.stmt_addDailyCashBalance);
   swap(lhs.stmt_beginTransaction, rhs.stmt_beginTransaction);
   swap(lhs.stmt_rollbackTransaction, rhs.stmt_rollbackTransaction);
   swap(lhs.stmt_commitTransaction, rhs.stmt_commitTransaction);
@@ -390,21 +729,156 @@ void DataFile::updateSQLiteHooks()
       db,
       [](void* dataFilePtr) {
         auto* dataFile = static_cast<DataFile*>(dataFilePtr);
-        dataFile->changedSignal();
         if (!dataFile->suppressRollbackSignal) {
+          // Everything since the last commit is gone, which may be more than the journal knows about
+          dataFile->invalidateBalances();
+          dataFile->touchEverything();
+          dataFile->groupTransaction = false; // SQLite rolls back by itself after some errors
+          dataFile->pendingChanges.clear();
+          dataFile->changesCommitted = false;
           dataFile->rollbackSignal();
         }
       },
       this);
 
+  sqlite3_commit_hook(
+      db,
+      [](void* dataFilePtr) {
+        static_cast<DataFile*>(dataFilePtr)->changesCommitted = true;
+        return 0; // Allow the commit
+      },
+      this);
+
+  if (checkpointer != nullptr) {
+    // This replaces SQLite's own checkpointing
+    sqlite3_wal_hook(
+        db,
+        [](void* checkpointerPtr, sqlite3*, const char*, int pages) {
+          static_cast<Checkpointer*>(checkpointerPtr)->committed(pages);
+          return SQLITE_OK;
+        },
+        checkpointer.get());
+  }
+
   sqlite3_update_hook(
       db,
-      [](void* dataFilePtr, int, const char*, const char*, sqlite3_int64) {
+      [](void* dataFilePtr, int, const char*, const char* table, sqlite3_int64 rowid) {
         auto* dataFile = static_cast<DataFile*>(dataFilePtr);
-        dataFile->changedSignal();
+
+        PendingChange::Kind kind;
+        if (std::strcmp(table, "Accounts") == 0) {
+          kind = PendingChange::Kind::Account;
+        } else if (std::strcmp(table, "Securities") == 0) {
+          kind = PendingChange::Kind::Security;
+        } else {
+          // Transactions, or one of the action-specific tables, whose rowid is the TransactionId
+          kind = PendingChange::Kind::Transaction;
+        }
+
+        try {
+          dataFile->pendingChanges.push_back({kind, static_cast<i64>(rowid), 0});
+        } catch (...) {
+          // Nothing sensible can be done from inside the hook
+        }
       },
       this
     );
+
+  unsigned int traceMask = (countingStatements ? SQLITE_TRACE_STMT : 0) |
+                           (profiler_ != nullptr ? SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW : 0);
+  if (traceMask == 0) {
+    sqlite3_trace_v2(db, 0, nullptr, nullptr);
+    return;
+  }
+  sqlite3_trace_v2(
+      db, traceMask,
+      [](unsigned int event, void* dataFilePtr, void* stmtPtr, void* detail) {
+        auto* dataFile = static_cast<DataFile*>(dataFilePtr);
+        auto* stmt = static_cast<sqlite3_stmt*>(stmtPtr);
+        try {
+          switch (event) {
+          case SQLITE_TRACE_STMT:
+            // Statements run by triggers are reported with their SQL starting with "--"
+            if (std::strncmp(static_cast<const char*>(detail), "--", 2) == 0) {
+              break;
+            }
+            if (dataFile->countingStatements) {
+              ++dataFile->statementCount_;
+            }
+            if (dataFile->profiler_ != nullptr) {
+              dataFile->profiledStatement(stmt).start = std::chrono::steady_clock::now();
+            }
+            break;
+          case SQLITE_TRACE_ROW:
+            ++dataFile->profiledStatement(stmt).rows;
+            break;
+          case SQLITE_TRACE_PROFILE: {
+            auto& profiled = dataFile->profiledStatement(stmt);
+            auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                                    profiled.start);
+            if (profiled.start == std::chrono::steady_clock::time_point()) {
+              // Started before profiling did
+              nanoseconds = std::chrono::nanoseconds(*static_cast<const sqlite3_int64*>(detail));
+            }
+            dataFile->profiler_->record(profiled.id, static_cast<std::uint64_t>(nanoseconds.count()), profiled.rows);
+            dataFile->profiledStatements.erase(stmt);
+            break;
+          }
+          default:
+            break;
+          }
+        } catch (...) {
+          // Nothing sensible can be done from inside the callback
+        }
+        return 0;
+      },
+      this);
+}
+
+DataFile::ProfiledStatement& DataFile::profiledStatement(sqlite3_stmt* stmt) {
+  if (auto iter = profiledStatements.find(stmt); iter != profiledStatements.end()) {
+    return iter->second;
+  }
+  const char* sql = sqlite3_sql(stmt);
+  std::string text = sql != nullptr ? sql : "";
+  auto id = profiledStatementIds.find(text);
+  if (id == profiledStatementIds.end()) {
+    id = profiledStatementIds.emplace(text, profiler_->statement(text.c_str())).first;
+  }
+  return profiledStatements.emplace(stmt, ProfiledStatement{id->second, 0, std::chrono::steady_clock::time_point()})
+      .first->second;
+}
+
+void DataFile::deliverChanges() {
+  commitGroupIfDue(); // Which delivers the changes itself
+  if (!changesCommitted) {
+    return;
+  }
+  changesCommitted = false;
+
+  ChangeSet changes;
+  for (const auto& change : pendingChanges) {
+    switch (change.kind) {
+    case PendingChange::Kind::Account:
+      changes.accounts.insert(change.id);
+      break;
+    case PendingChange::Kind::Transaction:
+      changes.transactions.insert(change.id);
+      break;
+    case PendingChange::Kind::Security:
+      changes.securities.insert(change.id);
+      break;
+    case PendingChange::Kind::SecurityPrice:
+      changes.securityPrices.insert({change.id, change.date});
+      break;
+    }
+  }
+  pendingChanges.clear();
+
+  if (!changes.empty()) {
+    changeSetSignal(changes);
+    changedSignal();
+  }
 }
 sqlite3_stmt* DataFile::prepare(std::string sql, int flags, ResultCode* outResult) noexcept {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
@@ -418,7 +892,9 @@ sqlite3_stmt* DataFile::prepare(std::string sql, int flags, ResultCode* outResul
   return stmt;
 }
 
-ResultCode DataFile::finishTransactionUpdate(ResultCode code, pv::i64 transaction) noexcept {
+ResultCode DataFile::finishTransactionUpdate(ResultCode code, pv::i64 transaction,
+                                             const std::optional<BalanceChange>& before) noexcept {
+  touchTransaction(transaction);
   if (code != ResultCode::Ok) {
     rollbackSavepoint();
     return code;
@@ -430,7 +906,12 @@ ResultCode DataFile::finishTransactionUpdate(ResultCode code, pv::i64 transactio
       rollbackSavepoint();
       return ResultCode::RecordNotFound;
     } else {
-      if ((code = validityCheck(*this, pv::transaction::account(*this, transaction), pv::transaction::date(*this, transaction))) == ResultCode::Ok) {
+      try {
+        code = updateBalances(before, balanceChange(transaction));
+      } catch (...) {
+        code = ResultCode::DbError;
+      }
+      if (code == ResultCode::Ok) {
         releaseSavepoint();
         transactionUpdatedSignal(transaction);
         return ResultCode::Ok;
@@ -442,12 +923,49 @@ ResultCode DataFile::finishTransactionUpdate(ResultCode code, pv::i64 transactio
   }
 }
 
+void DataFile::beginWrite() {
+  if (!groupCommit_.has_value()) {
+    return;
+  }
+  lastWrite = std::chrono::steady_clock::now();
+  if (sqlite3_get_autocommit(db) == 0) {
+    return; // The group transaction, or the user's, is already open
+  }
+  sqlite3_step(stmt_beginTransaction);
+  if (sqlite3_reset(stmt_beginTransaction) == SQLITE_OK) {
+    groupTransaction = true;
+    groupStart = lastWrite;
+    flushPendingSignal();
+  }
+}
+
+void DataFile::commitGroupIfDue() {
+  if (!groupTransaction || !savepointMarks.empty()) {
+    return; // Only between modifications
+  }
+  if (!groupCommit_.has_value() || pendingChanges.size() >= groupCommit_->maxChanges ||
+      std::chrono::steady_clock::now() - groupStart >= groupCommit_->window) {
+    flush();
+  }
+}
+
 ResultCode DataFile::beginSavepoint() {
+  beginWrite();
+  if (!balancesLoaded) {
+    loadBalances();
+  }
+  savepointMarks.push_back({balances.mark(), pendingChanges.size()});
+
   sqlite3_step(stmt_beginSavepoint);
   return dataBaseResult(sqlite3_reset(stmt_beginSavepoint));
 }
 
 ResultCode DataFile::rollbackSavepoint() {
+  if (!savepointMarks.empty()) {
+    balances.rollback(savepointMarks.back().balances);
+    pendingChanges.resize(std::min(pendingChanges.size(), savepointMarks.back().changes));
+  }
+
   suppressRollbackSignal = true;
   sqlite3_step(stmt_rollbackSavepoint);
   suppressRollbackSignal = false;
@@ -459,7 +977,158 @@ ResultCode DataFile::rollbackSavepoint() {
 
 ResultCode DataFile::releaseSavepoint() {
   sqlite3_step(stmt_releaseSavepoint);
-  return dataBaseResult(sqlite3_reset(stmt_releaseSavepoint));
+  auto result = dataBaseResult(sqlite3_reset(stmt_releaseSavepoint));
+
+  if (!savepointMarks.empty()) {
+    savepointMarks.pop_back();
+  }
+  if (savepointMarks.empty() && sqlite3_get_autocommit(db) != 0) {
+    // Releasing the outermost savepoint outside of a transaction commits it
+    balances.commit();
+  }
+  deliverChanges();
+  return result;
+}
+
+std::optional<BalanceChange> DataFile::balanceChange(i64 transaction) noexcept {
+  sqlite3_stmt* stmt = cachedQuery(balanceChangeQuery);
+  if (stmt == nullptr) {
+    return std::nullopt;
+  }
+  sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(transaction));
+
+  std::optional<BalanceChange> change;
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    change = readBalanceChange(stmt);
+  }
+  sqlite3_reset(stmt);
+  return change;
+}
+
+ResultCode DataFile::updateBalances(const std::optional<BalanceChange>& before,
+                                    const std::optional<BalanceChange>& after) {
+  if (!balancesLoaded) {
+    return ResultCode::DbError;
+  }
+  if (!before.has_value() && !after.has_value()) {
+    return ResultCode::Ok;
+  }
+
+  if (before.has_value()) {
+    balances.apply(*before, -1);
+  }
+  if (after.has_value()) {
+    balances.apply(*after);
+  }
+
+  // Cash (the account of a transaction never changes)
+  i64 account = before.has_value() ? before->account : after->account;
+  std::optional<BalanceEvent> cashRemoved, cashAdded;
+  if (before.has_value()) {
+    cashRemoved = BalanceEvent{before->date, before->cash};
+  }
+  if (after.has_value()) {
+    cashAdded = BalanceEvent{after->date, after->cash};
+  }
+  if (auto from = lowersBalanceFrom(cashRemoved, cashAdded); from && balances.cashNegativeFrom(account, *from)) {
+    return ResultCode::NegativeCashBalance;
+  }
+
+  // Shares held, for each (security, account) pair touched by the change
+  bool sharesBefore = before.has_value() && before->security.has_value();
+  bool sharesAfter = after.has_value() && after->security.has_value();
+  if (sharesBefore && sharesAfter && *before->security == *after->security) {
+    if (auto from = lowersBalanceFrom(BalanceEvent{before->date, before->shares},
+                                      BalanceEvent{after->date, after->shares});
+        from && balances.sharesNegativeFrom(*after->security, account, *from)) {
+      return ResultCode::NegativeSharesHeld;
+    }
+  } else {
+    if (sharesBefore) {
+      if (auto from = lowersBalanceFrom(BalanceEvent{before->date, before->shares}, std::nullopt);
+          from && balances.sharesNegativeFrom(*before->security, account, *from)) {
+        return ResultCode::NegativeSharesHeld;
+      }
+    }
+    if (sharesAfter) {
+      if (auto from = lowersBalanceFrom(std::nullopt, BalanceEvent{after->date, after->shares});
+          from && balances.sharesNegativeFrom(*after->security, account, *from)) {
+        return ResultCode::NegativeSharesHeld;
+      }
+    }
+  }
+
+  return ResultCode::Ok;
+}
+
+void DataFile::loadBalances() {
+  balances.clear();
+  balancesLoaded = false;
+
+  sqlite3_stmt* stmt = cachedQuery(balanceChangesQuery);
+  if (stmt == nullptr) {
+    return;
+  }
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    balances.apply(readBalanceChange(stmt));
+  }
+  balancesLoaded = sqlite3_reset(stmt) == SQLITE_OK;
+  balances.commit();
+}
+
+void DataFile::invalidateBalances() noexcept {
+  balances.clear();
+  balancesLoaded = false;
+}
+
+void DataFile::touchSecurity(i64 security) noexcept {
+  try {
+    securityVersions[security] = ++modificationCounter;
+  } catch (...) {
+    touchEverything();
+  }
+}
+
+void DataFile::touchAccount(i64 account) noexcept {
+  try {
+    accountVersions[account] = ++modificationCounter;
+  } catch (...) {
+    touchEverything();
+  }
+}
+
+void DataFile::touchTransaction(i64 transaction) noexcept {
+  sqlite3_stmt* stmt = cachedQuery(transactionSubjectsQuery);
+  if (stmt == nullptr) {
+    touchEverything();
+    return;
+  }
+  sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(transaction));
+  if (sqlite3_step(stmt) == SQLITE_ROW) {
+    touchAccount(sqlite3_column_int64(stmt, 0));
+    if (sqlite3_column_type(stmt, 1) != SQLITE_NULL) {
+      touchSecurity(sqlite3_column_int64(stmt, 1));
+    }
+  }
+  sqlite3_reset(stmt);
+}
+
+void DataFile::touchEverything() noexcept {
+  globalVersion = ++modificationCounter;
+  // Every version is now at most globalVersion, so they no longer need to be remembered
+  securityVersions.clear();
+  accountVersions.clear();
+  memo_.clear();
+}
+
+std::uint64_t DataFile::securityVersion(i64 security) const noexcept {
+  auto iter = securityVersions.find(security);
+  return iter != securityVersions.cend() ? std::max(iter->second, globalVersion) : globalVersion;
+}
+
+std::uint64_t DataFile::accountVersion(i64 account) const noexcept {
+  auto iter = accountVersions.find(account);
+  return iter != accountVersions.cend() ? std::max(iter->second, globalVersion) : globalVersion;
 }
 
 StatementPointer DataFile::query(std::string query) const noexcept {
@@ -498,12 +1167,14 @@ void DataFile::clearQueryCache() noexcept {
 
 ResultCode DataFile::addAccount(std::string name) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
+  beginWrite();
 
   sqlite3_bind_text(stmt_addAccount, 1, name.c_str(), static_cast<int>(name.length()), SQLITE_STATIC);
   auto result = dataBaseResult(sqlite3_step(stmt_addAccount));
   sqlite3_reset(stmt_addAccount);
   sqlite3_clear_bindings(stmt_addAccount);
 
+  deliverChanges();
   if (result == ResultCode::Ok) {
     accountAddedSignal(lastInsertedId());
   }
@@ -513,6 +1184,7 @@ ResultCode DataFile::addAccount(std::string name) {
 
 ResultCode DataFile::addSecurity(std::string symbol, std::string name, std::string assetClass, std::string sector) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
+  beginWrite();
 
   sqlite3_bind_text(stmt_addSecurity, 1, symbol.c_str(), static_cast<int>(symbol.length()), SQLITE_STATIC);
   sqlite3_bind_text(stmt_addSecurity, 2, name.c_str(), static_cast<int>(name.length()), SQLITE_STATIC);
@@ -524,6 +1196,7 @@ ResultCode DataFile::addSecurity(std::string symbol, std::string name, std::stri
   sqlite3_reset(stmt_addSecurity);
   sqlite3_clear_bindings(stmt_addSecurity);
 
+  deliverChanges();
   if (result == ResultCode::Ok) {
     securityAddedSignal(lastInsertedId());
   }
@@ -533,12 +1206,17 @@ ResultCode DataFile::addSecurity(std::string symbol, std::string name, std::stri
 
 ResultCode DataFile::removeAccount(i64 id) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
+  beginWrite();
+
+  touchEverything(); // Its transactions are removed too, whatever their securities
 
   sqlite3_bind_int64(stmt_removeAccount, 1, static_cast<sqlite3_int64>(id));
   sqlite3_step(stmt_removeAccount);
   auto result = dataBaseResult(sqlite3_reset(stmt_removeAccount));
 
+  deliverChanges();
   if (result == ResultCode::Ok) {
+    invalidateBalances(); // The account's transactions were removed by ON DELETE CASCADE
     accountRemovedSignal(id);
   }
 
@@ -547,11 +1225,15 @@ ResultCode DataFile::removeAccount(i64 id) {
 
 ResultCode DataFile::removeSecurity(i64 id) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
+  beginWrite();
+
+  touchSecurity(id);
 
   sqlite3_bind_int64(stmt_removeSecurity, 1, static_cast<sqlite3_int64>(id));
   sqlite3_step(stmt_removeSecurity);
   auto result = dataBaseResult(sqlite3_reset(stmt_removeSecurity));
 
+  deliverChanges();
   if (result == ResultCode::Ok) {
     securityRemovedSignal(id);
   }
@@ -560,11 +1242,13 @@ ResultCode DataFile::removeSecurity(i64 id) {
 }
 
 ResultCode DataFile::setAccountName(i64 id, std::string name) {
+  beginWrite();
   sqlite3_bind_text(stmt_setAccountName, 1, name.c_str(), static_cast<int>(name.length()), SQLITE_STATIC);
   sqlite3_bind_int64(stmt_setAccountName, 2, static_cast<sqlite3_int64>(id));
   sqlite3_step(stmt_setAccountName);
   sqlite3_clear_bindings(stmt_setAccountName); // Make sure that the char* binding is cleared
   auto result = dataBaseResult(sqlite3_reset(stmt_setAccountName));
+  deliverChanges();
   if (result == ResultCode::Ok) {
     accountUpdatedSignal(id);
   }
@@ -572,11 +1256,13 @@ ResultCode DataFile::setAccountName(i64 id, std::string name) {
 }
 
 ResultCode DataFile::setSecurityName(i64 id, std::string name) {
+  beginWrite();
   sqlite3_bind_text(stmt_setSecurityName, 1, name.c_str(), static_cast<int>(name.length()), SQLITE_STATIC);
   sqlite3_bind_int64(stmt_setSecurityName, 2, static_cast<sqlite3_int64>(id));
   sqlite3_step(stmt_setSecurityName);
   sqlite3_clear_bindings(stmt_setSecurityName); // Make sure that the char* binding is cleared
   auto result = dataBaseResult(sqlite3_reset(stmt_setSecurityName));
+  deliverChanges();
   if (result == ResultCode::Ok) {
     securityUpdatedSignal(id);
   }
@@ -584,11 +1270,13 @@ ResultCode DataFile::setSecurityName(i64 id, std::string name) {
 }
 
 ResultCode DataFile::setSecurityAssetClass(i64 id, std::string assetClass) {
+  beginWrite();
   sqlite3_bind_text(stmt_setSecurityAssetClass, 1, assetClass.c_str(), static_cast<int>(assetClass.length()), SQLITE_STATIC);
   sqlite3_bind_int64(stmt_setSecurityAssetClass, 2, static_cast<sqlite3_int64>(id));
   sqlite3_step(stmt_setSecurityAssetClass);
   sqlite3_clear_bindings(stmt_setSecurityAssetClass); // Make sure that the char* binding is cleared
   auto result = dataBaseResult(sqlite3_reset(stmt_setSecurityAssetClass));
+  deliverChanges();
   if (result == ResultCode::Ok) {
     securityUpdatedSignal(id);
   }
@@ -596,20 +1284,27 @@ ResultCode DataFile::setSecurityAssetClass(i64 id, std::string assetClass) {
 }
 
 ResultCode DataFile::setSecuritySector(i64 id, std::string sector) {
+  beginWrite();
   sqlite3_bind_text(stmt_setSecuritySector, 1, sector.c_str(), static_cast<int>(sector.length()), SQLITE_STATIC);
   sqlite3_bind_int64(stmt_setSecuritySector, 2, static_cast<sqlite3_int64>(id));
   sqlite3_step(stmt_setSecuritySector);
   sqlite3_clear_bindings(stmt_setSecuritySector); // Make sure that the char* binding is cleared
   auto result = dataBaseResult(sqlite3_reset(stmt_setSecuritySector));
+  deliverChanges();
   if (result == ResultCode::Ok) {
     securityUpdatedSignal(id);
   }
   return result;
 }
 
-ResultCode DataFile::addTransaction(i64 date, i64 account, Action action) noexcept {
+ResultCode DataFile::addTransaction(i64 date, i64 account, Action action, std::optional<i64> security) noexcept {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
+  touchAccount(account);
+  if (security.has_value()) {
+    touchSecurity(*security);
+  }
+
   sqlite3_bind_int64(stmt_addTransaction, 1, static_cast<sqlite3_int64>(account));
   sqlite3_bind_int64(stmt_addTransaction, 2, static_cast<sqlite3_int64>(date));
   sqlite3_bind_int(stmt_addTransaction, 3, static_cast<int>(action));
@@ -625,7 +1320,7 @@ ResultCode DataFile::addBuyTransaction(i64 account, i64 date, i64 security, i64
 
   beginSavepoint();
 
-  auto result = addTransaction(date, account, Action::BUY);
+  auto result = addTransaction(date, account, Action::BUY, security);
 
   if (result != ResultCode::Ok) {
     rollbackSavepoint();
@@ -642,7 +1337,7 @@ ResultCode DataFile::addBuyTransaction(i64 account, i64 date, i64 security, i64
   sqlite3_reset(stmt_addBuyTransaction);
 
   if (result == ResultCode::Ok) {
-    result = validityCheck(*this, account, date, security);
+    result = updateBalances(std::nullopt, balanceChange(lastInsertedId()));
   }
 
   if (result != ResultCode::Ok) {
@@ -661,7 +1356,7 @@ ResultCode DataFile::addSellTransaction(i64 account, i64 date, i64 security, i64
 
   beginSavepoint();
 
-  auto result = addTransaction(date, account, Action::SELL);
+  auto result = addTransaction(date, account, Action::SELL, security);
 
   if (result != ResultCode::Ok) {
     rollbackSavepoint();
@@ -678,7 +1373,7 @@ ResultCode DataFile::addSellTransaction(i64 account, i64 date, i64 security, i64
   sqlite3_reset(stmt_addSellTransaction);
 
   if (result == pv::ResultCode::Ok) {
-    result = validityCheck(*this, account, date);
+    result = updateBalances(std::nullopt, balanceChange(lastInsertedId()));
   }
 
   if (result != ResultCode::Ok) {
@@ -696,7 +1391,7 @@ ResultCode DataFile::addDepositTransaction(i64 account, i64 date, std::optional<
 
   beginSavepoint();
 
-  auto result = addTransaction(date, account, Action::DEPOSIT);
+  auto result = addTransaction(date, account, Action::DEPOSIT, security);
 
   if (result != ResultCode::Ok) {
     rollbackSavepoint();
@@ -714,7 +1409,10 @@ ResultCode DataFile::addDepositTransaction(i64 account, i64 date, std::optional<
   result = dataBaseResult(sqlite3_step(stmt_addDepositTransaction));
   sqlite3_reset(stmt_addDepositTransaction);
 
-  // No need to validityCheck, deposit is always successful
+  // Deposits and dividends never lower a balance, so this only updates the balance index
+  if (result == ResultCode::Ok) {
+    result = updateBalances(std::nullopt, balanceChange(lastInsertedId()));
+  }
 
   if (result != ResultCode::Ok) {
     rollbackSavepoint();
@@ -731,7 +1429,7 @@ ResultCode DataFile::addWithdrawTransaction(i64 account, i64 date, std::optional
 
   beginSavepoint();
 
-  auto result = addTransaction(date, account, Action::WITHDRAW);
+  auto result = addTransaction(date, account, Action::WITHDRAW, security);
 
   if (result != ResultCode::Ok) {
     rollbackSavepoint();
@@ -750,7 +1448,7 @@ ResultCode DataFile::addWithdrawTransaction(i64 account, i64 date, std::optional
   sqlite3_reset(stmt_addWithdrawTransaction);
 
   if (result == pv::ResultCode::Ok) {
-    result = validityCheck(*this, account, date);
+    result = updateBalances(std::nullopt, balanceChange(lastInsertedId()));
   }
 
   if (result != ResultCode::Ok) {
@@ -768,7 +1466,7 @@ ResultCode DataFile::addDividendTransaction(i64 account, i64 date, i64 security,
 
   beginSavepoint();
 
-  auto result = addTransaction(date, account, Action::DIVIDEND);
+  auto result = addTransaction(date, account, Action::DIVIDEND, security);
 
   if (result != ResultCode::Ok) {
     releaseSavepoint();
@@ -781,7 +1479,10 @@ ResultCode DataFile::addDividendTransaction(i64 account, i64 date, i64 security,
   result = dataBaseResult(sqlite3_step(stmt_addDividendTransaction));
   sqlite3_reset(stmt_addDividendTransaction);
 
-  // No need to validityCheck, dividend is always successful
+  // Deposits and dividends never lower a balance, so this only updates the balance index
+  if (result == ResultCode::Ok) {
+    result = updateBalances(std::nullopt, balanceChange(lastInsertedId()));
+  }
 
   if (result != ResultCode::Ok) {
     rollbackSavepoint();
@@ -798,7 +1499,7 @@ ResultCode DataFile::addInterestTransaction(i64 account, i64 date, i64 security,
 
   beginSavepoint();
 
-  auto result = addTransaction(date, account, Action::INTEREST);
+  auto result = addTransaction(date, account, Action::INTEREST, security);
 
   if (result != ResultCode::Ok) {
     releaseSavepoint();
@@ -811,7 +1512,7 @@ ResultCode DataFile::addInterestTransaction(i64 account, i64 date, i64 security,
   result = dataBaseResult(sqlite3_step(stmt_addInterestTransaction));
   sqlite3_reset(stmt_addInterestTransaction);
 
-  // No need to validityCheck interest transactions
+  // Interest transactions do not affect balances, so there is nothing to check
 
   if (result != ResultCode::Ok) {
     rollbackSavepoint();
@@ -827,114 +1528,233 @@ ResultCode DataFile::setBuyNumberOfShares(i64 transaction, i64 numberOfShares) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
   beginSavepoint();
+  auto before = balanceChange(transaction);
   sqlite3_bind_int64(stmt_setBuyNumberOfShares, 1, numberOfShares);
   sqlite3_bind_int64(stmt_setBuyNumberOfShares, 2, transaction);
   sqlite3_step(stmt_setBuyNumberOfShares);
-  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setBuyNumberOfShares)), transaction);
+  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setBuyNumberOfShares)), transaction, before);
 }
 
 ResultCode DataFile::setBuySharePrice(i64 transaction, i64 sharePrice) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
   beginSavepoint();
+  auto before = balanceChange(transaction);
   sqlite3_bind_int64(stmt_setBuySharePrice, 1, static_cast<sqlite3_int64>(sharePrice));
   sqlite3_bind_int64(stmt_setBuySharePrice, 2, static_cast<sqlite3_int64>(transaction));
   sqlite3_step(stmt_setBuySharePrice);
-  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setBuySharePrice)), transaction);
+  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setBuySharePrice)), transaction, before);
 }
 
 ResultCode DataFile::setBuyCommission(i64 transaction, i64 commission) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
   beginSavepoint();
+  auto before = balanceChange(transaction);
   sqlite3_bind_int64(stmt_setBuyCommission, 1, static_cast<sqlite3_int64>(commission));
   sqlite3_bind_int64(stmt_setBuyCommission, 2, static_cast<sqlite3_int64>(transaction));
   sqlite3_step(stmt_setBuyCommission);
-  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setBuyCommission)), transaction);
+  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setBuyCommission)), transaction, before);
 }
 
 ResultCode DataFile::setSellNumberOfShares(i64 transaction, i64 numberOfShares) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
   beginSavepoint();
+  auto before = balanceChange(transaction);
   sqlite3_bind_int64(stmt_setSellNumberOfShares, 1, static_cast<sqlite3_int64>(numberOfShares));
   sqlite3_bind_int64(stmt_setSellNumberOfShares, 2, static_cast<sqlite3_int64>(transaction));
   sqlite3_step(stmt_setSellNumberOfShares);
-  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setSellNumberOfShares)), transaction);
+  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setSellNumberOfShares)), transaction, before);
 }
 
 ResultCode DataFile::setSellSharePrice(i64 transaction, i64 sharePrice) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
   beginSavepoint();
+  auto before = balanceChange(transaction);
   sqlite3_bind_int64(stmt_setSellSharePrice, 1, static_cast<sqlite3_int64>(sharePrice));
   sqlite3_bind_int64(stmt_setSellSharePrice, 2, static_cast<sqlite3_int64>(transaction));
   sqlite3_step(stmt_setSellSharePrice);
-  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setSellSharePrice)), transaction);
+  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setSellSharePrice)), transaction, before);
 }
 
 ResultCode DataFile::setSellCommission(i64 transaction, i64 commission) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
   beginSavepoint();
+  auto before = balanceChange(transaction);
   sqlite3_bind_int64(stmt_setSellCommission, 1, static_cast<sqlite3_int64>(commission));
   sqlite3_bind_int64(stmt_setSellCommission, 2, static_cast<sqlite3_int64>(transaction));
   sqlite3_step(stmt_setSellCommission);
-  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setSellCommission)), transaction);
+  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setSellCommission)), transaction, before);
 }
 
 ResultCode DataFile::setDepositAmount(i64 transaction, i64 amount) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
   beginSavepoint();
+  auto before = balanceChange(transaction);
   sqlite3_bind_int64(stmt_setDepositAmount, 1, static_cast<sqlite3_int64>(amount));
   sqlite3_bind_int64(stmt_setDepositAmount, 2, static_cast<sqlite3_int64>(transaction));
   sqlite3_step(stmt_setDepositAmount);
-  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setDepositAmount)), transaction);
+  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setDepositAmount)), transaction, before);
 }
 
 ResultCode DataFile::setWithdrawAmount(i64 transaction, i64 amount) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
   beginSavepoint();
+  auto before = balanceChange(transaction);
   sqlite3_bind_int64(stmt_setWithdrawAmount, 1, static_cast<sqlite3_int64>(amount));
   sqlite3_bind_int64(stmt_setWithdrawAmount, 2, static_cast<sqlite3_int64>(transaction));
   sqlite3_step(stmt_setWithdrawAmount);
-  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setWithdrawAmount)), transaction);
+  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setWithdrawAmount)), transaction, before);
 }
 
 ResultCode DataFile::setDividendAmount(i64 transaction, i64 amount) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
   beginSavepoint();
+  auto before = balanceChange(transaction);
   sqlite3_bind_int64(stmt_setDividendAmount, 1, amount);
   sqlite3_bind_int64(stmt_setDividendAmount, 2, transaction);
   sqlite3_step(stmt_setDividendAmount);
-  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setDividendAmount)), transaction);
+  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setDividendAmount)), transaction, before);
 }
 
 ResultCode DataFile::setInterestAmount(i64 transaction, i64 amount) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
   beginSavepoint();
+  auto before = balanceChange(transaction);
   sqlite3_bind_int64(stmt_setInterestAmount, 1, amount);
   sqlite3_bind_int64(stmt_setInterestAmount, 2, transaction);
   sqlite3_step(stmt_setInterestAmount);
-  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setInterestAmount)), transaction);
+  return finishTransactionUpdate(dataBaseResult(sqlite3_reset(stmt_setInterestAmount)), transaction, before);
 }
 
-ResultCode DataFile::removeTransaction(i64 id) {
+ResultCode DataFile::addTransactions(const std::vector<TransactionRecord>& records) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
-  i64 account = pv::transaction::account(*this, id); 
-  i64 date = pv::transaction::date(*this, id); 
+  if (records.empty()) {
+    return ResultCode::Ok;
+  }
+
+  std::vector<i64> ids;
+  ids.reserve(records.size());
+
+  // Validation is deferred until every transaction has been inserted, so only remember the earliest date from
+  // which each balance may have been lowered
+  std::unordered_map<i64, i64> cashCheckFrom;
+  std::map<std::pair<i64, i64>, i64> sharesCheckFrom;
+
+  beginSavepoint();
+
+  auto result = ResultCode::Ok;
+  for (const auto& record : records) {
+    result = addTransaction(record.date, record.account, record.action, record.security);
+    if (result != ResultCode::Ok) {
+      break;
+    }
+    auto id = lastInsertedId();
+
+    sqlite3_stmt* stmt = nullptr;
+    switch (record.action) {
+    case Action::BUY:
+      stmt = stmt_addBuyTransaction;
+      break;
+    case Action::SELL:
+      stmt = stmt_addSellTransaction;
+      break;
+    case Action::DEPOSIT:
+      stmt = stmt_addDepositTransaction;
+      break;
+    case Action::WITHDRAW:
+      stmt = stmt_addWithdrawTransaction;
+      break;
+    case Action::DIVIDEND:
+      stmt = stmt_addDividendTransaction;
+      break;
+    case Action::INTEREST:
+      stmt = stmt_addInterestTransaction;
+      break;
+    }
+
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(id));
+    if (record.security.has_value()) {
+      sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(*record.security));
+    } else {
+      sqlite3_bind_null(stmt, 2); // Fails the NOT NULL constraint for everything but deposits and withdrawals
+    }
+    if (record.action == Action::BUY || record.action == Action::SELL) {
+      sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(record.numberOfShares));
+      sqlite3_bind_int64(stmt, 4, static_cast<sqlite3_int64>(record.sharePrice));
+      sqlite3_bind_int64(stmt, 5, static_cast<sqlite3_int64>(record.commission));
+    } else {
+      sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(record.amount));
+    }
+    result = dataBaseResult(sqlite3_step(stmt));
+    sqlite3_reset(stmt);
+    if (result != ResultCode::Ok) {
+      break;
+    }
+
+    ids.push_back(id);
+
+    auto change = recordBalanceChange(record);
+    balances.apply(change);
+    if (change.cash < 0) {
+      auto [iter, inserted] = cashCheckFrom.try_emplace(change.account, change.date);
+      iter->second = std::min(iter->second, change.date);
+    }
+    if (change.security.has_value() && change.shares < 0) {
+      auto [iter, inserted] = sharesCheckFrom.try_emplace({*change.security, change.account}, change.date);
+      iter->second = std::min(iter->second, change.date);
+    }
+  }
+
+  if (result == ResultCode::Ok && !balancesLoaded) {
+    result = ResultCode::DbError;
+  }
+  if (result == ResultCode::Ok) {
+    for (const auto& [account, date] : cashCheckFrom) {
+      if (balances.cashNegativeFrom(account, date)) {
+        result = ResultCode::NegativeCashBalance;
+        break;
+      }
+    }
+  }
+  if (result == ResultCode::Ok) {
+    for (const auto& [key, date] : sharesCheckFrom) {
+      if (balances.sharesNegativeFrom(key.first, key.second, date)) {
+        result = ResultCode::NegativeSharesHeld;
+        break;
+      }
+    }
+  }
+
+  if (result != ResultCode::Ok) {
+    rollbackSavepoint();
+  } else {
+    releaseSavepoint();
+    transactionsAddedSignal(ids);
+  }
+
+  return result;
+}
+
+ResultCode DataFile::removeTransaction(i64 id) {
+  assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
   beginSavepoint();
+  auto before = balanceChange(id);
+  touchTransaction(id);
   sqlite3_bind_int64(stmt_removeTransaction, 1, id);
   sqlite3_step(stmt_removeTransaction);
   auto result = dataBaseResult(sqlite3_reset(stmt_removeTransaction));
   if (result == ResultCode::Ok) {
-    result = validityCheck(*this, account, date);
+    result = updateBalances(before, std::nullopt);
   }
   if (result == ResultCode::Ok) {
     transactionRemovedSignal(id);
@@ -948,14 +1768,19 @@ ResultCode DataFile::removeTransaction(i64 id) {
 ResultCode DataFile::setSecurityPrice(i64 security, i64 date, i64 price) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
+  beginWrite();
+  touchSecurity(security);
+
   sqlite3_bind_int64(stmt_setSecurityPrice, 1, static_cast<sqlite3_int64>(security));
   sqlite3_bind_int64(stmt_setSecurityPrice, 2, static_cast<sqlite3_int64>(date));
   sqlite3_bind_int64(stmt_setSecurityPrice, 3, static_cast<sqlite3_int64>(price));
   sqlite3_step(stmt_setSecurityPrice);
   auto result = dataBaseResult(sqlite3_reset(stmt_setSecurityPrice));
   if (result == ResultCode::Ok) {
+    // SecurityPrices is not a rowid table, so the update hook doesn't see this
+    pendingChanges.push_back({PendingChange::Kind::SecurityPrice, security, date});
+    deliverChanges();
     securityPriceUpdatedSignal(security, date);
-    changedSignal(); // SecurityPrices is not a rowid table, so we have to do this manually
   }
   return result;
 }
@@ -963,17 +1788,170 @@ ResultCode DataFile::setSecurityPrice(i64 security, i64 date, i64 price) {
 ResultCode DataFile::removeSecurityPrice(i64 security, i64 date) {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
+  beginWrite();
+  touchSecurity(security);
+
   sqlite3_bind_int64(stmt_removeSecurityPrice, 1, static_cast<sqlite3_int64>(security));
   sqlite3_bind_int64(stmt_removeSecurityPrice, 2, static_cast<sqlite3_int64>(date));
   sqlite3_step(stmt_removeSecurityPrice);
   auto result = dataBaseResult(sqlite3_reset(stmt_removeSecurityPrice));
   if (result == ResultCode::Ok) {
+    // SecurityPrices is not a rowid table, so the update hook doesn't see this
+    pendingChanges.push_back({PendingChange::Kind::SecurityPrice, security, date});
+    deliverChanges();
     securityPriceRemovedSignal(security, date);
-    changedSignal(); // SecurityPrices is not a rowid table, so we have to do this manually
   }
   return result;
 }
 
+ResultCode DataFile::setSecurityPrices(i64 security, const PriceHistory& prices, PriceConflictPolicy policy,
+                                       i64 replaceFrom) {
+  assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
+
+  if (prices.empty()) {
+    return ResultCode::Ok;
+  }
+
+  switch (policy) {
+  case PriceConflictPolicy::Replace:
+    replaceFrom = std::numeric_limits<i64>::min();
+    break;
+  case PriceConflictPolicy::Ignore:
+    replaceFrom = std::numeric_limits<i64>::max();
+    break;
+  case PriceConflictPolicy::ReplaceFrom:
+    break;
+  }
+
+  beginSavepoint();
+
+  std::vector<i64> updated;
+  auto result = ResultCode::Ok;
+  sqlite3_bind_int64(stmt_upsertSecurityPrice, 1, static_cast<sqlite3_int64>(security));
+  sqlite3_bind_int64(stmt_upsertSecurityPrice, 4, static_cast<sqlite3_int64>(replaceFrom));
+  for (std::size_t i = 0; i < prices.size(); ++i) {
+    sqlite3_bind_int64(stmt_upsertSecurityPrice, 2, static_cast<sqlite3_int64>(prices.dates[i]));
+    sqlite3_bind_int64(stmt_upsertSecurityPrice, 3, static_cast<sqlite3_int64>(prices.prices[i]));
+    sqlite3_step(stmt_upsertSecurityPrice);
+    result = dataBaseResult(sqlite3_reset(stmt_upsertSecurityPrice));
+    if (result != ResultCode::Ok) {
+      break;
+    }
+    if (sqlite3_changes(db) != 0) {
+      // SecurityPrices is not a rowid table, so the update hook doesn't see this
+      pendingChanges.push_back({PendingChange::Kind::SecurityPrice, security, prices.dates[i]});
+      updated.push_back(prices.dates[i]);
+    }
+  }
+
+  if (result != ResultCode::Ok) {
+    rollbackSavepoint();
+  } else if (updated.empty()) {
+    releaseSavepoint();
+  } else {
+    touchSecurity(security);
+    releaseSavepoint();
+    securityPricesUpdatedSignal(security, updated);
+  }
+  return result;
+}
+
+DailyValuationsState DataFile::dailyValuationsState() {
+  assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
+
+  DailyValuationsState state;
+  if (stmt_dailyValuationsState != nullptr && sqlite3_step(stmt_dailyValuationsState) == SQLITE_ROW) {
+    if (sqlite3_column_type(stmt_dailyValuationsState, 0) != SQLITE_NULL) {
+      state.validThrough = sqlite3_column_int64(stmt_dailyValuationsState, 0);
+    }
+    state.generation = sqlite3_column_int64(stmt_dailyValuationsState, 1);
+  }
+  if (stmt_dailyValuationsState != nullptr) {
+    sqlite3_reset(stmt_dailyValuationsState);
+  }
+  return state;
+}
+
+ResultCode DataFile::storeDailyValuations(const DailyValuationsState& state, i64 through,
+                                          const std::vector<DailyValuation>& valuations,
+                                          const std::vector<std::pair<i64, i64>>& cashBalances) {
+  assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
+
+  auto bindValidThrough = [](sqlite3_stmt* stmt, const std::optional<i64>& validThrough) {
+    if (validThrough.has_value()) {
+      sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(*validThrough));
+    } else {
+      sqlite3_bind_null(stmt, 1);
+    }
+  };
+
+  beginSavepoint();
+
+  auto current = dailyValuationsState();
+  if (current.generation != state.generation || current.validThrough != state.validThrough) {
+    rollbackSavepoint();
+    return ResultCode::Outdated;
+  }
+
+  bindValidThrough(stmt_clearDailyValuations, state.validThrough);
+  auto result = dataBaseResult(sqlite3_step(stmt_clearDailyValuations));
+  sqlite3_reset(stmt_clearDailyValuations);
+
+  if (result == ResultCode::Ok) {
+    bindValidThrough(stmt_clearDailyCashBalances, state.validThrough);
+    result = dataBaseResult(sqlite3_step(stmt_clearDailyCashBalances));
+    sqlite3_reset(stmt_clearDailyCashBalances);
+  }
+
+  for (std::size_t i = 0; result == ResultCode::Ok && i < valuations.size(); ++i) {
+    const auto& valuation = valuations[i];
+    sqlite3_bind_int64(stmt_addDailyValuation, 1, static_cast<sqlite3_int64>(valuation.date));
+    sqlite3_bind_int64(stmt_addDailyValuation, 2, static_cast<sqlite3_int64>(valuation.security));
+    sqlite3_bind_int64(stmt_addDailyValuation, 3, static_cast<sqlite3_int64>(valuation.sharesHeld));
+    sqlite3_bind_int64(stmt_addDailyValuation, 4, static_cast<sqlite3_int64>(valuation.marketValue));
+    sqlite3_bind_int64(stmt_addDailyValuation, 5, static_cast<sqlite3_int64>(valuation.costBasis));
+    result = dataBaseResult(sqlite3_step(stmt_addDailyValuation));
+    sqlite3_reset(stmt_addDailyValuation);
+  }
+
+  for (std::size_t i = 0; result == ResultCode::Ok && i < cashBalances.size(); ++i) {
+    sqlite3_bind_int64(stmt_addDailyCashBalance, 1, static_cast<sqlite3_int64>(cashBalances[i].first));
+    sqlite3_bind_int64(stmt_addDailyCashBalance, 2, static_cast<sqlite3_int64>(cashBalances[i].second));
+    result = dataBaseResult(sqlite3_step(stmt_addDailyCashBalance));
+    sqlite3_reset(stmt_addDailyCashBalance);
+  }
+
+  if (result == ResultCode::Ok) {
+    sqlite3_bind_int64(stmt_setDailyValuationsValidThrough, 1, static_cast<sqlite3_int64>(through));
+    result = dataBaseResult(sqlite3_step(stmt_setDailyValuationsValidThrough));
+    sqlite3_reset(stmt_setDailyValuationsValidThrough);
+  }
+
+  if (result != ResultCode::Ok) {
+    rollbackSavepoint();
+    return result;
+  }
+  return releaseSavepoint();
+}
+
+ResultCode DataFile::setPriceFetch(i64 security, const PriceFetch& fetch) {
+  assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
+
+  auto* stmt = cachedQuery(setPriceFetchQuery);
+  if (stmt == nullptr) {
+    return ResultCode::DbError;
+  }
+
+  beginWrite();
+  sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(security));
+  sqlite3_bind_int64(stmt, 2, static_cast<sqlite3_int64>(fetch.through));
+  sqlite3_bind_int64(stmt, 3, static_cast<sqlite3_int64>(fetch.at));
+  sqlite3_step(stmt);
+  auto result = dataBaseResult(sqlite3_reset(stmt));
+  deliverChanges();
+  return result;
+}
+
 i64 DataFile::lastInsertedId() const noexcept {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
@@ -983,6 +1961,11 @@ i64 DataFile::lastInsertedId() const noexcept {
 ResultCode DataFile::beginTransaction() {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
+  auto result = flush();
+  if (result != ResultCode::Ok) {
+    return result;
+  }
+
   sqlite3_step(stmt_beginTransaction);
   return dataBaseResult(sqlite3_reset(stmt_beginTransaction));
 }
@@ -990,6 +1973,10 @@ ResultCode DataFile::beginTransaction() {
 ResultCode DataFile::rollbackTransaction() {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
+  if (groupTransaction) {
+    return ResultCode::DbError; // There is no transaction to roll back, only modifications waiting to be committed
+  }
+
   sqlite3_step(stmt_rollbackTransaction);
   return dataBaseResult(sqlite3_reset(stmt_rollbackTransaction));
 }
@@ -997,26 +1984,73 @@ ResultCode DataFile::rollbackTransaction() {
 ResultCode DataFile::commitTransaction() {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
+  if (groupTransaction) {
+    return ResultCode::DbError; // Like committing without a transaction; use flush() instead
+  }
+
   sqlite3_step(stmt_commitTransaction);
-  return dataBaseResult(sqlite3_reset(stmt_commitTransaction));
+  auto result = dataBaseResult(sqlite3_reset(stmt_commitTransaction));
+  if (result == ResultCode::Ok) {
+    balances.commit();
+  }
+  deliverChanges();
+  return result;
 }
 
-ResultCode DataFile::copyTo(DataFile& other) const noexcept {
+ResultCode DataFile::copyTo(DataFile& other) noexcept {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
 
+  // Neither database can be backed up with the group transaction open
+  flush();
+  other.flush();
   sqlite3_backup* backup = sqlite3_backup_init(other.db, "main", db, "main");
 
   if (backup) {
     sqlite3_backup_step(backup, -1);
     sqlite3_backup_finish(backup);
   }
+  other.invalidateBalances();
+  other.touchEverything();
 
   return dataBaseResult(sqlite3_errcode(other.db));
 }
 
 bool DataFile::hasTransaction() const noexcept {
   assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
-  return sqlite3_get_autocommit(db) == 0;
+  return sqlite3_get_autocommit(db) == 0 && !groupTransaction;
+}
+
+ResultCode DataFile::setGroupCommit(std::optional<GroupCommitOptions> options) {
+  groupCommit_ = std::move(options);
+  return groupCommit_.has_value() ? ResultCode::Ok : flush();
+}
+
+ResultCode DataFile::flush() {
+  assert(db != nullptr && "Using DataFile in invalid state, most likely a use-after-move");
+
+  if (!groupTransaction) {
+    return ResultCode::Ok;
+  }
+  sqlite3_step(stmt_commitTransaction);
+  auto result = dataBaseResult(sqlite3_reset(stmt_commitTransaction));
+  // If the commit failed, the transaction is usually still open (for example, while another connection is
+  // reading), and the next flush tries again
+  groupTransaction = sqlite3_get_autocommit(db) == 0;
+  if (result == ResultCode::Ok) {
+    balances.commit();
+  }
+  deliverChanges();
+  return result;
+}
+
+std::optional<std::chrono::steady_clock::time_point> DataFile::flushDeadline() const noexcept {
+  if (!groupTransaction) {
+    return std::nullopt;
+  }
+  if (!groupCommit_.has_value()) {
+    return lastWrite; // Group commit was turned off, but the transaction couldn't be committed yet
+  }
+  return std::min(groupStart + groupCommit_->window, lastWrite + groupCommit_->idle);
 }
 
 std::optional<std::string> DataFile::filePath() const noexcept {
@@ -1028,12 +2062,46 @@ std::optional<std::string> DataFile::filePath() const noexcept {
   return std::string(cStr);
 }
 
+bool DataFile::hasQuoteCache() const noexcept { return sqlite3_db_filename(db, "QuoteCache") != nullptr; }
+
+DataFile DataFile::openReadOnlyConnection() {
+  auto location = filePath();
+  if (!location.has_value()) {
+    throw std::runtime_error("Failed to open DataFile connection: in-memory data files can't be shared");
+  }
+
+  flush();
+  // The journal mode was chosen by this connection's options, so it's left alone
+  DataFile connection(*location, SQLITE_OPEN_READONLY, options_);
+  if (profiler_ != nullptr) {
+    connection.setProfiler(profiler_);
+  }
+  return connection;
+}
+
+void DataFile::interrupt() noexcept { sqlite3_interrupt(db); }
+
+void DataFile::setProfiler(std::shared_ptr<QueryProfiler> profiler) {
+  profiler_ = std::move(profiler);
+  profiledStatements.clear();
+  profiledStatementIds.clear();
+  updateSQLiteHooks();
+}
+
+void DataFile::countStatements() noexcept {
+  statementCount_ = 0;
+  countingStatements = true;
+  updateSQLiteHooks();
+}
+
 const char* pv::DataFile::errMsg() const noexcept { return sqlite3_errmsg(db); }
 
 Connection DataFile::onChanged(const ChangedSignal::slot_type& slot) {
   return changedSignal.connect(slot);
 }
 
+Connection DataFile::onChangeSet(const ChangeSetSignal::slot_type& slot) { return changeSetSignal.connect(slot); }
+
 Connection DataFile::onAccountAdded(const AccountAddedSignal::slot_type& slot) {
   return accountAddedSignal.connect(slot);
 }
@@ -1058,6 +2126,10 @@ Connection DataFile::onTransactionRemoved(const TransactionRemovedSignal::slot_t
   return transactionRemovedSignal.connect(slot);
 }
 
+Connection DataFile::onTransactionsAdded(const TransactionsAddedSignal::slot_type& slot) {
+  return transactionsAddedSignal.connect(slot);
+}
+
 Connection DataFile::onSecurityAdded(const SecurityAddedSignal::slot_type& slot) {
   return securityAddedSignal.connect(slot);
 }
@@ -1078,7 +2150,15 @@ Connection DataFile::onSecurityPriceRemoved(const SecurityPriceRemovedSignal::sl
   return securityPriceRemovedSignal.connect(slot);
 }
 
+Connection DataFile::onSecurityPricesUpdated(const SecurityPricesUpdatedSignal::slot_type& slot) {
+  return securityPricesUpdatedSignal.connect(slot);
+}
+
 Connection DataFile::onRollback(const RollbackSignal::slot_type& slot) { return rollbackSignal.connect(slot); }
 
+Connection DataFile::onFlushPending(const FlushPendingSignal::slot_type& slot) {
+  return flushPendingSignal.connect(slot);
+}
+
 } // namespace pv
 
@@ -1,18 +1,30 @@
 #ifndef PV_DATAFILE_H
 #define PV_DATAFILE_H
 
+#include "BalanceIndex.h"
+#include "ChangeSet.h"
+#include "PriceHistory.h"
 #include "Integer64.h"
+#include "Memo.h"
+#include "QueryProfiler.h"
 #include "Signals.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 class sqlite3;
 class sqlite3_stmt;
 
 namespace pv {
 
+class Checkpointer;
+
 enum class Action : unsigned char {
   BUY = 0,
   SELL = 1,
@@ -35,6 +47,127 @@ enum class ResultCode : unsigned char {
   RecordNotFound,
   NegativeCashBalance,
   NegativeSharesHeld,
+  /// \brief The data file was modified after the data that was going to be stored was read from it, so nothing was
+  /// stored.
+  Outdated,
+};
+
+/// \brief A single pView transaction, used for adding many transactions at once (see \c DataFile::addTransactions()).
+///
+/// Only the fields that apply to \c action are used:
+/// - BUY and SELL: \c security, \c numberOfShares, \c sharePrice, \c commission
+/// - DEPOSIT and WITHDRAW: \c security (optional), \c amount
+/// - DIVIDEND and INTEREST: \c security, \c amount
+struct TransactionRecord {
+  i64 account = 0;
+  i64 date = 0;
+  Action action = Action::DEPOSIT;
+  std::optional<i64> security = std::nullopt;
+  i64 numberOfShares = 0;
+  i64 sharePrice = 0;
+  i64 commission = 0;
+  i64 amount = 0;
+};
+
+/// \brief What \c DataFile::setSecurityPrices() does with a price for a date that already has one.
+enum class PriceConflictPolicy : unsigned char {
+  /// \brief Replace the existing price.
+  Replace,
+  /// \brief Keep the existing price.
+  Ignore,
+  /// \brief Only replace existing prices dated on or after a given date, such as today's price, which may have been
+  /// set before the market closed.
+  ReplaceFrom,
+};
+
+/// \brief A row of the \c DailyValuations table: how much of a security was held at the end of a day.
+struct DailyValuation {
+  i64 date = 0;
+  i64 security = 0;
+  i64 sharesHeld = 0;
+  /// \brief 0 before the security has a price, like \c pv::algorithms::SecurityTimeSeries::marketValue.
+  i64 marketValue = 0;
+  i64 costBasis = 0;
+};
+
+/// \brief How much of the daily valuations stored in a data file are up to date (see
+/// \c DataFile::dailyValuationsState()).
+struct DailyValuationsState {
+  /// \brief The last date whose daily valuations are up to date, or \c std::nullopt if none are.
+  std::optional<i64> validThrough = std::nullopt;
+  /// \brief Changes every time a modification lowers \c validThrough.
+  i64 generation = 0;
+};
+
+/// \brief When a security's prices were last downloaded (see \c DataFile::setPriceFetch()).
+struct PriceFetch {
+  /// \brief The last date whose price was requested.
+  i64 through = 0;
+  /// \brief When the prices were downloaded, in seconds since 1970-01-01 UTC.
+  i64 at = 0;
+};
+
+/// \brief How a data file configures its SQLite connection (see \c DataFile::DataFile()).
+///
+/// The defaults favour throughput: SQLite's own defaults date from when memory was scarce. \c legacy() gives those
+/// instead, which is mostly useful for comparison.
+struct DataFileOptions {
+  enum class JournalMode : unsigned char { Delete, Wal };
+  enum class Synchronous : unsigned char { Off, Normal, Full };
+  enum class TempStore : unsigned char { Default, File, Memory };
+
+  /// \brief With write-ahead logging, reading (including from read-only connections) doesn't block writing, and
+  /// commits only append to the log. The journal mode is stored in the file, so this switches existing files over
+  /// too. It is ignored for in-memory data files and read-only connections.
+  JournalMode journalMode = JournalMode::Wal;
+  /// \brief How often SQLite waits for the disk. With write-ahead logging, \c Normal can't corrupt the file, but
+  /// the last commits may be lost if the computer loses power (which group commit risks anyway).
+  Synchronous synchronous = Synchronous::Normal;
+  /// \brief The most memory used to cache pages, in KiB.
+  i64 cacheSize = 64 * 1024;
+  /// \brief How much of the file is read through memory mapping instead of copied into the cache, in bytes (0 turns
+  /// it off).
+  i64 mmapSize = 256 * 1024 * 1024;
+  /// \brief Where temporary tables and indices (such as the ones used for sorting) are kept.
+  TempStore tempStore = TempStore::Memory;
+  /// \brief How long to wait for a lock held by another connection. With write-ahead logging, readers only wait while
+  /// the log is being recovered, and writers only wait for each other.
+  std::chrono::milliseconds busyTimeout = std::chrono::milliseconds(5000);
+  /// \brief With write-ahead logging, checkpoint on a background thread (see \c Checkpointer) instead of during the
+  /// commit that makes the log reach \c checkpointPages pages.
+  bool backgroundCheckpoints = true;
+  int checkpointPages = 1000;
+  /// \brief The location of a \c QuoteCache to read prices through (empty for none). \c pv::algorithms::sharePrice(),
+  /// \c snapshot() and \c timeSeries() use the cache's price when it is newer than the data file's own. The cache is
+  /// attached to the connection, so it is read without copying anything into the data file. Price indexes and daily
+  /// valuations only use the data file's own prices.
+  std::string quoteCache;
+
+  /// \brief Returns SQLite's defaults (except for the busy timeout, which only matters with several connections).
+  static DataFileOptions legacy() {
+    DataFileOptions options;
+    options.journalMode = JournalMode::Delete;
+    options.synchronous = Synchronous::Full;
+    options.cacheSize = 2000;
+    options.mmapSize = 0;
+    options.tempStore = TempStore::Default;
+    options.backgroundCheckpoints = false;
+    return options;
+  }
+};
+
+/// \brief When modifications made outside of a transaction are committed, if they are grouped (see
+/// \c DataFile::setGroupCommit()).
+///
+/// Modifications are committed as soon as any one of these limits is reached.
+struct GroupCommitOptions {
+  /// \brief The longest that a modification may stay uncommitted, which is the most that can be lost if the program
+  /// crashes or the computer loses power.
+  std::chrono::milliseconds window = std::chrono::milliseconds(1000);
+  /// \brief How long to wait for another modification before committing.
+  std::chrono::milliseconds idle = std::chrono::milliseconds(200);
+  /// \brief The most rows that may be modified before committing.
+  std::size_t maxChanges = 10000;
 };
 
 using StatementPointer = std::unique_ptr<sqlite3_stmt, int(*)(sqlite3_stmt*)>;
@@ -42,6 +175,7 @@ using StatementPointer = std::unique_ptr<sqlite3_stmt, int(*)(sqlite3_stmt*)>;
 class DataFile {
 public:
   using ChangedSignal = Signal<>;
+  using ChangeSetSignal = Signal<const ChangeSet&>;
 
   using AccountAddedSignal = Signal<i64>;
   using AccountUpdatedSignal = Signal<i64>;
@@ -50,6 +184,7 @@ public:
   using TransactionAddedSignal = Signal<i64>;
   using TransactionUpdatedSignal = Signal<i64>;
   using TransactionRemovedSignal = Signal<i64>;
+  using TransactionsAddedSignal = Signal<const std::vector<i64>&>;
 
   using SecurityAddedSignal = Signal<i64>;
   using SecurityUpdatedSignal = Signal<i64>;
@@ -57,8 +192,10 @@ public:
 
   using SecurityPriceUpdatedSignal = Signal<i64, i64>;
   using SecurityPriceRemovedSignal = Signal<i64, i64>;
+  using SecurityPricesUpdatedSignal = Signal<i64, const std::vector<i64>&>;
 
   using RollbackSignal = Signal<>;
+  using FlushPendingSignal = Signal<>;
 private:
   sqlite3_stmt* prepare(std::string sql, int flags = 0, ResultCode* outResult = nullptr) noexcept;
 
@@ -66,14 +203,44 @@ private:
   /// \internal Adds a pView (not SQL!) transaciton to the master transaction table.
   /// Make sure to add a row to the corresponding action-specific
   /// transaction table after calling this function.
-  ResultCode addTransaction(i64 date, i64 account, Action action) noexcept;
+  ///
+  /// \param security the security of the action-specific row, which is only used to update the modification versions
+  ResultCode addTransaction(i64 date, i64 account, Action action, std::optional<i64> security) noexcept;
 
   /// \internal
   /// If \c code is not OK, return code. Otherwise, if one row was changed in the database,
   /// return OK. Otherwise, return RECORD_NOT_FOUND. This also emits transactionUpdatedSignal if the edit was successful.
   /// This is intended to be used at the end of the routines for modifying transactions
   /// (setBuyNumberOfShares, setDividendAmount, etc.).
-  ResultCode finishTransactionUpdate(ResultCode code, pv::i64 transaction) noexcept;
+  ///
+  /// \param before the balance change of the transaction before it was modified (see \c balanceChange())
+  ResultCode finishTransactionUpdate(ResultCode code, pv::i64 transaction,
+                                     const std::optional<BalanceChange>& before) noexcept;
+
+  /// \internal Reads the effect that \c transaction has on cash and shares balances, or \c std::nullopt
+  /// if it does not exist.
+  std::optional<BalanceChange> balanceChange(i64 transaction) noexcept;
+
+  /// \internal Replaces the balance change \c before with \c after in the balance index, then checks
+  /// that this did not make any cash balance or number of shares held negative.
+  ///
+  /// Only the accounts and (security, account) pairs touched by the change are checked, and only
+  /// if the change could lower their balances. Use \c std::nullopt for \c before when adding a
+  /// transaction, and for \c after when removing one.
+  ResultCode updateBalances(const std::optional<BalanceChange>& before, const std::optional<BalanceChange>& after);
+
+  /// \internal Rebuilds the balance index from the database, with a single scan of the transactions.
+  void loadBalances();
+
+  /// \internal Discards the balance index, so that it is rebuilt before the next modification.
+  void invalidateBalances() noexcept;
+
+  /// \internal Call before modifying the database. With group commit on, this opens the group transaction if no
+  /// transaction is open.
+  void beginWrite();
+
+  /// \internal Commits the group transaction if it has reached one of the group commit limits.
+  void commitGroupIfDue();
 
   /// \internal Use these instead of beginTransaction() for internal code, because
   /// this can be nested within transactions created by the user.
@@ -83,7 +250,11 @@ private:
 
   //// FIELDS GO HERE
   //// REMEMBER TO UPDATE THE DESTRUCTOR AND swap() FUNCTION
+  DataFileOptions options_;
+  std::unique_ptr<Checkpointer> checkpointer;
+
   ChangedSignal changedSignal;
+  ChangeSetSignal changeSetSignal;
 
   AccountAddedSignal accountAddedSignal;
   AccountUpdatedSignal accountUpdatedSignal;
@@ -92,6 +263,7 @@ private:
   TransactionAddedSignal transactionAddedSignal;
   TransactionUpdatedSignal transactionUpdatedSignal;
   TransactionRemovedSignal transactionRemovedSignal;
+  TransactionsAddedSignal transactionsAddedSignal;
 
   SecurityAddedSignal securityAddedSignal;
   SecurityUpdatedSignal securityUpdatedSignal;
@@ -99,6 +271,7 @@ private:
 
   SecurityPriceUpdatedSignal securityPriceUpdatedSignal;
   SecurityPriceRemovedSignal securityPriceRemovedSignal;
+  SecurityPricesUpdatedSignal securityPricesUpdatedSignal;
 
   void updateSQLiteHooks();
 
@@ -111,6 +284,87 @@ private:
   bool suppressRollbackSignal = false;
   RollbackSignal rollbackSignal;
 
+  /// \internal A row modified by the current SQL transaction. These are collected by the update hook
+  /// (and by hand for SecurityPrices, which is not a rowid table), and turned into a ChangeSet on commit.
+  struct PendingChange {
+    enum class Kind : unsigned char { Account, Transaction, Security, SecurityPrice };
+    Kind kind;
+    i64 id;
+    i64 date; // Only used for SecurityPrice
+  };
+
+  std::vector<PendingChange> pendingChanges;
+
+  /// \internal Set by the commit hook. SQLite does not allow the database to be used from inside the
+  /// commit hook, so the ChangeSet is emitted afterwards by \c deliverChanges().
+  bool changesCommitted = false;
+
+  /// \internal Emits \c changeSetSignal and \c changedSignal if the pending changes have been committed.
+  /// Call this after anything that may have committed a transaction.
+  void deliverChanges();
+
+  /// \internal
+  /// Running cash balances and shares held, used to validate modifications. This is loaded lazily
+  /// on the first modification, and kept in sync with the database from then on.
+  BalanceIndex balances;
+  bool balancesLoaded = false;
+
+  /// \internal The balance index journal position and number of pending changes at the start of
+  /// each open savepoint.
+  struct SavepointMark {
+    std::size_t balances;
+    std::size_t changes;
+  };
+
+  std::vector<SavepointMark> savepointMarks;
+
+  /// \internal Group commit. \c groupTransaction is set while the open SQL transaction is the one that holds back
+  /// modifications, rather than one begun by beginTransaction().
+  std::optional<GroupCommitOptions> groupCommit_ = std::nullopt;
+  bool groupTransaction = false;
+  std::chrono::steady_clock::time_point groupStart;
+  std::chrono::steady_clock::time_point lastWrite;
+  FlushPendingSignal flushPendingSignal;
+
+  /// \internal Modification versions, for the memo. Each modification gives the securities and accounts that it
+  /// touches the next value of \c modificationCounter, or gives it to \c globalVersion if it can't tell which
+  /// ones it touched.
+  std::uint64_t modificationCounter = 0;
+  std::uint64_t globalVersion = 0;
+  std::unordered_map<i64, std::uint64_t> securityVersions;
+  std::unordered_map<i64, std::uint64_t> accountVersions;
+  Memo memo_;
+
+  /// \internal Call these before a modification's signals are emitted, so that the slots don't see stale results.
+  void touchSecurity(i64 security) noexcept;
+  void touchAccount(i64 account) noexcept;
+  /// \internal Touches the account and security of an existing transaction.
+  void touchTransaction(i64 transaction) noexcept;
+  void touchEverything() noexcept;
+
+  /// \internal The number of statements run since countStatements() was called, counted by a trace callback.
+  bool countingStatements = false;
+  std::uint64_t statementCount_ = 0;
+
+  /// \internal A statement being profiled. The rows stepped are counted here, and passed to the profiler once the
+  /// statement finishes, so that the profiler isn't locked for every row.
+  ///
+  /// SQLite's own timings only have millisecond precision on some platforms, so statements are timed here instead.
+  struct ProfiledStatement {
+    std::size_t id;
+    std::uint64_t rows;
+    std::chrono::steady_clock::time_point start;
+  };
+
+  std::shared_ptr<QueryProfiler> profiler_ = nullptr;
+  /// \internal The statements that are running. Each one is removed when it finishes, or is finalized (which
+  /// finishes it), so that another statement allocated at the same address starts afresh.
+  std::unordered_map<const sqlite3_stmt*, ProfiledStatement> profiledStatements;
+  /// \internal The profiler's id for each SQL text run so far, so that it is only looked up once.
+  std::unordered_map<std::string, std::size_t> profiledStatementIds;
+
+  ProfiledStatement& profiledStatement(sqlite3_stmt* stmt);
+
   sqlite3* db = nullptr;
 
   sqlite3_stmt* stmt_addAccount = nullptr;
@@ -149,6 +403,14 @@ private:
 
   sqlite3_stmt* stmt_setSecurityPrice = nullptr;
   sqlite3_stmt* stmt_removeSecurityPrice = nullptr;
+  sqlite3_stmt* stmt_upsertSecurityPrice = nullptr;
+
+  sqlite3_stmt* stmt_dailyValuationsState = nullptr;
+  sqlite3_stmt* stmt_setDailyValuationsValidThrough = nullptr;
+  sqlite3_stmt* stmt_clearDailyValuations = nullptr;
+  sqlite3_stmt* stmt_clearDailyCashBalances = nullptr;
+  sqlite3_stmt* stmt_addDailyValuation = nullptr;
+  sqlite3_stmt* stmt_addDailyCashBalance = nullptr;
 
   sqlite3_stmt* stmt_beginTransaction = nullptr;
   sqlite3_stmt* stmt_rollbackTransaction = nullptr;
@@ -161,7 +423,12 @@ private:
 
   std::unordered_map<const char*, sqlite3_stmt*> queryCache;
 public:
-  explicit DataFile(std::string location = ":memory:", int flags = -1);
+  /// \brief Opens (or creates) the data file at \c location.
+  ///
+  /// \param flags the flags for \c sqlite3_open_v2(), or -1 to open for reading and writing, creating the file if
+  /// it doesn't exist
+  /// \throws std::runtime_error if the file couldn't be opened or initialized
+  explicit DataFile(std::string location = ":memory:", int flags = -1, DataFileOptions options = DataFileOptions());
 
   DataFile(const DataFile&) = delete;
   DataFile& operator=(const DataFile&) = delete;
@@ -205,6 +472,18 @@ public:
   ResultCode addDividendTransaction(i64 account, i64 date, i64 security, i64 amount);
   ResultCode addInterestTransaction(i64 account, i64 date, i64 security, i64 amount);
 
+  /// \brief Adds many transactions at once.
+  ///
+  /// All of the transactions are inserted inside a single SQL transaction (or savepoint, if a transaction
+  /// is already open), and the balances are validated once at the end instead of after each transaction.
+  /// Either every transaction is added or none are.
+  ///
+  /// Instead of \c transactionAdded being emitted for every transaction, \c transactionsAdded is emitted once.
+  ///
+  /// \returns \c ResultCode::Ok if every transaction was added, otherwise the error that caused the
+  /// import to be rolled back
+  ResultCode addTransactions(const std::vector<TransactionRecord>& records);
+
   ResultCode removeTransaction(i64 id);
 
   ResultCode setBuyNumberOfShares(i64 transaction, i64 numberOfShares);
@@ -226,6 +505,46 @@ public:
   ResultCode setSecurityPrice(i64 security, i64 date, i64 price);
   ResultCode removeSecurityPrice(i64 security, i64 date);
 
+  /// \brief Sets many prices of \c security at once, such as a downloaded price history.
+  ///
+  /// Every price is set inside a single SQL transaction (or savepoint, if a transaction is already open), with SQLite
+  /// deciding what to do about each date that already has a price (see \c PriceConflictPolicy). Prices that end up
+  /// unchanged don't count as modified, so they don't invalidate the daily valuations either. Either every price is
+  /// set or none are.
+  ///
+  /// Instead of \c securityPriceUpdated being emitted for every price, \c securityPricesUpdated is emitted once, with
+  /// the dates whose price was added or changed.
+  ///
+  /// \param replaceFrom only used by \c PriceConflictPolicy::ReplaceFrom
+  ResultCode setSecurityPrices(i64 security, const PriceHistory& prices, PriceConflictPolicy policy,
+                               i64 replaceFrom = 0);
+
+  /// \brief Reads how much of the daily valuations (the \c DailyValuations and \c DailyCashBalances tables) are up
+  /// to date.
+  ///
+  /// Adding, modifying or removing a transaction or a security price lowers \c validThrough to the day before its
+  /// date. This is done by triggers, so it happens no matter which connection modifies the data file, and is rolled
+  /// back along with the modification.
+  DailyValuationsState dailyValuationsState();
+
+  /// \brief Replaces the daily valuations after \c state.validThrough with ones calculated up to \c through, and
+  /// marks them as up to date until then.
+  ///
+  /// This is how \c pv::algorithms::repairDailyValuations() stores its results, which may be calculated on another
+  /// connection. Only securities that are held are listed in \c valuations, and \c cashBalances holds (date, cash
+  /// balance) pairs for the dates with a non-zero cash balance. No signals are emitted.
+  ///
+  /// \param state the state of the data that the valuations were calculated from
+  /// \returns \c ResultCode::Outdated if the daily valuations were invalidated or repaired since \c state was read
+  ResultCode storeDailyValuations(const DailyValuationsState& state, i64 through,
+                                  const std::vector<DailyValuation>& valuations,
+                                  const std::vector<std::pair<i64, i64>>& cashBalances);
+
+  /// \brief Records that the prices of \c security were downloaded (see \c pv::planPriceRefresh()).
+  ///
+  /// This is bookkeeping rather than part of the portfolio, so no signals are emitted.
+  ResultCode setPriceFetch(i64 security, const PriceFetch& fetch);
+
   /// \brief Gets the id of the last inserted account/security/transaction.
   ///
   /// If another modification has occured since the last call to \c addAccount, \c addSecurity,
@@ -236,23 +555,118 @@ public:
 
   /// \brief Begins a transaction (in the SQL sense).
   /// 
-  /// This cannot be nested.
+  /// This cannot be nested. Modifications held back by group commit are committed first, so that rolling back the
+  /// transaction doesn't lose them.
   ResultCode beginTransaction();
   /// \brief Rolls back the current transaction.
   ResultCode rollbackTransaction();
   /// \brief Commits the current transaction.
   ResultCode commitTransaction();
 
-  ResultCode copyTo(DataFile& other) const noexcept;
+  /// \brief Replaces the contents of \c other with a copy of this data file.
+  ///
+  /// Modifications held back by group commit in either data file are committed first.
+  ResultCode copyTo(DataFile& other) noexcept;
 
+  /// \brief Checks if a transaction begun by \c beginTransaction() is open (the one used by group commit doesn't
+  /// count).
   bool hasTransaction() const noexcept;
 
+  /// \brief Turns group commit on with \c options, or off with \c std::nullopt (the default).
+  ///
+  /// Normally every modification made outside of a transaction is committed (and written to disk) by itself. With
+  /// group commit on, the first one begins a transaction instead, which is committed once one of the limits in
+  /// \c options is reached, or when \c flush() is called. This makes bursts of modifications much cheaper, at the cost
+  /// of losing the last \c options.window of them in a crash. Since a data file can't time itself, the idle limit is
+  /// only reached if something calls \c flush() at \c flushDeadline() (see \c onFlushPending()). The others are also
+  /// checked after each modification.
+  ///
+  /// Signals for individual rows are still emitted right away, but \c onChangeSet() is emitted once per commit, and
+  /// other connections only see the modifications once they are committed. Turning group commit off, destroying the
+  /// data file, opening a read-only connection and beginning a transaction all commit everything first.
+  ResultCode setGroupCommit(std::optional<GroupCommitOptions> options);
+
+  const std::optional<GroupCommitOptions>& groupCommit() const noexcept { return groupCommit_; }
+
+  /// \brief Commits the modifications held back by group commit, if there are any.
+  ResultCode flush();
+
+  /// \brief Returns when the modifications held back by group commit should be committed, or \c std::nullopt if
+  /// there aren't any.
+  std::optional<std::chrono::steady_clock::time_point> flushDeadline() const noexcept;
+
   std::optional<std::string> filePath() const noexcept; 
 
+  /// \brief The options that the data file was opened with.
+  const DataFileOptions& options() const noexcept { return options_; }
+
+  /// \brief Checks if prices are read through a quote cache (see \c DataFileOptions::quoteCache).
+  bool hasQuoteCache() const noexcept;
+
+  /// \brief Opens another connection to this data file, which can only read from it.
+  ///
+  /// Each connection may be used by a different thread, so this is useful for long computations that shouldn't
+  /// block the thread that modifies the data file. The new connection only sees committed modifications (this
+  /// calls \c flush() first), and doesn't emit any signals. It is opened with the same options as this one.
+  ///
+  /// Reading from the new connection only doesn't block writing from this one (and vice versa) with write-ahead
+  /// logging (see \c DataFileOptions::journalMode). This doesn't change the journal mode, so with \c legacy()
+  /// options the connections still work, but block each other.
+  ///
+  /// \throws std::runtime_error if this is an in-memory data file, or the connection couldn't be opened
+  DataFile openReadOnlyConnection();
+
+  /// \brief Stops any query that is running on this connection as soon as possible.
+  ///
+  /// This may be called from any thread. Interrupted queries fail with \c SQLITE_INTERRUPT.
+  void interrupt() noexcept;
+
+  /// \brief Starts counting the SQL statements run on this connection, including the ones run internally.
+  void countStatements() noexcept;
+
+  /// \brief Returns the number of SQL statements run since \c countStatements() was called.
+  std::uint64_t statementCount() const noexcept { return statementCount_; }
+
+  /// \brief Records how long every SQL statement run on this connection takes in \c profiler, or stops recording if
+  /// \c profiler is \c nullptr.
+  ///
+  /// Connections opened by \c openReadOnlyConnection() record in the same profiler as this connection.
+  void setProfiler(std::shared_ptr<QueryProfiler> profiler);
+
+  /// \brief Returns the profiler that statements are recorded in, or \c nullptr if they aren't.
+  std::shared_ptr<QueryProfiler> profiler() const noexcept { return profiler_; }
+
+  /// \brief The memo that the \c pv::algorithms functions remember their results in.
+  ///
+  /// It is disabled for connections opened by \c openReadOnlyConnection(), since they can't tell when another
+  /// connection modifies the data file.
+  Memo& memo() noexcept { return memo_; }
+
+  /// \brief Returns a number that changes whenever this connection makes a modification that may change a
+  /// calculation about \c security (in any account), such as adding one of its transactions or prices.
+  ///
+  /// Modifications made by other connections are not seen.
+  std::uint64_t securityVersion(i64 security) const noexcept;
+
+  /// \brief Returns a number that changes whenever this connection makes a modification that may change a
+  /// calculation about \c account, such as adding one of its transactions.
+  ///
+  /// Modifications made by other connections are not seen.
+  std::uint64_t accountVersion(i64 account) const noexcept;
+
   const char* errMsg() const noexcept; 
 
+  /// \brief Connects to a signal that is emitted once whenever modifications are committed.
+  ///
+  /// Prefer \c onChangeSet(), which also says what was modified.
   Connection onChanged(const ChangedSignal::slot_type& slot);
 
+  /// \brief Connects to a signal that is emitted with everything that was modified whenever modifications
+  /// are committed, i.e. once per SQL transaction, no matter how many rows were touched.
+  ///
+  /// Nothing is emitted for modifications that are rolled back, see \c onRollback() instead.
+  Connection onChangeSet(const ChangeSetSignal::slot_type& slot);
+
   Connection onAccountAdded(const AccountAddedSignal::slot_type& slot);
   Connection onAccountUpdated(const AccountUpdatedSignal::slot_type& slot);
   Connection onAccountRemoved(const AccountRemovedSignal::slot_type& slot);
@@ -260,6 +674,7 @@ public:
   Connection onTransactionAdded(const TransactionAddedSignal::slot_type& slot);
   Connection onTransactionUpdated(const TransactionUpdatedSignal::slot_type& slot);
   Connection onTransactionRemoved(const TransactionRemovedSignal::slot_type& slot);
+  Connection onTransactionsAdded(const TransactionsAddedSignal::slot_type& slot);
 
   Connection onSecurityAdded(const SecurityAddedSignal::slot_type& slot);
   Connection onSecurityUpdated(const SecurityUpdatedSignal::slot_type& slot);
@@ -267,9 +682,14 @@ public:
 
   Connection onSecurityPriceUpdated(const SecurityPriceUpdatedSignal::slot_type& slot);
   Connection onSecurityPriceRemoved(const SecurityPriceRemovedSignal::slot_type& slot);
+  Connection onSecurityPricesUpdated(const SecurityPricesUpdatedSignal::slot_type& slot);
 
   Connection onRollback(const RollbackSignal::slot_type& slot);
 
+  /// \brief Connects to a signal that is emitted when group commit begins holding back modifications, so that
+  /// \c flush() can be scheduled for \c flushDeadline().
+  Connection onFlushPending(const FlushPendingSignal::slot_type& slot);
+
   friend void swap(DataFile& lhs, DataFile& rhs) noexcept;
 };
 
@@ -2,8 +2,11 @@
 #define PV_DATE_H
 
 #include "Integer64.h"
-#include <ctime>
 #include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <optional>
+#include <string>
 
 namespace pv {
 
@@ -13,6 +16,53 @@ inline i64 today() {
   return static_cast<i64>(std::floor(std::time(nullptr) / 86400.0));
 }
 
+/// \brief Returns the date (in days since 1970-01-01) of a day in the proleptic Gregorian calendar.
+inline i64 fromYearMonthDay(i64 year, i64 month, i64 day) noexcept {
+  // See http://howardhinnant.github.io/date_algorithms.html#days_from_civil
+  year -= month <= 2 ? 1 : 0;
+  i64 era = (year >= 0 ? year : year - 399) / 400;
+  i64 yearOfEra = year - era * 400;
+  i64 dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  i64 dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  return era * 146097 + dayOfEra - 719468;
+}
+
+/// \brief Formats a date (in days since 1970-01-01) as YYYY-MM-DD.
+inline std::string toIsoString(i64 date) {
+  // See http://howardhinnant.github.io/date_algorithms.html#civil_from_days
+  date += 719468;
+  i64 era = (date >= 0 ? date : date - 146096) / 146097;
+  i64 dayOfEra = date - era * 146097;
+  i64 yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+  i64 dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+  i64 shiftedMonth = (5 * dayOfYear + 2) / 153;
+  i64 day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+  i64 month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+  i64 year = yearOfEra + era * 400 + (month <= 2 ? 1 : 0);
+
+  char buffer[64];
+  std::snprintf(buffer, sizeof(buffer), "%04lld-%02d-%02d", static_cast<long long>(year), static_cast<int>(month),
+                static_cast<int>(day));
+  return buffer;
+}
+
+/// \brief Parses a date in the YYYY-MM-DD format, returning \c std::nullopt if it is invalid.
+inline std::optional<i64> fromIsoString(const std::string& string) {
+  int year = 0;
+  int month = 0;
+  int day = 0;
+  char end = '\0';
+  if (std::sscanf(string.c_str(), "%d-%d-%d%c", &year, &month, &day, &end) != 3 || month < 1 || month > 12 ||
+      day < 1 || day > 31) {
+    return std::nullopt;
+  }
+  i64 date = fromYearMonthDay(year, month, day);
+  if (toIsoString(date) != string) {
+    return std::nullopt; // For example, February 30th
+  }
+  return date;
+}
+
 } // namespace dates
 
 } // namespace pv
@@ -0,0 +1,125 @@
+#include "Kernels.h"
+#include <cstdint>
+#include <type_traits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PV_KERNELS_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// The vectorized versions load i64 arrays as 64-bit lanes
+static_assert(sizeof(pv::i64) == sizeof(std::int64_t) && std::is_signed_v<pv::i64>);
+
+#ifdef PV_KERNELS_AVX2
+
+// These are compiled for AVX2 while the rest of the program isn't, so they may only be called if hasAvx2()
+
+__attribute__((target("avx2"))) void prefixSumAvx2(const pv::i64* values, pv::i64* out, std::size_t count) noexcept {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i carry = zero; // The total so far, in every lane
+  std::size_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+    // Add each lane to the lane after it, then each pair of lanes to the two after them
+    x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x03));
+    x = _mm256_add_epi64(x, _mm256_blend_epi32(_mm256_permute4x64_epi64(x, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x0f));
+    x = _mm256_add_epi64(x, carry);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), x);
+    carry = _mm256_permute4x64_epi64(x, _MM_SHUFFLE(3, 3, 3, 3));
+  }
+  pv::i64 total = i == 0 ? 0 : out[i - 1];
+  for (; i < count; ++i) {
+    total += values[i];
+    out[i] = total;
+  }
+}
+
+__attribute__((target("avx2"))) pv::i64 sumAvx2(const pv::i64* values, std::size_t count) noexcept {
+  // Two accumulators, so that consecutive additions don't wait for each other
+  __m256i first = _mm256_setzero_si256();
+  __m256i second = _mm256_setzero_si256();
+  std::size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    first = _mm256_add_epi64(first, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i)));
+    second = _mm256_add_epi64(second, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i + 4)));
+  }
+  alignas(32) std::int64_t lanes[4];
+  _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(first, second));
+  pv::i64 total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  for (; i < count; ++i) {
+    total += values[i];
+  }
+  return total;
+}
+
+bool hasAvx2() noexcept {
+  static const bool result = __builtin_cpu_supports("avx2");
+  return result;
+}
+
+#endif
+
+} // namespace
+
+namespace pv {
+namespace kernels {
+
+namespace scalar {
+
+void prefixSum(const i64* values, i64* out, std::size_t count) noexcept {
+  i64 total = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    total += values[i];
+    out[i] = total;
+  }
+}
+
+i64 sum(const i64* values, std::size_t count) noexcept {
+  i64 total = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    total += values[i];
+  }
+  return total;
+}
+
+} // namespace scalar
+
+bool vectorized() noexcept {
+#ifdef PV_KERNELS_AVX2
+  return hasAvx2();
+#else
+  return false;
+#endif
+}
+
+void prefixSum(const i64* values, i64* out, std::size_t count) noexcept {
+#ifdef PV_KERNELS_AVX2
+  if (hasAvx2()) {
+    prefixSumAvx2(values, out, count);
+    return;
+  }
+#endif
+  scalar::prefixSum(values, out, count);
+}
+
+i64 sum(const i64* values, std::size_t count) noexcept {
+#ifdef PV_KERNELS_AVX2
+  if (hasAvx2()) {
+    return sumAvx2(values, count);
+  }
+#endif
+  return scalar::sum(values, count);
+}
+
+void segmentedSum(const i64* values, const std::size_t* ends, std::size_t segments, i64* out) noexcept {
+  std::size_t begin = 0;
+  for (std::size_t i = 0; i < segments; ++i) {
+    out[i] = sum(values + begin, ends[i] - begin);
+    begin = ends[i];
+  }
+}
+
+} // namespace kernels
+} // namespace pv
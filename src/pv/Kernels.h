@@ -0,0 +1,41 @@
+#ifndef PV_KERNELS_H
+#define PV_KERNELS_H
+
+#include "Integer64.h"
+#include <cstddef>
+
+namespace pv {
+
+/// \brief Loops over contiguous arrays of integers, which the ledger algorithms are built from.
+///
+/// On x86 processors with AVX2 (detected when the program runs), these process four values at a time; elsewhere they
+/// fall back to plain loops, with the same results.
+namespace kernels {
+
+/// \brief Returns whether the AVX2 versions are being used.
+bool vectorized() noexcept;
+
+/// \brief Writes the running total of \c values to \c out, i.e. <tt>out[i] = values[0] + ... + values[i]</tt>.
+///
+/// \c out may be the same array as \c values.
+void prefixSum(const i64* values, i64* out, std::size_t count) noexcept;
+
+/// \brief Returns the sum of \c values.
+i64 sum(const i64* values, std::size_t count) noexcept;
+
+/// \brief Sums consecutive runs of \c values.
+///
+/// Segment \c i is <tt>values[ends[i - 1]]</tt> up to (but not including) <tt>values[ends[i]]</tt>, where the first
+/// segment starts at 0. \c ends must be ascending and no greater than the length of \c values.
+void segmentedSum(const i64* values, const std::size_t* ends, std::size_t segments, i64* out) noexcept;
+
+/// \internal The plain versions, for comparing against the vectorized ones.
+namespace scalar {
+void prefixSum(const i64* values, i64* out, std::size_t count) noexcept;
+i64 sum(const i64* values, std::size_t count) noexcept;
+} // namespace scalar
+
+} // namespace kernels
+} // namespace pv
+
+#endif // PV_KERNELS_H
@@ -0,0 +1,342 @@
+#include "Ledger.h"
+#include "Trace.h"
+#include <algorithm>
+#include <sqlite3.h>
+#include <utility>
+
+namespace {
+
+// Both queries select the columns of Record, in order
+
+const char* ledgerQuery = R"(
+SELECT Transactions.Id, Transactions.Date, Transactions.AccountId, Transactions.Action,
+  COALESCE(BuyTransactions.SecurityId, SellTransactions.SecurityId, DepositTransactions.SecurityId,
+    WithdrawTransactions.SecurityId, DividendTransactions.SecurityId, InterestTransactions.SecurityId),
+  COALESCE(BuyTransactions.NumberOfShares, SellTransactions.NumberOfShares, 0),
+  COALESCE(BuyTransactions.SharePrice, SellTransactions.SharePrice, 0),
+  COALESCE(BuyTransactions.Commission, SellTransactions.Commission, 0),
+  COALESCE(BuyTransactions.Amount, SellTransactions.Amount, DepositTransactions.Amount, WithdrawTransactions.Amount,
+    DividendTransactions.Amount, InterestTransactions.Amount, 0)
+FROM Transactions
+  LEFT JOIN BuyTransactions ON Transactions.Id = BuyTransactions.TransactionId
+  LEFT JOIN SellTransactions ON Transactions.Id = SellTransactions.TransactionId
+  LEFT JOIN DepositTransactions ON Transactions.Id = DepositTransactions.TransactionId
+  LEFT JOIN WithdrawTransactions ON Transactions.Id = WithdrawTransactions.TransactionId
+  LEFT JOIN DividendTransactions ON Transactions.Id = DividendTransactions.TransactionId
+  LEFT JOIN InterestTransactions ON Transactions.Id = InterestTransactions.TransactionId
+ORDER BY Transactions.Date, Transactions.Id
+)";
+
+const char* ledgerTransactionQuery = R"(
+SELECT Transactions.Id, Transactions.Date, Transactions.AccountId, Transactions.Action,
+  COALESCE(BuyTransactions.SecurityId, SellTransactions.SecurityId, DepositTransactions.SecurityId,
+    WithdrawTransactions.SecurityId, DividendTransactions.SecurityId, InterestTransactions.SecurityId),
+  COALESCE(BuyTransactions.NumberOfShares, SellTransactions.NumberOfShares, 0),
+  COALESCE(BuyTransactions.SharePrice, SellTransactions.SharePrice, 0),
+  COALESCE(BuyTransactions.Commission, SellTransactions.Commission, 0),
+  COALESCE(BuyTransactions.Amount, SellTransactions.Amount, DepositTransactions.Amount, WithdrawTransactions.Amount,
+    DividendTransactions.Amount, InterestTransactions.Amount, 0)
+FROM Transactions
+  LEFT JOIN BuyTransactions ON Transactions.Id = BuyTransactions.TransactionId
+  LEFT JOIN SellTransactions ON Transactions.Id = SellTransactions.TransactionId
+  LEFT JOIN DepositTransactions ON Transactions.Id = DepositTransactions.TransactionId
+  LEFT JOIN WithdrawTransactions ON Transactions.Id = WithdrawTransactions.TransactionId
+  LEFT JOIN DividendTransactions ON Transactions.Id = DividendTransactions.TransactionId
+  LEFT JOIN InterestTransactions ON Transactions.Id = InterestTransactions.TransactionId
+WHERE Transactions.Id = ?
+)";
+
+/// \brief A single transaction, while it is being read or merged.
+struct Record {
+  pv::i64 id;
+  pv::i64 date;
+  pv::i64 account;
+  pv::Action action;
+  pv::i64 security;
+  pv::i64 numberOfShares;
+  pv::i64 sharePrice;
+  pv::i64 commission;
+  pv::i64 amount;
+};
+
+Record readRecord(sqlite3_stmt* stmt) {
+  return Record{sqlite3_column_int64(stmt, 0),
+                sqlite3_column_int64(stmt, 1),
+                sqlite3_column_int64(stmt, 2),
+                static_cast<pv::Action>(sqlite3_column_int(stmt, 3)),
+                sqlite3_column_type(stmt, 4) == SQLITE_NULL ? pv::Ledger::noSecurity : sqlite3_column_int64(stmt, 4),
+                sqlite3_column_int64(stmt, 5),
+                sqlite3_column_int64(stmt, 6),
+                sqlite3_column_int64(stmt, 7),
+                sqlite3_column_int64(stmt, 8)};
+}
+
+/// \brief If more transactions than this fraction of the ledger changed, it is reloaded instead of being patched.
+constexpr std::size_t reloadFraction = 4;
+
+} // namespace
+
+namespace pv {
+
+Ledger::Ledger(DataFile& dataFile) : dataFile(dataFile) {
+  auto markChanged = [this](i64 transaction) {
+    if (!reloadNeeded) {
+      changed.insert(transaction);
+    }
+  };
+  auto markReload = [this] {
+    reloadNeeded = true;
+    changed.clear();
+  };
+  // The change set is emitted before the signals for individual transactions, so this keeps the ledger up to date for
+  // anything that recalculates when it receives the change set
+  connections.emplace_back(dataFile.onChangeSet([markChanged](const ChangeSet& changes) {
+    for (auto transaction : changes.transactions) {
+      markChanged(transaction);
+    }
+  }));
+  connections.emplace_back(dataFile.onTransactionAdded(markChanged));
+  connections.emplace_back(dataFile.onTransactionUpdated(markChanged));
+  connections.emplace_back(dataFile.onTransactionRemoved(markChanged));
+  connections.emplace_back(dataFile.onTransactionsAdded([markChanged](const std::vector<i64>& transactions) {
+    for (auto transaction : transactions) {
+      markChanged(transaction);
+    }
+  }));
+  // The account's transactions are removed by ON DELETE CASCADE, without any signals of their own
+  connections.emplace_back(dataFile.onAccountRemoved([markReload](i64) { markReload(); }));
+  // Everything since the last commit is gone, and there is no record of what that was
+  connections.emplace_back(dataFile.onRollback(markReload));
+}
+
+void Ledger::sync() {
+  if (reloadNeeded) {
+    reload();
+  } else if (!changed.empty()) {
+    applyChanges();
+  }
+}
+
+void Ledger::reload() {
+  trace::Span span("Ledger::reload", "algorithms");
+  ids_.clear();
+  dates_.clear();
+  accounts_.clear();
+  actions_.clear();
+  securities_.clear();
+  numbersOfShares_.clear();
+  sharePrices_.clear();
+  commissions_.clear();
+  amounts_.clear();
+
+  auto* stmt = dataFile.cachedQuery(ledgerQuery);
+  if (stmt != nullptr) {
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      auto record = readRecord(stmt);
+      ids_.push_back(record.id);
+      dates_.push_back(record.date);
+      accounts_.push_back(record.account);
+      actions_.push_back(record.action);
+      securities_.push_back(record.security);
+      numbersOfShares_.push_back(record.numberOfShares);
+      sharePrices_.push_back(record.sharePrice);
+      commissions_.push_back(record.commission);
+      amounts_.push_back(record.amount);
+    }
+    sqlite3_reset(stmt);
+  }
+
+  reloadNeeded = false;
+  changed.clear();
+  rebuildDerived();
+}
+
+void Ledger::applyChanges() {
+  if (changed.size() > ids_.size() / reloadFraction) {
+    reload();
+    return;
+  }
+  trace::Span span("Ledger::applyChanges", "algorithms");
+
+  // Read the current version of every changed transaction; the ones that were removed aren't found
+  std::vector<Record> updated;
+  updated.reserve(changed.size());
+  auto* stmt = dataFile.cachedQuery(ledgerTransactionQuery);
+  if (stmt == nullptr) {
+    reload();
+    return;
+  }
+  for (auto transaction : changed) {
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(transaction));
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      updated.push_back(readRecord(stmt));
+    }
+    sqlite3_reset(stmt);
+  }
+  std::sort(updated.begin(), updated.end(), [](const Record& lhs, const Record& rhs) {
+    return lhs.date < rhs.date || (lhs.date == rhs.date && lhs.id < rhs.id);
+  });
+
+  // Merge the rows that didn't change with the updated ones, keeping them sorted by date and id
+  auto size = ids_.size() + updated.size();
+  std::vector<i64> ids, dates, accounts, securities, numbersOfShares, sharePrices, commissions, amounts;
+  std::vector<Action> actions;
+  for (auto* column : {&ids, &dates, &accounts, &securities, &numbersOfShares, &sharePrices, &commissions, &amounts}) {
+    column->reserve(size);
+  }
+  actions.reserve(size);
+
+  auto next = updated.cbegin();
+  auto appendUpdated = [&] {
+    ids.push_back(next->id);
+    dates.push_back(next->date);
+    accounts.push_back(next->account);
+    actions.push_back(next->action);
+    securities.push_back(next->security);
+    numbersOfShares.push_back(next->numberOfShares);
+    sharePrices.push_back(next->sharePrice);
+    commissions.push_back(next->commission);
+    amounts.push_back(next->amount);
+    ++next;
+  };
+  for (std::size_t row = 0; row < ids_.size(); ++row) {
+    if (changed.count(ids_[row]) != 0) {
+      continue;
+    }
+    while (next != updated.cend() && (next->date < dates_[row] || (next->date == dates_[row] && next->id < ids_[row]))) {
+      appendUpdated();
+    }
+    ids.push_back(ids_[row]);
+    dates.push_back(dates_[row]);
+    accounts.push_back(accounts_[row]);
+    actions.push_back(actions_[row]);
+    securities.push_back(securities_[row]);
+    numbersOfShares.push_back(numbersOfShares_[row]);
+    sharePrices.push_back(sharePrices_[row]);
+    commissions.push_back(commissions_[row]);
+    amounts.push_back(amounts_[row]);
+  }
+  while (next != updated.cend()) {
+    appendUpdated();
+  }
+
+  ids_ = std::move(ids);
+  dates_ = std::move(dates);
+  accounts_ = std::move(accounts);
+  actions_ = std::move(actions);
+  securities_ = std::move(securities);
+  numbersOfShares_ = std::move(numbersOfShares);
+  sharePrices_ = std::move(sharePrices);
+  commissions_ = std::move(commissions);
+  amounts_ = std::move(amounts);
+
+  changed.clear();
+  rebuildDerived();
+}
+
+void Ledger::rebuildDerived() {
+  accountRows_.clear();
+  securityRows_.clear();
+  cashChanges_.assign(ids_.size(), 0);
+  sharesChanges_.assign(ids_.size(), 0);
+  for (std::size_t row = 0; row < ids_.size(); ++row) {
+    accountRows_[accounts_[row]].push_back(static_cast<Row>(row));
+    if (securities_[row] != noSecurity) {
+      securityRows_[securities_[row]].push_back(static_cast<Row>(row));
+    }
+
+    switch (actions_[row]) {
+    case Action::BUY:
+      cashChanges_[row] = -amounts_[row];
+      sharesChanges_[row] = numbersOfShares_[row];
+      break;
+    case Action::SELL:
+      cashChanges_[row] = amounts_[row];
+      sharesChanges_[row] = -numbersOfShares_[row];
+      break;
+    case Action::DEPOSIT:
+    case Action::DIVIDEND: cashChanges_[row] = amounts_[row]; break;
+    case Action::WITHDRAW: cashChanges_[row] = -amounts_[row]; break;
+    default: break;
+    }
+  }
+}
+
+std::size_t Ledger::size() {
+  sync();
+  return ids_.size();
+}
+
+const std::vector<i64>& Ledger::ids() {
+  sync();
+  return ids_;
+}
+
+const std::vector<i64>& Ledger::dates() {
+  sync();
+  return dates_;
+}
+
+const std::vector<i64>& Ledger::accounts() {
+  sync();
+  return accounts_;
+}
+
+const std::vector<Action>& Ledger::actions() {
+  sync();
+  return actions_;
+}
+
+const std::vector<i64>& Ledger::securities() {
+  sync();
+  return securities_;
+}
+
+const std::vector<i64>& Ledger::numbersOfShares() {
+  sync();
+  return numbersOfShares_;
+}
+
+const std::vector<i64>& Ledger::sharePrices() {
+  sync();
+  return sharePrices_;
+}
+
+const std::vector<i64>& Ledger::commissions() {
+  sync();
+  return commissions_;
+}
+
+const std::vector<i64>& Ledger::amounts() {
+  sync();
+  return amounts_;
+}
+
+const std::vector<i64>& Ledger::cashChanges() {
+  sync();
+  return cashChanges_;
+}
+
+const std::vector<i64>& Ledger::sharesChanges() {
+  sync();
+  return sharesChanges_;
+}
+
+const std::vector<Ledger::Row>& Ledger::accountRows(i64 account) {
+  sync();
+  auto iter = accountRows_.find(account);
+  return iter != accountRows_.cend() ? iter->second : noRows;
+}
+
+const std::vector<Ledger::Row>& Ledger::securityRows(i64 security) {
+  sync();
+  auto iter = securityRows_.find(security);
+  return iter != securityRows_.cend() ? iter->second : noRows;
+}
+
+std::size_t Ledger::rowsUntil(i64 date) {
+  sync();
+  return static_cast<std::size_t>(std::upper_bound(dates_.cbegin(), dates_.cend(), date) - dates_.cbegin());
+}
+
+} // namespace pv
@@ -0,0 +1,112 @@
+#ifndef PV_LEDGER_H
+#define PV_LEDGER_H
+
+#include "DataFile.h"
+#include "Integer64.h"
+#include "Signals.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace pv {
+
+/// \brief An in-memory copy of every transaction in a data file, stored column by column.
+///
+/// Transactions are normally spread over \c Transactions and one table per action, so every calculation has to join
+/// them back together. A ledger does that once, and keeps one array per field (with the transactions sorted by date,
+/// then id), plus the rows of each account and of each security, so that the \c pv::algorithms overloads that take a
+/// ledger only have to scan arrays.
+///
+/// The ledger stays in sync with its data file through the data file's signals, including modifications made inside
+/// an open SQL transaction. Modifications are applied lazily, the next time a column or index is read, so that many
+/// small modifications only cost a single pass over the ledger. A rollback, or removing an account, reloads the whole
+/// ledger.
+///
+/// A ledger refers to a single \c DataFile object; create a new one if the data file is replaced. Like the data file,
+/// it may only be used by one thread at a time.
+class Ledger {
+public:
+  using Row = std::uint32_t;
+
+  /// \brief The security of a transaction without one (deposits and withdrawals may have no security).
+  static constexpr i64 noSecurity = std::numeric_limits<i64>::min();
+private:
+  DataFile& dataFile;
+
+  std::vector<i64> ids_;
+  std::vector<i64> dates_;
+  std::vector<i64> accounts_;
+  std::vector<Action> actions_;
+  std::vector<i64> securities_;
+  std::vector<i64> numbersOfShares_;
+  std::vector<i64> sharePrices_;
+  std::vector<i64> commissions_;
+  std::vector<i64> amounts_;
+  std::vector<i64> cashChanges_;
+  std::vector<i64> sharesChanges_;
+
+  std::unordered_map<i64, std::vector<Row>> accountRows_;
+  std::unordered_map<i64, std::vector<Row>> securityRows_;
+  const std::vector<Row> noRows;
+
+  bool reloadNeeded = true;
+  /// \internal Transactions added, updated or removed since the last sync.
+  std::unordered_set<i64> changed;
+
+  std::vector<ScopedConnection> connections;
+
+  void reload();
+  void applyChanges();
+  /// \internal Rebuilds the indices and the columns calculated from the others.
+  void rebuildDerived();
+public:
+  explicit Ledger(DataFile& dataFile);
+
+  Ledger(const Ledger&) = delete;
+  Ledger& operator=(const Ledger&) = delete;
+
+  /// \brief Applies every modification made to the data file since the last sync.
+  ///
+  /// This is called by every other function, so it rarely needs to be called directly.
+  void sync();
+
+  std::size_t size();
+
+  const std::vector<i64>& ids();
+  const std::vector<i64>& dates();
+  const std::vector<i64>& accounts();
+  const std::vector<Action>& actions();
+  /// \brief The security of each transaction, or \c noSecurity.
+  const std::vector<i64>& securities();
+  /// \brief The number of shares of each buy and sell, and 0 for other transactions.
+  const std::vector<i64>& numbersOfShares();
+  /// \brief The share price of each buy and sell, and 0 for other transactions.
+  const std::vector<i64>& sharePrices();
+  /// \brief The commission of each buy and sell, and 0 for other transactions.
+  const std::vector<i64>& commissions();
+  /// \brief The amount of each transaction. For buys and sells this includes the commission, like the \c Amount
+  /// column of their tables.
+  const std::vector<i64>& amounts();
+  /// \brief How much each transaction changes the cash balance of its account, calculated the same way as
+  /// \c pv::algorithms::cashBalance() (so interest isn't included).
+  const std::vector<i64>& cashChanges();
+  /// \brief How much each transaction changes the number of shares of its security held: the number of shares of
+  /// buys, minus the number of shares of sells, and 0 for other transactions.
+  const std::vector<i64>& sharesChanges();
+
+  /// \brief Returns the rows of the transactions of \c account, in order (and so by date).
+  const std::vector<Row>& accountRows(i64 account);
+
+  /// \brief Returns the rows of the transactions of \c security, in order (and so by date).
+  const std::vector<Row>& securityRows(i64 security);
+
+  /// \brief Returns the number of transactions dated on or before \c date, which is also the first row after them.
+  std::size_t rowsUntil(i64 date);
+};
+
+} // namespace pv
+
+#endif // PV_LEDGER_H
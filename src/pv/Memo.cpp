@@ -0,0 +1,80 @@
+#include "Memo.h"
+#include <functional>
+
+namespace pv {
+
+std::size_t Memo::KeyHash::operator()(const Key& key) const noexcept {
+  // Boost's hash_combine
+  std::size_t seed = static_cast<std::size_t>(key.function);
+  for (auto value : {key.security, key.account, key.date}) {
+    seed ^= std::hash<i64>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  }
+  return seed;
+}
+
+const std::optional<i64>* Memo::find(const Key& key, std::uint64_t version) noexcept {
+  if (!enabled_) {
+    return nullptr;
+  }
+  auto iter = index.find(key);
+  if (iter == index.end() || entries[iter->second].version != version) {
+    ++misses_;
+    return nullptr;
+  }
+  ++hits_;
+  auto& entry = entries[iter->second];
+  entry.lastUsed = ++uses;
+  return &entry.value;
+}
+
+void Memo::store(const Key& key, std::uint64_t version, std::optional<i64> value) {
+  if (!enabled_) {
+    return;
+  }
+  if (auto iter = index.find(key); iter != index.end()) {
+    entries[iter->second] = {key, version, value, ++uses};
+    return;
+  }
+  if (entries.size() >= capacity) {
+    evict();
+  }
+  entries.push_back({key, version, value, ++uses});
+  try {
+    index.emplace(key, entries.size() - 1);
+  } catch (...) {
+    entries.pop_back();
+    throw;
+  }
+}
+
+void Memo::evict() noexcept {
+  std::uniform_int_distribution<std::size_t> slots(0, entries.size() - 1);
+  std::size_t victim = slots(random);
+  for (int i = 1; i < evictionSamples; ++i) {
+    auto slot = slots(random);
+    if (entries[slot].lastUsed < entries[victim].lastUsed) {
+      victim = slot;
+    }
+  }
+
+  index.erase(entries[victim].key);
+  if (victim != entries.size() - 1) {
+    entries[victim] = entries.back();
+    index.find(entries[victim].key)->second = victim;
+  }
+  entries.pop_back();
+}
+
+void Memo::setEnabled(bool enabled) noexcept {
+  enabled_ = enabled;
+  if (!enabled) {
+    clear();
+  }
+}
+
+void Memo::clear() noexcept {
+  index.clear();
+  entries.clear();
+}
+
+} // namespace pv
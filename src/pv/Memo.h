@@ -0,0 +1,106 @@
+#ifndef PV_MEMO_H
+#define PV_MEMO_H
+
+#include "Integer64.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace pv {
+
+/// \brief Remembers the results of the \c pv::algorithms functions that query a data file, so that asking the same
+/// question again (which the functions built from them do a lot) is a hash lookup instead of a query.
+///
+/// Each data file has its own memo (see \c DataFile::memo()). Every result is stored with the modification version
+/// of its security and account (see \c DataFile::securityVersion()), and is only used while that version is
+/// unchanged, so modifying a transaction or a price only forgets the results that it may have changed. When the
+/// memo holds \c capacity results, the least recently used of a few chosen at random is forgotten to make room for
+/// another one. Unlike strictly least recently used eviction, this keeps most of a working set that is a little too
+/// large, even when it is asked for in the same order every time (like the holdings of a large portfolio).
+class Memo {
+public:
+  /// \brief The functions whose results are remembered.
+  enum class Function : unsigned char {
+    CashBalance,
+    SharesHeld,
+    SharesSold,
+    DividendIncome,
+    InterestIncome,
+    SharePrice,
+    AverageBuyPrice,
+    AverageSellPrice,
+  };
+
+  /// \brief Used in a key for a function that doesn't take a security, an account or a date.
+  static constexpr i64 none = std::numeric_limits<i64>::min();
+
+  struct Key {
+    Function function;
+    i64 security;
+    i64 account;
+    i64 date;
+
+    bool operator==(const Key& other) const noexcept {
+      return function == other.function && security == other.security && account == other.account &&
+             date == other.date;
+    }
+  };
+
+  static constexpr std::size_t capacity = std::size_t(1) << 16;
+private:
+  struct KeyHash {
+    std::size_t operator()(const Key& key) const noexcept;
+  };
+
+  struct Entry {
+    Key key;
+    std::uint64_t version;
+    std::optional<i64> value;
+    std::uint64_t lastUsed;
+  };
+
+  /// \internal The number of entries that are compared to choose which one to forget.
+  static constexpr int evictionSamples = 2;
+
+  std::vector<Entry> entries;
+  std::unordered_map<Key, std::size_t, KeyHash> index;
+  std::uint64_t uses = 0;
+  std::minstd_rand random;
+  bool enabled_ = true;
+  std::uint64_t hits_ = 0;
+  std::uint64_t misses_ = 0;
+
+  /// \internal Forgets an entry that hasn't been used recently.
+  void evict() noexcept;
+public:
+  /// \brief Returns the result stored for \c key, or \c nullptr if there is none, or it was stored at a different
+  /// \c version.
+  ///
+  /// The result is only valid until the next call to \c store().
+  const std::optional<i64>* find(const Key& key, std::uint64_t version) noexcept;
+
+  void store(const Key& key, std::uint64_t version, std::optional<i64> value);
+
+  bool enabled() const noexcept { return enabled_; }
+
+  /// \brief Turns memoization on or off. Turning it off also forgets every result.
+  void setEnabled(bool enabled) noexcept;
+
+  void clear() noexcept;
+
+  std::size_t size() const noexcept { return index.size(); }
+
+  /// \brief The number of lookups that found a result, since the memo was created.
+  std::uint64_t hits() const noexcept { return hits_; }
+
+  /// \brief The number of lookups that didn't find a result, since the memo was created.
+  std::uint64_t misses() const noexcept { return misses_; }
+};
+
+} // namespace pv
+
+#endif // PV_MEMO_H
@@ -0,0 +1,161 @@
+#include "PriceCsvParser.h"
+#include "Date.h"
+#include <algorithm>
+#include <optional>
+
+namespace {
+
+bool isDigit(char c) noexcept { return c >= '0' && c <= '9'; }
+
+/// \internal Parses exactly \c count digits from the start of \c string.
+std::optional<pv::i64> parseDigits(std::string_view string, std::size_t count) {
+  if (string.size() < count) {
+    return std::nullopt;
+  }
+  pv::i64 value = 0;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (!isDigit(string[i])) {
+      return std::nullopt;
+    }
+    value = value * 10 + (string[i] - '0');
+  }
+  return value;
+}
+
+} // namespace
+
+namespace pv {
+
+std::optional<i64> parseCsvDate(std::string_view string) {
+  if (string.size() != 10 || string[4] != '-' || string[7] != '-') {
+    return std::nullopt;
+  }
+  auto year = parseDigits(string, 4);
+  auto month = parseDigits(string.substr(5), 2);
+  auto day = parseDigits(string.substr(8), 2);
+  if (!year || !month || !day || *month < 1 || *month > 12 || *day < 1) {
+    return std::nullopt;
+  }
+  constexpr i64 daysInMonth[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  bool leapYear = *year % 4 == 0 && (*year % 100 != 0 || *year % 400 == 0);
+  if (*day > daysInMonth[*month - 1] + (*month == 2 && leapYear ? 1 : 0)) {
+    return std::nullopt;
+  }
+  return dates::fromYearMonthDay(*year, *month, *day);
+}
+
+std::optional<i64> parseCsvPrice(std::string_view string) {
+  bool negative = !string.empty() && string.front() == '-';
+  if (negative || (!string.empty() && string.front() == '+')) {
+    string.remove_prefix(1);
+  }
+
+  std::size_t i = 0;
+  i64 whole = 0;
+  for (; i < string.size() && isDigit(string[i]); ++i) {
+    if (whole > 1'000'000'000'000'000) {
+      return std::nullopt; // Would overflow once in cents
+    }
+    whole = whole * 10 + (string[i] - '0');
+  }
+  std::size_t wholeDigits = i;
+
+  i64 fraction = 0; // In thousandths, the last digit only deciding the rounding
+  std::size_t fractionDigits = 0;
+  if (i < string.size() && string[i] == '.') {
+    for (++i; i < string.size() && isDigit(string[i]); ++i, ++fractionDigits) {
+      if (fractionDigits < 3) {
+        fraction = fraction * 10 + (string[i] - '0');
+      }
+    }
+  }
+  if (i != string.size() || wholeDigits + fractionDigits == 0) {
+    return std::nullopt;
+  }
+  for (auto digits = fractionDigits; digits < 3; ++digits) {
+    fraction *= 10;
+  }
+
+  i64 cents = whole * 100 + (fraction + 5) / 10;
+  return negative ? -cents : cents;
+}
+
+PriceCsvParser::PriceCsvParser(std::size_t dateColumn, std::size_t priceColumn, std::size_t headerRows)
+    : dateColumn(dateColumn), priceColumn(priceColumn), headerRows(headerRows) {}
+
+void PriceCsvParser::parseLine(std::string_view line) {
+  if (lines++ < headerRows) {
+    return;
+  }
+  if (!line.empty() && line.back() == '\r') {
+    line.remove_suffix(1);
+  }
+
+  std::string_view dateField;
+  std::string_view priceField;
+  bool priceFound = false;
+  for (std::size_t column = 0;; ++column) {
+    auto comma = line.find(',');
+    auto field = line.substr(0, comma);
+    if (column == dateColumn) {
+      dateField = field;
+    }
+    if (column == priceColumn) {
+      priceField = field;
+      priceFound = true;
+    }
+    if (comma == std::string_view::npos || column >= std::max(dateColumn, priceColumn)) {
+      break;
+    }
+    line.remove_prefix(comma + 1);
+  }
+  if (!priceFound) {
+    return; // Not enough columns, which includes blank lines
+  }
+
+  auto date = parseCsvDate(dateField);
+  auto price = parseCsvPrice(priceField);
+  if (!date || !price) {
+    return;
+  }
+  if (!history.dates.empty() && *date <= history.dates.back()) {
+    sorted = false;
+  }
+  history.dates.push_back(*date);
+  history.prices.push_back(*price);
+}
+
+void PriceCsvParser::feed(std::string_view chunk) {
+  auto newline = chunk.find('\n');
+  if (!partial.empty()) {
+    // Finish the line started by the last chunk, which is the only one that needs to be copied
+    partial.append(chunk.data(), newline == std::string_view::npos ? chunk.size() : newline);
+    if (newline == std::string_view::npos) {
+      return;
+    }
+    parseLine(partial);
+    partial.clear();
+    chunk.remove_prefix(newline + 1);
+    newline = chunk.find('\n');
+  }
+
+  while (newline != std::string_view::npos) {
+    parseLine(chunk.substr(0, newline));
+    chunk.remove_prefix(newline + 1);
+    newline = chunk.find('\n');
+  }
+  partial.assign(chunk.data(), chunk.size());
+}
+
+PriceHistory PriceCsvParser::finish() {
+  if (!partial.empty()) {
+    parseLine(partial);
+    partial.clear();
+  }
+  if (!sorted) {
+    history.sort(); // Yahoo Finance's files are already in order, so this is rarely needed
+  }
+  return std::move(history);
+}
+
+} // namespace pv
@@ -0,0 +1,58 @@
+#ifndef PV_PRICECSVPARSER_H
+#define PV_PRICECSVPARSER_H
+
+#include "Integer64.h"
+#include "PriceHistory.h"
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pv {
+
+/// \brief Parses a YYYY-MM-DD date, as days since 1970-01-01, or returns \c std::nullopt if it isn't one.
+std::optional<i64> parseCsvDate(std::string_view string);
+
+/// \brief Parses a decimal price (without an exponent) as cents, rounding exactly half a cent away from zero, or
+/// returns \c std::nullopt if it isn't one.
+std::optional<i64> parseCsvPrice(std::string_view string);
+
+/// \brief Parses price histories in CSV format (such as Yahoo Finance's), a chunk at a time as they are downloaded.
+///
+/// Each line has a YYYY-MM-DD date and a decimal price, in the columns given to the constructor. Lines are parsed in
+/// place in the chunk they arrive in, so the only copying is of a line split between two chunks. Lines whose date or
+/// price can't be parsed (for example, Yahoo Finance writes \c null for missing prices) are skipped.
+///
+/// Prices are rounded to cents from their decimal digits, so unlike rounding the nearest \c double, exactly half a
+/// cent always rounds away from zero.
+class PriceCsvParser {
+private:
+  std::size_t dateColumn;
+  std::size_t priceColumn;
+  std::size_t headerRows;
+
+  std::size_t lines = 0;
+  /// \internal The start of a line that continues in the next chunk.
+  std::string partial;
+  PriceHistory history;
+  bool sorted = true;
+
+  void parseLine(std::string_view line);
+public:
+  /// \brief Creates a parser for files with \c headerRows lines before the prices. The defaults are for Yahoo
+  /// Finance's history downloads, where the fifth column is the closing price.
+  explicit PriceCsvParser(std::size_t dateColumn = 0, std::size_t priceColumn = 4, std::size_t headerRows = 1);
+
+  /// \brief Parses the next chunk of the file. Chunks may be split anywhere.
+  void feed(std::string_view chunk);
+
+  /// \brief Parses the last line (which doesn't need to end with a newline), and returns every price parsed.
+  ///
+  /// If a date appears more than once, its first price is kept. The parser can't be used afterwards.
+  PriceHistory finish();
+};
+
+} // namespace pv
+
+#endif // PV_PRICECSVPARSER_H
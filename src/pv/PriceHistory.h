@@ -0,0 +1,57 @@
+#ifndef PV_PRICEHISTORY_H
+#define PV_PRICEHISTORY_H
+
+#include "Integer64.h"
+#include <algorithm>
+#include <cstddef>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace pv {
+
+/// \brief A security's prices, sorted by date, with at most one price per date.
+struct PriceHistory {
+  std::vector<i64> dates;
+  std::vector<i64> prices;
+
+  std::size_t size() const noexcept { return dates.size(); }
+  bool empty() const noexcept { return dates.empty(); }
+
+  /// \brief Removes the prices dated on or after \c date.
+  void eraseFrom(i64 date) {
+    auto count = static_cast<std::size_t>(std::lower_bound(dates.cbegin(), dates.cend(), date) - dates.cbegin());
+    dates.resize(count);
+    prices.resize(count);
+  }
+
+  /// \brief Removes the prices dated before \c date.
+  void eraseBefore(i64 date) {
+    auto count = std::lower_bound(dates.cbegin(), dates.cend(), date) - dates.cbegin();
+    dates.erase(dates.begin(), dates.begin() + count);
+    prices.erase(prices.begin(), prices.begin() + count);
+  }
+
+  /// \brief Sorts prices that were added in any order, keeping the first price of each date.
+  void sort() {
+    if (std::is_sorted(dates.cbegin(), dates.cend(), [](i64 lhs, i64 rhs) { return lhs <= rhs; })) {
+      return; // Already sorted without duplicates, as most sources are
+    }
+    std::vector<std::size_t> order(size());
+    std::iota(order.begin(), order.end(), std::size_t(0));
+    std::stable_sort(order.begin(), order.end(),
+                     [this](std::size_t lhs, std::size_t rhs) { return dates[lhs] < dates[rhs]; });
+    PriceHistory result;
+    for (auto i : order) {
+      if (result.dates.empty() || result.dates.back() != dates[i]) {
+        result.dates.push_back(dates[i]);
+        result.prices.push_back(prices[i]);
+      }
+    }
+    *this = std::move(result);
+  }
+};
+
+} // namespace pv
+
+#endif // PV_PRICEHISTORY_H
@@ -0,0 +1,131 @@
+#include "PriceIndex.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstddef>
+#include <sqlite3.h>
+
+namespace {
+
+const char* priceIndexQuery = "SELECT SecurityId, Date, Price FROM SecurityPrices ORDER BY SecurityId, Date";
+
+const char* priceIndexSecurityQuery = "SELECT Date, Price FROM SecurityPrices WHERE SecurityId = ? ORDER BY Date";
+
+} // namespace
+
+namespace pv {
+
+PriceIndex::PriceIndex(DataFile& dataFile) : dataFile(dataFile) {
+  auto markStale = [this](i64 security) {
+    if (!reloadNeeded) {
+      stale.insert(security);
+    }
+  };
+  // The change set is emitted before the signals for individual prices, so this keeps the index up to date for
+  // anything that recalculates when it receives the change set
+  connections.emplace_back(dataFile.onChangeSet([markStale](const ChangeSet& changes) {
+    for (const auto& price : changes.securityPrices) {
+      markStale(price.first);
+    }
+    for (auto security : changes.securities) {
+      markStale(security); // A removed security's prices are removed without being listed
+    }
+  }));
+  connections.emplace_back(dataFile.onSecurityPriceUpdated([markStale](i64 security, i64) { markStale(security); }));
+  connections.emplace_back(dataFile.onSecurityPriceRemoved([markStale](i64 security, i64) { markStale(security); }));
+  connections.emplace_back(
+      dataFile.onSecurityPricesUpdated([markStale](i64 security, const std::vector<i64>&) { markStale(security); }));
+  connections.emplace_back(dataFile.onSecurityRemoved(markStale));
+  connections.emplace_back(dataFile.onRollback([this] {
+    reloadNeeded = true;
+    stale.clear();
+  }));
+}
+
+void PriceIndex::reload() {
+  trace::Span span("PriceIndex::reload", "algorithms");
+  histories.clear();
+  auto* stmt = dataFile.cachedQuery(priceIndexQuery);
+  if (stmt != nullptr) {
+    History* current = nullptr;
+    i64 currentSecurity = 0;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      i64 security = sqlite3_column_int64(stmt, 0);
+      if (current == nullptr || security != currentSecurity) {
+        current = &histories[security];
+        currentSecurity = security;
+      }
+      current->dates.push_back(sqlite3_column_int64(stmt, 1));
+      current->prices.push_back(sqlite3_column_int64(stmt, 2));
+    }
+    sqlite3_reset(stmt);
+  }
+  reloadNeeded = false;
+  stale.clear();
+}
+
+const PriceIndex::History& PriceIndex::history(i64 security) {
+  if (reloadNeeded) {
+    reload();
+  }
+
+  if (stale.erase(security) != 0) {
+    History history;
+    auto* stmt = dataFile.cachedQuery(priceIndexSecurityQuery);
+    if (stmt != nullptr) {
+      sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(security));
+      while (sqlite3_step(stmt) == SQLITE_ROW) {
+        history.dates.push_back(sqlite3_column_int64(stmt, 0));
+        history.prices.push_back(sqlite3_column_int64(stmt, 1));
+      }
+      sqlite3_reset(stmt);
+    }
+    if (history.dates.empty()) {
+      histories.erase(security);
+    } else {
+      histories[security] = std::move(history);
+    }
+  }
+
+  auto iter = histories.find(security);
+  return iter != histories.cend() ? iter->second : noHistory;
+}
+
+std::optional<i64> PriceIndex::price(i64 security, i64 date) {
+  const auto& history = this->history(security);
+  auto count = std::upper_bound(history.dates.cbegin(), history.dates.cend(), date) - history.dates.cbegin();
+  if (count == 0) {
+    return std::nullopt;
+  }
+  return history.prices[static_cast<std::size_t>(count - 1)];
+}
+
+std::vector<std::vector<std::optional<i64>>> PriceIndex::prices(const std::vector<i64>& securities,
+                                                                const std::vector<i64>& dates) {
+  trace::Span span("PriceIndex::prices", "algorithms");
+  std::vector<std::size_t> order(dates.size());
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](std::size_t lhs, std::size_t rhs) { return dates[lhs] < dates[rhs]; });
+
+  std::vector<std::vector<std::optional<i64>>> result;
+  result.reserve(securities.size());
+  for (auto security : securities) {
+    const auto& history = this->history(security);
+    std::vector<std::optional<i64>> row(dates.size());
+    // Both the history and the dates are in order, so each only has to be walked through once
+    std::size_t next = 0;
+    for (auto i : order) {
+      while (next < history.dates.size() && history.dates[next] <= dates[i]) {
+        ++next;
+      }
+      if (next != 0) {
+        row[i] = history.prices[next - 1];
+      }
+    }
+    result.push_back(std::move(row));
+  }
+  return result;
+}
+
+} // namespace pv
@@ -0,0 +1,61 @@
+#ifndef PV_PRICEINDEX_H
+#define PV_PRICEINDEX_H
+
+#include "DataFile.h"
+#include "Integer64.h"
+#include "Signals.h"
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace pv {
+
+/// \brief An in-memory copy of the price history of every security, for looking up many prices at once.
+///
+/// Each security's prices are kept as arrays of dates and prices, sorted by date. Everything is loaded with a single
+/// query the first time it is needed. After that, when prices are set or removed (as told by the data file's
+/// signals), only the securities whose prices changed are read again, the next time they are looked up. A rollback
+/// reloads everything.
+///
+/// Like \c Ledger, a price index refers to a single \c DataFile object, and may only be used by one thread at a time.
+class PriceIndex {
+private:
+  struct History {
+    std::vector<i64> dates;
+    std::vector<i64> prices;
+  };
+
+  DataFile& dataFile;
+  std::unordered_map<i64, History> histories;
+  const History noHistory;
+
+  bool reloadNeeded = true;
+  /// \internal Securities whose prices changed since they were loaded.
+  std::unordered_set<i64> stale;
+
+  std::vector<ScopedConnection> connections;
+
+  void reload();
+  const History& history(i64 security);
+public:
+  explicit PriceIndex(DataFile& dataFile);
+
+  PriceIndex(const PriceIndex&) = delete;
+  PriceIndex& operator=(const PriceIndex&) = delete;
+
+  /// \brief Returns the most recent price of \c security on or before \c date, the same as
+  /// \c pv::algorithms::sharePrice().
+  std::optional<i64> price(i64 security, i64 date);
+
+  /// \brief Returns the most recent price of each of \c securities on or before each of \c dates.
+  ///
+  /// The result has one row per security, with one price per date. Each row is filled by a single sweep through the
+  /// security's history alongside the sorted dates, rather than a search per date. \c dates may be in any order.
+  std::vector<std::vector<std::optional<i64>>> prices(const std::vector<i64>& securities,
+                                                      const std::vector<i64>& dates);
+};
+
+} // namespace pv
+
+#endif // PV_PRICEINDEX_H
@@ -0,0 +1,71 @@
+#include "PriceProvider.h"
+#include "Trace.h"
+#include <algorithm>
+#include <sqlite3.h>
+#include <utility>
+
+namespace {
+
+const char* securitySymbolsQuery = "SELECT Id, Symbol FROM Securities ORDER BY Id";
+
+} // namespace
+
+namespace pv {
+
+PriceImport importPrices(DataFile& dataFile, PriceProvider& provider, i64 begin, i64 end, PriceConflictPolicy policy,
+                         std::size_t batchSize) {
+  trace::Span span("importPrices", "datafile");
+  PriceImport import;
+
+  std::vector<std::pair<i64, std::string>> securities;
+  auto* stmt = dataFile.cachedQuery(securitySymbolsQuery);
+  if (stmt == nullptr) {
+    import.result = ResultCode::DbError;
+    return import;
+  }
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    const auto* symbol = sqlite3_column_text(stmt, 1);
+    securities.emplace_back(sqlite3_column_int64(stmt, 0),
+                            std::string(symbol, symbol + sqlite3_column_bytes(stmt, 1)));
+  }
+  sqlite3_reset(stmt);
+
+  import.result = dataFile.beginTransaction();
+  if (import.result != ResultCode::Ok) {
+    return import;
+  }
+  if (provider.readsEverything()) {
+    batchSize = securities.size(); // Reading it all once beats reading it all for every batch
+  }
+  batchSize = std::max<std::size_t>(batchSize, 1);
+  for (std::size_t first = 0; first < securities.size(); first += batchSize) {
+    auto last = std::min(first + batchSize, securities.size());
+    std::vector<PriceQuery> queries;
+    queries.reserve(last - first);
+    for (auto i = first; i < last; ++i) {
+      queries.push_back({securities[i].second, begin, end});
+    }
+
+    auto histories = provider.prices(queries);
+    for (auto i = first; i < last; ++i) {
+      const auto& history = histories[i - first];
+      if (!history.has_value()) {
+        import.missing.push_back(securities[i].second);
+        continue;
+      }
+      import.result = dataFile.setSecurityPrices(securities[i].first, *history, policy);
+      if (import.result != ResultCode::Ok) {
+        dataFile.rollbackTransaction();
+        import.securities = 0;
+        import.prices = 0;
+        return import;
+      }
+      ++import.securities;
+      import.prices += history->size();
+    }
+  }
+  import.result = dataFile.commitTransaction();
+  return import;
+}
+
+} // namespace pv
@@ -0,0 +1,61 @@
+#ifndef PV_PRICEPROVIDER_H
+#define PV_PRICEPROVIDER_H
+
+#include "DataFile.h"
+#include "Integer64.h"
+#include "PriceHistory.h"
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace pv {
+
+/// \brief The prices of \c symbol dated from \c begin (inclusive) to \c end (exclusive).
+struct PriceQuery {
+  std::string symbol;
+  i64 begin = 0;
+  i64 end = 0;
+};
+
+/// \brief A source of price histories other than downloading them, such as files of market data.
+///
+/// Dates are days since 1970-01-01 in the calendar of the source, like those parsed by \c PriceCsvParser.
+class PriceProvider {
+public:
+  virtual ~PriceProvider() = default;
+
+  /// \brief Returns the prices answering each of \c queries, in the same order, or \c std::nullopt for a symbol the
+  /// provider has no prices for.
+  ///
+  /// Providers answer many queries at once so that they can work on them in parallel. This may be called from any
+  /// thread, but not from more than one at a time.
+  virtual std::vector<std::optional<PriceHistory>> prices(const std::vector<PriceQuery>& queries) = 0;
+
+  /// \brief Checks if each call to \c prices() reads all of the provider's data, however few queries it answers, so
+  /// that it should be asked for everything at once rather than in batches.
+  virtual bool readsEverything() const noexcept { return false; }
+};
+
+/// \brief The outcome of \c importPrices().
+struct PriceImport {
+  ResultCode result = ResultCode::Ok;
+  /// \brief The number of securities that the provider had prices for.
+  std::size_t securities = 0;
+  std::size_t prices = 0;
+  /// \brief The symbols that the provider had no prices for.
+  std::vector<std::string> missing;
+};
+
+/// \brief Stores the prices of every security in \c dataFile from \c provider, dated from \c begin (inclusive) to
+/// \c end (exclusive), with \c DataFile::setSecurityPrices().
+///
+/// Securities are asked for and stored \c batchSize at a time, so that memory use doesn't grow with the number of
+/// securities, all inside one SQL transaction. Either every price is stored or none are. Providers that read all of
+/// their data for each batch (see \c PriceProvider::readsEverything()) are asked for every security at once instead.
+PriceImport importPrices(DataFile& dataFile, PriceProvider& provider, i64 begin, i64 end,
+                         PriceConflictPolicy policy = PriceConflictPolicy::Replace, std::size_t batchSize = 256);
+
+} // namespace pv
+
+#endif // PV_PRICEPROVIDER_H
@@ -0,0 +1,68 @@
+#include "PriceRefresh.h"
+#include "Trace.h"
+#include <algorithm>
+#include <optional>
+#include <sqlite3.h>
+#include <unordered_set>
+
+namespace {
+
+// The last price of each security is found with the primary key of SecurityPrices, without reading the others
+const char* priceRefreshQuery = R"(
+SELECT Securities.Id, Securities.Symbol,
+  (SELECT MAX(Date) FROM SecurityPrices WHERE SecurityPrices.SecurityId = Securities.Id),
+  SecurityPriceFetches.Through, SecurityPriceFetches.At
+FROM Securities
+  LEFT JOIN SecurityPriceFetches ON Securities.Id = SecurityPriceFetches.SecurityId
+ORDER BY Securities.Id
+)";
+
+std::optional<pv::i64> columnOrNull(sqlite3_stmt* stmt, int column) {
+  if (sqlite3_column_type(stmt, column) == SQLITE_NULL) {
+    return std::nullopt;
+  }
+  return sqlite3_column_int64(stmt, column);
+}
+
+} // namespace
+
+namespace pv {
+
+std::vector<PriceRefresh> planPriceRefresh(DataFile& dataFile, const std::vector<i64>& securities, i64 today,
+                                           i64 now, i64 defaultFrom) {
+  trace::Span span("planPriceRefresh", "datafile");
+  std::unordered_set<i64> wanted(securities.cbegin(), securities.cend());
+
+  std::vector<PriceRefresh> refreshes;
+  auto* stmt = dataFile.cachedQuery(priceRefreshQuery);
+  if (stmt == nullptr) {
+    return refreshes;
+  }
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    i64 security = sqlite3_column_int64(stmt, 0);
+    if (!wanted.empty() && wanted.count(security) == 0) {
+      continue;
+    }
+    auto lastPrice = columnOrNull(stmt, 2);
+    auto fetchedThrough = columnOrNull(stmt, 3);
+    auto fetchedAt = columnOrNull(stmt, 4);
+    if (fetchedThrough.has_value() && *fetchedThrough >= today && now - fetchedAt.value_or(0) < priceRefreshInterval) {
+      continue;
+    }
+
+    i64 from = defaultFrom;
+    if (lastPrice.has_value() || fetchedThrough.has_value()) {
+      from = std::max(lastPrice.value_or(*fetchedThrough), fetchedThrough.value_or(*lastPrice));
+    }
+    if (from > today) {
+      continue; // Only prices set by hand can be in the future
+    }
+
+    const auto* symbol = sqlite3_column_text(stmt, 1);
+    refreshes.push_back({security, std::string(symbol, symbol + sqlite3_column_bytes(stmt, 1)), from});
+  }
+  sqlite3_reset(stmt);
+  return refreshes;
+}
+
+} // namespace pv
@@ -0,0 +1,37 @@
+#ifndef PV_PRICEREFRESH_H
+#define PV_PRICEREFRESH_H
+
+#include "DataFile.h"
+#include "Integer64.h"
+#include <string>
+#include <vector>
+
+namespace pv {
+
+/// \brief The prices of a security that need to be downloaded, from \c from through today.
+struct PriceRefresh {
+  i64 security = 0;
+  std::string symbol;
+  i64 from = 0;
+};
+
+/// \brief How long after downloading a security's prices through today they are still current, in seconds. Quotes
+/// are delayed by about as much anyway.
+constexpr i64 priceRefreshInterval = 15 * 60;
+
+/// \brief Works out which prices of \c securities (or every security, if it is empty) to download, so that
+/// refreshing them only downloads what is missing.
+///
+/// Each security's prices are downloaded from the later of its last price and the last date requested by its last
+/// download (see \c DataFile::setPriceFetch()). That date is downloaded again since its price may have been taken
+/// before the market closed. Securities without either start from \c defaultFrom. Securities that were downloaded
+/// through \c today less than \c priceRefreshInterval before \c now are skipped.
+///
+/// \param today the date used by the data file for today
+/// \param now the current time, in seconds since 1970-01-01 UTC
+std::vector<PriceRefresh> planPriceRefresh(DataFile& dataFile, const std::vector<i64>& securities, i64 today,
+                                           i64 now, i64 defaultFrom);
+
+} // namespace pv
+
+#endif // PV_PRICEREFRESH_H
@@ -0,0 +1,99 @@
+#include "QueryProfiler.h"
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+namespace {
+
+std::uint64_t percentile(const std::vector<std::uint64_t>& sorted, double fraction) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  auto index = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+  return sorted[std::min(index, sorted.size() - 1)];
+}
+
+} // namespace
+
+namespace pv {
+
+std::string QueryProfiler::normalize(const char* sql) {
+  std::string result;
+  bool pendingSpace = false;
+  for (const char* c = sql; c != nullptr && *c != '\0'; ++c) {
+    if (std::isspace(static_cast<unsigned char>(*c))) {
+      pendingSpace = !result.empty();
+      continue;
+    }
+    if (pendingSpace) {
+      result += ' ';
+      pendingSpace = false;
+    }
+    result += *c;
+  }
+  return result;
+}
+
+std::size_t QueryProfiler::statement(const char* sql) {
+  std::string normalized = normalize(sql);
+  std::lock_guard lock(mutex);
+  auto iter = indices.find(normalized);
+  if (iter != indices.cend()) {
+    return iter->second;
+  }
+  entries.push_back(Entry{StatementProfile{normalized}, {}});
+  indices.emplace(std::move(normalized), entries.size() - 1);
+  return entries.size() - 1;
+}
+
+void QueryProfiler::record(std::size_t statement, std::uint64_t nanoseconds, std::uint64_t rows) {
+  std::lock_guard lock(mutex);
+  auto& entry = entries.at(statement);
+  auto& profile = entry.profile;
+  ++profile.executions;
+  profile.rows += rows;
+  profile.totalTime += nanoseconds;
+  profile.maxTime = std::max(profile.maxTime, nanoseconds);
+
+  // Reservoir sampling, so that every execution is equally likely to be in the sample
+  if (entry.samples.size() < maxSamples) {
+    entry.samples.push_back(nanoseconds);
+  } else {
+    auto index = static_cast<std::uint64_t>(random()) % profile.executions;
+    if (index < maxSamples) {
+      entry.samples[static_cast<std::size_t>(index)] = nanoseconds;
+    }
+  }
+}
+
+std::vector<StatementProfile> QueryProfiler::profile() const {
+  std::vector<StatementProfile> result;
+  {
+    std::lock_guard lock(mutex);
+    for (const auto& entry : entries) {
+      if (entry.profile.executions == 0) {
+        continue;
+      }
+      auto samples = entry.samples;
+      std::sort(samples.begin(), samples.end());
+      StatementProfile profile = entry.profile;
+      profile.medianTime = percentile(samples, 0.5);
+      profile.p90Time = percentile(samples, 0.9);
+      profile.p99Time = percentile(samples, 0.99);
+      result.push_back(std::move(profile));
+    }
+  }
+  std::sort(result.begin(), result.end(),
+            [](const StatementProfile& lhs, const StatementProfile& rhs) { return lhs.totalTime > rhs.totalTime; });
+  return result;
+}
+
+void QueryProfiler::reset() {
+  std::lock_guard lock(mutex);
+  for (auto& entry : entries) {
+    entry.profile = StatementProfile{std::move(entry.profile.sql)};
+    entry.samples.clear();
+  }
+}
+
+} // namespace pv
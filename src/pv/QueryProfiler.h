@@ -0,0 +1,70 @@
+#ifndef PV_QUERYPROFILER_H
+#define PV_QUERYPROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pv {
+
+/// \brief How often a single SQL statement ran, and how long it took.
+///
+/// Times are in nanoseconds, from the first step of an execution until it finishes or is reset, so they include any
+/// time the caller spends between steps.
+struct StatementProfile {
+  /// \brief The SQL of the statement, with its whitespace collapsed.
+  std::string sql;
+  std::uint64_t executions = 0;
+  /// \brief The number of result rows stepped through, over every execution.
+  std::uint64_t rows = 0;
+  std::uint64_t totalTime = 0;
+  std::uint64_t medianTime = 0;
+  std::uint64_t p90Time = 0;
+  std::uint64_t p99Time = 0;
+  std::uint64_t maxTime = 0;
+};
+
+/// \brief Collects a \c StatementProfile for every SQL statement run by the data files that use it (see
+/// \c DataFile::setProfiler()).
+///
+/// A profiler may be shared by several connections on different threads. Percentiles are calculated from a random
+/// sample of at most \c maxSamples executions of each statement, so they are exact until a statement has run that
+/// many times.
+class QueryProfiler {
+private:
+  struct Entry {
+    StatementProfile profile;
+    std::vector<std::uint64_t> samples;
+  };
+
+  mutable std::mutex mutex;
+  std::unordered_map<std::string, std::size_t> indices;
+  std::vector<Entry> entries;
+  std::minstd_rand random;
+public:
+  static constexpr std::size_t maxSamples = 1024;
+
+  /// \brief Collapses runs of whitespace in \c sql into single spaces, and trims it.
+  static std::string normalize(const char* sql);
+
+  /// \brief Returns the id of a statement, which stays the same until the profiler is destroyed (even if it is
+  /// reset).
+  std::size_t statement(const char* sql);
+
+  /// \brief Records one execution of a statement.
+  void record(std::size_t statement, std::uint64_t nanoseconds, std::uint64_t rows);
+
+  /// \brief Returns the profile of every statement that has run since the last reset, slowest (in total) first.
+  std::vector<StatementProfile> profile() const;
+
+  /// \brief Forgets every execution recorded so far.
+  void reset();
+};
+
+} // namespace pv
+
+#endif // PV_QUERYPROFILER_H
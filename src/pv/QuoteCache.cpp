@@ -0,0 +1,185 @@
+#include "QuoteCache.h"
+#include "Trace.h"
+#include <sqlite3.h>
+#include <stdexcept>
+
+namespace {
+
+// Both tables are only read by key, so they don't need row ids. Symbol then date keeps each symbol's prices together.
+const char* quoteCacheInitializationSQL = R"(
+PRAGMA journal_mode = WAL;
+PRAGMA synchronous = NORMAL;
+CREATE TABLE IF NOT EXISTS Quotes(
+  Symbol TEXT NOT NULL,
+  Date INTEGER NOT NULL,
+  Price INTEGER NOT NULL,
+  PRIMARY KEY(Symbol, Date)
+) WITHOUT ROWID;
+CREATE TABLE IF NOT EXISTS QuoteFetches(
+  Symbol TEXT PRIMARY KEY NOT NULL,
+  Since INTEGER NOT NULL,
+  Through INTEGER NOT NULL,
+  At INTEGER NOT NULL
+) WITHOUT ROWID;
+)";
+
+const char* storePriceSQL = "INSERT INTO Quotes(Symbol, Date, Price) VALUES (?, ?, ?) "
+                            "ON CONFLICT DO UPDATE SET Price = excluded.Price WHERE Price != excluded.Price";
+
+// The expressions on the right of SET read the row from before the update
+const char* storeFetchSQL = R"(
+INSERT INTO QuoteFetches(Symbol, Since, Through, At) VALUES (?1, ?2, ?3, ?4)
+ON CONFLICT DO UPDATE SET
+  Since = CASE WHEN excluded.Since <= Through + 1 AND excluded.Through + 1 >= Since
+    THEN MIN(Since, excluded.Since) ELSE excluded.Since END,
+  Through = CASE WHEN excluded.Since <= Through + 1 AND excluded.Through + 1 >= Since
+    THEN MAX(Through, excluded.Through) ELSE excluded.Through END,
+  At = excluded.At
+)";
+
+const char* fetchSQL = "SELECT Since, Through, At FROM QuoteFetches WHERE Symbol = ?";
+
+const char* pricesSQL = "SELECT Date, Price FROM Quotes WHERE Symbol = ? AND Date >= ? AND Date < ? ORDER BY Date";
+
+void bindSymbol(sqlite3_stmt* stmt, int index, const std::string& symbol) {
+  sqlite3_bind_text(stmt, index, symbol.c_str(), static_cast<int>(symbol.size()), SQLITE_STATIC);
+}
+
+} // namespace
+
+namespace pv {
+
+QuoteCache::QuoteCache(const std::string& location) {
+  auto result = sqlite3_open_v2(location.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr);
+  if (result == SQLITE_OK) {
+    // Other processes (and data files reading through the cache) may be using it
+    sqlite3_busy_timeout(db, 5000);
+    result = sqlite3_exec(db, quoteCacheInitializationSQL, nullptr, nullptr, nullptr);
+  }
+  if (result != SQLITE_OK) {
+    sqlite3_close_v2(db);
+    throw std::runtime_error(std::string("Failed to open QuoteCache: SQLite Error Code ") + std::to_string(result));
+  }
+
+  // IMMEDIATE, so that a writer never has to upgrade a read lock that another writer is waiting on
+  stmt_beginTransaction = prepare("BEGIN IMMEDIATE");
+  stmt_commitTransaction = prepare("COMMIT");
+  stmt_rollbackTransaction = prepare("ROLLBACK");
+  stmt_storePrice = prepare(storePriceSQL);
+  stmt_storeFetch = prepare(storeFetchSQL);
+  stmt_fetch = prepare(fetchSQL);
+  stmt_prices = prepare(pricesSQL);
+}
+
+QuoteCache::~QuoteCache() noexcept {
+  sqlite3_finalize(stmt_beginTransaction);
+  sqlite3_finalize(stmt_commitTransaction);
+  sqlite3_finalize(stmt_rollbackTransaction);
+  sqlite3_finalize(stmt_storePrice);
+  sqlite3_finalize(stmt_storeFetch);
+  sqlite3_finalize(stmt_fetch);
+  sqlite3_finalize(stmt_prices);
+  sqlite3_close_v2(db);
+}
+
+sqlite3_stmt* QuoteCache::prepare(const char* sql) {
+  sqlite3_stmt* stmt = nullptr;
+  sqlite3_prepare_v3(db, sql, -1, SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+  return stmt;
+}
+
+ResultCode QuoteCache::store(const std::string& symbol, const PriceHistory& prices, const QuoteFetch& fetch) {
+  trace::Span span("QuoteCache::store", "prices");
+  sqlite3_step(stmt_beginTransaction);
+  if (sqlite3_reset(stmt_beginTransaction) != SQLITE_OK) {
+    return ResultCode::DbError;
+  }
+
+  bool ok = true;
+  bindSymbol(stmt_storePrice, 1, symbol);
+  for (std::size_t i = 0; ok && i < prices.size(); ++i) {
+    sqlite3_bind_int64(stmt_storePrice, 2, static_cast<sqlite3_int64>(prices.dates[i]));
+    sqlite3_bind_int64(stmt_storePrice, 3, static_cast<sqlite3_int64>(prices.prices[i]));
+    ok = sqlite3_step(stmt_storePrice) == SQLITE_DONE;
+    sqlite3_reset(stmt_storePrice);
+  }
+  sqlite3_clear_bindings(stmt_storePrice);
+
+  if (ok) {
+    bindSymbol(stmt_storeFetch, 1, symbol);
+    sqlite3_bind_int64(stmt_storeFetch, 2, static_cast<sqlite3_int64>(fetch.since));
+    sqlite3_bind_int64(stmt_storeFetch, 3, static_cast<sqlite3_int64>(fetch.through));
+    sqlite3_bind_int64(stmt_storeFetch, 4, static_cast<sqlite3_int64>(fetch.at));
+    ok = sqlite3_step(stmt_storeFetch) == SQLITE_DONE;
+    sqlite3_reset(stmt_storeFetch);
+    sqlite3_clear_bindings(stmt_storeFetch);
+  }
+
+  if (!ok) {
+    sqlite3_step(stmt_rollbackTransaction);
+    sqlite3_reset(stmt_rollbackTransaction);
+    return ResultCode::DbError;
+  }
+  sqlite3_step(stmt_commitTransaction);
+  return sqlite3_reset(stmt_commitTransaction) == SQLITE_OK ? ResultCode::Ok : ResultCode::DbError;
+}
+
+std::optional<QuoteFetch> QuoteCache::fetch(const std::string& symbol) {
+  bindSymbol(stmt_fetch, 1, symbol);
+  std::optional<QuoteFetch> result = std::nullopt;
+  if (sqlite3_step(stmt_fetch) == SQLITE_ROW) {
+    result = QuoteFetch{sqlite3_column_int64(stmt_fetch, 0), sqlite3_column_int64(stmt_fetch, 1),
+                        sqlite3_column_int64(stmt_fetch, 2)};
+  }
+  sqlite3_reset(stmt_fetch);
+  sqlite3_clear_bindings(stmt_fetch);
+  return result;
+}
+
+PriceHistory QuoteCache::prices(const std::string& symbol, i64 begin, i64 end) {
+  PriceHistory history;
+  bindSymbol(stmt_prices, 1, symbol);
+  sqlite3_bind_int64(stmt_prices, 2, static_cast<sqlite3_int64>(begin));
+  sqlite3_bind_int64(stmt_prices, 3, static_cast<sqlite3_int64>(end));
+  while (sqlite3_step(stmt_prices) == SQLITE_ROW) {
+    history.dates.push_back(sqlite3_column_int64(stmt_prices, 0));
+    history.prices.push_back(sqlite3_column_int64(stmt_prices, 1));
+  }
+  sqlite3_reset(stmt_prices);
+  sqlite3_clear_bindings(stmt_prices);
+  return history;
+}
+
+std::vector<std::optional<PriceHistory>> QuoteCache::prices(const std::vector<PriceQuery>& queries) {
+  trace::Span span("QuoteCache::prices", "prices");
+  std::vector<std::optional<PriceHistory>> results(queries.size());
+  for (std::size_t i = 0; i < queries.size(); ++i) {
+    if (fetch(queries[i].symbol).has_value()) {
+      results[i] = prices(queries[i].symbol, queries[i].begin, queries[i].end);
+    }
+  }
+  return results;
+}
+
+std::vector<PriceRefresh> refreshFromQuoteCache(DataFile& dataFile, QuoteCache& cache,
+                                                const std::vector<PriceRefresh>& refreshes, i64 today, i64 now,
+                                                PriceConflictPolicy policy) {
+  trace::Span span("refreshFromQuoteCache", "prices");
+  std::vector<PriceRefresh> remaining;
+  for (const auto& refresh : refreshes) {
+    auto fetch = cache.fetch(refresh.symbol);
+    bool answered = fetch.has_value() && fetch->since <= refresh.from && fetch->through >= today &&
+                    now - fetch->at < priceRefreshInterval;
+    if (answered) {
+      auto prices = cache.prices(refresh.symbol, refresh.from, today + 1);
+      answered = dataFile.setSecurityPrices(refresh.security, prices, policy, today) == ResultCode::Ok &&
+                 dataFile.setPriceFetch(refresh.security, {fetch->through, fetch->at}) == ResultCode::Ok;
+    }
+    if (!answered) {
+      remaining.push_back(refresh);
+    }
+  }
+  return remaining;
+}
+
+} // namespace pv
@@ -0,0 +1,84 @@
+#ifndef PV_QUOTECACHE_H
+#define PV_QUOTECACHE_H
+
+#include "DataFile.h"
+#include "Integer64.h"
+#include "PriceHistory.h"
+#include "PriceProvider.h"
+#include "PriceRefresh.h"
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace pv {
+
+/// \brief Which of a symbol's prices a \c QuoteCache has, and when they were downloaded.
+struct QuoteFetch {
+  /// \brief The first date downloaded.
+  i64 since = 0;
+  /// \brief The last date downloaded.
+  i64 through = 0;
+  /// \brief When the prices were downloaded, in seconds since 1970-01-01 UTC.
+  i64 at = 0;
+};
+
+/// \brief A store of downloaded prices shared by every data file of a user, so that each symbol's prices are only
+/// downloaded (and stored) once, no matter how many data files hold the symbol.
+///
+/// The cache is its own SQLite database, keyed by symbol and date, with dates as used by data files. Data files can
+/// read prices through it (see \c DataFileOptions::quoteCache), or copy them in bulk with \c importPrices(), since
+/// it is a \c PriceProvider. Several processes may use the same cache at once, but each \c QuoteCache object may only
+/// be used by one thread at a time.
+class QuoteCache : public PriceProvider {
+private:
+  sqlite3* db = nullptr;
+
+  sqlite3_stmt* stmt_beginTransaction = nullptr;
+  sqlite3_stmt* stmt_commitTransaction = nullptr;
+  sqlite3_stmt* stmt_rollbackTransaction = nullptr;
+  sqlite3_stmt* stmt_storePrice = nullptr;
+  sqlite3_stmt* stmt_storeFetch = nullptr;
+  sqlite3_stmt* stmt_fetch = nullptr;
+  sqlite3_stmt* stmt_prices = nullptr;
+
+  sqlite3_stmt* prepare(const char* sql);
+public:
+  /// \brief Opens the cache at \c location, creating it if it doesn't exist.
+  ///
+  /// \throws std::runtime_error if the cache can't be opened
+  explicit QuoteCache(const std::string& location);
+  ~QuoteCache() noexcept override;
+
+  QuoteCache(const QuoteCache&) = delete;
+  QuoteCache& operator=(const QuoteCache&) = delete;
+
+  /// \brief Stores the prices of \c symbol downloaded by \c fetch, replacing any that are cached for the same dates.
+  ///
+  /// If the dates downloaded overlap or adjoin the ones already cached, the cache records that it has both.
+  /// Otherwise, it only records the new ones.
+  ResultCode store(const std::string& symbol, const PriceHistory& prices, const QuoteFetch& fetch);
+
+  /// \brief Returns which of the prices of \c symbol are cached, or \c std::nullopt if none are.
+  std::optional<QuoteFetch> fetch(const std::string& symbol);
+
+  /// \brief Returns the cached prices of \c symbol dated from \c begin (inclusive) to \c end (exclusive).
+  PriceHistory prices(const std::string& symbol, i64 begin, i64 end);
+
+  /// \brief Returns the cached prices answering each of \c queries, or \c std::nullopt for symbols that were never
+  /// cached.
+  std::vector<std::optional<PriceHistory>> prices(const std::vector<PriceQuery>& queries) override;
+};
+
+/// \brief Copies the prices of the \c refreshes that \c cache can answer into \c dataFile, and returns the others,
+/// which still need to be downloaded.
+///
+/// The cache answers a refresh if it has every price from the refresh's \c from date through \c today, downloaded
+/// less than \c priceRefreshInterval before \c now (the same rule as \c planPriceRefresh()). The cache's download is
+/// recorded as the security's (see \c DataFile::setPriceFetch()).
+std::vector<PriceRefresh> refreshFromQuoteCache(DataFile& dataFile, QuoteCache& cache,
+                                                const std::vector<PriceRefresh>& refreshes, i64 today, i64 now,
+                                                PriceConflictPolicy policy);
+
+} // namespace pv
+
+#endif // PV_QUOTECACHE_H
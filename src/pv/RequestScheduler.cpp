@@ -0,0 +1,97 @@
+#include "RequestScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+namespace pv {
+
+RequestScheduler::RequestScheduler(RequestSchedulerOptions options, unsigned int seed)
+    : options(options), tokens(options.burst), random(seed) {}
+
+void RequestScheduler::refill(Clock::time_point now) {
+  if (refilled.has_value()) {
+    std::chrono::duration<double> elapsed = now - *refilled;
+    tokens = std::min(options.burst, tokens + elapsed.count() * options.requestsPerSecond);
+  }
+  refilled = now;
+}
+
+void RequestScheduler::wake(Clock::time_point now) {
+  while (!retries.empty() && retries.top().at <= now) {
+    ready.push(retries.top().waiting);
+    retries.pop();
+  }
+}
+
+void RequestScheduler::add(Id id, int priority) {
+  requests[id] = {priority, 0};
+  ready.push({priority, nextOrder++, id});
+}
+
+std::vector<RequestScheduler::Id> RequestScheduler::start(Clock::time_point now) {
+  wake(now);
+  refill(now);
+  bool limited = options.requestsPerSecond > 0;
+
+  std::vector<Id> started;
+  while (inFlight_ < options.maxInFlight && !ready.empty() && (!limited || tokens >= 1)) {
+    auto id = ready.top().id;
+    ready.pop();
+    if (limited) {
+      tokens -= 1;
+    }
+    ++inFlight_;
+    ++requests[id].attempts;
+    started.push_back(id);
+  }
+  return started;
+}
+
+std::optional<RequestScheduler::Clock::time_point> RequestScheduler::nextStart(Clock::time_point now) const {
+  if (inFlight_ >= options.maxInFlight || (ready.empty() && retries.empty())) {
+    return std::nullopt; // Nothing to start until a request finishes
+  }
+
+  // When the next token will be available
+  auto tokenAt = now;
+  if (options.requestsPerSecond > 0) {
+    double available = tokens;
+    if (refilled.has_value()) {
+      std::chrono::duration<double> elapsed = now - *refilled;
+      available = std::min(options.burst, tokens + elapsed.count() * options.requestsPerSecond);
+    }
+    if (available < 1) {
+      // Rounded up, so that there is a whole token by then
+      tokenAt += std::chrono::ceil<Clock::duration>(
+          std::chrono::duration<double>((1 - available) / options.requestsPerSecond));
+    }
+  }
+  return ready.empty() ? std::max(tokenAt, retries.top().at) : tokenAt;
+}
+
+void RequestScheduler::succeeded(Id) { --inFlight_; }
+
+bool RequestScheduler::failed(Id id, Clock::time_point now, bool retryable, std::optional<Clock::duration> retryAfter) {
+  --inFlight_;
+  const auto& request = requests[id];
+  if (!retryable || request.attempts >= options.maxAttempts) {
+    return false;
+  }
+
+  std::chrono::duration<double, std::milli> backoff =
+      options.initialBackoff * std::pow(options.backoffFactor, request.attempts - 1);
+  backoff = std::min<std::chrono::duration<double, std::milli>>(backoff, options.maxBackoff);
+  backoff *= std::uniform_real_distribution<double>(0.5, 1)(random);
+  auto delay = std::chrono::duration_cast<Clock::duration>(backoff);
+  if (retryAfter.has_value()) {
+    delay = std::max(delay, *retryAfter);
+  }
+  retries.push({now + delay, {request.priority, nextOrder++, id}});
+  return true;
+}
+
+int RequestScheduler::attempts(Id id) const noexcept {
+  auto iter = requests.find(id);
+  return iter != requests.cend() ? iter->second.attempts : 0;
+}
+
+} // namespace pv
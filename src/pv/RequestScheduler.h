@@ -0,0 +1,117 @@
+#ifndef PV_REQUESTSCHEDULER_H
+#define PV_REQUESTSCHEDULER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <queue>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace pv {
+
+/// \brief Limits on how requests are made by a \c RequestScheduler.
+struct RequestSchedulerOptions {
+  /// \brief The most requests in flight at once.
+  std::size_t maxInFlight = 4;
+  /// \brief The average number of requests started per second (0 for no limit).
+  double requestsPerSecond = 5;
+  /// \brief How many requests may be started at once after being idle.
+  double burst = 5;
+  /// \brief How many times a request is made before giving up (so 1 never retries).
+  int maxAttempts = 4;
+  /// \brief How long to wait before the first retry. Each retry waits \c backoffFactor times longer than the last,
+  /// up to \c maxBackoff, and then a random amount of up to half of that less, so that requests that failed together
+  /// aren't all retried together.
+  std::chrono::milliseconds initialBackoff = std::chrono::milliseconds(500);
+  double backoffFactor = 2;
+  std::chrono::milliseconds maxBackoff = std::chrono::milliseconds(30000);
+};
+
+/// \brief Decides when to make each of many requests (such as downloads): no more than a number at once, no faster
+/// than a rate (a token bucket), higher priorities first, and retrying failures with exponential backoff.
+///
+/// The scheduler doesn't make requests or keep time itself. The caller adds requests, calls \c start() to find out
+/// which ones to make now, reports how each one went with \c succeeded() or \c failed(), and calls \c start() again
+/// at \c nextStart() (or when a request finishes). This keeps it independent of any networking library and
+/// deterministic for a given seed.
+class RequestScheduler {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Id = std::size_t;
+private:
+  struct Waiting {
+    int priority;
+    std::uint64_t order; // Earlier first among equal priorities
+    Id id;
+
+    bool operator<(const Waiting& rhs) const noexcept {
+      return priority != rhs.priority ? priority < rhs.priority : order > rhs.order;
+    }
+  };
+
+  struct Retry {
+    Clock::time_point at;
+    Waiting waiting;
+
+    bool operator<(const Retry& rhs) const noexcept { return at > rhs.at; }
+  };
+
+  struct Request {
+    int priority;
+    int attempts;
+  };
+
+  RequestSchedulerOptions options;
+  std::unordered_map<Id, Request> requests;
+  std::priority_queue<Waiting> ready;
+  std::priority_queue<Retry> retries;
+  std::size_t inFlight_ = 0;
+  std::uint64_t nextOrder = 0;
+
+  double tokens;
+  std::optional<Clock::time_point> refilled;
+
+  std::minstd_rand random;
+
+  void refill(Clock::time_point now);
+  /// \internal Moves the retries that are due to \c ready.
+  void wake(Clock::time_point now);
+public:
+  explicit RequestScheduler(RequestSchedulerOptions options = RequestSchedulerOptions(), unsigned int seed = 1);
+
+  /// \brief Adds a request, which is made before any waiting request with a lower \c priority. \c id must be unique.
+  void add(Id id, int priority = 0);
+
+  /// \brief Returns the requests to make now, in order, and counts them as in flight.
+  std::vector<Id> start(Clock::time_point now);
+
+  /// \brief Returns when \c start() may next return a request, if one is waiting and the limit on requests in
+  /// flight wasn't what held it back.
+  std::optional<Clock::time_point> nextStart(Clock::time_point now) const;
+
+  /// \brief Reports that a request that was in flight succeeded.
+  void succeeded(Id id);
+
+  /// \brief Reports that a request that was in flight failed.
+  ///
+  /// \param retryAfter how long the server asked to wait, if it did, which is waited instead of a shorter backoff
+  /// \returns \c true if the request will be retried, or \c false if it was given up on (because it can't succeed,
+  /// or after \c RequestSchedulerOptions::maxAttempts attempts)
+  bool failed(Id id, Clock::time_point now, bool retryable,
+              std::optional<Clock::duration> retryAfter = std::nullopt);
+
+  /// \brief Returns how many times \c id has been started.
+  int attempts(Id id) const noexcept;
+
+  std::size_t inFlight() const noexcept { return inFlight_; }
+
+  /// \brief Checks if every request has succeeded or been given up on.
+  bool done() const noexcept { return inFlight_ == 0 && ready.empty() && retries.empty(); }
+};
+
+} // namespace pv
+
+#endif // PV_REQUESTSCHEDULER_H
@@ -0,0 +1,205 @@
+#include "Snapshot.h"
+#include "Kernels.h"
+#include "Trace.h"
+#include <cstddef>
+#include <sqlite3.h>
+#include <string>
+#include <unordered_map>
+
+namespace {
+
+// One row per security (plus one row with a NULL security for cash-only transactions). The cash column is
+// calculated the same way as cashBalanceQuery in Algorithms.cpp, and the sums match the per-security
+// queries there.
+const char* snapshotTransactionsQuery = R"(
+SELECT COALESCE(BuyTransactions.SecurityId, SellTransactions.SecurityId, DividendTransactions.SecurityId,
+    InterestTransactions.SecurityId),
+  SUM(BuyTransactions.NumberOfShares), SUM(BuyTransactions.SharePrice * BuyTransactions.NumberOfShares),
+  SUM(SellTransactions.NumberOfShares), SUM(SellTransactions.SharePrice * SellTransactions.NumberOfShares),
+  COALESCE(SUM(DividendTransactions.Amount), 0), COALESCE(SUM(InterestTransactions.Amount), 0),
+  -COALESCE(SUM(BuyTransactions.Amount), 0) + COALESCE(SUM(SellTransactions.Amount), 0)
+  + COALESCE(SUM(DepositTransactions.Amount), 0) - COALESCE(SUM(WithdrawTransactions.Amount), 0)
+  + COALESCE(SUM(DividendTransactions.Amount), 0)
+FROM Transactions
+  LEFT JOIN BuyTransactions ON Transactions.Id = BuyTransactions.TransactionId
+  LEFT JOIN SellTransactions ON Transactions.Id = SellTransactions.TransactionId
+  LEFT JOIN DepositTransactions ON Transactions.Id = DepositTransactions.TransactionId
+  LEFT JOIN WithdrawTransactions ON Transactions.Id = WithdrawTransactions.TransactionId
+  LEFT JOIN DividendTransactions ON Transactions.Id = DividendTransactions.TransactionId
+  LEFT JOIN InterestTransactions ON Transactions.Id = InterestTransactions.TransactionId
+WHERE Transactions.Date <= ?
+GROUP BY 1
+)";
+
+// The subquery is a single index seek per security because SecurityPrices is keyed by (SecurityId, Date)
+const char* snapshotSecuritiesQuery = R"(
+SELECT Id, Symbol, Name, AssetClass, Sector,
+  (SELECT Price FROM SecurityPrices WHERE SecurityId = Securities.Id AND Date <= ? ORDER BY Date DESC LIMIT 1)
+FROM Securities
+ORDER BY Id
+)";
+
+// The same, but with the latest price of the data file or the quote cache, whichever is newer (the data file's on the
+// same date), like sharePrice()
+const char* snapshotSecuritiesReadThroughQuery = R"(
+SELECT Id, Symbol, Name, AssetClass, Sector,
+  (SELECT Price FROM (
+    SELECT * FROM (SELECT Date, Price, 1 AS Own FROM SecurityPrices WHERE SecurityId = Securities.Id AND Date <= ?1
+                   ORDER BY Date DESC LIMIT 1)
+    UNION ALL
+    SELECT * FROM (SELECT Date, Price, 0 AS Own FROM QuoteCache.Quotes WHERE Symbol = Securities.Symbol AND Date <= ?1
+                   ORDER BY Date DESC LIMIT 1)
+  ) ORDER BY Date DESC, Own DESC LIMIT 1)
+FROM Securities
+ORDER BY Id
+)";
+
+std::string columnText(sqlite3_stmt* stmt, int column) {
+  const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+  return text != nullptr ? std::string(text) : std::string();
+}
+
+} // namespace
+
+namespace pv {
+namespace algorithms {
+
+namespace {
+
+/// \internal The sums of a security's transactions, before any averages are taken.
+struct TransactionTotals {
+  i64 sharesBought = 0;
+  i64 buyCost = 0; // sum of SharePrice * NumberOfShares over every buy
+  i64 sharesSold = 0;
+  i64 sellProceeds = 0; // sum of SharePrice * NumberOfShares over every sell
+  i64 dividendIncome = 0;
+  i64 interestIncome = 0;
+};
+
+/// \internal Adds every security to \c result, with its metrics calculated from \c totals.
+void addSecurities(DataFile& dataFile, i64 date, const std::unordered_map<i64, TransactionTotals>& totals,
+                   Snapshot& result) {
+  auto* stmt =
+      dataFile.cachedQuery(dataFile.hasQuoteCache() ? snapshotSecuritiesReadThroughQuery : snapshotSecuritiesQuery);
+  if (stmt == nullptr) {
+    return;
+  }
+  sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(date));
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    SecuritySnapshot security;
+    security.security = sqlite3_column_int64(stmt, 0);
+    security.symbol = columnText(stmt, 1);
+    security.name = columnText(stmt, 2);
+    security.assetClass = columnText(stmt, 3);
+    security.sector = columnText(stmt, 4);
+    if (sqlite3_column_type(stmt, 5) != SQLITE_NULL) {
+      security.sharePrice = sqlite3_column_int64(stmt, 5);
+    }
+
+    auto iter = totals.find(security.security);
+    if (iter != totals.cend()) {
+      const auto& total = iter->second;
+      security.sharesHeld = total.sharesBought - total.sharesSold;
+      security.sharesSold = total.sharesSold;
+      security.dividendIncome = total.dividendIncome;
+      security.interestIncome = total.interestIncome;
+      // Same as averageBuyPrice() and averageSellPrice(): integer division, and no average without shares
+      if (total.sharesBought != 0) {
+        security.averageBuyPrice = total.buyCost / total.sharesBought;
+      }
+      if (total.sharesSold != 0) {
+        security.averageSellPrice = total.sellProceeds / total.sharesSold;
+      }
+    }
+
+    security.cashGained = security.sharesSold * (security.averageSellPrice.value_or(0) -
+                                                 security.averageBuyPrice.value_or(0));
+    security.costBasis = security.sharesHeld * security.averageBuyPrice.value_or(0);
+    if (security.sharePrice.has_value()) {
+      security.marketValue = *security.sharePrice * security.sharesHeld;
+      if (security.averageBuyPrice.has_value()) {
+        security.unrealizedCashGained = security.sharesHeld * (*security.sharePrice - *security.averageBuyPrice);
+      }
+    }
+    security.totalIncome = security.unrealizedCashGained.value_or(0) + security.cashGained +
+                           security.dividendIncome + security.interestIncome;
+
+    result.securities.push_back(std::move(security));
+  }
+  sqlite3_reset(stmt);
+}
+
+} // namespace
+
+Snapshot snapshot(DataFile& dataFile, i64 date) {
+  trace::Span span("snapshot", "algorithms");
+  Snapshot result;
+
+  std::unordered_map<i64, TransactionTotals> totals;
+  auto* stmt = dataFile.cachedQuery(snapshotTransactionsQuery);
+  if (stmt != nullptr) {
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(date));
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      result.cashBalance += sqlite3_column_int64(stmt, 7);
+      if (sqlite3_column_type(stmt, 0) == SQLITE_NULL) {
+        continue; // Deposits and withdrawals only change the cash balance
+      }
+
+      // SUM() of no rows is NULL, which sqlite3_column_int64 reads as 0
+      auto& total = totals[sqlite3_column_int64(stmt, 0)];
+      total.sharesBought = sqlite3_column_int64(stmt, 1);
+      total.buyCost = sqlite3_column_int64(stmt, 2);
+      total.sharesSold = sqlite3_column_int64(stmt, 3);
+      total.sellProceeds = sqlite3_column_int64(stmt, 4);
+      total.dividendIncome = sqlite3_column_int64(stmt, 5);
+      total.interestIncome = sqlite3_column_int64(stmt, 6);
+    }
+    sqlite3_reset(stmt);
+  }
+
+  addSecurities(dataFile, date, totals, result);
+  return result;
+}
+
+Snapshot snapshot(DataFile& dataFile, Ledger& ledger, i64 date) {
+  trace::Span span("snapshot", "algorithms");
+  Snapshot result;
+
+  const auto& securities = ledger.securities();
+  const auto& actions = ledger.actions();
+  const auto& numbersOfShares = ledger.numbersOfShares();
+  const auto& sharePrices = ledger.sharePrices();
+  const auto& amounts = ledger.amounts();
+  auto rows = ledger.rowsUntil(date);
+  result.cashBalance = kernels::sum(ledger.cashChanges().data(), rows);
+
+  std::unordered_map<i64, TransactionTotals> totals;
+  for (std::size_t row = 0; row < rows; ++row) {
+    if (securities[row] == Ledger::noSecurity) {
+      continue;
+    }
+
+    switch (actions[row]) {
+    case Action::BUY: {
+      auto& total = totals[securities[row]];
+      total.sharesBought += numbersOfShares[row];
+      total.buyCost += numbersOfShares[row] * sharePrices[row];
+      break;
+    }
+    case Action::SELL: {
+      auto& total = totals[securities[row]];
+      total.sharesSold += numbersOfShares[row];
+      total.sellProceeds += numbersOfShares[row] * sharePrices[row];
+      break;
+    }
+    case Action::DIVIDEND: totals[securities[row]].dividendIncome += amounts[row]; break;
+    case Action::INTEREST: totals[securities[row]].interestIncome += amounts[row]; break;
+    default: break; // Deposits and withdrawals only change the cash balance
+    }
+  }
+
+  addSecurities(dataFile, date, totals, result);
+  return result;
+}
+} // namespace algorithms
+} // namespace pv
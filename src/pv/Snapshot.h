@@ -0,0 +1,61 @@
+#ifndef PV_ALGORITHMS_SNAPSHOT_H
+#define PV_ALGORITHMS_SNAPSHOT_H
+
+#include "pv/DataFile.h"
+#include "pv/Ledger.h"
+#include "pv/Integer64.h"
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace pv {
+namespace algorithms {
+
+/// \brief Every holding metric of a single security on a single date.
+///
+/// Each field is equal to the result of the \c pv::algorithms function with the same name.
+struct SecuritySnapshot {
+  i64 security;
+  std::string symbol;
+  std::string name;
+  std::string assetClass;
+  std::string sector;
+
+  i64 sharesHeld = 0;
+  i64 sharesSold = 0;
+  std::optional<i64> sharePrice;
+  std::optional<i64> averageBuyPrice;
+  std::optional<i64> averageSellPrice;
+  std::optional<i64> unrealizedCashGained;
+  i64 cashGained = 0;
+  i64 dividendIncome = 0;
+  i64 interestIncome = 0;
+  i64 costBasis = 0;
+  i64 totalIncome = 0;
+  std::optional<i64> marketValue;
+};
+
+/// \brief The state of the whole portfolio on a single date.
+struct Snapshot {
+  /// \brief One entry for every security, ordered by id.
+  std::vector<SecuritySnapshot> securities;
+  /// \brief The sum of the cash balances of every account.
+  i64 cashBalance = 0;
+};
+
+/// \brief Calculates every holding metric for every security on \c date.
+///
+/// This uses a constant number of queries no matter how many securities there are, instead of calling
+/// the individual \c pv::algorithms functions (many of which repeat each other's work) for each security.
+Snapshot snapshot(DataFile& dataFile, i64 date);
+
+/// \brief Calculates every holding metric for every security on \c date, summing the transactions in \c ledger
+/// instead of querying them.
+///
+/// Only the securities and their prices are read from \c dataFile, which must be the data file of \c ledger.
+Snapshot snapshot(DataFile& dataFile, Ledger& ledger, i64 date);
+
+} // namespace algorithms
+} // namespace pv
+
+#endif // PV_ALGORITHMS_SNAPSHOT_H
@@ -0,0 +1,200 @@
+#include "TimeSeries.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+#include <sqlite3.h>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace {
+
+// The cash column is calculated the same way as cashBalanceQuery in Algorithms.cpp
+const char* timeSeriesTransactionsQuery = R"(
+SELECT Transactions.Date, Transactions.AccountId,
+  BuyTransactions.SecurityId, BuyTransactions.NumberOfShares, BuyTransactions.SharePrice,
+  SellTransactions.SecurityId, SellTransactions.NumberOfShares,
+  -COALESCE(BuyTransactions.Amount, 0) + COALESCE(SellTransactions.Amount, 0)
+  + COALESCE(DepositTransactions.Amount, 0) - COALESCE(WithdrawTransactions.Amount, 0)
+  + COALESCE(DividendTransactions.Amount, 0)
+FROM Transactions
+  LEFT JOIN BuyTransactions ON Transactions.Id = BuyTransactions.TransactionId
+  LEFT JOIN SellTransactions ON Transactions.Id = SellTransactions.TransactionId
+  LEFT JOIN DepositTransactions ON Transactions.Id = DepositTransactions.TransactionId
+  LEFT JOIN WithdrawTransactions ON Transactions.Id = WithdrawTransactions.TransactionId
+  LEFT JOIN DividendTransactions ON Transactions.Id = DividendTransactions.TransactionId
+WHERE Transactions.Date <= ?
+ORDER BY Transactions.Date
+)";
+
+// Ordered by the primary key, so SQLite doesn't need to sort
+const char* timeSeriesPricesQuery = R"(
+SELECT SecurityId, Date, Price FROM SecurityPrices WHERE Date <= ? ORDER BY SecurityId, Date
+)";
+
+// The same, merged with the quote cache's prices of the same symbols. The data file's price comes last on the same
+// date, so that it is the one used, like sharePrice().
+const char* timeSeriesPricesReadThroughQuery = R"(
+SELECT SecurityId, Date, Price FROM (
+  SELECT SecurityId, Date, Price, 1 AS Own FROM SecurityPrices WHERE Date <= ?1
+  UNION ALL
+  SELECT Securities.Id, Quotes.Date, Quotes.Price, 0 FROM Securities
+    JOIN QuoteCache.Quotes AS Quotes ON Quotes.Symbol = Securities.Symbol
+  WHERE Quotes.Date <= ?1
+) ORDER BY SecurityId, Date, Own
+)";
+
+} // namespace
+
+namespace pv {
+namespace algorithms {
+
+namespace {
+
+/// \internal Running totals for one security while sweeping through the ledger.
+struct SecurityState {
+  i64 sharesHeld = 0;
+  i64 sharesBought = 0;
+  i64 buyCost = 0; // sum of SharePrice * NumberOfShares over every buy
+};
+
+} // namespace
+
+TimeSeries timeSeries(DataFile& dataFile, const std::vector<i64>& securities, const std::vector<i64>& accounts,
+                      std::vector<i64> dates) {
+  trace::Span span("timeSeries", "algorithms");
+  TimeSeries result;
+
+  std::sort(dates.begin(), dates.end());
+  dates.erase(std::unique(dates.begin(), dates.end()), dates.end());
+  result.dates = std::move(dates);
+  const std::size_t dateCount = result.dates.size();
+
+  result.cashBalance.assign(dateCount, 0);
+  result.securities.reserve(securities.size());
+  std::unordered_map<i64, std::size_t> securityIndices;
+  for (auto security : securities) {
+    if (securityIndices.try_emplace(security, result.securities.size()).second) {
+      result.securities.push_back(
+          {security, std::vector<i64>(dateCount, 0), std::vector<i64>(dateCount, 0), std::vector<i64>(dateCount, 0)});
+    }
+  }
+  if (dateCount == 0) {
+    return result;
+  }
+
+  std::unordered_set<i64> accountSet(accounts.cbegin(), accounts.cend());
+  const i64 lastDate = result.dates.back();
+
+  // Sweep through the ledger in date order. When all of the transactions on or before a date have been
+  // seen, the running totals are recorded for that date. Market values hold the number of shares held
+  // until the prices are known.
+  std::vector<SecurityState> states(result.securities.size());
+  i64 cash = 0;
+  std::size_t dateIndex = 0;
+
+  auto record = [&](std::size_t index) {
+    result.cashBalance[index] = cash;
+    for (std::size_t i = 0; i < states.size(); ++i) {
+      const auto& state = states[i];
+      // Same as averageBuyPrice(): integer division, and no average price until a share has been bought
+      i64 averageBuyPrice = state.sharesBought != 0 ? state.buyCost / state.sharesBought : 0;
+      result.securities[i].sharesHeld[index] = state.sharesHeld;
+      result.securities[i].marketValue[index] = state.sharesHeld;
+      result.securities[i].costBasis[index] = state.sharesHeld * averageBuyPrice;
+    }
+  };
+
+  auto* stmt = dataFile.cachedQuery(timeSeriesTransactionsQuery);
+  if (stmt != nullptr) {
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(lastDate));
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      i64 date = sqlite3_column_int64(stmt, 0);
+      while (result.dates[dateIndex] < date) {
+        record(dateIndex++);
+      }
+
+      if (accountSet.count(sqlite3_column_int64(stmt, 1)) == 0) {
+        continue;
+      }
+
+      cash += sqlite3_column_int64(stmt, 7);
+
+      if (sqlite3_column_type(stmt, 2) != SQLITE_NULL) {
+        auto iter = securityIndices.find(sqlite3_column_int64(stmt, 2));
+        if (iter != securityIndices.cend()) {
+          auto& state = states[iter->second];
+          i64 numberOfShares = sqlite3_column_int64(stmt, 3);
+          state.sharesHeld += numberOfShares;
+          state.sharesBought += numberOfShares;
+          state.buyCost += numberOfShares * sqlite3_column_int64(stmt, 4);
+        }
+      } else if (sqlite3_column_type(stmt, 5) != SQLITE_NULL) {
+        auto iter = securityIndices.find(sqlite3_column_int64(stmt, 5));
+        if (iter != securityIndices.cend()) {
+          states[iter->second].sharesHeld -= sqlite3_column_int64(stmt, 6);
+        }
+      }
+    }
+    sqlite3_reset(stmt);
+  }
+  while (dateIndex < dateCount) {
+    record(dateIndex++);
+  }
+
+  // Sweep through each security's prices, multiplying the shares held at each date by the most recent
+  // price on or before that date.
+  std::optional<std::size_t> current;
+  i64 price = 0; // No price yet means no market value
+  std::vector<bool> priced(result.securities.size(), false);
+  dateIndex = 0;
+
+  auto finishSecurity = [&]() {
+    if (!current.has_value()) {
+      return;
+    }
+    auto& marketValue = result.securities[*current].marketValue;
+    for (; dateIndex < dateCount; ++dateIndex) {
+      marketValue[dateIndex] *= price;
+    }
+  };
+
+  stmt = dataFile.cachedQuery(dataFile.hasQuoteCache() ? timeSeriesPricesReadThroughQuery : timeSeriesPricesQuery);
+  if (stmt != nullptr) {
+    sqlite3_bind_int64(stmt, 1, static_cast<sqlite3_int64>(lastDate));
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+      auto iter = securityIndices.find(sqlite3_column_int64(stmt, 0));
+      if (iter == securityIndices.cend()) {
+        continue;
+      }
+      if (current != iter->second) {
+        finishSecurity();
+        current = iter->second;
+        priced[*current] = true;
+        price = 0;
+        dateIndex = 0;
+      }
+
+      i64 date = sqlite3_column_int64(stmt, 1);
+      auto& marketValue = result.securities[*current].marketValue;
+      for (; dateIndex < dateCount && result.dates[dateIndex] < date; ++dateIndex) {
+        marketValue[dateIndex] *= price;
+      }
+      price = sqlite3_column_int64(stmt, 2);
+    }
+    sqlite3_reset(stmt);
+  }
+  finishSecurity();
+
+  // Securities without any prices have no market value
+  for (std::size_t i = 0; i < priced.size(); ++i) {
+    if (!priced[i]) {
+      std::fill(result.securities[i].marketValue.begin(), result.securities[i].marketValue.end(), 0);
+    }
+  }
+
+  return result;
+}
+
+} // namespace algorithms
+} // namespace pv
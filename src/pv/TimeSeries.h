@@ -0,0 +1,48 @@
+#ifndef PV_ALGORITHMS_TIMESERIES_H
+#define PV_ALGORITHMS_TIMESERIES_H
+
+#include "pv/DataFile.h"
+#include "pv/Integer64.h"
+#include <vector>
+
+namespace pv {
+namespace algorithms {
+
+/// \brief The values of a single security at every date of a \c TimeSeries.
+struct SecurityTimeSeries {
+  i64 security;
+  /// \brief Equivalent to \c sharesHeld().
+  std::vector<i64> sharesHeld;
+  /// \brief Equivalent to \c marketValue(), except that it is 0 (instead of \c std::nullopt) before the
+  /// security has a price.
+  std::vector<i64> marketValue;
+  /// \brief Equivalent to \c costBasis().
+  std::vector<i64> costBasis;
+};
+
+/// \brief Market values, cost bases, and cash balances of a portfolio over a range of dates.
+struct TimeSeries {
+  /// \brief The dates of the series, sorted in ascending order and without duplicates.
+  std::vector<i64> dates;
+  /// \brief One entry per requested security, in the order they were requested.
+  std::vector<SecurityTimeSeries> securities;
+  /// \brief The sum of the cash balances of the requested accounts at each date.
+  std::vector<i64> cashBalance;
+};
+
+/// \brief Calculates a \c TimeSeries for \c securities and \c accounts at every date in \c dates.
+///
+/// Only transactions in \c accounts are counted, so passing every account gives the same values as
+/// the security-wide \c marketValue(), \c costBasis() and \c cashBalance() functions.
+///
+/// This is much faster than calling those functions for each date, because the ledger and the security
+/// prices are each read once, in order, no matter how many dates, securities, or accounts are requested.
+///
+/// \param dates the dates to calculate values at, in any order (they will be sorted)
+TimeSeries timeSeries(DataFile& dataFile, const std::vector<i64>& securities, const std::vector<i64>& accounts,
+                      std::vector<i64> dates);
+
+} // namespace algorithms
+} // namespace pv
+
+#endif // PV_ALGORITHMS_TIMESERIES_H
@@ -0,0 +1,187 @@
+#include "Trace.h"
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+/// \brief A finished span. Times are in nanoseconds since \c epoch.
+struct Event {
+  const char* name;
+  const char* category;
+  std::int64_t start;
+  std::int64_t duration;
+};
+
+/// \brief The spans recorded by a single thread.
+///
+/// Only its own thread appends to a buffer, so its mutex is almost never contended; it exists so that a trace can be
+/// written or cleared while other threads are still recording. A buffer is only created once its thread records a
+/// span. When the thread exits, its buffer is dropped if it is empty, and otherwise kept until the next \c clear(), so
+/// that spans recorded by short-lived workers aren't lost.
+struct ThreadBuffer {
+  std::mutex mutex;
+  std::vector<Event> events;
+  std::size_t thread;
+  const char* threadName = nullptr;
+  bool exited = false;
+};
+
+/// \brief Stops a runaway session from using up all memory; later spans are dropped.
+constexpr std::size_t maxEventsPerThread = std::size_t(1) << 20;
+
+const auto epoch = std::chrono::steady_clock::now();
+
+// Lock before the mutex of any buffer
+std::mutex buffersMutex;
+std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+std::size_t nextThread = 1;
+
+/// \brief The calling thread's name and buffer, if it has recorded anything.
+struct ThreadState {
+  std::shared_ptr<ThreadBuffer> buffer;
+  const char* name = nullptr;
+
+  ThreadState() = default;
+  ThreadState(const ThreadState&) = delete;
+  ThreadState& operator=(const ThreadState&) = delete;
+
+  ~ThreadState() {
+    if (buffer == nullptr) {
+      return;
+    }
+    std::lock_guard lock(buffersMutex);
+    std::lock_guard bufferLock(buffer->mutex);
+    buffer->exited = true;
+    if (buffer->events.empty()) {
+      buffers.erase(std::remove(buffers.begin(), buffers.end(), buffer), buffers.end());
+    }
+  }
+};
+
+thread_local ThreadState threadState;
+
+ThreadBuffer& threadBuffer() {
+  if (threadState.buffer == nullptr) {
+    auto buffer = std::make_shared<ThreadBuffer>();
+    buffer->threadName = threadState.name;
+    std::lock_guard lock(buffersMutex);
+    buffer->thread = nextThread++;
+    buffers.push_back(buffer);
+    threadState.buffer = std::move(buffer);
+  }
+  return *threadState.buffer;
+}
+
+std::vector<std::shared_ptr<ThreadBuffer>> allBuffers() {
+  std::lock_guard lock(buffersMutex);
+  return buffers;
+}
+
+void writeJsonString(std::ostream& out, const char* s) {
+  out << '"';
+  for (; *s != '\0'; ++s) {
+    auto c = static_cast<unsigned char>(*s);
+    if (c == '"' || c == '\\') {
+      out << '\\' << *s;
+    } else if (c < 0x20) {
+      const char* digits = "0123456789abcdef";
+      out << "\\u00" << digits[c >> 4] << digits[c & 0xf];
+    } else {
+      out << *s;
+    }
+  }
+  out << '"';
+}
+
+/// \brief Writes nanoseconds as microseconds, which is the unit of the trace event format.
+void writeMicroseconds(std::ostream& out, std::int64_t nanoseconds) {
+  out << nanoseconds / 1000 << '.';
+  auto fraction = nanoseconds % 1000;
+  out << static_cast<char>('0' + fraction / 100) << static_cast<char>('0' + fraction / 10 % 10)
+      << static_cast<char>('0' + fraction % 10);
+}
+
+} // namespace
+
+namespace pv {
+namespace trace {
+
+std::atomic<bool> enabledFlag{false};
+
+void setEnabled(bool enabled) { enabledFlag.store(enabled, std::memory_order_relaxed); }
+
+void setThreadName(const char* name) {
+  threadState.name = name;
+  if (threadState.buffer != nullptr) {
+    std::lock_guard lock(threadState.buffer->mutex);
+    threadState.buffer->threadName = name;
+  }
+}
+
+void clear() {
+  std::lock_guard lock(buffersMutex);
+  buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+                               [](const auto& buffer) {
+                                 std::lock_guard bufferLock(buffer->mutex);
+                                 buffer->events.clear();
+                                 return buffer->exited;
+                               }),
+                buffers.end());
+}
+
+std::size_t spanCount() {
+  std::size_t result = 0;
+  for (const auto& buffer : allBuffers()) {
+    std::lock_guard lock(buffer->mutex);
+    result += buffer->events.size();
+  }
+  return result;
+}
+
+void writeChromeTrace(std::ostream& out) {
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto& buffer : allBuffers()) {
+    std::lock_guard lock(buffer->mutex);
+    if (buffer->threadName != nullptr) {
+      out << (first ? "\n" : ",\n") << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << buffer->thread
+          << R"(,"args":{"name":)";
+      writeJsonString(out, buffer->threadName);
+      out << "}}";
+      first = false;
+    }
+    for (const auto& event : buffer->events) {
+      out << (first ? "\n" : ",\n") << "{\"name\":";
+      first = false;
+      writeJsonString(out, event.name);
+      out << ",\"cat\":";
+      writeJsonString(out, event.category);
+      out << R"(,"ph":"X","pid":1,"tid":)" << buffer->thread << ",\"ts\":";
+      writeMicroseconds(out, event.start);
+      out << ",\"dur\":";
+      writeMicroseconds(out, event.duration);
+      out << '}';
+    }
+  }
+  out << "\n]}\n";
+}
+
+Span::~Span() {
+  if (!active) {
+    return;
+  }
+  auto end = std::chrono::steady_clock::now();
+  auto& buffer = threadBuffer();
+  std::lock_guard lock(buffer.mutex);
+  if (buffer.events.size() < maxEventsPerThread) {
+    buffer.events.push_back(
+        Event{name, category, std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch).count(),
+              std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()});
+  }
+}
+
+} // namespace trace
+} // namespace pv
@@ -0,0 +1,71 @@
+#ifndef PV_TRACE_H
+#define PV_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+
+namespace pv {
+namespace trace {
+
+/// \internal
+extern std::atomic<bool> enabledFlag;
+
+/// \brief Returns whether spans are being recorded.
+inline bool enabled() noexcept { return enabledFlag.load(std::memory_order_relaxed); }
+
+/// \brief Starts or stops recording spans. Spans already recorded are kept until \c clear() is called.
+void setEnabled(bool enabled);
+
+/// \brief Names the calling thread's track in exported traces. \c name must outlive the trace.
+void setThreadName(const char* name);
+
+/// \brief Forgets every span recorded so far.
+void clear();
+
+/// \brief Returns the number of spans recorded since the last \c clear().
+std::size_t spanCount();
+
+/// \brief Writes every recorded span to \c out in the Chrome trace event format, which can be loaded into
+/// \c chrome://tracing or Perfetto.
+///
+/// Spans are written as complete ("X") events, with one track per thread. The viewer nests spans on the same thread
+/// by their times, so a span that begins and ends within another shows up beneath it.
+void writeChromeTrace(std::ostream& out);
+
+/// \brief Records the time between its construction and destruction as a span, if tracing is enabled when it is
+/// constructed.
+///
+/// When tracing is disabled a span costs a single relaxed load. \c name and \c category must outlive the trace
+/// (string literals are expected), since only the pointers are kept.
+///
+/// \code
+/// void HoldingsModel::repopulate() {
+///   pv::trace::Span span("HoldingsModel::repopulate", "ui");
+///   ...
+/// }
+/// \endcode
+class Span {
+private:
+  const char* name;
+  const char* category;
+  std::chrono::steady_clock::time_point start;
+  bool active;
+public:
+  explicit Span(const char* name, const char* category = "pv") noexcept
+      : name(name), category(category), active(enabled()) {
+    if (active) {
+      start = std::chrono::steady_clock::now();
+    }
+  }
+  ~Span();
+
+  Span(const Span&) = delete;
+  Span& operator=(const Span&) = delete;
+};
+
+} // namespace trace
+} // namespace pv
+
+#endif // PV_TRACE_H
@@ -3,9 +3,67 @@
 #include "pv/Integer64.h"
 #include <sqlite3.h>
 
+namespace {
+
+// Each transaction has exactly one action-specific row, so at most one of each COALESCE's arguments is set
+const char* recordQuery = R"(
+SELECT Transactions.AccountId, Transactions.Date, Transactions.Action,
+  COALESCE(BuyTransactions.SecurityId, SellTransactions.SecurityId, DepositTransactions.SecurityId,
+    WithdrawTransactions.SecurityId, DividendTransactions.SecurityId, InterestTransactions.SecurityId),
+  COALESCE(BuyTransactions.NumberOfShares, SellTransactions.NumberOfShares, 0),
+  COALESCE(BuyTransactions.SharePrice, SellTransactions.SharePrice, 0),
+  COALESCE(BuyTransactions.Commission, SellTransactions.Commission, 0),
+  COALESCE(BuyTransactions.Amount, SellTransactions.Amount, DepositTransactions.Amount, WithdrawTransactions.Amount,
+    DividendTransactions.Amount, InterestTransactions.Amount, 0),
+  Securities.Symbol
+FROM Transactions
+  LEFT JOIN BuyTransactions ON Transactions.Id = BuyTransactions.TransactionId
+  LEFT JOIN SellTransactions ON Transactions.Id = SellTransactions.TransactionId
+  LEFT JOIN DepositTransactions ON Transactions.Id = DepositTransactions.TransactionId
+  LEFT JOIN WithdrawTransactions ON Transactions.Id = WithdrawTransactions.TransactionId
+  LEFT JOIN DividendTransactions ON Transactions.Id = DividendTransactions.TransactionId
+  LEFT JOIN InterestTransactions ON Transactions.Id = InterestTransactions.TransactionId
+  LEFT JOIN Securities ON Securities.Id = COALESCE(BuyTransactions.SecurityId, SellTransactions.SecurityId,
+    DepositTransactions.SecurityId, WithdrawTransactions.SecurityId, DividendTransactions.SecurityId,
+    InterestTransactions.SecurityId)
+WHERE Transactions.Id = ?
+)";
+
+} // namespace
+
 namespace pv {
 namespace transaction {
 
+std::optional<Record> record(DataFile& dataFile, pv::i64 transaction) noexcept {
+  auto* query = dataFile.cachedQuery(recordQuery);
+  if (query == nullptr) {
+    return std::nullopt;
+  }
+  sqlite3_bind_int64(query, 1, static_cast<sqlite3_int64>(transaction));
+  if (sqlite3_step(query) != SQLITE_ROW) {
+    sqlite3_reset(query);
+    return std::nullopt;
+  }
+
+  Record result;
+  result.id = transaction;
+  result.account = sqlite3_column_int64(query, 0);
+  result.date = sqlite3_column_int64(query, 1);
+  result.action = static_cast<pv::Action>(sqlite3_column_int(query, 2));
+  if (sqlite3_column_type(query, 3) != SQLITE_NULL) {
+    result.security = sqlite3_column_int64(query, 3);
+  }
+  result.numberOfShares = sqlite3_column_int64(query, 4);
+  result.sharePrice = sqlite3_column_int64(query, 5);
+  result.commission = sqlite3_column_int64(query, 6);
+  result.amount = sqlite3_column_int64(query, 7);
+  if (const auto* symbol = reinterpret_cast<const char*>(sqlite3_column_text(query, 8)); symbol != nullptr) {
+    result.symbol = symbol;
+  }
+  sqlite3_reset(query);
+  return result;
+}
+
 i64 date(DataFile& dataFile, pv::i64 transaction) noexcept {
   auto* query = dataFile.cachedQuery("SELECT Date FROM Transactions WHERE Id = ?");
   sqlite3_bind_int64(query, 1, static_cast<sqlite3_int64>(transaction));
@@ -3,10 +3,28 @@
 
 #include "pv/DataFile.h"
 #include "pv/Integer64.h"
+#include <optional>
+#include <string>
 
 namespace pv {
 namespace transaction {
 
+/// \brief Every column of a single transaction, as read by \c record().
+///
+/// The fields are filled in the same way as \c TransactionRecord, except that \c amount is also set for BUY
+/// and SELL transactions (to the total amount, including the commission).
+struct Record : TransactionRecord {
+  i64 id = 0;
+  /// \brief The symbol of \c security, or empty if there is no security.
+  std::string symbol;
+};
+
+/// \brief Reads every column of \c transaction with a single query.
+///
+/// This is much cheaper than calling \c action() followed by the action-specific functions below.
+/// \returns the transaction, or \c std::nullopt if it does not exist
+std::optional<Record> record(DataFile& dataFile, pv::i64 transaction) noexcept;
+
 i64 date(DataFile& dataFile, pv::i64 transaction) noexcept;
 i64 account(DataFile& dataFile, pv::i64 transaction) noexcept;
 pv::Action action(DataFile& dataFile, pv::i64 transaction) noexcept;
@@ -0,0 +1,393 @@
+#include "pv/BalanceIndex.h"
+#include "pv/DataFile.h"
+#include "pv/Integer64.h"
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <set>
+#include <sqlite3.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char* usage = R"(Usage: pv_balance_check
+
+Checks the running cash balances and shares held that pView keeps to reject
+modifications that would make one negative. Random sequences of changes, marks
+and rollbacks are applied to the balance index, and random sequences of
+inserts, updates, deletes and rolled back transactions to a data file, and every
+balance and every result is compared with one recomputed from scratch. The
+sequences are seeded, so a failure can be reproduced.
+)";
+
+using pv::i64;
+
+class Checker {
+private:
+  std::string scenario;
+  int failures_ = 0;
+public:
+  void start(std::string name) { scenario = std::move(name); }
+
+  void check(bool ok, const std::string& what) {
+    if (!ok) {
+      ++failures_;
+      std::cout << scenario << ": FAILED: " << what << '\n';
+    }
+  }
+
+  int failures() const noexcept { return failures_; }
+};
+
+constexpr i64 accounts = 2;
+constexpr i64 securities = 2;
+constexpr i64 days = 40;
+
+/// \brief Returns a random integer in [low, high].
+i64 uniform(std::mt19937& random, i64 low, i64 high) {
+  return std::uniform_int_distribution<i64>(low, high)(random);
+}
+
+/// \brief Every change applied to a balance index, which is summed up again for each query.
+struct Deltas {
+  struct Delta {
+    std::optional<i64> security;
+    i64 account;
+    i64 date;
+    i64 delta;
+  };
+
+  std::vector<Delta> deltas;
+
+  void apply(const pv::BalanceChange& change, int sign) {
+    deltas.push_back({std::nullopt, change.account, change.date, sign * change.cash});
+    if (change.security.has_value()) {
+      deltas.push_back({change.security, change.account, change.date, sign * change.shares});
+    }
+  }
+
+  i64 balance(std::optional<i64> security, i64 account, i64 date) const {
+    i64 sum = 0;
+    for (const auto& delta : deltas) {
+      if (delta.security == security && delta.account == account && delta.date <= date) {
+        sum += delta.delta;
+      }
+    }
+    return sum;
+  }
+
+  bool negativeFrom(std::optional<i64> security, i64 account, i64 date) const {
+    for (i64 day = date; day < days; ++day) {
+      if (balance(security, account, day) < 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+};
+
+void checkIndex(Checker& checker) {
+  checker.start("index");
+  std::mt19937 random(1);
+  pv::BalanceIndex index;
+  Deltas expected;
+  std::vector<std::pair<std::size_t, std::size_t>> marks; // The index's mark, and the size of expected.deltas
+
+  for (int step = 0; step < 2000; ++step) {
+    auto what = uniform(random, 0, 9);
+    if (what == 0) {
+      marks.emplace_back(index.mark(), expected.deltas.size());
+    } else if (what == 1 && !marks.empty()) {
+      index.rollback(marks.back().first);
+      expected.deltas.resize(marks.back().second);
+      marks.pop_back();
+    } else if (what == 2 && marks.size() == 1) {
+      index.commit();
+      marks.clear();
+    } else {
+      pv::BalanceChange change{uniform(random, 1, accounts), uniform(random, 0, days - 1), std::nullopt,
+                               uniform(random, -50, 50), 0};
+      if (uniform(random, 0, 1) == 0) {
+        change.security = uniform(random, 1, securities);
+        change.shares = uniform(random, -5, 5);
+      }
+      int sign = uniform(random, 0, 3) == 0 ? -1 : 1;
+      index.apply(change, sign);
+      expected.apply(change, sign);
+    }
+
+    auto account = uniform(random, 1, accounts);
+    auto security = uniform(random, 1, securities);
+    auto date = uniform(random, 0, days - 1);
+    auto at = " of account " + std::to_string(account) + " on day " + std::to_string(date) + " after step " +
+              std::to_string(step);
+    checker.check(index.cashBalance(account, date) == expected.balance(std::nullopt, account, date),
+                  "cash balance" + at);
+    checker.check(index.sharesHeld(security, account, date) == expected.balance(security, account, date),
+                  "shares held" + at);
+    checker.check(index.cashNegativeFrom(account, date) == expected.negativeFrom(std::nullopt, account, date),
+                  "negative cash" + at);
+    checker.check(index.sharesNegativeFrom(security, account, date) ==
+                      expected.negativeFrom(security, account, date),
+                  "negative shares" + at);
+  }
+}
+
+/// \brief The transactions that a data file should have, and what it should say to each modification.
+class Ledger {
+private:
+  std::map<i64, pv::TransactionRecord> transactions;
+public:
+  const std::map<i64, pv::TransactionRecord>& records() const noexcept { return transactions; }
+
+  /// \brief Recomputes every balance on every date, returning the result that \c DataFile gives for a ledger with
+  /// \c records in place of the transactions with their ids (removing those that are \c std::nullopt).
+  pv::ResultCode check(const std::map<i64, std::optional<pv::TransactionRecord>>& records) const {
+    auto after = transactions;
+    for (const auto& [id, record] : records) {
+      if (record.has_value()) {
+        after[id] = *record;
+      } else {
+        after.erase(id);
+      }
+    }
+
+    std::map<std::pair<i64, i64>, std::map<i64, i64>> cash, shares; // Deltas on each date
+    for (const auto& [id, record] : after) {
+      auto& account = cash[{0, record.account}];
+      switch (record.action) {
+      case pv::Action::BUY:
+        account[record.date] -= record.numberOfShares * record.sharePrice + record.commission;
+        shares[{*record.security, record.account}][record.date] += record.numberOfShares;
+        break;
+      case pv::Action::SELL:
+        account[record.date] += record.numberOfShares * record.sharePrice - record.commission;
+        shares[{*record.security, record.account}][record.date] -= record.numberOfShares;
+        break;
+      case pv::Action::DEPOSIT:
+      case pv::Action::DIVIDEND: account[record.date] += record.amount; break;
+      case pv::Action::WITHDRAW: account[record.date] -= record.amount; break;
+      case pv::Action::INTEREST: break;
+      }
+    }
+
+    auto negative = [](const std::map<std::pair<i64, i64>, std::map<i64, i64>>& balances) {
+      for (const auto& [key, deltas] : balances) {
+        i64 balance = 0;
+        for (const auto& [date, delta] : deltas) {
+          balance += delta;
+          if (balance < 0) {
+            return true;
+          }
+        }
+      }
+      return false;
+    };
+    if (negative(cash)) {
+      return pv::ResultCode::NegativeCashBalance;
+    }
+    if (negative(shares)) {
+      return pv::ResultCode::NegativeSharesHeld;
+    }
+    return pv::ResultCode::Ok;
+  }
+
+  void set(i64 id, const pv::TransactionRecord& record) { transactions[id] = record; }
+  void remove(i64 id) { transactions.erase(id); }
+};
+
+std::string resultName(pv::ResultCode result) {
+  switch (result) {
+  case pv::ResultCode::Ok: return "Ok";
+  case pv::ResultCode::NegativeCashBalance: return "NegativeCashBalance";
+  case pv::ResultCode::NegativeSharesHeld: return "NegativeSharesHeld";
+  default: return "error " + std::to_string(static_cast<int>(result));
+  }
+}
+
+pv::TransactionRecord randomRecord(std::mt19937& random) {
+  pv::TransactionRecord record;
+  record.account = uniform(random, 1, accounts);
+  record.date = uniform(random, 0, days - 1);
+  record.action = static_cast<pv::Action>(uniform(random, 0, 5));
+  switch (record.action) {
+  case pv::Action::BUY:
+  case pv::Action::SELL:
+    record.security = uniform(random, 1, securities);
+    record.numberOfShares = uniform(random, 0, 10);
+    record.sharePrice = uniform(random, 0, 10);
+    record.commission = uniform(random, 0, 10);
+    break;
+  case pv::Action::DEPOSIT:
+  case pv::Action::WITHDRAW:
+    record.amount = uniform(random, 0, 100);
+    break;
+  case pv::Action::DIVIDEND:
+  case pv::Action::INTEREST:
+    record.security = uniform(random, 1, securities);
+    record.amount = uniform(random, 0, 20);
+    break;
+  }
+  return record;
+}
+
+pv::ResultCode add(pv::DataFile& dataFile, const pv::TransactionRecord& record) {
+  switch (record.action) {
+  case pv::Action::BUY:
+    return dataFile.addBuyTransaction(record.account, record.date, *record.security, record.numberOfShares,
+                                      record.sharePrice, record.commission);
+  case pv::Action::SELL:
+    return dataFile.addSellTransaction(record.account, record.date, *record.security, record.numberOfShares,
+                                       record.sharePrice, record.commission);
+  case pv::Action::DEPOSIT:
+    return dataFile.addDepositTransaction(record.account, record.date, std::nullopt, record.amount);
+  case pv::Action::WITHDRAW:
+    return dataFile.addWithdrawTransaction(record.account, record.date, std::nullopt, record.amount);
+  case pv::Action::DIVIDEND:
+    return dataFile.addDividendTransaction(record.account, record.date, *record.security, record.amount);
+  case pv::Action::INTEREST:
+  default: return dataFile.addInterestTransaction(record.account, record.date, *record.security, record.amount);
+  }
+}
+
+/// \brief Changes one of the amounts of \c record at random, and sets it in \c dataFile.
+pv::ResultCode update(pv::DataFile& dataFile, i64 id, pv::TransactionRecord& record, std::mt19937& random) {
+  auto value = uniform(random, 0, record.action == pv::Action::BUY || record.action == pv::Action::SELL ? 10 : 100);
+  auto field = uniform(random, 0, 2);
+  switch (record.action) {
+  case pv::Action::BUY:
+  case pv::Action::SELL: {
+    bool buy = record.action == pv::Action::BUY;
+    if (field == 0) {
+      record.numberOfShares = value;
+      return buy ? dataFile.setBuyNumberOfShares(id, value) : dataFile.setSellNumberOfShares(id, value);
+    } else if (field == 1) {
+      record.sharePrice = value;
+      return buy ? dataFile.setBuySharePrice(id, value) : dataFile.setSellSharePrice(id, value);
+    }
+    record.commission = value;
+    return buy ? dataFile.setBuyCommission(id, value) : dataFile.setSellCommission(id, value);
+  }
+  case pv::Action::DEPOSIT: record.amount = value; return dataFile.setDepositAmount(id, value);
+  case pv::Action::WITHDRAW: record.amount = value; return dataFile.setWithdrawAmount(id, value);
+  case pv::Action::DIVIDEND: record.amount = value; return dataFile.setDividendAmount(id, value);
+  case pv::Action::INTEREST:
+  default: record.amount = value; return dataFile.setInterestAmount(id, value);
+  }
+}
+
+/// \brief Reads the ids of the transactions in \c dataFile straight from the database.
+std::set<i64> transactionIds(const pv::DataFile& dataFile) {
+  std::set<i64> ids;
+  auto stmt = dataFile.query("SELECT Id FROM Transactions");
+  while (stmt != nullptr && sqlite3_step(stmt.get()) == SQLITE_ROW) {
+    ids.insert(sqlite3_column_int64(stmt.get(), 0));
+  }
+  return ids;
+}
+
+void checkDataFile(Checker& checker) {
+  checker.start("data file");
+  std::mt19937 random(2);
+  pv::DataFile dataFile;
+  for (i64 account = 1; account <= accounts; ++account) {
+    dataFile.addAccount("Account " + std::to_string(account));
+  }
+  for (i64 security = 1; security <= securities; ++security) {
+    dataFile.addSecurity("S" + std::to_string(security), "", "", "");
+  }
+
+  Ledger ledger;
+  std::optional<Ledger> saved; // The ledger when a transaction was begun, if one is open
+  std::size_t accepted = 0;
+  std::size_t rejected = 0;
+
+  for (int step = 0; step < 3000; ++step) {
+    auto at = " at step " + std::to_string(step);
+    auto expectResult = [&](pv::ResultCode actual, pv::ResultCode expected) {
+      checker.check(actual == expected, resultName(actual) + " instead of " + resultName(expected) + at);
+      ++(actual == pv::ResultCode::Ok ? accepted : rejected);
+      return actual == pv::ResultCode::Ok && expected == pv::ResultCode::Ok;
+    };
+
+    const auto& records = ledger.records();
+    auto what = uniform(random, 0, 19);
+    if (what < 7 || records.empty()) {
+      auto record = randomRecord(random);
+      auto expected = ledger.check({{-1, record}});
+      if (expectResult(add(dataFile, record), expected)) {
+        ledger.set(dataFile.lastInsertedId(), record);
+      }
+    } else if (what < 13) {
+      auto iter = std::next(records.begin(), uniform(random, 0, static_cast<i64>(records.size()) - 1));
+      auto id = iter->first;
+      auto record = iter->second;
+      auto result = update(dataFile, id, record, random);
+      if (expectResult(result, ledger.check({{id, record}}))) {
+        ledger.set(id, record);
+      }
+    } else if (what < 16) {
+      auto id = std::next(records.begin(), uniform(random, 0, static_cast<i64>(records.size()) - 1))->first;
+      if (expectResult(dataFile.removeTransaction(id), ledger.check({{id, std::nullopt}}))) {
+        ledger.remove(id);
+      }
+    } else if (what < 18) {
+      std::vector<pv::TransactionRecord> batch;
+      std::map<i64, std::optional<pv::TransactionRecord>> added;
+      for (i64 i = uniform(random, 1, 5); i > 0; --i) {
+        batch.push_back(randomRecord(random));
+        added[-i] = batch.back();
+      }
+      if (expectResult(dataFile.addTransactions(batch), ledger.check(added))) {
+        auto id = dataFile.lastInsertedId() - static_cast<i64>(batch.size());
+        for (const auto& record : batch) {
+          ledger.set(++id, record);
+        }
+      }
+    } else if (!saved.has_value()) {
+      checker.check(dataFile.beginTransaction() == pv::ResultCode::Ok, "could not begin a transaction" + at);
+      saved = ledger;
+    } else if (what == 18) {
+      checker.check(dataFile.rollbackTransaction() == pv::ResultCode::Ok, "could not roll back" + at);
+      ledger = *saved;
+      saved.reset();
+    } else {
+      checker.check(dataFile.commitTransaction() == pv::ResultCode::Ok, "could not commit" + at);
+      saved.reset();
+    }
+
+    std::set<i64> expectedIds;
+    for (const auto& [id, record] : ledger.records()) {
+      expectedIds.insert(id);
+    }
+    checker.check(transactionIds(dataFile) == expectedIds, "the transactions differ from the expected ones" + at);
+  }
+
+  // Both outcomes should have come up often enough to mean something
+  checker.check(accepted >= 100 && rejected >= 100, std::to_string(accepted) + " modifications were accepted and " +
+                                                        std::to_string(rejected) + " rejected");
+}
+
+} // namespace
+
+int main(int argc, char**) {
+  if (argc > 1) {
+    std::cerr << usage;
+    return EXIT_FAILURE;
+  }
+
+  Checker checker;
+  checkIndex(checker);
+  checkDataFile(checker);
+  if (checker.failures() != 0) {
+    std::cout << checker.failures() << " checks failed\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "All checks passed\n";
+  return EXIT_SUCCESS;
+}
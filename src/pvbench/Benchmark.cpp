@@ -0,0 +1,111 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+#include <utility>
+
+#ifndef PVIEW_VERSION_MAJOR
+#define PVIEW_VERSION_MAJOR 3
+#define PVIEW_VERSION_MINOR 0
+#define PVIEW_VERSION_PATCH 0
+#endif
+
+namespace {
+
+volatile pv::i64 sink = 0;
+
+void writeJsonString(std::ostream& out, const std::string& string) {
+  out << '"';
+  for (char c : string) {
+    if (c == '"' || c == '\\') {
+      out << '\\';
+    }
+    out << c;
+  }
+  out << '"';
+}
+
+} // namespace
+
+namespace pvbench {
+
+bool Runner::selected(const std::string& name) const noexcept {
+  return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+void Runner::run(const std::string& name, const std::function<void(std::size_t)>& iteration,
+                 const std::function<void()>& setup) {
+  if (!selected(name)) {
+    return;
+  }
+
+  using Clock = std::chrono::steady_clock;
+  std::vector<double> timings;
+  std::chrono::nanoseconds total(0);
+  while (timings.size() < minIterations || total < minTime) {
+    if (setup) {
+      setup();
+    }
+    auto start = Clock::now();
+    iteration(timings.size());
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+    total += elapsed;
+    timings.push_back(static_cast<double>(elapsed.count()));
+  }
+
+  std::sort(timings.begin(), timings.end());
+  Result result;
+  result.name = name;
+  result.iterations = timings.size();
+  result.mean = std::accumulate(timings.cbegin(), timings.cend(), 0.0) / static_cast<double>(timings.size());
+  result.median = timings.size() % 2 == 0 ? (timings[timings.size() / 2 - 1] + timings[timings.size() / 2]) / 2
+                                          : timings[timings.size() / 2];
+  result.min = timings.front();
+  result.max = timings.back();
+  results_.push_back(std::move(result));
+}
+
+void consume(pv::i64 value) noexcept { sink = sink + value; }
+
+void writeText(std::ostream& out, const std::vector<Result>& results) {
+  std::size_t nameWidth = 9;
+  for (const auto& result : results) {
+    nameWidth = std::max(nameWidth, result.name.size());
+  }
+
+  auto flags = out.flags();
+  out << std::left << std::setw(static_cast<int>(nameWidth)) << "Benchmark" << std::right << std::setw(12)
+      << "Iterations" << std::setw(16) << "Mean (us)" << std::setw(16) << "Median (us)" << std::setw(16) << "Min (us)"
+      << '\n';
+  out << std::fixed << std::setprecision(2);
+  for (const auto& result : results) {
+    out << std::left << std::setw(static_cast<int>(nameWidth)) << result.name << std::right << std::setw(12)
+        << result.iterations << std::setw(16) << result.mean / 1000 << std::setw(16) << result.median / 1000
+        << std::setw(16) << result.min / 1000 << '\n';
+  }
+  out.flags(flags);
+}
+
+void writeJson(std::ostream& out, const std::vector<Result>& results, const PortfolioShape& shape) {
+  out << "{\n";
+  out << "  \"version\": \"" << PVIEW_VERSION_MAJOR << '.' << PVIEW_VERSION_MINOR << '.' << PVIEW_VERSION_PATCH
+      << "\",\n";
+  out << "  \"portfolio\": {\"accounts\": " << shape.accounts << ", \"securities\": " << shape.securities
+      << ", \"transactions\": " << shape.transactions << ", \"prices\": " << shape.prices
+      << ", \"seed\": " << shape.seed << "},\n";
+  out << "  \"unit\": \"ns\",\n";
+  out << "  \"benchmarks\": [";
+  auto flags = out.flags();
+  out << std::fixed << std::setprecision(0);
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const auto& result = results[i];
+    out << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+    writeJsonString(out, result.name);
+    out << ", \"iterations\": " << result.iterations << ", \"mean\": " << result.mean
+        << ", \"median\": " << result.median << ", \"min\": " << result.min << ", \"max\": " << result.max << '}';
+  }
+  out.flags(flags);
+  out << "\n  ]\n}\n";
+}
+
+} // namespace pvbench
@@ -0,0 +1,64 @@
+#ifndef PVBENCH_BENCHMARK_H
+#define PVBENCH_BENCHMARK_H
+
+#include "Generator.h"
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pvbench {
+
+/// \brief The timings of a single benchmark, in nanoseconds per iteration.
+struct Result {
+  std::string name;
+  std::size_t iterations;
+  double mean;
+  double median;
+  double min;
+  double max;
+};
+
+/// \brief Times benchmarks and collects their results.
+///
+/// Each benchmark is run repeatedly until it has taken at least the minimum time (and has run at least
+/// \c minIterations times), and every iteration is timed separately.
+class Runner {
+private:
+  std::string filter;
+  std::chrono::nanoseconds minTime;
+  std::vector<Result> results_;
+public:
+  static constexpr std::size_t minIterations = 3;
+
+  /// \param filter only benchmarks whose names contain this are run
+  Runner(std::string filter, std::chrono::nanoseconds minTime) : filter(std::move(filter)), minTime(minTime) {}
+
+  /// \brief Runs a benchmark, unless it is filtered out.
+  ///
+  /// \param iteration called once per iteration with the number of the iteration, starting from 0
+  /// \param setup called (untimed) before each iteration, if it is not empty
+  void run(const std::string& name, const std::function<void(std::size_t)>& iteration,
+           const std::function<void()>& setup = nullptr);
+
+  /// \brief Checks if a benchmark would be run, so that expensive fixtures can be skipped.
+  bool selected(const std::string& name) const noexcept;
+
+  const std::vector<Result>& results() const noexcept { return results_; }
+};
+
+/// \brief Keeps the compiler from optimizing away a value that a benchmark computes.
+void consume(pv::i64 value) noexcept;
+
+/// \brief Writes results as an aligned table, for reading.
+void writeText(std::ostream& out, const std::vector<Result>& results);
+
+/// \brief Writes results as a JSON document, for comparing runs with other tools.
+void writeJson(std::ostream& out, const std::vector<Result>& results, const PortfolioShape& shape);
+
+} // namespace pvbench
+
+#endif // PVBENCH_BENCHMARK_H
@@ -0,0 +1,206 @@
+#include "pv/ChangeSet.h"
+#include "pv/DataFile.h"
+#include "pv/Integer64.h"
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char* usage = R"(Usage: pv_changeset_check
+
+Checks that a data file emits exactly one ChangeSet for each commit, listing
+every row that it modified, and none for modifications that are rolled back,
+whether by rolling back a transaction or by rejecting a modification.
+)";
+
+using pv::i64;
+
+class Checker {
+private:
+  std::string scenario;
+  int failures_ = 0;
+public:
+  void start(std::string name) { scenario = std::move(name); }
+
+  void check(bool ok, const std::string& what) {
+    if (!ok) {
+      ++failures_;
+      std::cout << scenario << ": FAILED: " << what << '\n';
+    }
+  }
+
+  int failures() const noexcept { return failures_; }
+};
+
+/// \brief A data file with an account holding 100 and a security, which records every change set it emits.
+class Recorder {
+public:
+  pv::DataFile dataFile;
+  std::vector<pv::ChangeSet> changeSets;
+  std::size_t rollbacks = 0;
+  i64 account = 0;
+  i64 security = 0;
+  i64 deposit = 0;
+private:
+  pv::ScopedConnection changeSetConnection;
+  pv::ScopedConnection rollbackConnection;
+public:
+  Recorder() {
+    dataFile.addAccount("Account");
+    account = dataFile.lastInsertedId();
+    dataFile.addSecurity("S", "Security", "", "");
+    security = dataFile.lastInsertedId();
+    dataFile.addDepositTransaction(account, 0, std::nullopt, 100);
+    deposit = dataFile.lastInsertedId();
+
+    changeSetConnection = dataFile.onChangeSet([this](const pv::ChangeSet& changes) { changeSets.push_back(changes); });
+    rollbackConnection = dataFile.onRollback([this] { ++rollbacks; });
+  }
+};
+
+void checkSingle(Checker& checker) {
+  checker.start("single modifications");
+  Recorder recorder;
+  auto& dataFile = recorder.dataFile;
+
+  dataFile.addAccount("Another");
+  auto account = dataFile.lastInsertedId();
+  checker.check(recorder.changeSets.size() == 1, "adding an account emitted " +
+                                                      std::to_string(recorder.changeSets.size()) + " change sets");
+  checker.check(!recorder.changeSets.empty() && recorder.changeSets.back().accounts == std::set<i64>{account} &&
+                    recorder.changeSets.back().transactions.empty(),
+                "the change set should only list the new account");
+
+  // A buy writes to Transactions and BuyTransactions, but is still one row of one commit
+  dataFile.addBuyTransaction(recorder.account, 1, recorder.security, 2, 10, 1);
+  auto buy = dataFile.lastInsertedId();
+  checker.check(recorder.changeSets.size() == 2, "adding a buy should emit one change set");
+  checker.check(recorder.changeSets.back().transactions == std::set<i64>{buy},
+                "the change set should only list the buy");
+
+  dataFile.setSecurityPrice(recorder.security, 5, 123);
+  checker.check(recorder.changeSets.size() == 3, "setting a price should emit one change set");
+  checker.check(recorder.changeSets.back().securityPrices == std::set<std::pair<i64, i64>>{{recorder.security, 5}} &&
+                    recorder.changeSets.back().hasSecurityPrices(recorder.security),
+                "the change set should list the price");
+}
+
+void checkTransaction(Checker& checker) {
+  checker.start("transaction");
+  Recorder recorder;
+  auto& dataFile = recorder.dataFile;
+
+  dataFile.beginTransaction();
+  dataFile.addWithdrawTransaction(recorder.account, 1, std::nullopt, 10);
+  auto withdrawal = dataFile.lastInsertedId();
+  dataFile.setDepositAmount(recorder.deposit, 150);
+  dataFile.setSecurityName(recorder.security, "Renamed");
+  dataFile.setSecurityPrice(recorder.security, 2, 50);
+  dataFile.setSecurityPrice(recorder.security, 2, 51);
+  checker.check(recorder.changeSets.empty(), "emitted a change set before committing");
+
+  dataFile.commitTransaction();
+  checker.check(recorder.changeSets.size() == 1, "committing emitted " + std::to_string(recorder.changeSets.size()) +
+                                                     " change sets instead of one");
+  if (recorder.changeSets.size() == 1) {
+    const auto& changes = recorder.changeSets.front();
+    checker.check(changes.transactions == std::set<i64>{recorder.deposit, withdrawal},
+                  "the change set should list the withdrawal and the deposit once each");
+    checker.check(changes.securities == std::set<i64>{recorder.security}, "the change set should list the security");
+    checker.check(changes.securityPrices == std::set<std::pair<i64, i64>>{{recorder.security, 2}},
+                  "the change set should list the price once");
+  }
+
+  checker.start("batch");
+  dataFile.addTransactions({{recorder.account, 3, pv::Action::DEPOSIT, std::nullopt, 0, 0, 0, 5},
+                            {recorder.account, 4, pv::Action::WITHDRAW, std::nullopt, 0, 0, 0, 5},
+                            {recorder.account, 5, pv::Action::DEPOSIT, std::nullopt, 0, 0, 0, 5}});
+  checker.check(recorder.changeSets.size() == 2, "adding three transactions at once should emit one change set");
+  checker.check(recorder.changeSets.back().transactions.size() == 3, "the change set should list three transactions");
+}
+
+void checkRollback(Checker& checker) {
+  checker.start("rollback");
+  Recorder recorder;
+  auto& dataFile = recorder.dataFile;
+
+  dataFile.beginTransaction();
+  dataFile.addAccount("Rolled back");
+  dataFile.addDepositTransaction(recorder.account, 1, std::nullopt, 10);
+  dataFile.setSecurityPrice(recorder.security, 1, 10);
+  dataFile.rollbackTransaction();
+  checker.check(recorder.changeSets.empty(), "emitted a change set for a rolled back transaction");
+  checker.check(recorder.rollbacks == 1, "rolling back should be signalled once");
+
+  // Nothing rolled back should turn up in the next commit
+  dataFile.addAccount("Committed");
+  auto account = dataFile.lastInsertedId();
+  checker.check(recorder.changeSets.size() == 1 && recorder.changeSets.front().accounts == std::set<i64>{account} &&
+                    recorder.changeSets.front().transactions.empty() &&
+                    recorder.changeSets.front().securityPrices.empty(),
+                "the next change set should only list what was committed");
+
+  checker.start("rejected");
+  recorder.changeSets.clear();
+  auto result = dataFile.addWithdrawTransaction(recorder.account, 1, std::nullopt, 1000);
+  checker.check(result == pv::ResultCode::NegativeCashBalance, "withdrawing more than the balance was accepted");
+  result = dataFile.setDepositAmount(recorder.deposit, 0);
+  checker.check(result == pv::ResultCode::Ok, "emptying the deposit should be accepted with no withdrawals");
+  checker.check(recorder.changeSets.size() == 1 &&
+                    recorder.changeSets.front().transactions == std::set<i64>{recorder.deposit},
+                "a rejected modification should emit nothing, and only the accepted one should be listed");
+  checker.check(recorder.rollbacks == 1, "rejecting a modification should not be signalled as a rollback");
+
+  // A modification rejected inside a transaction only takes its own rows out of the commit
+  recorder.changeSets.clear();
+  dataFile.beginTransaction();
+  dataFile.addDepositTransaction(recorder.account, 2, std::nullopt, 10);
+  auto deposit = dataFile.lastInsertedId();
+  result = dataFile.addWithdrawTransaction(recorder.account, 2, std::nullopt, 1000);
+  checker.check(result == pv::ResultCode::NegativeCashBalance, "withdrawing more than the balance was accepted");
+  dataFile.commitTransaction();
+  checker.check(recorder.changeSets.size() == 1 && recorder.changeSets.front().transactions == std::set<i64>{deposit},
+                "the commit should only list the accepted deposit");
+}
+
+void checkRemovedSecurity(Checker& checker) {
+  checker.start("removed security");
+  Recorder recorder;
+  auto& dataFile = recorder.dataFile;
+
+  dataFile.addSecurity("T", "Removed", "", "");
+  auto security = dataFile.lastInsertedId();
+  dataFile.setSecurityPrice(security, 1, 10);
+  recorder.changeSets.clear();
+  dataFile.removeSecurity(security);
+  checker.check(recorder.changeSets.size() == 1, "removing a security should emit one change set");
+  checker.check(!recorder.changeSets.empty() && recorder.changeSets.back().securities == std::set<i64>{security} &&
+                    !recorder.changeSets.back().hasSecurityPrices(security),
+                "the change set should only list the security, not its prices");
+}
+
+} // namespace
+
+int main(int argc, char**) {
+  if (argc > 1) {
+    std::cerr << usage;
+    return EXIT_FAILURE;
+  }
+
+  Checker checker;
+  checkSingle(checker);
+  checkTransaction(checker);
+  checkRollback(checker);
+  checkRemovedSecurity(checker);
+  if (checker.failures() != 0) {
+    std::cout << checker.failures() << " checks failed\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "All checks passed\n";
+  return EXIT_SUCCESS;
+}
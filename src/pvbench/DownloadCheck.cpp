@@ -0,0 +1,211 @@
+#include "PriceServer.h"
+#include "pvui/SecurityPriceDownloader.h"
+#include <QCoreApplication>
+#include <QDate>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QHash>
+#include <QStringList>
+#include <QTimer>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace pvbench;
+using Fault = PriceServer::Fault;
+
+const char* usage = R"(Usage: pv_download_check
+
+Downloads prices with pView's downloader from a local stand-in server that
+answers with latency, server errors, throttling (429 with Retry-After), stalls
+and unknown symbols, and checks that every symbol ends in success or error and
+that each download completes exactly once, including aborted ones.
+)";
+
+/// \brief What a download reported.
+struct Result {
+  QHash<QString, int> successes;
+  QHash<QString, int> errors;
+  QHash<QString, QNetworkReply::NetworkError> errorCodes;
+  QHash<QString, std::size_t> prices;
+  int completions = 0;
+  qint64 milliseconds = 0;
+};
+
+enum class Abort : unsigned char { Never, Immediately, OnFirstSuccess };
+
+// Long enough for every retry, short enough to notice a download that never completes
+constexpr std::chrono::seconds timeLimit(30);
+
+Result download(const PriceServer& server, const QStringList& symbols, Abort abort) {
+  pvui::SecurityPriceDownloader downloader;
+  downloader.setPriceProvider(nullptr); // Even if PVIEW_PRICE_SOURCE is set
+  downloader.setUrlTemplate(server.urlTemplate());
+  downloader.setTransferTimeout(500);
+  pv::RequestSchedulerOptions options;
+  options.maxInFlight = 8;
+  options.requestsPerSecond = 50;
+  options.burst = 8;
+  options.initialBackoff = std::chrono::milliseconds(50);
+  downloader.setSchedulerOptions(options);
+
+  Result result;
+  QElapsedTimer timer;
+  timer.start();
+  QEventLoop loop;
+  auto* priceDownload = downloader.download(symbols, QDate(2000, 1, 1), QDate::currentDate().addDays(1));
+  bool aborted = false;
+  QObject::connect(priceDownload, &pvui::SecurityPriceDownload::success, &loop,
+                   [&](const pv::PriceHistory& prices, const QString& symbol) {
+                     ++result.successes[symbol];
+                     result.prices[symbol] = prices.size();
+                     if (abort == Abort::OnFirstSuccess && !aborted) {
+                       aborted = true;
+                       priceDownload->abort(); // Other replies are usually still being parsed
+                     }
+                   });
+  QObject::connect(priceDownload, &pvui::SecurityPriceDownload::error, &loop,
+                   [&](QNetworkReply::NetworkError error, const QString& symbol) {
+                     ++result.errors[symbol];
+                     result.errorCodes[symbol] = error;
+                   });
+  QObject::connect(priceDownload, &pvui::SecurityPriceDownload::complete, &loop, [&] {
+    ++result.completions;
+    result.milliseconds = timer.elapsed();
+    // Wait a little, in case complete is emitted again
+    QTimer::singleShot(std::chrono::milliseconds(200), &loop, &QEventLoop::quit);
+  });
+  if (abort == Abort::Immediately) {
+    priceDownload->abort();
+  }
+  QTimer::singleShot(timeLimit, &loop, &QEventLoop::quit);
+  loop.exec();
+  return result;
+}
+
+class Checker {
+private:
+  std::string scenario;
+  int failures_ = 0;
+public:
+  void start(std::string name) { scenario = std::move(name); }
+
+  void check(bool ok, const std::string& what) {
+    if (!ok) {
+      ++failures_;
+      std::cout << scenario << ": FAILED: " << what << '\n';
+    }
+  }
+
+  int failures() const noexcept { return failures_; }
+};
+
+/// \brief Every symbol ends in exactly one of success or error, and the download completes once.
+void checkFinished(Checker& checker, const QStringList& symbols, const Result& result) {
+  checker.check(result.completions == 1, "complete was emitted " + std::to_string(result.completions) + " times");
+  for (const auto& symbol : symbols) {
+    auto finishes = result.successes.value(symbol) + result.errors.value(symbol);
+    checker.check(finishes == 1, symbol.toStdString() + " finished " + std::to_string(finishes) + " times");
+  }
+}
+
+void checkFaults(Checker& checker) {
+  checker.start("faults");
+  PriceServer server;
+  checker.check(server.listen(), "the server could not listen");
+  server.setDelay(std::chrono::milliseconds(5), std::chrono::milliseconds(50));
+
+  QStringList symbols;
+  for (int i = 0; i < 60; ++i) {
+    auto symbol = QStringLiteral("S%1").arg(i);
+    symbols += symbol;
+    switch (i % 10) {
+    case 0: server.setFault(symbol, Fault::Missing); break;
+    case 1: server.setFault(symbol, Fault::ServerError); break;
+    case 2: server.setFault(symbol, Fault::Throttled); break;
+    case 3: server.setFault(symbol, Fault::Stalled); break;
+    default: break;
+    }
+  }
+
+  auto result = download(server, symbols, Abort::Never);
+  checkFinished(checker, symbols, result);
+
+  QHash<QString, std::vector<std::chrono::steady_clock::time_point>> requests;
+  for (const auto& request : server.requests()) {
+    requests[request.symbol].push_back(request.at);
+  }
+  for (int i = 0; i < symbols.size(); ++i) {
+    const auto& symbol = symbols[i];
+    auto name = symbol.toStdString();
+    if (i % 10 == 0) {
+      checker.check(result.errorCodes.value(symbol) == QNetworkReply::ContentNotFoundError,
+                    name + " should have failed as not found");
+      checker.check(requests.value(symbol).size() == 1, name + " should not have been retried");
+      continue;
+    }
+    checker.check(result.successes.value(symbol) == 1, name + " should have been retried until it succeeded");
+    checker.check(result.prices.value(symbol) == static_cast<std::size_t>(server.days()),
+                  name + " has " + std::to_string(result.prices.value(symbol)) + " prices");
+    const auto times = requests.value(symbol);
+    if (i % 10 == 2 && times.size() >= 2) {
+      checker.check(times[1] - times[0] >= std::chrono::seconds(server.retryAfterSeconds()),
+                    name + " was retried before Retry-After");
+    }
+  }
+  std::cout << "faults: " << symbols.size() << " symbols, " << server.requests().size() << " requests, completed in "
+            << result.milliseconds << " ms\n";
+}
+
+void checkAborts(Checker& checker) {
+  checker.start("abort");
+  PriceServer server;
+  checker.check(server.listen(), "the server could not listen");
+  server.setDelay(std::chrono::milliseconds(0), std::chrono::milliseconds(20));
+  server.setDays(10000); // Slow enough to parse that other replies are still being parsed when aborting
+  QStringList symbols;
+  for (int i = 0; i < 40; ++i) {
+    symbols += QStringLiteral("A%1").arg(i);
+  }
+
+  auto result = download(server, symbols, Abort::OnFirstSuccess);
+  checker.check(result.completions == 1,
+                "complete was emitted " + std::to_string(result.completions) + " times after aborting");
+  for (const auto& symbol : symbols) {
+    checker.check(result.successes.value(symbol) + result.errors.value(symbol) <= 1,
+                  symbol.toStdString() + " finished more than once");
+  }
+  std::cout << "abort: completed in " << result.milliseconds << " ms\n";
+
+  checker.start("abort before starting");
+  result = download(server, symbols, Abort::Immediately);
+  checker.check(result.completions == 1,
+                "complete was emitted " + std::to_string(result.completions) + " times after aborting");
+  checker.check(result.successes.isEmpty() && result.errors.isEmpty(), "symbols finished after aborting");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  QCoreApplication app(argc, argv);
+  if (argc > 1) {
+    std::cerr << usage;
+    return EXIT_FAILURE;
+  }
+
+  Checker checker;
+  checkFaults(checker);
+  checkAborts(checker);
+  if (checker.failures() != 0) {
+    std::cout << checker.failures() << " checks failed\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "All checks passed\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,139 @@
+#include "Generator.h"
+#include <algorithm>
+#include <array>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+// 2020-01-01
+constexpr pv::i64 firstGeneratedDate = 18262;
+
+const std::array<const char*, 5> assetClasses = {"Equities", "Fixed Income", "Real Estate", "Commodities", "Cash"};
+const std::array<const char*, 11> sectors = {"Communication Services",
+                                             "Consumer Discretionary",
+                                             "Consumer Staples",
+                                             "Energy",
+                                             "Financials",
+                                             "Health Care",
+                                             "Industrials",
+                                             "Information Technology",
+                                             "Materials",
+                                             "Real Estate",
+                                             "Utilities"};
+
+/// \internal A random number generator that gives the same sequence on every platform. (The standard distributions
+/// are implementation-defined, so only the raw engine output is used.)
+class Random {
+private:
+  std::mt19937 engine;
+public:
+  explicit Random(std::uint32_t seed) : engine(seed) {}
+
+  /// \brief Returns a number in [0, bound).
+  pv::i64 below(pv::i64 bound) noexcept { return static_cast<pv::i64>(engine() % static_cast<std::uint32_t>(bound)); }
+
+  /// \brief Returns a number in [low, high].
+  pv::i64 between(pv::i64 low, pv::i64 high) noexcept { return low + below(high - low + 1); }
+};
+
+void check(pv::ResultCode result, const char* what) {
+  if (result != pv::ResultCode::Ok) {
+    throw std::runtime_error(std::string("Could not generate portfolio: ") + what + " failed");
+  }
+}
+
+} // namespace
+
+namespace pvbench {
+
+Portfolio generatePortfolio(pv::DataFile& dataFile, const PortfolioShape& shape) {
+  Random random(shape.seed);
+  Portfolio portfolio;
+  const auto days = static_cast<pv::i64>(std::max<std::size_t>(shape.prices, 1));
+  portfolio.firstDate = firstGeneratedDate;
+  portfolio.lastDate = firstGeneratedDate + days - 1;
+
+  check(dataFile.beginTransaction(), "beginTransaction()");
+
+  for (std::size_t i = 0; i < shape.accounts; ++i) {
+    check(dataFile.addAccount("Account " + std::to_string(i + 1)), "addAccount()");
+    portfolio.accounts.push_back(dataFile.lastInsertedId());
+  }
+
+  // A random walk of daily prices for each security, kept so that transactions can be made at market prices
+  std::vector<std::vector<pv::i64>> prices;
+  prices.reserve(shape.securities);
+  for (std::size_t i = 0; i < shape.securities; ++i) {
+    check(dataFile.addSecurity("S" + std::to_string(i + 1), "Security " + std::to_string(i + 1),
+                               assetClasses[static_cast<std::size_t>(random.below(assetClasses.size()))],
+                               sectors[static_cast<std::size_t>(random.below(sectors.size()))]),
+          "addSecurity()");
+    pv::i64 security = dataFile.lastInsertedId();
+    portfolio.securities.push_back(security);
+
+    std::vector<pv::i64> history;
+    history.reserve(static_cast<std::size_t>(days));
+    pv::i64 price = random.between(1000, 50000);
+    for (pv::i64 day = 0; day < days; ++day) {
+      price = std::max<pv::i64>(1, price + price * random.between(-200, 200) / 10000); // +/- 2% per day
+      history.push_back(price);
+      if (shape.prices != 0) {
+        check(dataFile.setSecurityPrice(security, portfolio.firstDate + day, price), "setSecurityPrice()");
+      }
+    }
+    prices.push_back(std::move(history));
+  }
+
+  std::vector<pv::TransactionRecord> records;
+  records.reserve(shape.transactions + shape.accounts);
+  for (auto account : portfolio.accounts) {
+    // Large enough that no sequence of buys and withdrawals can overdraw the account
+    records.push_back(pv::TransactionRecord{account, portfolio.firstDate, pv::Action::DEPOSIT, std::nullopt, 0, 0, 0,
+                                            static_cast<pv::i64>(shape.transactions + 1) * 10000000});
+  }
+
+  std::map<std::pair<pv::i64, pv::i64>, pv::i64> sharesHeld;
+  //       ^ security, account
+  const auto transactionCount = static_cast<pv::i64>(shape.transactions);
+  for (pv::i64 i = 0; i < transactionCount && !portfolio.accounts.empty(); ++i) {
+    pv::i64 day = i * days / transactionCount; // Dates never decrease, so sharesHeld is always up to date
+    pv::i64 date = portfolio.firstDate + day;
+    pv::i64 account = portfolio.accounts[static_cast<std::size_t>(random.below(portfolio.accounts.size()))];
+    pv::i64 kind = random.below(100);
+
+    if (portfolio.securities.empty() || kind < 10) {
+      records.push_back({account, date, pv::Action::DEPOSIT, std::nullopt, 0, 0, 0, random.between(100, 1000000)});
+      continue;
+    }
+    auto securityIndex = static_cast<std::size_t>(random.below(portfolio.securities.size()));
+    pv::i64 security = portfolio.securities[securityIndex];
+    pv::i64 price = prices[securityIndex][static_cast<std::size_t>(day)];
+    pv::i64& held = sharesHeld[{security, account}];
+
+    if (kind < 25 && held > 0) {
+      pv::i64 shares = random.between(1, held);
+      held -= shares;
+      records.push_back({account, date, pv::Action::SELL, security, shares, price, random.between(0, 999), 0});
+    } else if (kind < 65) {
+      pv::i64 shares = random.between(1, 100);
+      held += shares;
+      records.push_back({account, date, pv::Action::BUY, security, shares, price, random.between(0, 999), 0});
+    } else if (kind < 80) {
+      records.push_back({account, date, pv::Action::DIVIDEND, security, 0, 0, 0, random.between(100, 100000)});
+    } else if (kind < 85) {
+      records.push_back({account, date, pv::Action::INTEREST, security, 0, 0, 0, random.between(100, 10000)});
+    } else {
+      records.push_back({account, date, pv::Action::WITHDRAW, std::nullopt, 0, 0, 0, random.between(100, 100000)});
+    }
+  }
+
+  check(dataFile.addTransactions(records), "addTransactions()");
+  check(dataFile.commitTransaction(), "commitTransaction()");
+  return portfolio;
+}
+
+} // namespace pvbench
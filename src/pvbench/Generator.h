@@ -0,0 +1,41 @@
+#ifndef PVBENCH_GENERATOR_H
+#define PVBENCH_GENERATOR_H
+
+#include "pv/DataFile.h"
+#include "pv/Integer64.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace pvbench {
+
+/// \brief The size of a generated portfolio.
+struct PortfolioShape {
+  std::size_t accounts = 4;
+  std::size_t securities = 50;
+  std::size_t transactions = 10000;
+  /// \brief The number of days that each security has a price for. Transactions are spread over these days.
+  std::size_t prices = 1000;
+  std::uint32_t seed = 1;
+};
+
+/// \brief The ids and date range of a generated portfolio.
+struct Portfolio {
+  std::vector<pv::i64> accounts;
+  std::vector<pv::i64> securities;
+  pv::i64 firstDate;
+  pv::i64 lastDate;
+};
+
+/// \brief Fills an empty data file with a random, but valid, portfolio.
+///
+/// The portfolio only depends on \c shape (including its seed), so the same shape always generates the same data
+/// file on every platform. Each account starts with a large deposit, so that cash balances never go negative, and
+/// securities are only sold from accounts that hold them.
+///
+/// \throws std::runtime_error if the data file rejects the portfolio
+Portfolio generatePortfolio(pv::DataFile& dataFile, const PortfolioShape& shape);
+
+} // namespace pvbench
+
+#endif // PVBENCH_GENERATOR_H
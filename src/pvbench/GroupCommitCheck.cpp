@@ -0,0 +1,226 @@
+#include "pv/ChangeSet.h"
+#include "pv/DataFile.h"
+#include "pv/Integer64.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <sqlite3.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char* usage = R"(Usage: pv_group_commit_check
+
+Checks that a data file with group commit holds modifications back until one of
+its limits is reached or it is flushed, that other connections only see them
+once they are committed, that each commit emits one ChangeSet, and that
+beginning a transaction, turning group commit off and closing the data file all
+commit what was held back. Uses a scratch file in the temporary directory.
+)";
+
+using pv::i64;
+using namespace std::chrono_literals;
+
+class Checker {
+private:
+  std::string scenario;
+  int failures_ = 0;
+public:
+  void start(std::string name) { scenario = std::move(name); }
+
+  void check(bool ok, const std::string& what) {
+    if (!ok) {
+      ++failures_;
+      std::cout << scenario << ": FAILED: " << what << '\n';
+    }
+  }
+
+  int failures() const noexcept { return failures_; }
+};
+
+const std::filesystem::path scratch = std::filesystem::temp_directory_path() / "pv_group_commit_check.pvf";
+
+void removeScratch() {
+  for (const char* suffix : {"", "-wal", "-shm", "-journal"}) {
+    std::error_code error;
+    std::filesystem::remove(scratch.string() + suffix, error);
+  }
+}
+
+/// \brief Counts the transactions that another connection sees in the scratch file.
+i64 committedTransactions() {
+  sqlite3* db = nullptr;
+  i64 count = -1;
+  if (sqlite3_open_v2(scratch.string().c_str(), &db, SQLITE_OPEN_READONLY, nullptr) == SQLITE_OK) {
+    sqlite3_stmt* stmt = nullptr;
+    sqlite3_prepare_v2(db, "SELECT COUNT(*) FROM Transactions", -1, &stmt, nullptr);
+    if (stmt != nullptr && sqlite3_step(stmt) == SQLITE_ROW) {
+      count = sqlite3_column_int64(stmt, 0);
+    }
+    sqlite3_finalize(stmt);
+  }
+  sqlite3_close(db);
+  return count;
+}
+
+/// \brief A new scratch data file with an account holding 100, which records every change set it emits.
+class Recorder {
+public:
+  std::unique_ptr<pv::DataFile> dataFile;
+  std::vector<pv::ChangeSet> changeSets;
+  std::size_t flushesPending = 0;
+  i64 account = 0;
+private:
+  pv::ScopedConnection changeSetConnection;
+  pv::ScopedConnection flushPendingConnection;
+public:
+  explicit Recorder(std::optional<pv::GroupCommitOptions> options) {
+    removeScratch();
+    dataFile = std::make_unique<pv::DataFile>(scratch.string());
+    dataFile->addAccount("Account");
+    account = dataFile->lastInsertedId();
+    dataFile->addDepositTransaction(account, 0, std::nullopt, 100);
+
+    dataFile->setGroupCommit(std::move(options));
+    changeSetConnection =
+        dataFile->onChangeSet([this](const pv::ChangeSet& changes) { changeSets.push_back(changes); });
+    flushPendingConnection = dataFile->onFlushPending([this] { ++flushesPending; });
+  }
+
+  ~Recorder() {
+    changeSetConnection.disconnect();
+    flushPendingConnection.disconnect();
+    dataFile.reset();
+    removeScratch();
+  }
+
+  Recorder(const Recorder&) = delete;
+  Recorder& operator=(const Recorder&) = delete;
+
+  void deposit(i64 date) { dataFile->addDepositTransaction(account, date, std::nullopt, 10); }
+};
+
+/// \brief Limits that are never reached while the checks run, so only flushing commits.
+pv::GroupCommitOptions distantLimits() {
+  return pv::GroupCommitOptions{1h, 1h, 1000000};
+}
+
+void checkHeldBack(Checker& checker) {
+  checker.start("held back");
+  Recorder recorder(distantLimits());
+  auto& dataFile = *recorder.dataFile;
+  checker.check(!dataFile.flushDeadline().has_value(), "nothing is waiting to be committed yet");
+
+  auto before = std::chrono::steady_clock::now();
+  for (i64 date = 1; date <= 3; ++date) {
+    recorder.deposit(date);
+  }
+  checker.check(recorder.changeSets.empty(), "emitted a change set before committing");
+  checker.check(recorder.flushesPending == 1, "should signal once that a flush is pending, not " +
+                                                  std::to_string(recorder.flushesPending) + " times");
+  checker.check(committedTransactions() == 1, "another connection sees uncommitted deposits");
+  checker.check(!dataFile.hasTransaction(), "the group's transaction shouldn't count as the user's");
+  auto deadline = dataFile.flushDeadline();
+  checker.check(deadline.has_value() && *deadline >= before + 1h, "the flush should be due in an hour");
+  checker.check(dataFile.rollbackTransaction() == pv::ResultCode::DbError,
+                "rolling back modifications held back by group commit should fail");
+  checker.check(dataFile.commitTransaction() == pv::ResultCode::DbError,
+                "committing without a transaction should fail, even with group commit");
+
+  checker.check(dataFile.flush() == pv::ResultCode::Ok, "could not flush");
+  checker.check(committedTransactions() == 4, "another connection should see the deposits once flushed");
+  checker.check(recorder.changeSets.size() == 1 && recorder.changeSets.front().transactions.size() == 3,
+                "flushing should emit one change set with the three deposits");
+  checker.check(!dataFile.flushDeadline().has_value(), "nothing should be waiting to be committed after flushing");
+  checker.check(dataFile.flush() == pv::ResultCode::Ok && recorder.changeSets.size() == 1,
+                "flushing again should do nothing");
+
+  checker.start("rejected");
+  recorder.deposit(4);
+  auto result = dataFile.addWithdrawTransaction(recorder.account, 4, std::nullopt, 1000);
+  checker.check(result == pv::ResultCode::NegativeCashBalance, "withdrawing more than the balance was accepted");
+  dataFile.flush();
+  checker.check(committedTransactions() == 5, "only the deposit should be committed");
+  checker.check(recorder.changeSets.size() == 2 && recorder.changeSets.back().transactions.size() == 1,
+                "the change set should only list the deposit");
+}
+
+void checkMaxChanges(Checker& checker) {
+  checker.start("max changes");
+  auto options = distantLimits();
+  options.maxChanges = 4; // A deposit modifies two rows, one in Transactions and one in DepositTransactions
+  Recorder recorder(options);
+  recorder.deposit(1);
+  checker.check(recorder.changeSets.empty(), "committed before reaching the limit");
+  recorder.deposit(2);
+  checker.check(recorder.changeSets.size() == 1, "should commit once the limit is reached");
+  checker.check(committedTransactions() == 3, "another connection should see the deposits once committed");
+  checker.check(!recorder.dataFile->flushDeadline().has_value(), "nothing should be waiting to be committed");
+}
+
+void checkWindow(Checker& checker) {
+  checker.start("window");
+  auto options = distantLimits();
+  options.window = 0ms;
+  Recorder recorder(options);
+  recorder.deposit(1);
+  recorder.deposit(2);
+  checker.check(recorder.changeSets.size() == 2, "without a window, each modification should commit by itself");
+  checker.check(committedTransactions() == 3, "another connection should see every deposit");
+}
+
+void checkCommittedFirst(Checker& checker) {
+  checker.start("transaction");
+  Recorder recorder(distantLimits());
+  auto& dataFile = *recorder.dataFile;
+  recorder.deposit(1);
+  checker.check(dataFile.beginTransaction() == pv::ResultCode::Ok, "could not begin a transaction");
+  checker.check(recorder.changeSets.size() == 1, "beginning a transaction should commit what was held back first");
+  checker.check(dataFile.hasTransaction(), "the user's transaction should be open");
+  recorder.deposit(2);
+  checker.check(dataFile.rollbackTransaction() == pv::ResultCode::Ok, "could not roll back");
+  checker.check(committedTransactions() == 2, "rolling back should only lose the deposit made in the transaction");
+  recorder.deposit(3);
+  checker.check(recorder.changeSets.size() == 1, "group commit should hold modifications back again");
+
+  checker.start("turned off");
+  checker.check(dataFile.setGroupCommit(std::nullopt) == pv::ResultCode::Ok, "could not turn group commit off");
+  checker.check(recorder.changeSets.size() == 2 && committedTransactions() == 3,
+                "turning group commit off should commit what was held back");
+  recorder.deposit(4);
+  checker.check(recorder.changeSets.size() == 3 && committedTransactions() == 4,
+                "without group commit, each modification should commit by itself");
+
+  checker.start("closed");
+  dataFile.setGroupCommit(distantLimits());
+  recorder.deposit(5);
+  recorder.dataFile.reset();
+  checker.check(committedTransactions() == 5, "closing the data file should commit what was held back");
+}
+
+} // namespace
+
+int main(int argc, char**) {
+  if (argc > 1) {
+    std::cerr << usage;
+    return EXIT_FAILURE;
+  }
+
+  Checker checker;
+  checkHeldBack(checker);
+  checkMaxChanges(checker);
+  checkWindow(checker);
+  checkCommittedFirst(checker);
+  if (checker.failures() != 0) {
+    std::cout << checker.failures() << " checks failed\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "All checks passed\n";
+  return EXIT_SUCCESS;
+}
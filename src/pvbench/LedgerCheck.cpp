@@ -0,0 +1,242 @@
+#include "pv/DataFile.h"
+#include "pv/Integer64.h"
+#include "pv/Ledger.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <sqlite3.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char* usage = R"(Usage: pv_ledger_check
+
+Checks that a ledger stays in sync with its data file. Random sequences of
+inserts, updates, deletes, removed accounts and committed or rolled back
+transactions are applied to a data file, and every so often the ledger, which
+has been patching itself along the way, is compared with one loaded from
+scratch. The sequence is seeded, so a failure can be reproduced.
+)";
+
+using pv::i64;
+
+class Checker {
+private:
+  std::string scenario;
+  int failures_ = 0;
+public:
+  void start(std::string name) { scenario = std::move(name); }
+
+  void check(bool ok, const std::string& what) {
+    if (!ok) {
+      ++failures_;
+      std::cout << scenario << ": FAILED: " << what << '\n';
+    }
+  }
+
+  int failures() const noexcept { return failures_; }
+};
+
+constexpr i64 securities = 3;
+constexpr i64 days = 60;
+
+/// \brief Returns a random integer in [low, high].
+i64 uniform(std::mt19937& random, i64 low, i64 high) {
+  return std::uniform_int_distribution<i64>(low, high)(random);
+}
+
+/// \brief Reads the ids of the transactions in \c dataFile straight from the database.
+std::vector<i64> transactionIds(const pv::DataFile& dataFile) {
+  std::vector<i64> ids;
+  auto stmt = dataFile.query("SELECT Id FROM Transactions");
+  while (stmt != nullptr && sqlite3_step(stmt.get()) == SQLITE_ROW) {
+    ids.push_back(sqlite3_column_int64(stmt.get(), 0));
+  }
+  return ids;
+}
+
+pv::TransactionRecord randomRecord(std::mt19937& random, const std::vector<i64>& accounts) {
+  pv::TransactionRecord record;
+  record.account = accounts[static_cast<std::size_t>(uniform(random, 0, static_cast<i64>(accounts.size()) - 1))];
+  record.date = uniform(random, 0, days - 1);
+  record.action = static_cast<pv::Action>(uniform(random, 0, 5));
+  switch (record.action) {
+  case pv::Action::BUY:
+  case pv::Action::SELL:
+    record.security = uniform(random, 1, securities);
+    record.numberOfShares = uniform(random, 0, 10);
+    record.sharePrice = uniform(random, 0, 10);
+    record.commission = uniform(random, 0, 5);
+    break;
+  case pv::Action::DEPOSIT:
+  case pv::Action::WITHDRAW:
+    if (uniform(random, 0, 1) == 0) {
+      record.security = uniform(random, 1, securities);
+    }
+    record.amount = uniform(random, 0, record.action == pv::Action::DEPOSIT ? 1000 : 50);
+    break;
+  case pv::Action::DIVIDEND:
+  case pv::Action::INTEREST:
+    record.security = uniform(random, 1, securities);
+    record.amount = uniform(random, 0, 20);
+    break;
+  }
+  return record;
+}
+
+pv::ResultCode add(pv::DataFile& dataFile, const pv::TransactionRecord& record) {
+  switch (record.action) {
+  case pv::Action::BUY:
+    return dataFile.addBuyTransaction(record.account, record.date, *record.security, record.numberOfShares,
+                                      record.sharePrice, record.commission);
+  case pv::Action::SELL:
+    return dataFile.addSellTransaction(record.account, record.date, *record.security, record.numberOfShares,
+                                       record.sharePrice, record.commission);
+  case pv::Action::DEPOSIT:
+    return dataFile.addDepositTransaction(record.account, record.date, record.security, record.amount);
+  case pv::Action::WITHDRAW:
+    return dataFile.addWithdrawTransaction(record.account, record.date, record.security, record.amount);
+  case pv::Action::DIVIDEND:
+    return dataFile.addDividendTransaction(record.account, record.date, *record.security, record.amount);
+  case pv::Action::INTEREST:
+  default: return dataFile.addInterestTransaction(record.account, record.date, *record.security, record.amount);
+  }
+}
+
+/// \brief Changes one amount of the transaction \c id at random (which may be rejected, or not be of that action).
+void update(pv::DataFile& dataFile, i64 id, std::mt19937& random) {
+  auto value = uniform(random, 0, 20);
+  switch (uniform(random, 0, 5)) {
+  case 0: dataFile.setBuyNumberOfShares(id, value); break;
+  case 1: dataFile.setSellSharePrice(id, value); break;
+  case 2: dataFile.setBuyCommission(id, value); break;
+  case 3: dataFile.setDepositAmount(id, value * 50); break;
+  case 4: dataFile.setWithdrawAmount(id, value); break;
+  default: dataFile.setDividendAmount(id, value); break;
+  }
+}
+
+/// \brief Compares every column and index of \c ledger with those of a ledger loaded from scratch.
+void compare(Checker& checker, pv::Ledger& ledger, pv::DataFile& dataFile, const std::string& at) {
+  pv::Ledger expected(dataFile);
+  checker.check(ledger.ids() == expected.ids(), "the ids differ" + at);
+  checker.check(ledger.dates() == expected.dates(), "the dates differ" + at);
+  checker.check(ledger.accounts() == expected.accounts(), "the accounts differ" + at);
+  checker.check(ledger.actions() == expected.actions(), "the actions differ" + at);
+  checker.check(ledger.securities() == expected.securities(), "the securities differ" + at);
+  checker.check(ledger.numbersOfShares() == expected.numbersOfShares(), "the numbers of shares differ" + at);
+  checker.check(ledger.sharePrices() == expected.sharePrices(), "the share prices differ" + at);
+  checker.check(ledger.commissions() == expected.commissions(), "the commissions differ" + at);
+  checker.check(ledger.amounts() == expected.amounts(), "the amounts differ" + at);
+  checker.check(ledger.cashChanges() == expected.cashChanges(), "the cash changes differ" + at);
+  checker.check(ledger.sharesChanges() == expected.sharesChanges(), "the shares changes differ" + at);
+
+  for (auto account : expected.accounts()) {
+    checker.check(ledger.accountRows(account) == expected.accountRows(account),
+                  "the rows of account " + std::to_string(account) + " differ" + at);
+  }
+  for (i64 security = 1; security <= securities; ++security) {
+    checker.check(ledger.securityRows(security) == expected.securityRows(security),
+                  "the rows of security " + std::to_string(security) + " differ" + at);
+  }
+  for (i64 date = -1; date <= days; date += 7) {
+    checker.check(ledger.rowsUntil(date) == expected.rowsUntil(date),
+                  "the rows until day " + std::to_string(date) + " differ" + at);
+  }
+
+  // The ledger loaded from scratch has every transaction in the file, in order
+  auto ids = transactionIds(dataFile);
+  auto sorted = expected.ids();
+  std::sort(ids.begin(), ids.end());
+  std::sort(sorted.begin(), sorted.end());
+  checker.check(ids == sorted, "the ledger doesn't have the file's transactions" + at);
+  const auto& dates = expected.dates();
+  bool ordered = true;
+  for (std::size_t row = 1; row < dates.size(); ++row) {
+    ordered = ordered && (dates[row - 1] < dates[row] ||
+                          (dates[row - 1] == dates[row] && expected.ids()[row - 1] < expected.ids()[row]));
+  }
+  checker.check(ordered, "the ledger isn't sorted by date and id" + at);
+}
+
+void checkSync(Checker& checker) {
+  checker.start("sync");
+  std::mt19937 random(3);
+  pv::DataFile dataFile;
+  std::vector<i64> accounts;
+  for (int i = 0; i < 3; ++i) {
+    dataFile.addAccount("Account " + std::to_string(i));
+    accounts.push_back(dataFile.lastInsertedId());
+  }
+  for (i64 security = 1; security <= securities; ++security) {
+    dataFile.addSecurity("S" + std::to_string(security), "", "", "");
+  }
+
+  pv::Ledger ledger(dataFile);
+  bool inTransaction = false;
+  std::size_t compared = 0;
+  for (int step = 0; step < 3000; ++step) {
+    auto what = uniform(random, 0, 99);
+    auto ids = transactionIds(dataFile);
+    if (what < 40 || ids.empty()) {
+      add(dataFile, randomRecord(random, accounts));
+    } else if (what < 65) {
+      update(dataFile, ids[static_cast<std::size_t>(uniform(random, 0, static_cast<i64>(ids.size()) - 1))], random);
+    } else if (what < 80) {
+      dataFile.removeTransaction(ids[static_cast<std::size_t>(uniform(random, 0, static_cast<i64>(ids.size()) - 1))]);
+    } else if (what < 88) {
+      std::vector<pv::TransactionRecord> batch;
+      for (i64 i = uniform(random, 1, 6); i > 0; --i) {
+        batch.push_back(randomRecord(random, accounts));
+      }
+      dataFile.addTransactions(batch);
+    } else if (what < 96) {
+      if (!inTransaction) {
+        dataFile.beginTransaction();
+      } else if (what < 92) {
+        dataFile.rollbackTransaction();
+      } else {
+        dataFile.commitTransaction();
+      }
+      inTransaction = !inTransaction;
+    } else if (what == 96 && !inTransaction) {
+      // Removing an account takes its transactions with it, without a signal for each
+      auto account = accounts[static_cast<std::size_t>(uniform(random, 0, static_cast<i64>(accounts.size()) - 1))];
+      dataFile.removeAccount(account);
+      accounts.erase(std::find(accounts.begin(), accounts.end(), account));
+      dataFile.addAccount("Account " + std::to_string(step));
+      accounts.push_back(dataFile.lastInsertedId());
+    }
+
+    // Let modifications pile up between reads for a while, sometimes enough for the ledger to reload
+    if (uniform(random, 0, 3) == 0) {
+      compare(checker, ledger, dataFile, " at step " + std::to_string(step));
+      ++compared;
+    }
+  }
+  compare(checker, ledger, dataFile, " at the end");
+  checker.check(compared > 500, "only compared " + std::to_string(compared) + " times");
+}
+
+} // namespace
+
+int main(int argc, char**) {
+  if (argc > 1) {
+    std::cerr << usage;
+    return EXIT_FAILURE;
+  }
+
+  Checker checker;
+  checkSync(checker);
+  if (checker.failures() != 0) {
+    std::cout << checker.failures() << " checks failed\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "All checks passed\n";
+  return EXIT_SUCCESS;
+}
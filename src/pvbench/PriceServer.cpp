@@ -0,0 +1,89 @@
+#include "PriceServer.h"
+#include <QDate>
+#include <QHostAddress>
+#include <QTimer>
+#include <QUrl>
+#include <algorithm>
+
+namespace pvbench {
+
+PriceServer::PriceServer() {
+  QObject::connect(&server, &QTcpServer::newConnection, &server, [this] {
+    while (auto* socket = server.nextPendingConnection()) {
+      QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket] { read(socket); });
+      QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+  });
+}
+
+bool PriceServer::listen() { return server.listen(QHostAddress::LocalHost); }
+
+QString PriceServer::urlTemplate() const {
+  return QStringLiteral("http://127.0.0.1:") + QString::number(server.serverPort()) +
+         QStringLiteral("/%1?period1=%2&period2=%3");
+}
+
+void PriceServer::read(QTcpSocket* socket) {
+  // Only the request line matters, and each connection is closed after one response
+  if (socket->property("answering").toBool() || !socket->canReadLine()) {
+    return;
+  }
+  socket->setProperty("answering", true);
+  auto line = socket->readLine().split(' ');
+  if (line.size() < 2) {
+    socket->disconnectFromHost();
+    return;
+  }
+  auto symbol = QUrl::fromPercentEncoding(line[1].mid(1).split('?').first());
+  requests_.push_back({symbol, std::chrono::steady_clock::now()});
+  auto attempt = ++attempts[symbol];
+
+  std::uniform_int_distribution<long long> delay(minDelay.count(), std::max(minDelay, maxDelay).count());
+  QTimer::singleShot(std::chrono::milliseconds(delay(random)), socket,
+                     [this, socket, symbol, attempt] { respond(socket, symbol, attempt); });
+}
+
+void PriceServer::respond(QTcpSocket* socket, const QString& symbol, int attempt) {
+  auto fault = faults.value(symbol, Fault::None);
+  if (attempt > 1 && fault != Fault::Missing) {
+    fault = Fault::None;
+  }
+
+  QByteArray status = "200 OK";
+  QByteArray headers;
+  QByteArray body;
+  switch (fault) {
+  case Fault::Stalled:
+    return; // The client times out and closes the connection
+  case Fault::Missing:
+    status = "404 Not Found";
+    break;
+  case Fault::ServerError:
+    status = "503 Service Unavailable";
+    break;
+  case Fault::Throttled:
+    status = "429 Too Many Requests";
+    headers = "Retry-After: " + QByteArray::number(retryAfterSeconds_) + "\r\n";
+    break;
+  case Fault::None:
+    headers = "Content-Type: text/csv\r\n";
+    body = prices();
+    break;
+  }
+  socket->write("HTTP/1.1 " + status + "\r\n" + headers + "Content-Length: " + QByteArray::number(body.size()) +
+                "\r\nConnection: close\r\n\r\n" + body);
+  socket->disconnectFromHost(); // After the response is written
+}
+
+QByteArray PriceServer::prices() const {
+  QByteArray csv = "Date,Open,High,Low,Close,Adj Close,Volume\n";
+  auto date = QDate(2000, 1, 3);
+  for (int day = 0; day < days_; ++day) {
+    auto price = QByteArray::number(10 + day % 100) + ".25";
+    csv += date.addDays(day).toString(Qt::ISODate).toLatin1() + ',' + price + ',' + price + ',' + price + ',' +
+           price + ',' + price + ",1000\n";
+  }
+  return csv;
+}
+
+} // namespace pvbench
@@ -0,0 +1,78 @@
+#ifndef PVBENCH_PRICESERVER_H
+#define PVBENCH_PRICESERVER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <chrono>
+#include <random>
+#include <vector>
+
+namespace pvbench {
+
+/// \brief A stand-in for Yahoo Finance's price history downloads on localhost, which answers with latency and
+/// injected failures, so that \c pvui::SecurityPriceDownload can be checked without the internet.
+///
+/// Every symbol has the same prices: one a day for \c days days from 2000-01-03. Each symbol's first request fails as
+/// its \c Fault says (except \c Missing, which fails every time), and later ones succeed.
+class PriceServer {
+public:
+  enum class Fault : unsigned char {
+    None,
+    /// \brief 404 Not Found, like an unknown symbol.
+    Missing,
+    /// \brief 503 Service Unavailable.
+    ServerError,
+    /// \brief 429 Too Many Requests, with a \c Retry-After header.
+    Throttled,
+    /// \brief Never answers, until the client gives up.
+    Stalled,
+  };
+
+  /// \brief A request that the server received.
+  struct Request {
+    QString symbol;
+    std::chrono::steady_clock::time_point at;
+  };
+private:
+  QTcpServer server;
+  QHash<QString, Fault> faults;
+  QHash<QString, int> attempts;
+  std::vector<Request> requests_;
+  std::chrono::milliseconds minDelay{0};
+  std::chrono::milliseconds maxDelay{0};
+  int days_ = 250;
+  int retryAfterSeconds_ = 1;
+  std::minstd_rand random{1};
+
+  void read(QTcpSocket* socket);
+  void respond(QTcpSocket* socket, const QString& symbol, int attempt);
+  QByteArray prices() const;
+public:
+  PriceServer();
+
+  /// \brief Starts listening on a free port of localhost.
+  bool listen();
+
+  /// \brief Returns the URL template to download from this server (see \c pvui::SecurityPriceDownloader).
+  QString urlTemplate() const;
+
+  void setFault(const QString& symbol, Fault fault) { faults.insert(symbol, fault); }
+  /// \brief Sets the range that the delay before answering each request is chosen from.
+  void setDelay(std::chrono::milliseconds min, std::chrono::milliseconds max) {
+    minDelay = min;
+    maxDelay = max;
+  }
+  void setDays(int days) noexcept { days_ = days; }
+  int days() const noexcept { return days_; }
+  int retryAfterSeconds() const noexcept { return retryAfterSeconds_; }
+
+  /// \brief Returns every request received so far, in order.
+  const std::vector<Request>& requests() const noexcept { return requests_; }
+};
+
+} // namespace pvbench
+
+#endif // PVBENCH_PRICESERVER_H
@@ -0,0 +1,246 @@
+#include "pv/RequestScheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+const char* usage = R"(Usage: pv_scheduler_check
+
+Checks that pView's request scheduler keeps to its limits on requests in flight
+and requests per second, starts higher priorities first, and retries failures
+with bounded exponential backoff (or Retry-After) until it gives up. Time is
+simulated, so the checks are exact and take no time.
+)";
+
+using Clock = pv::RequestScheduler::Clock;
+using std::chrono::milliseconds;
+
+class Checker {
+private:
+  std::string scenario;
+  int failures_ = 0;
+public:
+  void start(std::string name) { scenario = std::move(name); }
+
+  void check(bool ok, const std::string& what) {
+    if (!ok) {
+      ++failures_;
+      std::cout << scenario << ": FAILED: " << what << '\n';
+    }
+  }
+
+  int failures() const noexcept { return failures_; }
+};
+
+std::string ms(Clock::duration duration) {
+  return std::to_string(std::chrono::duration_cast<milliseconds>(duration).count()) + " ms";
+}
+
+pv::RequestSchedulerOptions unlimitedRate() {
+  pv::RequestSchedulerOptions options;
+  options.requestsPerSecond = 0;
+  return options;
+}
+
+void checkConcurrency(Checker& checker) {
+  checker.start("concurrency");
+  auto options = unlimitedRate();
+  options.maxInFlight = 3;
+  pv::RequestScheduler scheduler(options);
+  for (pv::RequestScheduler::Id id = 0; id < 10; ++id) {
+    scheduler.add(id);
+  }
+
+  auto now = Clock::time_point();
+  checker.check(scheduler.start(now).size() == 3, "should start as many requests as may be in flight");
+  checker.check(scheduler.start(now).empty(), "started more requests than may be in flight");
+  checker.check(!scheduler.nextStart(now).has_value(), "nothing can start until a request finishes");
+
+  std::size_t finished = 0;
+  std::vector<pv::RequestScheduler::Id> inFlight = {0, 1, 2};
+  while (!inFlight.empty()) {
+    scheduler.succeeded(inFlight.back());
+    inFlight.pop_back();
+    ++finished;
+    auto started = scheduler.start(now);
+    inFlight.insert(inFlight.end(), started.begin(), started.end());
+    checker.check(scheduler.inFlight() <= options.maxInFlight, std::to_string(scheduler.inFlight()) + " in flight");
+    checker.check(scheduler.inFlight() == inFlight.size(), "the count of requests in flight is wrong");
+  }
+  checker.check(finished == 10, std::to_string(finished) + " of 10 requests finished");
+  checker.check(scheduler.done(), "should be done once every request succeeded");
+}
+
+void checkPriorities(Checker& checker) {
+  checker.start("priorities");
+  auto options = unlimitedRate();
+  options.maxInFlight = 1;
+  pv::RequestScheduler scheduler(options);
+  scheduler.add(0, 0);
+  scheduler.add(1, 5);
+  scheduler.add(2, 0);
+  scheduler.add(3, 5);
+
+  std::vector<pv::RequestScheduler::Id> order;
+  auto now = Clock::time_point();
+  for (auto started = scheduler.start(now); !started.empty(); started = scheduler.start(now)) {
+    order.insert(order.end(), started.begin(), started.end());
+    scheduler.succeeded(started.front());
+  }
+  checker.check(order == std::vector<pv::RequestScheduler::Id>{1, 3, 0, 2},
+                "should start higher priorities first, and equal ones in the order they were added");
+}
+
+void checkRate(Checker& checker) {
+  checker.start("rate");
+  pv::RequestSchedulerOptions options;
+  options.maxInFlight = 100;
+  options.requestsPerSecond = 4;
+  options.burst = 3;
+  pv::RequestScheduler scheduler(options);
+  for (pv::RequestScheduler::Id id = 0; id < 100; ++id) {
+    scheduler.add(id);
+  }
+
+  auto start = Clock::time_point();
+  checker.check(scheduler.start(start).size() == 3, "should start a burst at once");
+  checker.check(scheduler.start(start).empty(), "started more than a burst at once");
+  auto next = scheduler.nextStart(start);
+  checker.check(next == start + milliseconds(250), "the next token is due after " + ms(next.value_or(start) - start));
+  checker.check(scheduler.start(start + milliseconds(249)).empty(), "started before the next token");
+  checker.check(scheduler.start(start + milliseconds(250)).size() == 1, "should start when the next token is due");
+
+  // Starting whenever nextStart() says to never goes faster than the rate (after the first burst)
+  std::size_t started = 4;
+  auto now = start + milliseconds(250);
+  const auto end = start + std::chrono::seconds(10);
+  while (true) {
+    auto at = scheduler.nextStart(now);
+    if (!at.has_value() || *at > end) {
+      break;
+    }
+    checker.check(*at >= now, "nextStart() is in the past");
+    now = *at;
+    auto count = scheduler.start(now).size();
+    checker.check(count > 0, "nothing started at nextStart() " + ms(now - start));
+    started += count;
+  }
+  checker.check(started <= 3 + 4 * 10, std::to_string(started) + " requests started in 10 s");
+  checker.check(started >= 4 * 10, "only " + std::to_string(started) + " requests started in 10 s");
+}
+
+/// \brief Fails a request until it is given up on, returning the delay before each retry.
+std::vector<Clock::duration> retryDelays(pv::RequestScheduler& scheduler, pv::RequestScheduler::Id id,
+                                         std::optional<Clock::duration> retryAfter = std::nullopt) {
+  std::vector<Clock::duration> delays;
+  auto now = Clock::time_point();
+  scheduler.add(id);
+  while (true) {
+    auto started = scheduler.start(now);
+    if (started.size() != 1 || started.front() != id) {
+      break;
+    }
+    if (!scheduler.failed(id, now, true, retryAfter)) {
+      break;
+    }
+    auto at = scheduler.nextStart(now);
+    if (!at.has_value()) {
+      break;
+    }
+    if (!scheduler.start(*at - Clock::duration(1)).empty()) {
+      delays.push_back(Clock::duration::zero()); // Retried early, which the caller reports
+      break;
+    }
+    delays.push_back(*at - now);
+    now = *at;
+  }
+  return delays;
+}
+
+void checkBackoff(Checker& checker) {
+  checker.start("backoff");
+  auto options = unlimitedRate();
+  options.maxAttempts = 6;
+  options.initialBackoff = milliseconds(100);
+  options.backoffFactor = 2;
+  options.maxBackoff = milliseconds(500);
+  pv::RequestScheduler scheduler(options);
+
+  auto delays = retryDelays(scheduler, 0);
+  checker.check(delays.size() == 5, "should retry 5 times, but retried " + std::to_string(delays.size()));
+  checker.check(scheduler.attempts(0) == 6, "made " + std::to_string(scheduler.attempts(0)) + " of 6 attempts");
+  checker.check(scheduler.done(), "should be done after giving up");
+  for (std::size_t i = 0; i < delays.size(); ++i) {
+    // Up to half of the backoff is taken off at random
+    auto backoff = std::min<Clock::duration>(options.initialBackoff * (1 << i), options.maxBackoff);
+    checker.check(delays[i] <= backoff && delays[i] >= backoff / 2,
+                  "retry " + std::to_string(i + 1) + " waited " + ms(delays[i]) + " instead of up to " + ms(backoff));
+  }
+
+  pv::RequestScheduler same(options);
+  checker.check(retryDelays(same, 0) == delays, "the same seed should give the same delays");
+
+  checker.start("give up");
+  pv::RequestScheduler scheduler2(options);
+  scheduler2.add(1);
+  auto now = Clock::time_point();
+  scheduler2.start(now);
+  checker.check(!scheduler2.failed(1, now, false), "should not retry a request that can't succeed");
+  checker.check(scheduler2.done() && scheduler2.attempts(1) == 1, "should give up after one attempt");
+
+  auto once = options;
+  once.maxAttempts = 1;
+  pv::RequestScheduler scheduler3(once);
+  checker.check(retryDelays(scheduler3, 2).empty(), "should never retry with a single attempt");
+}
+
+void checkRetryAfter(Checker& checker) {
+  checker.start("Retry-After");
+  auto options = unlimitedRate();
+  options.maxAttempts = 3;
+  options.initialBackoff = milliseconds(100);
+  pv::RequestScheduler scheduler(options);
+
+  const Clock::duration retryAfter = std::chrono::seconds(2);
+  auto delays = retryDelays(scheduler, 0, retryAfter);
+  checker.check(delays.size() == 2, "should retry twice, but retried " + std::to_string(delays.size()));
+  for (auto delay : delays) {
+    checker.check(delay == retryAfter, "waited " + ms(delay) + " instead of the 2000 ms asked for");
+  }
+
+  // A shorter Retry-After than the backoff doesn't shorten it
+  pv::RequestScheduler scheduler2(options);
+  delays = retryDelays(scheduler2, 1, milliseconds(1));
+  for (auto delay : delays) {
+    checker.check(delay >= options.initialBackoff / 2, "waited only " + ms(delay));
+  }
+}
+
+} // namespace
+
+int main(int argc, char**) {
+  if (argc > 1) {
+    std::cerr << usage;
+    return EXIT_FAILURE;
+  }
+
+  Checker checker;
+  checkConcurrency(checker);
+  checkPriorities(checker);
+  checkRate(checker);
+  checkBackoff(checker);
+  checkRetryAfter(checker);
+  if (checker.failures() != 0) {
+    std::cout << checker.failures() << " checks failed\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "All checks passed\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,840 @@
+#include "Benchmark.h"
+#include "Generator.h"
+#include "pv/Algorithms.h"
+#include "pv/BalanceIndex.h"
+#include "pv/BulkPriceFiles.h"
+#include "pv/DailyValuations.h"
+#include "pv/DataFile.h"
+#include "pv/Date.h"
+#include "pv/Integer64.h"
+#include "pv/Kernels.h"
+#include "pv/Ledger.h"
+#include "pv/PriceCsvParser.h"
+#include "pv/PriceIndex.h"
+#include "pv/PriceProvider.h"
+#include "pv/RequestScheduler.h"
+#include "pv/Security.h"
+#include "pv/Snapshot.h"
+#include "pv/TimeSeries.h"
+#include "pv/Transaction.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sqlite3.h>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using namespace pvbench;
+namespace algorithms = pv::algorithms;
+
+struct Options {
+  PortfolioShape shape;
+  std::string filter;
+  std::chrono::milliseconds minTime{200};
+  bool json = false;
+  std::string output;
+  std::string file; // Empty for an in-memory data file
+};
+
+const char* usage = R"(Usage: pv_bench [options]
+
+Generates a portfolio and times pView's core operations on it.
+
+Options:
+  --accounts N        number of accounts (default 4)
+  --securities N      number of securities (default 50)
+  --transactions N    number of transactions (default 10000)
+  --prices N          number of days of prices per security (default 1000)
+  --seed N            seed for the portfolio generator (default 1)
+  --file PATH         generate the portfolio into PATH (replacing it) instead of memory
+  --filter TEXT       only run benchmarks whose names contain TEXT
+  --min-time MS       minimum time to spend on each benchmark (default 200)
+  --json              write results as JSON instead of a table
+  --output PATH       write results to PATH instead of standard output
+)";
+
+std::optional<Options> parseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (option == "--json") {
+      options.json = true;
+      continue;
+    }
+    if (option == "--help" || i + 1 >= argc) {
+      return std::nullopt;
+    }
+
+    std::string value = argv[++i];
+    try {
+      if (option == "--accounts") {
+        options.shape.accounts = std::stoul(value);
+      } else if (option == "--securities") {
+        options.shape.securities = std::stoul(value);
+      } else if (option == "--transactions") {
+        options.shape.transactions = std::stoul(value);
+      } else if (option == "--prices") {
+        options.shape.prices = std::stoul(value);
+      } else if (option == "--seed") {
+        options.shape.seed = static_cast<std::uint32_t>(std::stoul(value));
+      } else if (option == "--file") {
+        options.file = value;
+      } else if (option == "--filter") {
+        options.filter = value;
+      } else if (option == "--min-time") {
+        options.minTime = std::chrono::milliseconds(std::stol(value));
+      } else if (option == "--output") {
+        options.output = value;
+      } else {
+        return std::nullopt;
+      }
+    } catch (const std::exception&) {
+      return std::nullopt;
+    }
+  }
+  return options;
+}
+
+std::atomic<int> sqliteErrors{0};
+
+/// \brief Reports SQLite's errors (which include statements that fail to prepare) as they happen, since the
+/// algorithms treat them as empty results and would otherwise be timed as if they had succeeded.
+void logSqliteError(void*, int code, const char* message) {
+  if ((code & 0xff) == SQLITE_ERROR) {
+    ++sqliteErrors;
+    std::cerr << "pv_bench: SQLite error: " << message << '\n';
+  }
+}
+
+/// \brief Returns the item for iteration \c i, cycling through every item.
+template <typename T> T cycle(const std::vector<T>& items, std::size_t i) { return items[i % items.size()]; }
+
+/// \brief An algorithm that is calculated for one security (and possibly one account) at a time.
+struct AlgorithmBenchmark {
+  const char* name;
+  std::function<pv::i64(pv::DataFile&, pv::i64 security, pv::i64 account, pv::i64 date)> calculate;
+  /// \brief The same algorithm over the ledger, which every result is checked against before timing, or \c nullptr
+  /// if it depends on prices, which the ledger doesn't have.
+  std::function<pv::i64(pv::Ledger&, pv::i64 security, pv::i64 account, pv::i64 date)> expected;
+};
+
+const std::vector<AlgorithmBenchmark>& algorithmBenchmarks() {
+  using pv::DataFile;
+  using pv::i64;
+  using pv::Ledger;
+  static const std::vector<AlgorithmBenchmark> benchmarks = {
+      {"cashBalance", [](DataFile& f, i64, i64 a, i64 d) { return algorithms::cashBalance(f, a, d); },
+       [](Ledger& l, i64, i64 a, i64 d) { return algorithms::cashBalance(l, a, d); }},
+      {"sharesHeld", [](DataFile& f, i64 s, i64, i64 d) { return algorithms::sharesHeld(f, s, d); },
+       [](Ledger& l, i64 s, i64, i64 d) { return algorithms::sharesHeld(l, s, d); }},
+      {"sharesHeld(account)", [](DataFile& f, i64 s, i64 a, i64 d) { return algorithms::sharesHeld(f, s, a, d); },
+       [](Ledger& l, i64 s, i64 a, i64 d) { return algorithms::sharesHeld(l, s, a, d); }},
+      {"sharesSold", [](DataFile& f, i64 s, i64, i64 d) { return algorithms::sharesSold(f, s, d); },
+       [](Ledger& l, i64 s, i64, i64 d) { return algorithms::sharesSold(l, s, d); }},
+      {"sharesSold(account)", [](DataFile& f, i64 s, i64 a, i64 d) { return algorithms::sharesSold(f, s, a, d); },
+       [](Ledger& l, i64 s, i64 a, i64 d) { return algorithms::sharesSold(l, s, a, d); }},
+      {"cashGained", [](DataFile& f, i64 s, i64, i64 d) { return algorithms::cashGained(f, s, d); },
+       [](Ledger& l, i64 s, i64, i64 d) { return algorithms::cashGained(l, s, d); }},
+      {"cashGained(account)", [](DataFile& f, i64 s, i64 a, i64 d) { return algorithms::cashGained(f, s, a, d); },
+       [](Ledger& l, i64 s, i64 a, i64 d) { return algorithms::cashGained(l, s, a, d); }},
+      {"dividendIncome", [](DataFile& f, i64 s, i64, i64 d) { return algorithms::dividendIncome(f, s, d); },
+       [](Ledger& l, i64 s, i64, i64 d) { return algorithms::dividendIncome(l, s, d); }},
+      {"dividendIncome(account)",
+       [](DataFile& f, i64 s, i64 a, i64 d) { return algorithms::dividendIncome(f, s, a, d); },
+       [](Ledger& l, i64 s, i64 a, i64 d) { return algorithms::dividendIncome(l, s, a, d); }},
+      {"interestIncome", [](DataFile& f, i64 s, i64, i64 d) { return algorithms::interestIncome(f, s, d); },
+       [](Ledger& l, i64 s, i64, i64 d) { return algorithms::interestIncome(l, s, d); }},
+      {"interestIncome(account)",
+       [](DataFile& f, i64 s, i64 a, i64 d) { return algorithms::interestIncome(f, s, a, d); },
+       [](Ledger& l, i64 s, i64 a, i64 d) { return algorithms::interestIncome(l, s, a, d); }},
+      {"costBasis", [](DataFile& f, i64 s, i64, i64 d) { return algorithms::costBasis(f, s, d); },
+       [](Ledger& l, i64 s, i64, i64 d) { return algorithms::costBasis(l, s, d); }},
+      {"costBasis(account)", [](DataFile& f, i64 s, i64 a, i64 d) { return algorithms::costBasis(f, s, a, d); },
+       [](Ledger& l, i64 s, i64 a, i64 d) { return algorithms::costBasis(l, s, a, d); }},
+      {"totalIncome", [](DataFile& f, i64 s, i64, i64 d) { return algorithms::totalIncome(f, s, d); }, nullptr},
+      {"totalIncome(account)", [](DataFile& f, i64 s, i64 a, i64 d) { return algorithms::totalIncome(f, s, a, d); },
+       nullptr},
+      {"sharePrice", [](DataFile& f, i64 s, i64, i64 d) { return algorithms::sharePrice(f, s, d).value_or(0); },
+       nullptr},
+      {"unrealizedCashGained",
+       [](DataFile& f, i64 s, i64, i64 d) { return algorithms::unrealizedCashGained(f, s, d).value_or(0); }, nullptr},
+      {"unrealizedCashGained(account)",
+       [](DataFile& f, i64 s, i64 a, i64 d) { return algorithms::unrealizedCashGained(f, s, a, d).value_or(0); },
+       nullptr},
+      {"averageBuyPrice",
+       [](DataFile& f, i64 s, i64, i64 d) { return algorithms::averageBuyPrice(f, s, d).value_or(0); },
+       [](Ledger& l, i64 s, i64, i64 d) { return algorithms::averageBuyPrice(l, s, d).value_or(0); }},
+      {"averageBuyPrice(account)",
+       [](DataFile& f, i64 s, i64 a, i64 d) { return algorithms::averageBuyPrice(f, s, a, d).value_or(0); },
+       [](Ledger& l, i64 s, i64 a, i64 d) { return algorithms::averageBuyPrice(l, s, a, d).value_or(0); }},
+      {"averageSellPrice",
+       [](DataFile& f, i64 s, i64, i64 d) { return algorithms::averageSellPrice(f, s, d).value_or(0); },
+       [](Ledger& l, i64 s, i64, i64 d) { return algorithms::averageSellPrice(l, s, d).value_or(0); }},
+      {"averageSellPrice(account)",
+       [](DataFile& f, i64 s, i64 a, i64 d) { return algorithms::averageSellPrice(f, s, a, d).value_or(0); },
+       [](Ledger& l, i64 s, i64 a, i64 d) { return algorithms::averageSellPrice(l, s, a, d).value_or(0); }},
+      {"marketValue", [](DataFile& f, i64 s, i64, i64 d) { return algorithms::marketValue(f, s, d).value_or(0); },
+       nullptr},
+      {"marketValue(account)",
+       [](DataFile& f, i64 s, i64 a, i64 d) { return algorithms::marketValue(f, s, a, d).value_or(0); }, nullptr},
+  };
+  return benchmarks;
+}
+
+/// \brief Checks every selected algorithm against the ledger, for every combination of security and account, so
+/// that a broken query is reported instead of timed.
+void checkAlgorithms(const Runner& runner, pv::DataFile& dataFile, const Portfolio& portfolio) {
+  pv::Ledger ledger(dataFile);
+  ledger.sync();
+  for (const auto& benchmark : algorithmBenchmarks()) {
+    if (!benchmark.expected || (!runner.selected(std::string("algorithms/") + benchmark.name) &&
+                                !runner.selected(std::string("algorithms/memo/") + benchmark.name))) {
+      continue;
+    }
+    for (auto security : portfolio.securities) {
+      for (auto account : portfolio.accounts) {
+        auto result = benchmark.calculate(dataFile, security, account, portfolio.lastDate);
+        auto expected = benchmark.expected(ledger, security, account, portfolio.lastDate);
+        if (result != expected) {
+          throw std::runtime_error(std::string("algorithms/") + benchmark.name + " returned " +
+                                   std::to_string(result) + " for security " + std::to_string(security) +
+                                   " and account " + std::to_string(account) + ", but the ledger gives " +
+                                   std::to_string(expected));
+        }
+      }
+    }
+  }
+}
+
+void runAlgorithmBenchmarks(Runner& runner, pv::DataFile& dataFile, const Portfolio& portfolio) {
+  if (portfolio.securities.empty() || portfolio.accounts.empty()) {
+    return;
+  }
+  checkAlgorithms(runner, dataFile, portfolio);
+  for (const auto& benchmark : algorithmBenchmarks()) {
+    runner.run(std::string("algorithms/") + benchmark.name, [&](std::size_t i) {
+      consume(benchmark.calculate(dataFile, cycle(portfolio.securities, i), cycle(portfolio.accounts, i),
+                                  portfolio.lastDate));
+    });
+  }
+
+  // The same algorithms again, with every call answered from the data file's memo. Each one is called for every
+  // combination of security and account first, since that takes longer than some of the benchmarks run for.
+  dataFile.memo().setEnabled(true);
+  const std::size_t combinations = portfolio.securities.size() * portfolio.accounts.size();
+  for (const auto& benchmark : algorithmBenchmarks()) {
+    if (!runner.selected(std::string("algorithms/memo/") + benchmark.name)) {
+      continue;
+    }
+    for (std::size_t i = 0; i < combinations; ++i) {
+      benchmark.calculate(dataFile, cycle(portfolio.securities, i), cycle(portfolio.accounts, i), portfolio.lastDate);
+    }
+    runner.run(std::string("algorithms/memo/") + benchmark.name, [&](std::size_t i) {
+      consume(benchmark.calculate(dataFile, cycle(portfolio.securities, i), cycle(portfolio.accounts, i),
+                                  portfolio.lastDate));
+    });
+  }
+  dataFile.memo().setEnabled(false);
+}
+
+/// \brief Copies the generated data file into memory, so that benchmarks can modify it.
+///
+/// \param loadBalances if this is true, the copy is modified once so that its balance index is already loaded, which
+/// would otherwise make the first timed modification much slower than the rest
+std::unique_ptr<pv::DataFile> scratchCopy(pv::DataFile& dataFile, const Portfolio& portfolio,
+                                          bool loadBalances = true) {
+  auto copy = std::make_unique<pv::DataFile>();
+  dataFile.copyTo(*copy);
+  if (loadBalances && !portfolio.accounts.empty()) {
+    copy->addDepositTransaction(portfolio.accounts.front(), portfolio.lastDate, std::nullopt, 100);
+  }
+  return copy;
+}
+
+void runDataFileBenchmarks(Runner& runner, pv::DataFile& dataFile, const Portfolio& portfolio) {
+  if (portfolio.securities.empty() || portfolio.accounts.empty()) {
+    return;
+  }
+  std::unique_ptr<pv::DataFile> scratch;
+  auto freshScratch = [&] {
+    if (scratch == nullptr) {
+      scratch = scratchCopy(dataFile, portfolio);
+    }
+  };
+
+  runner.run("datafile/addDepositTransaction", [&](std::size_t i) {
+    consume(static_cast<pv::i64>(
+        scratch->addDepositTransaction(cycle(portfolio.accounts, i), portfolio.lastDate, std::nullopt, 100)));
+  }, freshScratch);
+  runner.run("datafile/addBuyTransaction", [&](std::size_t i) {
+    consume(static_cast<pv::i64>(scratch->addBuyTransaction(cycle(portfolio.accounts, i), portfolio.lastDate,
+                                                            cycle(portfolio.securities, i), 1, 100, 0)));
+  }, freshScratch);
+  runner.run("datafile/addTransactions(1000)", [&](std::size_t i) {
+    std::vector<pv::TransactionRecord> records;
+    records.reserve(1000);
+    for (std::size_t j = 0; j < 1000; ++j) {
+      records.push_back({cycle(portfolio.accounts, i + j), portfolio.lastDate, pv::Action::DEPOSIT, std::nullopt, 0,
+                         0, 0, 100});
+    }
+    consume(static_cast<pv::i64>(scratch->addTransactions(records)));
+  }, freshScratch);
+  runner.run("datafile/setSecurityPrice", [&](std::size_t i) {
+    auto date = portfolio.lastDate + 1 + static_cast<pv::i64>(i / portfolio.securities.size());
+    consume(static_cast<pv::i64>(scratch->setSecurityPrice(cycle(portfolio.securities, i), date, 100)));
+  }, freshScratch);
+
+  // A year of downloaded prices for one security, the way the security page used to store them, then in bulk. Every
+  // iteration changes every price, so that nothing is skipped as unchanged.
+  auto yearOfPrices = [&](std::size_t i) {
+    pv::PriceHistory prices;
+    for (pv::i64 date = portfolio.lastDate - 364; date <= portfolio.lastDate; ++date) {
+      prices.dates.push_back(date);
+      prices.prices.push_back(100 + static_cast<pv::i64>(i));
+    }
+    return prices;
+  };
+  runner.run("datafile/setSecurityPrices(1y, perPrice)", [&](std::size_t i) {
+    auto prices = yearOfPrices(i);
+    auto security = cycle(portfolio.securities, i);
+    scratch->beginTransaction();
+    for (std::size_t j = 0; j < prices.size(); ++j) {
+      if (pv::security::price(*scratch, security, prices.dates[j]) != prices.prices[j]) {
+        scratch->setSecurityPrice(security, prices.dates[j], prices.prices[j]);
+      }
+    }
+    consume(static_cast<pv::i64>(scratch->commitTransaction()));
+  }, freshScratch);
+  runner.run("datafile/setSecurityPrices(1y)", [&](std::size_t i) {
+    consume(static_cast<pv::i64>(scratch->setSecurityPrices(cycle(portfolio.securities, i), yearOfPrices(i),
+                                                            pv::PriceConflictPolicy::Replace)));
+  }, freshScratch);
+
+  // Only on disk does each commit have to wait for the file to be written, which is what write-ahead logging (with
+  // synchronous = NORMAL) and group commit save. The legacy options are those of data files before DataFileOptions.
+  struct DiskVariant {
+    const char* suffix;
+    pv::DataFileOptions options;
+    bool groupCommit;
+  };
+  const DiskVariant diskVariants[] = {{", legacy", pv::DataFileOptions::legacy(), false},
+                                      {"", pv::DataFileOptions(), false},
+                                      {", groupCommit", pv::DataFileOptions(), true}};
+  auto path = (std::filesystem::temp_directory_path() / "pv_bench_scratch.pvf").string();
+  for (const auto& variant : diskVariants) {
+    std::string writeName = std::string("datafile/setSecurityPrice(disk") + variant.suffix + ")";
+    std::string readName = std::string("datafile/open+loadLedger(disk") + variant.suffix + ")";
+    if (!runner.selected(writeName) && (variant.groupCommit || !runner.selected(readName))) {
+      continue;
+    }
+    std::remove(path.c_str());
+    {
+      pv::DataFile disk(path, -1, variant.options);
+      dataFile.copyTo(disk);
+      if (variant.groupCommit) {
+        disk.setGroupCommit(pv::GroupCommitOptions());
+      }
+      runner.run(writeName, [&](std::size_t i) {
+        auto date = portfolio.lastDate + 1 + static_cast<pv::i64>(i / portfolio.securities.size());
+        consume(static_cast<pv::i64>(disk.setSecurityPrice(cycle(portfolio.securities, i), date, 100)));
+      });
+    }
+    // Reading every transaction is mostly the page cache and memory mapping at work (group commit makes no difference)
+    if (!variant.groupCommit) {
+      runner.run(readName, [&](std::size_t) {
+        pv::DataFile disk(path, -1, variant.options);
+        pv::Ledger ledger(disk);
+        consume(static_cast<pv::i64>(ledger.size()));
+      });
+    }
+    std::remove(path.c_str());
+  }
+
+  runner.run("datafile/transactionRecord", [&](std::size_t i) {
+    // Transaction ids start from 1, and the generator never removes any
+    auto transaction = static_cast<pv::i64>(i % 1000) + 1;
+    consume(pv::transaction::record(dataFile, transaction).has_value());
+  });
+}
+
+void runValidationBenchmarks(Runner& runner, pv::DataFile& dataFile, const Portfolio& portfolio) {
+  if (portfolio.accounts.empty()) {
+    return;
+  }
+
+  // The balance index is rebuilt by the first modification after opening a data file
+  std::unique_ptr<pv::DataFile> scratch;
+  runner.run("validation/firstModification", [&](std::size_t) {
+    consume(static_cast<pv::i64>(
+        scratch->addDepositTransaction(portfolio.accounts.front(), portfolio.lastDate, std::nullopt, 100)));
+  }, [&] { scratch = scratchCopy(dataFile, portfolio, false); });
+
+  // Withdrawing at the start of the ledger has to check every later balance
+  scratch = nullptr;
+  runner.run("validation/earlyWithdraw", [&](std::size_t i) {
+    consume(static_cast<pv::i64>(
+        scratch->addWithdrawTransaction(cycle(portfolio.accounts, i), portfolio.firstDate, std::nullopt, 1)));
+  }, [&] {
+    if (scratch == nullptr) {
+      scratch = scratchCopy(dataFile, portfolio);
+    }
+  });
+
+  pv::BalanceIndex index;
+  runner.run("validation/balanceIndex(apply+check)", [&](std::size_t i) {
+    pv::i64 account = cycle(portfolio.accounts, i);
+    auto date = portfolio.firstDate + static_cast<pv::i64>(i % 4096);
+    index.apply(pv::BalanceChange{account, date, std::nullopt, i % 2 == 0 ? 100 : -50, 0});
+    consume(index.cashNegativeFrom(account, portfolio.firstDate));
+  });
+}
+
+/// \brief What the holdings report calculated before \c pv::algorithms::snapshot() existed.
+pv::i64 holdingsPerFunction(pv::DataFile& dataFile, const Portfolio& portfolio) {
+  pv::i64 total = 0;
+  for (auto security : portfolio.securities) {
+    auto date = portfolio.lastDate;
+    total += algorithms::sharesHeld(dataFile, security, date);
+    total += algorithms::averageBuyPrice(dataFile, security, date).value_or(0);
+    total += algorithms::costBasis(dataFile, security, date);
+    total += algorithms::sharePrice(dataFile, security, date).value_or(0);
+    total += algorithms::marketValue(dataFile, security, date).value_or(0);
+    total += algorithms::unrealizedCashGained(dataFile, security, date).value_or(0);
+    total += algorithms::cashGained(dataFile, security, date);
+    total += algorithms::dividendIncome(dataFile, security, date);
+    total += algorithms::interestIncome(dataFile, security, date);
+    total += algorithms::totalIncome(dataFile, security, date);
+  }
+  return total;
+}
+
+void runReportBenchmarks(Runner& runner, pv::DataFile& dataFile, const Portfolio& portfolio) {
+  runner.run("report/holdings(perFunction)", [&](std::size_t) { consume(holdingsPerFunction(dataFile, portfolio)); });
+  runner.run("report/holdings(snapshot)", [&](std::size_t) {
+    auto snapshot = algorithms::snapshot(dataFile, portfolio.lastDate);
+    consume(snapshot.cashBalance + static_cast<pv::i64>(snapshot.securities.size()));
+  });
+
+  runner.run("ledger/load", [&](std::size_t) {
+    pv::Ledger ledger(dataFile);
+    consume(static_cast<pv::i64>(ledger.size()));
+  });
+  pv::Ledger ledger(dataFile);
+  ledger.sync();
+  runner.run("report/holdings(ledger)", [&](std::size_t) {
+    auto snapshot = algorithms::snapshot(dataFile, ledger, portfolio.lastDate);
+    consume(snapshot.cashBalance + static_cast<pv::i64>(snapshot.securities.size()));
+  });
+  if (!portfolio.securities.empty()) {
+    runner.run("ledger/costBasis", [&](std::size_t i) {
+      consume(algorithms::costBasis(ledger, cycle(portfolio.securities, i), portfolio.lastDate));
+    });
+  }
+
+  // The market value report's default is one point per month
+  std::vector<pv::i64> monthly;
+  for (auto date = portfolio.firstDate; date <= portfolio.lastDate; date += 30) {
+    monthly.push_back(date);
+  }
+  runner.run("report/marketValue(monthly)", [&](std::size_t) {
+    auto series = algorithms::timeSeries(dataFile, portfolio.securities, portfolio.accounts, monthly);
+    consume(static_cast<pv::i64>(series.dates.size()));
+  });
+  algorithms::repairDailyValuations(dataFile, portfolio.lastDate);
+  runner.run("report/marketValue(monthly, stored)", [&](std::size_t) {
+    auto series = algorithms::storedTimeSeries(dataFile, portfolio.securities, monthly);
+    consume(series.has_value() ? static_cast<pv::i64>(series->dates.size()) : 0);
+  });
+  if (!portfolio.securities.empty()) {
+    // A new price a month before the end, so only the last month is calculated again
+    runner.run("dailyValuations/repair(lastMonth)", [&](std::size_t i) {
+      dataFile.setSecurityPrice(portfolio.securities.front(), portfolio.lastDate - 30, static_cast<pv::i64>(i + 1));
+      consume(static_cast<pv::i64>(algorithms::repairDailyValuations(dataFile, portfolio.lastDate)));
+    });
+  }
+  runner.run("report/marketValue(monthly, perFunction)", [&](std::size_t) {
+    for (auto date : monthly) {
+      for (auto security : portfolio.securities) {
+        consume(algorithms::marketValue(dataFile, security, date).value_or(0));
+        consume(algorithms::costBasis(dataFile, security, date));
+      }
+      for (auto account : portfolio.accounts) {
+        consume(algorithms::cashBalance(dataFile, account, date));
+      }
+    }
+  });
+}
+
+void runBalanceBenchmarks(Runner& runner, pv::DataFile& dataFile, const Portfolio& portfolio) {
+  std::vector<pv::i64> monthly;
+  for (auto date = portfolio.firstDate; date <= portfolio.lastDate; date += 30) {
+    monthly.push_back(date);
+  }
+  runner.run("balances/cashBalance(monthly, sql)", [&](std::size_t) {
+    for (auto account : portfolio.accounts) {
+      for (auto date : monthly) {
+        consume(algorithms::cashBalance(dataFile, account, date));
+      }
+    }
+  });
+  pv::Ledger ledger(dataFile);
+  ledger.sync();
+  runner.run("balances/cashBalances(monthly, ledger)", [&](std::size_t) {
+    for (auto account : portfolio.accounts) {
+      consume(algorithms::cashBalances(ledger, account, monthly).back());
+    }
+  });
+  runner.run("balances/cashBalances(monthly, ledger, allAccounts)",
+             [&](std::size_t) { consume(algorithms::cashBalances(ledger, monthly).back()); });
+  if (!portfolio.securities.empty()) {
+    runner.run("balances/sharesHeld(monthly, sql)", [&](std::size_t i) {
+      auto security = cycle(portfolio.securities, i);
+      for (auto date : monthly) {
+        consume(algorithms::sharesHeld(dataFile, security, date));
+      }
+    });
+    runner.run("balances/sharesHeld(monthly, ledger)", [&](std::size_t i) {
+      consume(algorithms::sharesHeld(ledger, cycle(portfolio.securities, i), monthly).back());
+    });
+  }
+
+  runner.run("prices/load", [&](std::size_t) {
+    pv::PriceIndex prices(dataFile);
+    consume(prices.price(portfolio.securities.empty() ? 0 : portfolio.securities.front(), portfolio.lastDate)
+                .value_or(0));
+  });
+  runner.run("prices/sharePrice(monthly, allSecurities, sql)", [&](std::size_t) {
+    for (auto security : portfolio.securities) {
+      for (auto date : monthly) {
+        consume(algorithms::sharePrice(dataFile, security, date).value_or(0));
+      }
+    }
+  });
+  pv::PriceIndex prices(dataFile);
+  prices.prices(portfolio.securities, monthly); // Loads the index, which prices/load measures
+  runner.run("prices/sharePrice(monthly, allSecurities, index)", [&](std::size_t) {
+    for (auto security : portfolio.securities) {
+      for (auto date : monthly) {
+        consume(algorithms::sharePrice(prices, security, date).value_or(0));
+      }
+    }
+  });
+  runner.run("prices/prices(monthly, allSecurities, index)", [&](std::size_t) {
+    auto grid = prices.prices(portfolio.securities, monthly);
+    consume(static_cast<pv::i64>(grid.size()));
+  });
+
+  // The kernels on their own, over a column much larger than a ledger's, so that the loops dominate
+  std::vector<pv::i64> values(1 << 20);
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    values[i] = static_cast<pv::i64>(i % 1000) - 500;
+  }
+  std::vector<pv::i64> sums(values.size());
+  const char* suffix = pv::kernels::vectorized() ? ", avx2)" : ", scalar)";
+  runner.run(std::string("kernels/prefixSum(1M") + suffix, [&](std::size_t) {
+    pv::kernels::prefixSum(values.data(), sums.data(), values.size());
+    consume(sums.back());
+  });
+  runner.run("kernels/prefixSum(1M, scalar)", [&](std::size_t) {
+    pv::kernels::scalar::prefixSum(values.data(), sums.data(), values.size());
+    consume(sums.back());
+  });
+  runner.run(std::string("kernels/sum(1M") + suffix,
+             [&](std::size_t) { consume(pv::kernels::sum(values.data(), values.size())); });
+  runner.run("kernels/sum(1M, scalar)",
+             [&](std::size_t) { consume(pv::kernels::scalar::sum(values.data(), values.size())); });
+}
+
+/// \brief Returns a price history in Yahoo Finance's CSV format, with a line for each weekday of \c years years.
+std::string priceHistoryCsv(int years) {
+  std::string csv = "Date,Open,High,Low,Close,Adj Close,Volume\n";
+  auto first = pv::dates::fromYearMonthDay(2024 - years, 1, 1);
+  unsigned int price = 1000000; // In millionths
+  char line[128];
+  for (auto date = first; date < first + 365 * years; ++date) {
+    if ((date + 3) % 7 >= 5) {
+      continue; // 1970-01-01 was a Thursday
+    }
+    price = price * 1103515245u % 2147483648u % 900000000u + 1000000u;
+    std::snprintf(line, sizeof(line), "%s,%u.%06u,%u.%06u,%u.%06u,%u.%06u,%u.%06u,%u\n",
+                  pv::dates::toIsoString(date).c_str(), price / 1000000, price % 1000000, price / 1000000,
+                  price % 1000000, price / 1000000, price % 1000000, price / 1000000, price % 1000000,
+                  price / 1000000, price % 1000000, price);
+    csv += line;
+  }
+  return csv;
+}
+
+/// \brief Parses a price history the way the downloader used to: a line at a time, each split into strings, into a
+/// map.
+std::map<pv::i64, pv::i64> parsePriceHistoryByLine(const std::string& csv) {
+  std::map<pv::i64, pv::i64> prices;
+  std::istringstream stream(csv);
+  std::string line;
+  std::getline(stream, line);
+  while (std::getline(stream, line)) {
+    std::vector<std::string> fields;
+    std::istringstream lineStream(line);
+    for (std::string field; std::getline(lineStream, field, ',');) {
+      fields.push_back(field);
+    }
+    if (fields.size() <= 4) {
+      continue;
+    }
+    auto date = pv::dates::fromIsoString(fields[0]);
+    char* end = nullptr;
+    double price = std::strtod(fields[4].c_str(), &end);
+    if (date.has_value() && end != fields[4].c_str()) {
+      prices.insert({*date, static_cast<pv::i64>(std::llround(price * 100))});
+    }
+  }
+  return prices;
+}
+
+void runDownloadBenchmarks(Runner& runner) {
+  // About 10,000 days, the longest histories Yahoo Finance has for most securities
+  if (!runner.selected("download/parsePrices(40y, byLine)") && !runner.selected("download/parsePrices(40y)") &&
+      !runner.selected("download/parsePrices(40y, 16KiB chunks)") &&
+      !runner.selected("download/schedule(500 symbols, 10% errors)")) {
+    return;
+  }
+  auto csv = priceHistoryCsv(40);
+  runner.run("download/parsePrices(40y, byLine)",
+             [&](std::size_t) { consume(static_cast<pv::i64>(parsePriceHistoryByLine(csv).size())); });
+  runner.run("download/parsePrices(40y)", [&](std::size_t) {
+    pv::PriceCsvParser parser;
+    parser.feed(csv);
+    consume(static_cast<pv::i64>(parser.finish().size()));
+  });
+  // The size of the chunks that network replies tend to arrive in
+  runner.run("download/parsePrices(40y, 16KiB chunks)", [&](std::size_t) {
+    constexpr std::size_t chunkSize = 16 * 1024;
+    pv::PriceCsvParser parser;
+    for (std::size_t i = 0; i < csv.size(); i += chunkSize) {
+      parser.feed(std::string_view(csv).substr(i, chunkSize));
+    }
+    consume(static_cast<pv::i64>(parser.finish().size()));
+  });
+
+  // A simulated server, with latency and failures, instead of a real one (whose time would swamp the scheduler's)
+  runner.run("download/schedule(500 symbols, 10% errors)", [&](std::size_t) {
+    using Clock = pv::RequestScheduler::Clock;
+    pv::RequestSchedulerOptions options;
+    options.maxInFlight = 8;
+    options.requestsPerSecond = 20;
+    pv::RequestScheduler scheduler(options);
+    for (std::size_t i = 0; i < 500; ++i) {
+      scheduler.add(i, i % 5 == 0 ? 1 : 0);
+    }
+
+    std::minstd_rand random(1);
+    std::uniform_int_distribution<int> latency(50, 400);
+    std::uniform_int_distribution<int> outcome(0, 9);
+    std::multimap<Clock::time_point, pv::RequestScheduler::Id> finishing;
+    auto now = Clock::time_point();
+    while (!scheduler.done()) {
+      for (auto id : scheduler.start(now)) {
+        finishing.emplace(now + std::chrono::milliseconds(latency(random)), id);
+      }
+      auto next = scheduler.nextStart(now);
+      if (!finishing.empty() && (!next || finishing.begin()->first <= *next)) {
+        auto [at, id] = *finishing.begin();
+        finishing.erase(finishing.begin());
+        now = at;
+        if (outcome(random) == 0) {
+          scheduler.failed(id, now, true);
+        } else {
+          scheduler.succeeded(id);
+        }
+      } else if (next) {
+        now = *next;
+      }
+    }
+    consume(std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count());
+  });
+}
+
+/// \brief Writes a wide price file with the same prices as \c priceHistoryCsv() for symbols \c S0, \c S1, and so on.
+void writeWidePriceFile(const std::filesystem::path& path, int symbols, int years) {
+  auto csv = priceHistoryCsv(years);
+  std::ofstream out(path);
+  out << "Date";
+  for (int symbol = 0; symbol < symbols; ++symbol) {
+    out << ",S" << symbol;
+  }
+  std::istringstream lines(csv);
+  std::string line;
+  std::getline(lines, line);
+  while (std::getline(lines, line)) {
+    auto close = line.substr(0, line.find(',', line.find(',', line.find(',', line.find(',') + 1) + 1) + 1));
+    auto date = close.substr(0, close.find(','));
+    auto price = close.substr(close.rfind(',') + 1);
+    out << '\n' << date;
+    for (int symbol = 0; symbol < symbols; ++symbol) {
+      out << ',' << price;
+    }
+  }
+  out << '\n';
+}
+
+void runBulkPriceBenchmarks(Runner& runner) {
+  const std::string wideSerial = "import/wideFile(500 symbols, 20y, 1 job)";
+  const std::string wideParallel = "import/wideFile(500 symbols, 20y)";
+  const std::string directorySerial = "import/directory(500 symbols, 20y, 1 job)";
+  const std::string directoryParallel = "import/directory(500 symbols, 20y)";
+  if (!runner.selected(wideSerial) && !runner.selected(wideParallel) && !runner.selected(directorySerial) &&
+      !runner.selected(directoryParallel)) {
+    return;
+  }
+
+  // The same prices as a wide file and as a directory of Yahoo Finance style files
+  constexpr int symbols = 500;
+  auto directory = std::filesystem::temp_directory_path() / "pv_bench_prices";
+  auto wideFile = std::filesystem::temp_directory_path() / "pv_bench_prices.csv";
+  std::filesystem::remove_all(directory);
+  std::filesystem::create_directories(directory);
+  std::vector<pv::PriceQuery> queries;
+  for (int symbol = 0; symbol < symbols; ++symbol) {
+    queries.push_back({"S" + std::to_string(symbol), 0, pv::dates::fromYearMonthDay(2100, 1, 1)});
+    std::ofstream(directory / (queries.back().symbol + ".csv")) << priceHistoryCsv(20);
+  }
+  writeWidePriceFile(wideFile, symbols, 20);
+
+  auto run = [&](const std::string& name, pv::PriceProvider& provider) {
+    runner.run(name, [&](std::size_t) {
+      std::size_t prices = 0;
+      for (const auto& history : provider.prices(queries)) {
+        prices += history.has_value() ? history->size() : 0;
+      }
+      consume(static_cast<pv::i64>(prices));
+    });
+  };
+  pv::WidePriceFileProvider wideOneJob(wideFile, 1);
+  pv::WidePriceFileProvider wide(wideFile);
+  pv::PriceDirectoryProvider directoryOneJob(directory, 1);
+  pv::PriceDirectoryProvider directoryProvider(directory);
+  run(wideSerial, wideOneJob);
+  run(wideParallel, wide);
+  run(directorySerial, directoryOneJob);
+  run(directoryParallel, directoryProvider);
+
+  std::filesystem::remove_all(directory);
+  std::filesystem::remove(wideFile);
+}
+
+/// \internal Forwards to another provider, but in batches, like providers that don't read everything.
+class BatchedPriceProvider : public pv::PriceProvider {
+private:
+  pv::PriceProvider& provider;
+public:
+  explicit BatchedPriceProvider(pv::PriceProvider& provider) : provider(provider) {}
+
+  std::vector<std::optional<pv::PriceHistory>> prices(const std::vector<pv::PriceQuery>& queries) override {
+    return provider.prices(queries);
+  }
+};
+
+void runImportBenchmarks(Runner& runner) {
+  const std::string once = "import/importPrices(wideFile, 1000 of 3000 symbols, 10y, last month)";
+  const std::string batched = "import/importPrices(wideFile, 1000 of 3000 symbols, 10y, last month, batches of 256)";
+  if (!runner.selected(once) && !runner.selected(batched)) {
+    return;
+  }
+
+  // A nightly import: the latest prices of more securities than fit in a batch, from a large market data dump
+  constexpr int symbols = 3000;
+  constexpr int securities = 1000;
+  auto wideFile = std::filesystem::temp_directory_path() / "pv_bench_import.csv";
+  writeWidePriceFile(wideFile, symbols, 10);
+  pv::DataFile dataFile;
+  for (int security = 0; security < securities; ++security) {
+    dataFile.addSecurity("S" + std::to_string(security * (symbols / securities)), "", "", "");
+  }
+
+  pv::WidePriceFileProvider wide(wideFile);
+  BatchedPriceProvider wideBatched(wide);
+  auto run = [&](const std::string& name, pv::PriceProvider& provider) {
+    runner.run(name, [&](std::size_t) {
+      auto import = pv::importPrices(dataFile, provider, pv::dates::fromYearMonthDay(2023, 12, 1),
+                                     pv::dates::fromYearMonthDay(2100, 1, 1));
+      consume(static_cast<pv::i64>(import.prices));
+    });
+  };
+  run(once, wide);
+  run(batched, wideBatched);
+
+  std::filesystem::remove(wideFile);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  auto options = parseOptions(argc, argv);
+  if (!options) {
+    std::cerr << usage;
+    return EXIT_FAILURE;
+  }
+
+  sqlite3_config(SQLITE_CONFIG_LOG, logSqliteError, nullptr);
+
+  try {
+    if (!options->file.empty()) {
+      std::remove(options->file.c_str());
+    }
+    auto dataFile = options->file.empty() ? pv::DataFile() : pv::DataFile(options->file);
+
+    auto generationStart = std::chrono::steady_clock::now();
+    auto portfolio = generatePortfolio(dataFile, options->shape);
+    auto generationTime = std::chrono::steady_clock::now() - generationStart;
+    std::cerr << "Generated portfolio in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(generationTime).count() << " ms\n";
+    // Otherwise every benchmark that repeats a calculation would only measure the memo
+    dataFile.memo().setEnabled(false);
+
+    Runner runner(options->filter, options->minTime);
+    runAlgorithmBenchmarks(runner, dataFile, portfolio);
+    runDataFileBenchmarks(runner, dataFile, portfolio);
+    runValidationBenchmarks(runner, dataFile, portfolio);
+    runReportBenchmarks(runner, dataFile, portfolio);
+    runBalanceBenchmarks(runner, dataFile, portfolio);
+    runDownloadBenchmarks(runner);
+    runBulkPriceBenchmarks(runner);
+    runImportBenchmarks(runner);
+    if (sqliteErrors != 0) {
+      throw std::runtime_error(std::to_string(sqliteErrors) + " SQLite errors while benchmarking, so the results "
+                                                                "are not valid");
+    }
+
+    std::ofstream file;
+    if (!options->output.empty()) {
+      file.open(options->output);
+    }
+    std::ostream& out = options->output.empty() ? std::cout : file;
+    if (options->json) {
+      writeJson(out, runner.results(), options->shape);
+    } else {
+      writeText(out, runner.results());
+    }
+  } catch (const std::exception& e) {
+    std::cerr << "pv_bench: " << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,147 @@
+#include "Reports.h"
+#include "pv/Date.h"
+#include "pv/Snapshot.h"
+#include "pv/TimeSeries.h"
+#include <cstddef>
+#include <map>
+#include <sqlite3.h>
+#include <utility>
+
+namespace {
+
+const char* securitiesQuery = "SELECT Id, Symbol, AssetClass, Sector FROM Securities ORDER BY Id";
+const char* accountsQuery = "SELECT Id FROM Accounts";
+const char* firstTransactionDateQuery = "SELECT MIN(Date) FROM Transactions";
+
+std::string columnText(sqlite3_stmt* stmt, int column) {
+  const auto* text = reinterpret_cast<const char*>(sqlite3_column_text(stmt, column));
+  return text != nullptr ? std::string(text) : std::string();
+}
+
+const std::string& group(const std::string& symbol, const std::string& assetClass, const std::string& sector,
+                         pvcli::GroupBy groupBy) noexcept {
+  switch (groupBy) {
+  case pvcli::GroupBy::AssetClass: return assetClass;
+  case pvcli::GroupBy::Sector: return sector;
+  case pvcli::GroupBy::Symbol:
+  default: return symbol;
+  }
+}
+
+} // namespace
+
+namespace pvcli {
+
+std::optional<GroupBy> parseGroupBy(const std::string& string) noexcept {
+  if (string == "asset-class") {
+    return GroupBy::AssetClass;
+  } else if (string == "sector") {
+    return GroupBy::Sector;
+  } else if (string == "symbol") {
+    return GroupBy::Symbol;
+  }
+  return std::nullopt;
+}
+
+Table holdings(pv::DataFile& dataFile, pv::i64 date) {
+  auto snapshot = pv::algorithms::snapshot(dataFile, date);
+
+  Table table;
+  table.columns = {"symbol",         "name",           "sharesHeld",           "sharePrice",
+                   "averageBuyPrice", "averageSellPrice", "unrealizedCashGained", "cashGained",
+                   "dividendIncome",  "interestIncome", "costBasis",            "totalIncome",
+                   "marketValue"};
+  table.rows.reserve(snapshot.securities.size());
+  for (const auto& security : snapshot.securities) {
+    table.rows.push_back({Cell::text(security.symbol), Cell::text(security.name), Cell::number(security.sharesHeld),
+                          Cell::money(security.sharePrice), Cell::money(security.averageBuyPrice),
+                          Cell::money(security.averageSellPrice), Cell::money(security.unrealizedCashGained),
+                          Cell::money(security.cashGained), Cell::money(security.dividendIncome),
+                          Cell::money(security.interestIncome), Cell::money(security.costBasis),
+                          Cell::money(security.totalIncome), Cell::money(security.marketValue)});
+  }
+  return table;
+}
+
+Table allocation(pv::DataFile& dataFile, pv::i64 date, GroupBy groupBy) {
+  auto snapshot = pv::algorithms::snapshot(dataFile, date);
+
+  std::map<std::string, pv::i64> values;
+  for (const auto& security : snapshot.securities) {
+    values[group(security.symbol, security.assetClass, security.sector, groupBy)] +=
+        security.marketValue.value_or(0);
+  }
+
+  Table table;
+  table.columns = {"group", "marketValue"};
+  for (const auto& pair : values) {
+    table.rows.push_back({Cell::text(pair.first), Cell::money(pair.second)});
+  }
+  table.rows.push_back({Cell::text("Cash Balance"), Cell::money(snapshot.cashBalance)});
+  return table;
+}
+
+Table marketValue(pv::DataFile& dataFile, std::vector<pv::i64> dates, GroupBy groupBy) {
+  std::vector<pv::i64> securities;
+  std::vector<std::string> groups; // The group of each security
+  auto* stmt = dataFile.cachedQuery(securitiesQuery);
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    securities.push_back(sqlite3_column_int64(stmt, 0));
+    groups.push_back(group(columnText(stmt, 1), columnText(stmt, 2), columnText(stmt, 3), groupBy));
+  }
+  sqlite3_reset(stmt);
+
+  std::vector<pv::i64> accounts;
+  stmt = dataFile.cachedQuery(accountsQuery);
+  while (sqlite3_step(stmt) == SQLITE_ROW) {
+    accounts.push_back(sqlite3_column_int64(stmt, 0));
+  }
+  sqlite3_reset(stmt);
+
+  auto series = pv::algorithms::timeSeries(dataFile, securities, accounts, std::move(dates));
+  const std::size_t dateCount = series.dates.size();
+
+  std::vector<pv::i64> costBasis(dateCount, 0);
+  std::vector<pv::i64> marketValue(dateCount, 0);
+  std::map<std::string, std::vector<pv::i64>> groupValues;
+  for (std::size_t s = 0; s < series.securities.size(); ++s) {
+    const auto& securitySeries = series.securities[s];
+    auto& values = groupValues[groups[s]];
+    values.resize(dateCount, 0);
+    for (std::size_t i = 0; i < dateCount; ++i) {
+      values[i] += securitySeries.marketValue[i];
+      marketValue[i] += securitySeries.marketValue[i];
+      costBasis[i] += securitySeries.costBasis[i];
+    }
+  }
+
+  Table table;
+  table.columns = {"date", "costBasis", "marketValue", "cashBalance"};
+  for (const auto& pair : groupValues) {
+    table.columns.push_back(pair.first);
+  }
+  table.rows.reserve(dateCount);
+  for (std::size_t i = 0; i < dateCount; ++i) {
+    std::vector<Cell> row = {Cell::text(pv::dates::toIsoString(series.dates[i])), Cell::money(costBasis[i]),
+                             Cell::money(marketValue[i]), Cell::money(series.cashBalance[i])};
+    for (const auto& pair : groupValues) {
+      row.push_back(Cell::money(pair.second[i]));
+    }
+    table.rows.push_back(std::move(row));
+  }
+  return table;
+}
+
+std::optional<pv::i64> firstTransactionDate(pv::DataFile& dataFile) noexcept {
+  auto* stmt = dataFile.cachedQuery(firstTransactionDateQuery);
+  std::optional<pv::i64> date = std::nullopt;
+  if (stmt != nullptr && sqlite3_step(stmt) == SQLITE_ROW && sqlite3_column_type(stmt, 0) != SQLITE_NULL) {
+    date = sqlite3_column_int64(stmt, 0);
+  }
+  if (stmt != nullptr) {
+    sqlite3_reset(stmt);
+  }
+  return date;
+}
+
+} // namespace pvcli
@@ -0,0 +1,34 @@
+#ifndef PVCLI_REPORTS_H
+#define PVCLI_REPORTS_H
+
+#include "Table.h"
+#include "pv/DataFile.h"
+#include "pv/Integer64.h"
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace pvcli {
+
+/// \brief How securities are grouped by the allocation and market value reports, like \c pvui::GroupBy.
+enum class GroupBy : unsigned char { AssetClass, Sector, Symbol };
+
+/// \brief Parses "asset-class", "sector" or "symbol".
+std::optional<GroupBy> parseGroupBy(const std::string& string) noexcept;
+
+/// \brief Every holding metric of every security on \c date, like the holdings report.
+Table holdings(pv::DataFile& dataFile, pv::i64 date);
+
+/// \brief The market value of each group on \c date, plus the cash balance, like the asset allocation report.
+Table allocation(pv::DataFile& dataFile, pv::i64 date, GroupBy groupBy);
+
+/// \brief The cost basis, market value, cash balance, and market value of each group at each date, like the market
+/// value report.
+Table marketValue(pv::DataFile& dataFile, std::vector<pv::i64> dates, GroupBy groupBy);
+
+/// \brief Returns the date of the earliest transaction, or \c std::nullopt if there are no transactions.
+std::optional<pv::i64> firstTransactionDate(pv::DataFile& dataFile) noexcept;
+
+} // namespace pvcli
+
+#endif // PVCLI_REPORTS_H
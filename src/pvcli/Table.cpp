@@ -0,0 +1,99 @@
+#include "Table.h"
+#include <cstddef>
+#include <cstdio>
+
+namespace {
+
+void writeCsvField(std::ostream& out, const std::string& field) {
+  if (field.find_first_of(",\"\r\n") == std::string::npos) {
+    out << field;
+    return;
+  }
+  out << '"';
+  for (char c : field) {
+    if (c == '"') {
+      out << '"';
+    }
+    out << c;
+  }
+  out << '"';
+}
+
+void writeJsonString(std::ostream& out, const std::string& string) {
+  out << '"';
+  for (char c : string) {
+    switch (c) {
+    case '"': out << "\\\""; break;
+    case '\\': out << "\\\\"; break;
+    case '\n': out << "\\n"; break;
+    case '\r': out << "\\r"; break;
+    case '\t': out << "\\t"; break;
+    default:
+      if (static_cast<unsigned char>(c) < 0x20) {
+        char escape[8];
+        std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned int>(c));
+        out << escape;
+      } else {
+        out << c;
+      }
+    }
+  }
+  out << '"';
+}
+
+} // namespace
+
+namespace pvcli {
+
+Cell Cell::money(pv::i64 cents) {
+  // Formatted exactly from the integer, so that no precision is lost to floating point
+  bool negative = cents < 0;
+  auto magnitude = negative ? 0 - static_cast<unsigned long long>(cents) : static_cast<unsigned long long>(cents);
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%s%llu.%02llu", negative ? "-" : "", magnitude / 100, magnitude % 100);
+  return Cell{Kind::Number, buffer};
+}
+
+void writeCsv(std::ostream& out, const Table& table) {
+  for (std::size_t i = 0; i < table.columns.size(); ++i) {
+    if (i != 0) {
+      out << ',';
+    }
+    writeCsvField(out, table.columns[i]);
+  }
+  out << '\n';
+
+  for (const auto& row : table.rows) {
+    for (std::size_t i = 0; i < row.size(); ++i) {
+      if (i != 0) {
+        out << ',';
+      }
+      writeCsvField(out, row[i].value); // Null is an empty field
+    }
+    out << '\n';
+  }
+}
+
+void writeJson(std::ostream& out, const Table& table) {
+  out << '[';
+  for (std::size_t r = 0; r < table.rows.size(); ++r) {
+    const auto& row = table.rows[r];
+    out << (r == 0 ? "\n  {" : ",\n  {");
+    for (std::size_t i = 0; i < row.size() && i < table.columns.size(); ++i) {
+      if (i != 0) {
+        out << ", ";
+      }
+      writeJsonString(out, table.columns[i]);
+      out << ": ";
+      switch (row[i].kind) {
+      case Cell::Kind::Null: out << "null"; break;
+      case Cell::Kind::Number: out << row[i].value; break;
+      case Cell::Kind::Text: writeJsonString(out, row[i].value); break;
+      }
+    }
+    out << '}';
+  }
+  out << (table.rows.empty() ? "]\n" : "\n]\n");
+}
+
+} // namespace pvcli
@@ -0,0 +1,41 @@
+#ifndef PVCLI_TABLE_H
+#define PVCLI_TABLE_H
+
+#include "pv/Integer64.h"
+#include <optional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pvcli {
+
+/// \brief A single value of a \c Table.
+struct Cell {
+  enum class Kind : unsigned char { Null, Text, Number };
+  Kind kind = Kind::Null;
+  /// \brief The formatted value. Numbers are already formatted as they should be written.
+  std::string value;
+
+  static Cell text(std::string value) { return Cell{Kind::Text, std::move(value)}; }
+  static Cell number(pv::i64 value) { return Cell{Kind::Number, std::to_string(value)}; }
+  /// \brief A money value, given in cents.
+  static Cell money(pv::i64 cents);
+  static Cell money(const std::optional<pv::i64>& cents) { return cents.has_value() ? money(*cents) : Cell(); }
+};
+
+/// \brief The output of a report: named columns, and rows of cells.
+struct Table {
+  std::vector<std::string> columns;
+  std::vector<std::vector<Cell>> rows;
+};
+
+/// \brief Writes \c table as CSV (RFC 4180), with a header row.
+void writeCsv(std::ostream& out, const Table& table);
+
+/// \brief Writes \c table as a JSON array, with one object per row.
+void writeJson(std::ostream& out, const Table& table);
+
+} // namespace pvcli
+
+#endif // PVCLI_TABLE_H
@@ -0,0 +1,356 @@
+#include "Reports.h"
+#include "Table.h"
+#include "pv/BulkPriceFiles.h"
+#include "pv/DataFile.h"
+#include "pv/Date.h"
+#include "pv/Integer64.h"
+#include "pv/Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <sqlite3.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace pvcli;
+
+enum class Report : unsigned char { Holdings, Allocation, MarketValue };
+enum class Format : unsigned char { Csv, Json };
+
+struct Options {
+  std::vector<std::string> files;
+  std::vector<Report> reports;
+  Format format = Format::Csv;
+  std::filesystem::path output = ".";
+  pv::i64 date = pv::dates::today();
+  std::optional<pv::i64> start = std::nullopt; // Defaults to each file's first transaction
+  pv::i64 interval = 30;
+  GroupBy groupBy = GroupBy::Symbol;
+  unsigned int jobs = std::max(1u, std::thread::hardware_concurrency());
+  std::string trace; // Empty if not tracing
+  std::filesystem::path prices; // Empty if not importing prices
+  std::string quoteCache; // Empty if not reading through a quote cache
+};
+
+const char* usage = R"(Usage: pview-cli [options] FILE...
+
+Writes reports for each pView data file, without modifying it (unless importing
+prices). The reports for example.pvf are written to example.holdings.csv,
+example.allocation.csv and example.market-value.csv. Files with the same name in
+different directories are told apart by their position on the command line, so
+the reports for a/example.pvf b/example.pvf are written to
+example-1.holdings.csv, example-2.holdings.csv and so on. A summary of each file
+is written to standard output.
+
+Options:
+  --report NAME     holdings, allocation or market-value (may be repeated; default: all)
+  --format FORMAT   csv or json (default csv)
+  --output DIR      directory to write the reports to (default: the current directory)
+  --date DATE       date to report on, as YYYY-MM-DD (default: today)
+  --start DATE      first date of the market value series (default: the first transaction)
+  --interval DAYS   days between dates of the market value series (default 30)
+  --group-by GROUP  asset-class, sector or symbol (default symbol)
+  --jobs N          number of files to process at once (default: the number of cores)
+  --trace FILE      write a trace of the run to FILE, for chrome://tracing or Perfetto
+  --import-prices PATH
+                    before reporting, store the prices of each file's securities
+                    up to the report date from PATH: a directory of SYMBOL.csv
+                    files, or one CSV file with a Date column and a column per symbol
+  --quote-cache FILE
+                    report with the prices in the quote cache FILE that pView
+                    shares between data files, where they are newer than the file's
+)";
+
+const char* reportName(Report report) noexcept {
+  switch (report) {
+  case Report::Holdings: return "holdings";
+  case Report::Allocation: return "allocation";
+  case Report::MarketValue:
+  default: return "market-value";
+  }
+}
+
+std::optional<Options> parseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (option.rfind("--", 0) != 0) {
+      options.files.push_back(option);
+      continue;
+    }
+    if (option == "--help" || i + 1 >= argc) {
+      return std::nullopt;
+    }
+
+    std::string value = argv[++i];
+    if (option == "--report") {
+      if (value == "holdings") {
+        options.reports.push_back(Report::Holdings);
+      } else if (value == "allocation") {
+        options.reports.push_back(Report::Allocation);
+      } else if (value == "market-value") {
+        options.reports.push_back(Report::MarketValue);
+      } else {
+        return std::nullopt;
+      }
+    } else if (option == "--format") {
+      if (value != "csv" && value != "json") {
+        return std::nullopt;
+      }
+      options.format = value == "csv" ? Format::Csv : Format::Json;
+    } else if (option == "--output") {
+      options.output = value;
+    } else if (option == "--date" || option == "--start") {
+      auto date = pv::dates::fromIsoString(value);
+      if (!date) {
+        return std::nullopt;
+      }
+      if (option == "--date") {
+        options.date = *date;
+      } else {
+        options.start = *date;
+      }
+    } else if (option == "--interval" || option == "--jobs") {
+      long number = std::strtol(value.c_str(), nullptr, 10);
+      if (number <= 0) {
+        return std::nullopt;
+      }
+      if (option == "--interval") {
+        options.interval = number;
+      } else {
+        options.jobs = static_cast<unsigned int>(number);
+      }
+    } else if (option == "--trace") {
+      options.trace = value;
+    } else if (option == "--import-prices") {
+      options.prices = value;
+    } else if (option == "--quote-cache") {
+      options.quoteCache = value;
+    } else if (option == "--group-by") {
+      auto groupBy = parseGroupBy(value);
+      if (!groupBy) {
+        return std::nullopt;
+      }
+      options.groupBy = *groupBy;
+    } else {
+      return std::nullopt;
+    }
+  }
+
+  if (options.files.empty()) {
+    return std::nullopt;
+  }
+  if (options.reports.empty()) {
+    options.reports = {Report::Holdings, Report::Allocation, Report::MarketValue};
+  }
+  return options;
+}
+
+/// \brief The outcome of processing a single file.
+struct FileResult {
+  std::string error; // Empty if the file was processed
+  double milliseconds = 0;
+  std::uint64_t statements = 0;
+  std::size_t importedPrices = 0;
+  std::vector<std::string> missingSymbols; // Symbols without imported prices
+};
+
+void writeTable(const std::filesystem::path& path, const Table& table, Format format) {
+  std::ofstream out(path);
+  if (!out) {
+    throw std::runtime_error("Could not write " + path.string());
+  }
+  if (format == Format::Csv) {
+    writeCsv(out, table);
+  } else {
+    writeJson(out, table);
+  }
+}
+
+/// \brief Returns the name that the reports of each file start with: the file's name without its extension,
+/// followed by its position on the command line if another file has the same name.
+///
+/// \throws std::runtime_error if two files would still write the same reports (names are compared ignoring ASCII
+/// case, since some file systems do)
+std::vector<std::string> reportStems(const std::vector<std::string>& files) {
+  auto folded = [](std::string name) {
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; });
+    return name;
+  };
+
+  std::vector<std::string> stems;
+  std::map<std::string, std::size_t> counts;
+  for (const auto& file : files) {
+    stems.push_back(std::filesystem::path(file).stem().string());
+    ++counts[folded(stems.back())];
+  }
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    if (counts[folded(stems[i])] > 1) {
+      stems[i] += '-' + std::to_string(i + 1);
+    }
+  }
+
+  std::map<std::string, std::size_t> owners;
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    auto [owner, inserted] = owners.emplace(folded(stems[i]), i);
+    if (!inserted) {
+      throw std::runtime_error(files[owner->second] + " and " + files[i] + " would both write reports named " +
+                               stems[i] + ".*; rename one of them, or report on them separately");
+    }
+  }
+  return stems;
+}
+
+/// \param stem the name that the file's reports start with (see \c reportStems())
+/// \param importJobs the number of threads to parse imported prices with
+FileResult process(const std::string& file, const std::string& stem, const Options& options,
+                   unsigned int importJobs) {
+  pv::trace::Span span("process", "cli");
+  FileResult result;
+  auto start = std::chrono::steady_clock::now();
+  try {
+    if (!std::filesystem::is_regular_file(file)) {
+      throw std::runtime_error("No such file");
+    }
+    bool importing = !options.prices.empty();
+    pv::DataFileOptions dataFileOptions;
+    dataFileOptions.quoteCache = options.quoteCache;
+    pv::DataFile dataFile(file, importing ? SQLITE_OPEN_READWRITE : SQLITE_OPEN_READONLY, dataFileOptions);
+    dataFile.countStatements();
+
+    if (importing) {
+      pv::trace::Span span("importPrices", "cli");
+      auto provider = pv::openPriceFiles(options.prices, importJobs);
+      if (provider == nullptr) {
+        throw std::runtime_error("No such prices file or directory");
+      }
+      auto import = pv::importPrices(dataFile, *provider, 0, options.date + 1);
+      if (import.result != pv::ResultCode::Ok) {
+        throw std::runtime_error("Could not import prices");
+      }
+      result.importedPrices = import.prices;
+      result.missingSymbols = std::move(import.missing);
+    }
+
+    const char* extension = options.format == Format::Csv ? ".csv" : ".json";
+    for (auto report : options.reports) {
+      pv::trace::Span span(reportName(report), "cli");
+      Table table;
+      switch (report) {
+      case Report::Holdings: table = holdings(dataFile, options.date); break;
+      case Report::Allocation: table = allocation(dataFile, options.date, options.groupBy); break;
+      case Report::MarketValue: {
+        std::vector<pv::i64> dates;
+        for (auto date = options.start.value_or(firstTransactionDate(dataFile).value_or(options.date));
+             date <= options.date; date += options.interval) {
+          dates.push_back(date);
+        }
+        table = marketValue(dataFile, std::move(dates), options.groupBy);
+        break;
+      }
+      }
+      writeTable(options.output / (stem + '.' + reportName(report) + extension), table, options.format);
+    }
+    result.statements = dataFile.statementCount();
+  } catch (const std::exception& e) {
+    result.error = e.what();
+  }
+  result.milliseconds =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  auto options = parseOptions(argc, argv);
+  if (!options) {
+    std::cerr << usage;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<std::string> stems;
+  try {
+    stems = reportStems(options->files);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+
+  pv::trace::setEnabled(!options->trace.empty());
+
+  auto workerCount = std::min<std::size_t>(options->jobs, options->files.size());
+  // Cores that aren't processing a file of their own help parse the prices being imported
+  auto importJobs = std::max(1u, options->jobs / static_cast<unsigned int>(workerCount));
+
+  // Each worker opens its own connection to each file it takes (read-only, unless importing prices)
+  std::vector<FileResult> results(options->files.size());
+  std::atomic<std::size_t> next{0};
+  auto worker = [&] {
+    for (std::size_t i = next++; i < options->files.size(); i = next++) {
+      results[i] = process(options->files[i], stems[i], *options, importJobs);
+    }
+  };
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  for (std::size_t i = 1; i < workerCount; ++i) {
+    workers.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : workers) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  Table summary;
+  summary.columns = {"file", "milliseconds", "statements", "error"};
+  bool failed = false;
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const auto& result = results[i];
+    failed = failed || !result.error.empty();
+    summary.rows.push_back({Cell::text(options->files[i]),
+                            Cell{Cell::Kind::Number, std::to_string(static_cast<long long>(result.milliseconds))},
+                            Cell::number(static_cast<pv::i64>(result.statements)),
+                            result.error.empty() ? Cell() : Cell::text(result.error)});
+  }
+  if (options->format == Format::Csv) {
+    writeCsv(std::cout, summary);
+  } else {
+    writeJson(std::cout, summary);
+  }
+  if (!options->trace.empty()) {
+    std::ofstream traceFile(options->trace);
+    pv::trace::writeChromeTrace(traceFile);
+    if (!traceFile) {
+      std::cerr << "Could not write " << options->trace << '\n';
+      failed = true;
+    }
+  }
+  if (!options->prices.empty()) {
+    for (std::size_t i = 0; i < results.size(); ++i) {
+      const auto& result = results[i];
+      if (result.error.empty()) {
+        std::cerr << options->files[i] << ": imported " << result.importedPrices << " prices, "
+                  << result.missingSymbols.size() << " symbols without prices\n";
+      }
+    }
+  }
+  std::cerr << "Processed " << results.size() << " files in " << static_cast<long long>(elapsed) << " ms with "
+            << workerCount << (workerCount == 1 ? " worker\n" : " workers\n");
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -8,35 +8,37 @@
 #include "pv/Algorithms.h"
 #include "pv/DataFile.h"
 #include "pv/Integer64.h"
+#include "pv/Security.h"
 #include "pv/Transaction.h"
 #include "pvui/DataFileManager.h"
-#include "pvui/ModelUtils.h"
-#include <QAbstractProxyModel>
 #include <QCheckBox>
 #include <QDate>
+#include <QHBoxLayout>
 #include <QHeaderView>
 #include <QLineEdit>
 #include <QMessageBox>
 #include <QTreeView>
 #include <cassert>
+#include <memory>
 #include <optional>
+#include <string>
 
 pvui::AccountPageWidget::AccountPageWidget(pvui::DataFileManager& dataFileManager, QWidget* parent)
     : PageWidget(parent), dataFileManager(dataFileManager),
       insertWidget(new controls::TransactionInsertionWidget(dataFileManager)) {
   settings.beginGroup("AccountPage");
   // UI Init
+  setupFilters();
   layout()->addWidget(table, 1);
   layout()->addWidget(insertWidget);
   setFocusProxy(insertWidget);
   table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
   table->verticalHeader()->hide();
+  // The model sorts (and pages in rows) itself, so the most recent transactions are shown first rather than
+  // scrolling to the bottom, which would need every row to be fetched
   table->setSortingEnabled(true);
-  table->sortByColumn(0, Qt::AscendingOrder);
+  table->sortByColumn(0, Qt::DescendingOrder);
   table->setSelectionBehavior(QTableView::SelectRows);
-  table->setModel(proxyModel);
-  proxyModel->setSortRole(pvui::modelutils::SortRole);
-  table->scrollToBottom();
   table->setItemDelegate(new AutoFillingDelegate);
 
   // Setup delete transaction
@@ -54,15 +56,75 @@ pvui::AccountPageWidget::AccountPageWidget(pvui::DataFileManager& dataFileManage
 
   QObject::connect(insertWidget, &controls::TransactionInsertionWidget::submitted, this,
                    &AccountPageWidget::handleTransactionSubmitted);
-  QObject::connect(
-      proxyModel, &QAbstractProxyModel::sourceModelChanged, this, [this] { table->scrollToBottom(); },
-      Qt::ConnectionType::QueuedConnection); // scroll to bottom when the table is changed,
-  // For the previous line, we force a queued connection because we need to give it a delay, otherwise scrollToBottom
-  // will not work
 
   handleDataFileChanged(); // Call in constructor to initialize state
 }
 
+void pvui::AccountPageWidget::setupFilters() {
+  auto* filterLayout = new QHBoxLayout;
+  filterLayout->addWidget(startDateFilter, 1);
+  filterLayout->addWidget(endDateFilter, 1);
+  filterLayout->addWidget(actionFilter, 1);
+  filterLayout->addWidget(securityFilter, 1);
+  filterLayout->addStretch(3);
+  layout()->addLayout(filterLayout);
+
+  // The minimum date means that the date isn't filtered
+  for (auto* dateFilter : {startDateFilter, endDateFilter}) {
+    dateFilter->setCalendarPopup(true);
+    dateFilter->setMinimumDate(QDate(1900, 1, 1));
+    dateFilter->setDate(dateFilter->minimumDate());
+    QObject::connect(dateFilter, &QDateEdit::dateChanged, this, &AccountPageWidget::updateFilter);
+  }
+  startDateFilter->setSpecialValueText(tr("Any Start Date"));
+  endDateFilter->setSpecialValueText(tr("Any End Date"));
+
+  actionFilter->addItem(tr("All Actions"));
+  actionFilter->addItem(tr("In"), static_cast<int>(pv::Action::DEPOSIT));
+  actionFilter->addItem(tr("Out"), static_cast<int>(pv::Action::WITHDRAW));
+  actionFilter->addItem(tr("Buy"), static_cast<int>(pv::Action::BUY));
+  actionFilter->addItem(tr("Sell"), static_cast<int>(pv::Action::SELL));
+  actionFilter->addItem(tr("Dividend"), static_cast<int>(pv::Action::DIVIDEND));
+  actionFilter->addItem(tr("Interest"), static_cast<int>(pv::Action::INTEREST));
+  QObject::connect(actionFilter, qOverload<int>(&QComboBox::currentIndexChanged), this,
+                   &AccountPageWidget::updateFilter);
+
+  securityFilter->setEditable(true);
+  // The combo box's own placeholder also stops it from selecting the first security once the list is populated
+  securityFilter->setPlaceholderText(tr("All Securities"));
+  securityFilter->lineEdit()->setPlaceholderText(tr("All Securities"));
+  securityFilterProxy.sort(0, Qt::AscendingOrder);
+  securityFilter->setModelColumn(0);
+  securityFilter->setModel(&securityFilterProxy);
+  QObject::connect(securityFilter, &QComboBox::currentTextChanged, this, &AccountPageWidget::updateFilter);
+}
+
+pvui::models::TransactionModel::Filter pvui::AccountPageWidget::currentFilter() const {
+  models::TransactionModel::Filter filter;
+  if (startDateFilter->date() != startDateFilter->minimumDate()) {
+    filter.startDate = toEpochDate(startDateFilter->date());
+  }
+  if (endDateFilter->date() != endDateFilter->minimumDate()) {
+    filter.endDate = toEpochDate(endDateFilter->date());
+  }
+  if (QVariant action = actionFilter->currentData(); action.isValid()) {
+    filter.action = static_cast<pv::Action>(action.toInt());
+  }
+
+  std::string symbol = securityFilter->currentText().trimmed().toStdString();
+  if (!symbol.empty() && dataFileManager.has()) {
+    // An unknown symbol matches nothing, rather than being ignored
+    filter.security = pv::security::securityForSymbol(*dataFileManager, symbol).value_or(-1);
+  }
+  return filter;
+}
+
+void pvui::AccountPageWidget::updateFilter() {
+  if (model != nullptr) {
+    model->setFilter(currentFilter());
+  }
+}
+
 bool pvui::AccountPageWidget::canDeleteTransactions() {
   if (!account_.has_value() || !dataFileManager.has()) {
     return false;
@@ -117,6 +179,11 @@ void pvui::AccountPageWidget::deleteSelectedTransactions() {
 void pvui::AccountPageWidget::handleDataFileChanged() {
   setAccount(std::nullopt);
 
+  securityFilterModel = dataFileManager.has() ? std::make_unique<models::SecurityModel>(*dataFileManager) : nullptr;
+  securityFilterProxy.setSourceModel(securityFilterModel.get());
+  securityFilter->setCurrentIndex(-1);
+  securityFilter->clearEditText();
+
   if (dataFileManager.has()) {
     accountUpdatedConnection =
         dataFileManager->onAccountUpdated([this](pv::i64 changedAccount) { emit accountUpdated(changedAccount); });
@@ -126,12 +193,15 @@ void pvui::AccountPageWidget::handleDataFileChanged() {
         dataFileManager->onTransactionUpdated([this](pv::i64 transaction) { emit transactionUpdated(transaction); });
     transactionRemovedConnection = dataFileManager->onTransactionRemoved(
         [this](pv::i64 transaction) { emit transactionUpdated(transaction, true); });
+    transactionsAddedConnection =
+        dataFileManager->onTransactionsAdded([this](const std::vector<pv::i64>&) { emit reset(); });
     resetConnection = dataFileManager->onRollback([this] { emit reset(); });
   } else {
     accountUpdatedConnection.disconnect();
     transactionAddedConnection.disconnect();
     transactionUpdatedConnection.disconnect();
     transactionRemovedConnection.disconnect();
+    transactionsAddedConnection.disconnect();
   }
 }
 
@@ -170,9 +240,12 @@ void pvui::AccountPageWidget::handleTransactionSubmitted(pv::i64 transaction) {
   assert(pv::transaction::account(*dataFileManager, transaction) == account_);
   assert(model != nullptr);
 
-  QModelIndex index = proxyModel->mapFromSource(model->index(model->indexOfTransaction(transaction), 0));
-  table->selectRow(index.row());
-  table->scrollTo(index);
+  int rowIndex = model->indexOfTransaction(transaction);
+  if (rowIndex == -1) {
+    return; // Filtered out, or not fetched yet
+  }
+  table->selectRow(rowIndex);
+  table->scrollTo(model->index(rowIndex, 0));
 }
 
 void pvui::AccountPageWidget::updateTitle() {
@@ -188,8 +261,17 @@ void pvui::AccountPageWidget::setAccount(std::optional<pv::i64> account) {
   updateTitle();
   updateCashBalance();
 
-  model = this->account_.has_value() ? std::make_unique<models::TransactionModel>(*dataFileManager, *this->account_)
-                                     : nullptr;
-  proxyModel->setSourceModel(model.get());
+  auto newModel = this->account_.has_value()
+                      ? std::make_unique<models::TransactionModel>(*dataFileManager, *this->account_)
+                      : nullptr;
+  if (newModel != nullptr) {
+    newModel->setFilter(currentFilter());
+    newModel->sort(table->horizontalHeader()->sortIndicatorSection(),
+                   table->horizontalHeader()->sortIndicatorOrder());
+  }
+  auto* oldSelectionModel = table->selectionModel();
+  table->setModel(newModel.get());
+  delete oldSelectionModel;
+  model = std::move(newModel);
   insertWidget->setAccount(this->account_);
 }
@@ -9,11 +9,15 @@
 #include "pv/Integer64.h"
 #include "pv/Signals.h"
 #include "pvui/DataFileManager.h"
+#include "pvui/SecurityModel.h"
+#include <QComboBox>
+#include <QDateEdit>
 #include <QSortFilterProxyModel>
 #include <QTableView>
 #include <QWidget>
 #include <QSettings>
 #include <QAction>
+#include <memory>
 
 namespace pvui {
 
@@ -27,19 +31,30 @@ private:
   pv::ScopedConnection transactionAddedConnection;
   pv::ScopedConnection transactionRemovedConnection;
   pv::ScopedConnection transactionUpdatedConnection;
+  pv::ScopedConnection transactionsAddedConnection;
   pv::ScopedConnection resetConnection;
 
   QSettings settings;
   QTableView* table = new QTableView;
   controls::TransactionInsertionWidget* insertWidget;
-  QSortFilterProxyModel* proxyModel = new QSortFilterProxyModel(table);
   std::unique_ptr<models::TransactionModel> model = nullptr;
 
+  // Filters
+  QDateEdit* startDateFilter = new QDateEdit;
+  QDateEdit* endDateFilter = new QDateEdit;
+  QComboBox* actionFilter = new QComboBox;
+  QComboBox* securityFilter = new QComboBox;
+  QSortFilterProxyModel securityFilterProxy;
+  std::unique_ptr<models::SecurityModel> securityFilterModel = nullptr;
+
   QAction deleteTransactionAction = QAction(tr("Delete Selected Transactions"));
 
   void updateCashBalance() noexcept;
   void updateTitle();
+  void setupFilters();
+  models::TransactionModel::Filter currentFilter() const;
 private slots:
+  void updateFilter();
   void handleAccountUpdated(pv::i64 account);
   void handleTransactionsUpdated(pv::i64 transaction, bool removed);
   void handleReset();
@@ -1,7 +1,9 @@
 #include "AssetAllocationReport.h"
 #include "DateUtils.h"
-#include "pv/Algorithms.h"
+#include "pv/DailyValuations.h"
 #include "pv/DataFile.h"
+#include "pv/Snapshot.h"
+#include "pv/Trace.h"
 #include "GroupBy.h"
 #include <QComboBox>
 #include <QHBoxLayout>
@@ -11,8 +13,10 @@
 #include <QString>
 #include <QwtLegend>
 #include <QwtText>
+#include <map>
 #include <sqlite3.h>
 #include <utility>
+#include <vector>
 
 namespace pvui {
 namespace reports {
@@ -49,44 +53,64 @@ AssetAllocationReport::AssetAllocationReport(DataFileManager& dataFileManager, Q
 }
 
 void AssetAllocationReport::reload() {
+  pv::trace::Span span("AssetAllocationReport::reload", "ui");
   if (currentGroupBy() != static_cast<GroupBy>(groupBy->currentData().toInt())) {
     groupBy->setCurrentIndex(groupBy->findData(static_cast<int>(pvui::currentGroupBy())));
   }
-  auto* stmt = dataFileManager->cachedQuery("SELECT Id FROM Securities");
-  QList<double> data;
-  QList<QwtText> titles;
-  QList<QColor> colors;
-  std::map<QString, pv::i64> values;
-  while (sqlite3_step(stmt) == SQLITE_ROW) {
-    pv::i64 security = sqlite3_column_int64(stmt, 0);
-    values[pvui::group(*dataFileManager, security, currentGroupBy())] +=
-        pv::algorithms::marketValue(*dataFileManager, security, currentEpochDate()).value_or(0) / 100.;
-  }
 
-  int i = 0;
-  for (const auto& pair : values) {
-    data += pair.second;
-    titles += QwtText(pair.first);
-    colors += pvui::Report::plotColor(i);
-    ++i;
-  }
+  executor().run<Allocation>(
+      [date = currentEpochDate(), groupBy = currentGroupBy()](ReportExecutor::Task& task) {
+        auto& dataFile = task.dataFile();
+        Allocation allocation;
 
-  int cashBalance = 0;
-  stmt = dataFileManager->cachedQuery("SELECT Id FROM Accounts");
-  while (sqlite3_step(stmt) == SQLITE_ROW) {
-    cashBalance +=
-        pv::algorithms::cashBalance(*dataFileManager, sqlite3_column_int64(stmt, 0), currentEpochDate()) / 100.;
-  }
-  titles += QwtText(tr("Cash Balance"));
-  data += cashBalance;
-  colors += pvui::Report::plotColor(i);
+        // Reads the stored daily valuations if they are up to date
+        std::vector<pv::i64> securities;
+        auto* securityListStmt = dataFile.cachedQuery("SELECT Id FROM Securities");
+        while (sqlite3_step(securityListStmt) == SQLITE_ROW) {
+          securities.push_back(sqlite3_column_int64(securityListStmt, 0));
+        }
+        sqlite3_reset(securityListStmt);
+        auto stored = pv::algorithms::storedTimeSeries(dataFile, securities, {date});
+        if (stored.has_value()) {
+          for (const auto& security : stored->securities) {
+            allocation.groups[pvui::group(dataFile, security.security, groupBy)] += security.marketValue.front();
+          }
+          allocation.cashBalance = stored->cashBalance.front();
+          return allocation;
+        }
+
+        auto snapshot = pv::algorithms::snapshot(dataFile, date);
+        for (const auto& security : snapshot.securities) {
+          allocation.groups[pvui::group(security, groupBy)] += security.marketValue.value_or(0);
+        }
+        allocation.cashBalance = snapshot.cashBalance;
+        return allocation;
+      },
+      [this](Allocation allocation) {
+        QList<double> data;
+        QList<QwtText> titles;
+        QList<QColor> colors;
+
+        int i = 0;
+        for (const auto& pair : allocation.groups) {
+          data += pair.second / 100.;
+          titles += QwtText(pair.first);
+          colors += pvui::Report::plotColor(i);
+          ++i;
+        }
+
+        titles += QwtText(tr("Cash Balance"));
+        data += allocation.cashBalance / 100.;
+        colors += pvui::Report::plotColor(i);
 
-  pie.setSamples(std::move(data));
-  pie.setPieTitles(std::move(titles));
-  pie.setPieColors(std::move(colors));
+        pie.setSamples(std::move(data));
+        pie.setPieTitles(std::move(titles));
+        pie.setPieColors(std::move(colors));
 
-  plot->insertLegend(new QwtLegend);
-  plot->replot();
+        plot->insertLegend(new QwtLegend);
+        pv::trace::Span replotSpan("QwtPlot::replot", "ui");
+        plot->replot();
+      });
 }
 } // namespace reports
 
@@ -4,7 +4,9 @@
 #include "DataFileManager.h"
 #include "PiePlot.h"
 #include "Report.h"
+#include <QString>
 #include <QwtPlot>
+#include <map>
 
 class QComboBox;
 
@@ -17,6 +19,13 @@ private:
   QComboBox* groupBy;
   QwtPlot* plot;
   PiePlot pie;
+
+  /// \brief The values drawn in the pie chart, which are calculated on a background thread.
+  struct Allocation {
+    std::map<QString, pv::i64> groups;
+    //       ^ group  ^ market value
+    pv::i64 cashBalance = 0;
+  };
 public:
   AssetAllocationReport(DataFileManager& dataFileManager, QWidget* parent = nullptr);
   void reload() override;
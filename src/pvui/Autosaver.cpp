@@ -0,0 +1,83 @@
+#include "Autosaver.h"
+#include "pv/DataFile.h"
+#include "pv/Trace.h"
+#include <QSettings>
+#include <QStringLiteral>
+#include <algorithm>
+#include <chrono>
+#include <optional>
+
+namespace pvui {
+
+namespace {
+
+/// \internal How long to wait for another modification before saving. This is short, since other connections (and so
+/// the reports) don't see modifications until they are saved.
+constexpr std::chrono::milliseconds idleDelay(100);
+
+} // namespace
+
+const QString Autosaver::durabilityWindowKey = QStringLiteral("DataFile/DurabilityWindow");
+
+Autosaver::Autosaver(DataFileManager& dataFileManager, QObject* parent)
+    : QObject(parent), dataFileManager(dataFileManager) {
+  timer.setSingleShot(true);
+  QObject::connect(&timer, &QTimer::timeout, this, &Autosaver::schedule);
+  QObject::connect(&dataFileManager, &DataFileManager::dataFileChanged, this, &Autosaver::handleDataFileChanged);
+  handleDataFileChanged();
+}
+
+void Autosaver::handleDataFileChanged() {
+  timer.stop();
+  if (dataFileManager.has()) {
+    flushPendingConnection = dataFileManager->onFlushPending([this] { timer.start(0); });
+    reloadSettings();
+  } else {
+    flushPendingConnection.disconnect();
+  }
+}
+
+void Autosaver::reloadSettings() {
+  if (!dataFileManager.has()) {
+    return;
+  }
+  int window = QSettings().value(durabilityWindowKey, defaultDurabilityWindow).toInt();
+  if (window <= 0 || !dataFileManager->filePath().has_value()) {
+    // Temporary files are never saved to disk, so there is nothing to group
+    dataFileManager->setGroupCommit(std::nullopt);
+    return;
+  }
+  pv::GroupCommitOptions options;
+  options.window = std::chrono::milliseconds(window);
+  options.idle = std::min(idleDelay, options.window);
+  dataFileManager->setGroupCommit(options);
+}
+
+void Autosaver::schedule() {
+  if (!dataFileManager.has()) {
+    return;
+  }
+  auto deadline = dataFileManager->flushDeadline();
+  if (!deadline.has_value()) {
+    return;
+  }
+  auto remaining = std::chrono::ceil<std::chrono::milliseconds>(*deadline - std::chrono::steady_clock::now());
+  if (remaining.count() > 0) {
+    // Another modification was made since this was scheduled, which moved the deadline
+    timer.start(static_cast<int>(remaining.count()));
+    return;
+  }
+  flush();
+  if (dataFileManager->flushDeadline().has_value()) {
+    timer.start(static_cast<int>(idleDelay.count())); // The commit failed, e.g. because the file is locked
+  }
+}
+
+void Autosaver::flush() {
+  if (dataFileManager.has()) {
+    pv::trace::Span span("Autosaver::flush", "ui");
+    dataFileManager->flush();
+  }
+}
+
+} // namespace pvui
@@ -0,0 +1,43 @@
+#ifndef PVUI_AUTOSAVER_H
+#define PVUI_AUTOSAVER_H
+
+#include "DataFileManager.h"
+#include "pv/Signals.h"
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+namespace pvui {
+
+/// \brief Saves the modifications made to the data file in groups, instead of writing each one to disk by itself
+/// (see \c pv::DataFile::setGroupCommit()).
+///
+/// Modifications are saved once none have been made for a moment, or once the oldest one has waited for the
+/// durability window chosen in the settings, whichever comes first. Everything is saved before the data file is
+/// closed, and before the application quits.
+class Autosaver : public QObject {
+  Q_OBJECT
+private:
+  DataFileManager& dataFileManager;
+  QTimer timer;
+  pv::ScopedConnection flushPendingConnection;
+
+  void handleDataFileChanged();
+  void schedule();
+public:
+  /// \brief The settings key of the durability window, in milliseconds. 0 saves every modification right away.
+  static const QString durabilityWindowKey;
+  static constexpr int defaultDurabilityWindow = 1000;
+
+  explicit Autosaver(DataFileManager& dataFileManager, QObject* parent = nullptr);
+
+  /// \brief Applies the durability window from the settings to the data file.
+  void reloadSettings();
+
+  /// \brief Saves every modification that is waiting to be saved.
+  void flush();
+};
+
+} // namespace pvui
+
+#endif // PVUI_AUTOSAVER_H
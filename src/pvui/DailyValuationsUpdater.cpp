@@ -0,0 +1,63 @@
+#include "DailyValuationsUpdater.h"
+#include "DateUtils.h"
+#include "pv/DailyValuations.h"
+#include "pv/Trace.h"
+#include <optional>
+#include <utility>
+
+namespace pvui {
+
+namespace {
+
+/// \internal How long to wait after a modification before repairing, so that a burst of edits only causes one repair.
+constexpr int repairDelay = 1000;
+
+} // namespace
+
+DailyValuationsUpdater::DailyValuationsUpdater(DataFileManager& dataFileManager, QObject* parent)
+    : QObject(parent), dataFileManager(dataFileManager), executor(new ReportExecutor(dataFileManager, this)) {
+  timer.setSingleShot(true);
+  timer.setInterval(repairDelay);
+  QObject::connect(&timer, &QTimer::timeout, this, &DailyValuationsUpdater::repair);
+  QObject::connect(&dataFileManager, &DataFileManager::dataFileChanged, this,
+                   &DailyValuationsUpdater::handleDataFileChanged);
+  handleDataFileChanged();
+}
+
+void DailyValuationsUpdater::handleDataFileChanged() {
+  executor->cancel(); // It was calculating from the previous data file
+  if (dataFileManager.has()) {
+    changeSetConnection = dataFileManager->onChangeSet([this](const pv::ChangeSet&) { timer.start(); });
+    timer.start();
+  } else {
+    changeSetConnection.disconnect();
+    timer.stop();
+  }
+}
+
+void DailyValuationsUpdater::repair() {
+  if (!dataFileManager.has()) {
+    return;
+  }
+  if (dataFileManager->hasTransaction()) {
+    timer.start(); // Storing now would make the repair part of a transaction that may still be rolled back
+    return;
+  }
+
+  executor->run<std::optional<pv::algorithms::DailyValuationsRepair>>(
+      [through = currentEpochDate()](ReportExecutor::Task& task) {
+        return pv::algorithms::calculateDailyValuationsRepair(task.dataFile(), through);
+      },
+      [this](std::optional<pv::algorithms::DailyValuationsRepair> repair) {
+        if (!repair.has_value()) {
+          return;
+        }
+        pv::trace::Span span("DailyValuationsUpdater::store", "ui");
+        if (dataFileManager->hasTransaction() ||
+            pv::algorithms::storeDailyValuationsRepair(*dataFileManager, *repair) == pv::ResultCode::Outdated) {
+          timer.start(); // Calculated from data that has since been modified
+        }
+      });
+}
+
+} // namespace pvui
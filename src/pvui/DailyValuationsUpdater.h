@@ -0,0 +1,34 @@
+#ifndef PVUI_DAILYVALUATIONSUPDATER_H
+#define PVUI_DAILYVALUATIONSUPDATER_H
+
+#include "DataFileManager.h"
+#include "ReportExecutor.h"
+#include "pv/Signals.h"
+#include <QObject>
+#include <QTimer>
+
+namespace pvui {
+
+/// \brief Keeps the daily valuations stored in the data file up to date, so that reports can read them instead of
+/// calculating them (see \c pv::algorithms::storedTimeSeries()).
+///
+/// Shortly after a data file is opened or modified, the days that are out of date are recalculated on a background
+/// thread, then stored from the GUI thread, since only the main connection can write. Only the days from the
+/// earliest modification onwards are recalculated.
+class DailyValuationsUpdater : public QObject {
+  Q_OBJECT
+private:
+  DataFileManager& dataFileManager;
+  ReportExecutor* executor;
+  QTimer timer;
+  pv::ScopedConnection changeSetConnection;
+
+  void handleDataFileChanged();
+  void repair();
+public:
+  explicit DailyValuationsUpdater(DataFileManager& dataFileManager, QObject* parent = nullptr);
+};
+
+} // namespace pvui
+
+#endif // PVUI_DAILYVALUATIONSUPDATER_H
@@ -2,7 +2,9 @@
 #include "pv/DataFile.h"
 #include <utility>
 #include <filesystem>
+#include <QDir>
 #include <QObject>
+#include <QStandardPaths>
 
 namespace pvui {
 
@@ -13,4 +15,34 @@ void DataFileManager::setDataFile(std::optional<pv::DataFile> dataFile) noexcept
   emit dataFileChanged();
 }
 
+std::string DataFileManager::quoteCacheLocation() {
+  auto location = qEnvironmentVariable("PVIEW_QUOTE_CACHE");
+  if (location.isEmpty()) {
+    QDir directory(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+    directory.mkpath(QStringLiteral("."));
+    location = directory.filePath(QStringLiteral("quotes.db"));
+  }
+  return location.toStdString();
+}
+
+pv::QuoteCache* DataFileManager::quoteCache() {
+  if (!quoteCacheOpened) {
+    quoteCacheOpened = true; // Don't retry every time if it can't be opened
+    try {
+      quoteCache_ = std::make_unique<pv::QuoteCache>(quoteCacheLocation());
+    } catch (...) {
+      // Prices are downloaded for each data file without it
+    }
+  }
+  return quoteCache_.get();
+}
+
+pv::DataFileOptions DataFileManager::dataFileOptions() {
+  pv::DataFileOptions options;
+  if (quoteCache() != nullptr) {
+    options.quoteCache = quoteCacheLocation();
+  }
+  return options;
+}
+
 }
@@ -2,9 +2,11 @@
 #define PVUI_DATA_FILE_MANAGER_H
 
 #include "pv/DataFile.h"
+#include "pv/QuoteCache.h"
 #include "pv/Signals.h"
 #include <QObject>
 #include <filesystem>
+#include <memory>
 #include <utility>
 #include <string>
 #include <optional>
@@ -14,6 +16,8 @@ class DataFileManager : public QObject {
   Q_OBJECT
 private:
   std::optional<pv::DataFile> dataFile_ = std::nullopt;
+  std::unique_ptr<pv::QuoteCache> quoteCache_;
+  bool quoteCacheOpened = false;
 public:
   explicit DataFileManager(std::optional<pv::DataFile> file = std::nullopt);
 
@@ -44,6 +48,16 @@ public:
   bool has() { return dataFile_.has_value(); }
 
   void setDataFile(std::optional<pv::DataFile> dataFile) noexcept;
+
+  /// \brief Returns the location of the quote cache shared by every data file this user opens: the
+  /// \c PVIEW_QUOTE_CACHE environment variable if it is set, or otherwise \c quotes.db in pView's cache directory.
+  static std::string quoteCacheLocation();
+
+  /// \brief Returns the quote cache (opening it the first time), or \c nullptr if it can't be opened.
+  pv::QuoteCache* quoteCache();
+
+  /// \brief Returns the options to open data files with, which read prices through the quote cache.
+  pv::DataFileOptions dataFileOptions();
 signals:
   void dataFileChanged();
 };
@@ -0,0 +1,180 @@
+#include "DiagnosticsPage.h"
+#include "pv/Trace.h"
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QTableWidgetItem>
+#include <QVariant>
+#include <cstdint>
+#include <fstream>
+
+namespace pvui {
+
+namespace {
+
+constexpr int refreshInterval = 1000; // ms
+
+enum Column : int {
+  executionsColumn,
+  rowsColumn,
+  totalTimeColumn,
+  medianTimeColumn,
+  p90TimeColumn,
+  p99TimeColumn,
+  maxTimeColumn,
+  sqlColumn,
+  columnCount,
+};
+
+QTableWidgetItem* numberItem(QVariant value) {
+  auto* item = new QTableWidgetItem;
+  item->setData(Qt::DisplayRole, value);
+  item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+  return item;
+}
+
+QVariant milliseconds(std::uint64_t nanoseconds) { return qRound64(nanoseconds / 1e4) / 100.; }
+
+QVariant microseconds(std::uint64_t nanoseconds) { return qRound64(nanoseconds / 1e2) / 10.; }
+
+} // namespace
+
+DiagnosticsPageWidget::DiagnosticsPageWidget(DataFileManager& dataFileManager, QWidget* parent)
+    : PageWidget(parent), dataFileManager(dataFileManager) {
+  setTitle(tr("Diagnostics"));
+
+  auto* controlsLayout = new QHBoxLayout;
+  controlsLayout->addWidget(profileCheckBox);
+  controlsLayout->addWidget(resetButton);
+  controlsLayout->addStretch(1);
+  controlsLayout->addWidget(summaryLabel);
+  layout()->addLayout(controlsLayout);
+  layout()->addWidget(table);
+
+  auto* traceLayout = new QHBoxLayout;
+  traceLayout->addWidget(traceCheckBox);
+  traceLayout->addWidget(saveTraceButton);
+  traceLayout->addStretch(1);
+  traceLayout->addWidget(traceLabel);
+  layout()->addLayout(traceLayout);
+
+  table->setColumnCount(columnCount);
+  table->setHorizontalHeaderLabels({tr("Executions"), tr("Rows"), tr("Total (ms)"), tr("Median (µs)"),
+                                    tr("90th Percentile (µs)"), tr("99th Percentile (µs)"),
+                                    tr("Max (µs)"), tr("SQL")});
+  table->horizontalHeader()->setStretchLastSection(true);
+  table->verticalHeader()->hide();
+  table->setEditTriggers(QTableWidget::NoEditTriggers);
+  table->setSelectionBehavior(QTableWidget::SelectRows);
+  table->setWordWrap(false);
+  table->horizontalHeader()->setSortIndicator(totalTimeColumn, Qt::DescendingOrder);
+
+  resetButton->setEnabled(false);
+  traceCheckBox->setChecked(pv::trace::enabled()); // PVIEW_TRACE may have turned it on already
+  refreshTimer.setInterval(refreshInterval);
+
+  QObject::connect(profileCheckBox, &QCheckBox::toggled, this, &DiagnosticsPageWidget::setProfiling);
+  QObject::connect(resetButton, &QPushButton::clicked, this, [this] {
+    if (profiler != nullptr) {
+      profiler->reset();
+    }
+    refresh();
+  });
+  QObject::connect(traceCheckBox, &QCheckBox::toggled, this, &DiagnosticsPageWidget::setTracing);
+  QObject::connect(saveTraceButton, &QPushButton::clicked, this, &DiagnosticsPageWidget::saveTrace);
+  QObject::connect(&refreshTimer, &QTimer::timeout, this, &DiagnosticsPageWidget::refresh);
+  QObject::connect(&dataFileManager, &DataFileManager::dataFileChanged, this,
+                   &DiagnosticsPageWidget::handleDataFileChanged);
+  refresh();
+}
+
+void DiagnosticsPageWidget::setProfiling(bool profiling) {
+  profiler = profiling ? std::make_shared<pv::QueryProfiler>() : nullptr;
+  resetButton->setEnabled(profiling);
+  handleDataFileChanged();
+}
+
+void DiagnosticsPageWidget::setTracing(bool tracing) {
+  if (tracing) {
+    pv::trace::clear(); // Each recording starts a new trace
+  }
+  pv::trace::setEnabled(tracing);
+  refresh();
+}
+
+void DiagnosticsPageWidget::saveTrace() {
+  QString fileName = QFileDialog::getSaveFileName(this, tr("Save Trace"), QStringLiteral("pview-trace.json"),
+                                                  tr("Trace Files (*.json);;All Files (*.*)"));
+  if (fileName.isNull()) {
+    return;
+  }
+  std::ofstream out(fileName.toStdString());
+  if (out) {
+    pv::trace::writeChromeTrace(out);
+  }
+  if (!out) {
+    QMessageBox::critical(this, tr("Failed to Save Trace"), tr("pView couldn't write the trace to %1.").arg(fileName));
+  }
+}
+
+void DiagnosticsPageWidget::handleDataFileChanged() {
+  if (dataFileManager.has()) {
+    dataFileManager->setProfiler(profiler);
+  }
+  refresh();
+}
+
+void DiagnosticsPageWidget::refresh() {
+  auto spans = pv::trace::spanCount();
+  traceLabel->setText(pv::trace::enabled() ? tr("Recording, %1 spans").arg(static_cast<qulonglong>(spans))
+                                           : tr("%1 spans recorded").arg(static_cast<qulonglong>(spans)));
+  saveTraceButton->setEnabled(spans > 0);
+
+  if (profiler == nullptr) {
+    summaryLabel->setText(tr("Not profiling."));
+    table->setRowCount(0);
+    return;
+  }
+
+  auto profile = profiler->profile();
+  std::uint64_t executions = 0;
+  std::uint64_t totalTime = 0;
+
+  table->setSortingEnabled(false); // Otherwise rows move while they are being filled
+  table->setRowCount(static_cast<int>(profile.size()));
+  for (int row = 0; row < static_cast<int>(profile.size()); ++row) {
+    const auto& statement = profile[static_cast<std::size_t>(row)];
+    executions += statement.executions;
+    totalTime += statement.totalTime;
+
+    table->setItem(row, executionsColumn, numberItem(static_cast<qulonglong>(statement.executions)));
+    table->setItem(row, rowsColumn, numberItem(static_cast<qulonglong>(statement.rows)));
+    table->setItem(row, totalTimeColumn, numberItem(milliseconds(statement.totalTime)));
+    table->setItem(row, medianTimeColumn, numberItem(microseconds(statement.medianTime)));
+    table->setItem(row, p90TimeColumn, numberItem(microseconds(statement.p90Time)));
+    table->setItem(row, p99TimeColumn, numberItem(microseconds(statement.p99Time)));
+    table->setItem(row, maxTimeColumn, numberItem(microseconds(statement.maxTime)));
+    auto* sqlItem = new QTableWidgetItem(QString::fromStdString(statement.sql));
+    sqlItem->setToolTip(sqlItem->text());
+    table->setItem(row, sqlColumn, sqlItem);
+  }
+  table->setSortingEnabled(true);
+
+  summaryLabel->setText(tr("%1 queries, %2 ms in total")
+                            .arg(static_cast<qulonglong>(executions))
+                            .arg(milliseconds(totalTime).toDouble()));
+}
+
+void DiagnosticsPageWidget::showEvent(QShowEvent* event) {
+  PageWidget::showEvent(event);
+  refresh();
+  refreshTimer.start();
+}
+
+void DiagnosticsPageWidget::hideEvent(QHideEvent* event) {
+  refreshTimer.stop();
+  PageWidget::hideEvent(event);
+}
+
+} // namespace pvui
@@ -0,0 +1,54 @@
+#ifndef PVUI_DIAGNOSTICSPAGE_H
+#define PVUI_DIAGNOSTICSPAGE_H
+
+#include "DataFileManager.h"
+#include "Page.h"
+#include "pv/QueryProfiler.h"
+#include <QCheckBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QTimer>
+#include <memory>
+
+namespace pvui {
+
+/// \brief A page for developers, which shows how often each SQL query runs and how long it takes.
+///
+/// It isn't in the navigation tree; it is opened with Ctrl+Shift+D. Profiling is off until it is turned on here,
+/// and it covers the background connections used by reports as well. To find what a UI action costs, reset the
+/// profile, perform the action, then look at the counts.
+///
+/// It can also record a trace of the UI and report code (see \c pv::trace) and save it for a trace viewer, to show
+/// where the time goes when, for example, switching pages is slow.
+class DiagnosticsPageWidget : public PageWidget {
+  Q_OBJECT
+private:
+  DataFileManager& dataFileManager;
+  std::shared_ptr<pv::QueryProfiler> profiler = nullptr;
+
+  QCheckBox* profileCheckBox = new QCheckBox(tr("&Profile Queries"));
+  QPushButton* resetButton = new QPushButton(tr("&Reset"));
+  QCheckBox* traceCheckBox = new QCheckBox(tr("Record &Trace"));
+  QPushButton* saveTraceButton = new QPushButton(tr("&Save Trace..."));
+  QLabel* traceLabel = new QLabel;
+  QLabel* summaryLabel = new QLabel;
+  QTableWidget* table = new QTableWidget;
+  QTimer refreshTimer;
+
+  void setProfiling(bool profiling);
+  void setTracing(bool tracing);
+  void saveTrace();
+private slots:
+  void handleDataFileChanged();
+  void refresh();
+protected:
+  void showEvent(QShowEvent* event) override;
+  void hideEvent(QHideEvent* event) override;
+public:
+  explicit DiagnosticsPageWidget(DataFileManager& dataFileManager, QWidget* parent = nullptr);
+};
+
+} // namespace pvui
+
+#endif // PVUI_DIAGNOSTICSPAGE_H
@@ -23,6 +23,13 @@ QString group(pv::DataFile& dataFile, pv::i64 security, GroupBy groupBy) {
   }
 }
 
+QString group(const pv::algorithms::SecuritySnapshot& security, GroupBy groupBy) {
+  switch (groupBy) {
+    case GroupBy::AssetClass: return QString::fromStdString(security.assetClass);
+    case GroupBy::Sector: return QString::fromStdString(security.sector);
+    case GroupBy::Symbol: return QString::fromStdString(security.symbol);
+    default: return QString();
+  }
 }
 
-
+}
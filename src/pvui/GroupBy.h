@@ -3,6 +3,7 @@
 #include <QObject>
 #include <QString>
 #include "pv/DataFile.h"
+#include "pv/Snapshot.h"
 
 namespace pvui {
 enum class GroupBy {
@@ -11,6 +12,7 @@ enum class GroupBy {
 GroupBy currentGroupBy();
 void setGroupBy(GroupBy groupBy);
 QString group(pv::DataFile& dataFile, pv::i64 security, GroupBy groupBy);
+QString group(const pv::algorithms::SecuritySnapshot& security, GroupBy groupBy);
 }
 #endif // PVUI_GROUPBY_H
 
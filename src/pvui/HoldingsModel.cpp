@@ -1,13 +1,12 @@
 #include "HoldingsModel.h"
 #include "DateUtils.h"
 #include "ModelUtils.h"
-#include "pv/Algorithms.h"
 #include "pv/Integer64.h"
-#include "pv/Security.h"
+#include "pv/Snapshot.h"
+#include "pv/Trace.h"
 #include <QSize>
 #include <optional>
 #include <qnamespace.h>
-#include <sqlite3.h>
 #include <utility>
 
 constexpr int symbolColumn = 0;
@@ -30,8 +29,14 @@ namespace pvui {
 namespace models {
 
 HoldingsModel::HoldingsModel(pv::DataFile& dataFile, QObject* parent)
-    : QAbstractTableModel(parent), dataFile_(dataFile) {
-  changedConnection = dataFile.onChanged([&]() { emit reset(); });
+    : QAbstractTableModel(parent), dataFile_(dataFile), ledger(dataFile) {
+  changeSetConnection = dataFile.onChangeSet([&](const pv::ChangeSet& changes) {
+    // Renaming an account doesn't affect any holdings
+    if (!changes.transactions.empty() || !changes.securities.empty() || !changes.securityPrices.empty()) {
+      emit reset();
+    }
+  });
+  resetConnection = dataFile.onRollback([&]() { emit reset(); });
 
   QObject::connect(this, &HoldingsModel::reset, this, [&] {
     beginResetModel();
@@ -42,22 +47,23 @@ HoldingsModel::HoldingsModel(pv::DataFile& dataFile, QObject* parent)
 }
 
 void HoldingsModel::repopulate() {
+  pv::trace::Span span("HoldingsModel::repopulate", "ui");
   beginResetModel();
   holdings.clear();
 
-  auto stmt = dataFile_.query("SELECT Id FROM Securities");
-  while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
-    pv::i64 security = sqlite3_column_int64(stmt.get(), 0);
+  // Every holding is calculated at once from the in-memory ledger, rather than with a dozen queries per security
+  auto snapshot = pv::algorithms::snapshot(dataFile_, ledger, currentEpochDate());
+  holdings.reserve(snapshot.securities.size());
+  for (const auto& security : snapshot.securities) {
     Holding h;
-    pv::i64 today = currentEpochDate();
-    h.security = security;
-    h.symbol = QString::fromStdString(pv::security::symbol(dataFile_, security));
-    h.name = QString::fromStdString(pv::security::name(dataFile_, security));
-    h.sharesHeld = pv::algorithms::sharesHeld(dataFile_, security, today);
-    h.recentQuote = pv::algorithms::sharePrice(dataFile_, security, today);
-    h.avgBuyPrice = pv::algorithms::averageBuyPrice(dataFile_, security, today);
-    h.avgSellPrice = pv::algorithms::averageSellPrice(dataFile_, security, today);
-    h.unrealizedGain = pv::algorithms::unrealizedCashGained(dataFile_, security, today);
+    h.security = security.security;
+    h.symbol = QString::fromStdString(security.symbol);
+    h.name = QString::fromStdString(security.name);
+    h.sharesHeld = security.sharesHeld;
+    h.recentQuote = security.sharePrice;
+    h.avgBuyPrice = security.averageBuyPrice;
+    h.avgSellPrice = security.averageSellPrice;
+    h.unrealizedGain = security.unrealizedCashGained;
     if (!h.unrealizedGain.has_value() || !h.avgBuyPrice.has_value()) {
       h.unrealizedGainPercentage = std::nullopt;
     } else {
@@ -68,12 +74,12 @@ void HoldingsModel::repopulate() {
         h.unrealizedGainPercentage = (h.unrealizedGain.value() * 100) / second;
       }
     }
-    h.realizedGain = pv::algorithms::cashGained(dataFile_, security, today);
-    h.dividendIncome = pv::algorithms::dividendIncome(dataFile_, security, today);
-    h.interestIncome = pv::algorithms::interestIncome(dataFile_, security, today);
-    h.costBasis = pv::algorithms::costBasis(dataFile_, security, today);
-    h.totalIncome = pv::algorithms::totalIncome(dataFile_, security, today);
-    h.marketValue = pv::algorithms::marketValue(dataFile_, security, today);
+    h.realizedGain = security.cashGained;
+    h.dividendIncome = security.dividendIncome;
+    h.interestIncome = security.interestIncome;
+    h.costBasis = security.costBasis;
+    h.totalIncome = security.totalIncome;
+    h.marketValue = security.marketValue;
 
     holdings.push_back(std::move(h));
   }
@@ -3,6 +3,7 @@
 
 #include "pv/DataFile.h"
 #include "pv/Integer64.h"
+#include "pv/Ledger.h"
 #include "pv/Signals.h"
 #include <QAbstractTableModel>
 #include <qabstractitemmodel.h>
@@ -18,6 +19,7 @@ private:
   bool needsRepopulating = true;
 
   pv::DataFile& dataFile_;
+  pv::Ledger ledger;
 
   struct Holding {
     pv::i64 security;
@@ -40,7 +42,7 @@ private:
   std::vector<Holding> holdings;
 
   // Connections
-  pv::ScopedConnection changedConnection;
+  pv::ScopedConnection changeSetConnection;
   pv::ScopedConnection resetConnection;
 
   void repopulate();
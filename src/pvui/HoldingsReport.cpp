@@ -1,10 +1,9 @@
 #include "HoldingsReport.h"
 #include "FormatUtils.h"
-#include "pv/Algorithms.h"
 #include "DateUtils.h"
-#include <sqlite3.h>
 #include "pv/Integer64.h"
-#include "pv/Security.h"
+#include "pv/Snapshot.h"
+#include "pv/Trace.h"
 #include "pvui/DataFileManager.h"
 #include "pvui/ModelUtils.h"
 #include <QApplication>
@@ -60,6 +59,7 @@ HoldingsReport::HoldingsReport(DataFileManager& manager, QWidget* parent) : Repo
 }
 
 void HoldingsReport::reload() noexcept {
+  pv::trace::Span span("HoldingsReport::reload", "ui");
   populateSummary();
 
   if (!settings.contains(QString::fromUtf8(headerStateKey))) {
@@ -78,21 +78,22 @@ void HoldingsReport::populateSummary() {
   static QString summaryMarketValueLabelText = QString::fromUtf8("<strong>%1</strong> %2").arg(tr("Market Value:"));
   static QString summaryIncomeLabelText = QString::fromUtf8("<strong>%1</strong> %2").arg(tr("Income (All Time):"));
 
-  pv::i64 costBasis = 0;
-  pv::i64 marketValue = 0;
-  pv::i64 income = 0;
-
-  auto query = dataFileManager->query("SELECT Id FROM Securities");
-  while (sqlite3_step(&*query) == SQLITE_ROW) {
-    pv::i64 security = sqlite3_column_int64(&*query, 0);
-    costBasis += pv::algorithms::costBasis(*dataFileManager, security, currentEpochDate());
-    marketValue += pv::algorithms::marketValue(*dataFileManager, security, currentEpochDate()).value_or(0);
-    income += pv::algorithms::totalIncome(*dataFileManager, security, currentEpochDate());
-  }
-
-  summaryCostBasisLabel->setText(summaryCostBasisLabelText.arg(util::formatMoney(costBasis)));
-  summaryMarketValueLabel->setText(summaryMarketValueLabelText.arg(util::formatMoney(marketValue)));
-  summaryIncomeLabel->setText(summaryIncomeLabelText.arg(util::formatMoney(income)));
+  executor().run<Summary>(
+      [date = currentEpochDate()](ReportExecutor::Task& task) {
+        Summary summary;
+        auto snapshot = pv::algorithms::snapshot(task.dataFile(), date);
+        for (const auto& security : snapshot.securities) {
+          summary.costBasis += security.costBasis;
+          summary.marketValue += security.marketValue.value_or(0);
+          summary.income += security.totalIncome;
+        }
+        return summary;
+      },
+      [this](Summary summary) {
+        summaryCostBasisLabel->setText(summaryCostBasisLabelText.arg(util::formatMoney(summary.costBasis)));
+        summaryMarketValueLabel->setText(summaryMarketValueLabelText.arg(util::formatMoney(summary.marketValue)));
+        summaryIncomeLabel->setText(summaryIncomeLabelText.arg(util::formatMoney(summary.income)));
+      });
 }
 
 } // namespace reports
@@ -3,6 +3,7 @@
 
 #include "HoldingsModel.h"
 #include "Report.h"
+#include "pv/Integer64.h"
 #include <QGridLayout>
 #include <QGroupBox>
 #include <QLabel>
@@ -30,6 +31,13 @@ private:
   QLabel* summaryMarketValueLabel = new QLabel();
   QLabel* summaryIncomeLabel = new QLabel();
 
+  /// \brief The totals shown in the summary, which are calculated on a background thread.
+  struct Summary {
+    pv::i64 costBasis = 0;
+    pv::i64 marketValue = 0;
+    pv::i64 income = 0;
+  };
+
   void populateSummary();
 
 private slots:
@@ -3,6 +3,7 @@
 #include "ThemeManager.h"
 #include "Version.h"
 #include "pv/DataFile.h"
+#include "pv/Trace.h"
 #include <QAction>
 #include <QApplication>
 #include <QCoreApplication>
@@ -15,6 +16,7 @@
 #include <QMessageBox>
 #include <QMimeData>
 #include <QOperatingSystemVersion>
+#include <QSessionManager>
 #include <QShortcut>
 #include <QStandardPaths>
 #include <QStatusBar>
@@ -89,6 +91,15 @@ pvui::MainWindow::MainWindow(mac::WindowList& windowList, QWidget* parent)
 
   setAcceptDrops(true);
 
+  // Quitting doesn't close (and so destroy) the windows, and logging out may not quit cleanly at all
+  QObject::connect(qApp, &QCoreApplication::aboutToQuit, this, [this] { autosaver.flush(); });
+  QObject::connect(qApp, &QGuiApplication::commitDataRequest, this, [this](QSessionManager&) { autosaver.flush(); });
+  QObject::connect(&settingsDialog, &dialogs::SettingsDialog::settingChanged, this, [this](const QString& key) {
+    if (key == Autosaver::durabilityWindowKey) {
+      autosaver.reloadSettings();
+    }
+  });
+
   // Restore state
   if (settings.contains("State")) {
     restoreState(settings.value("State").toByteArray());
@@ -150,6 +161,7 @@ void pvui::MainWindow::dropEvent(QDropEvent* event) {
 }
 
 void pvui::MainWindow::pageChanged() {
+  pv::trace::Span span("MainWindow::pageChanged", "ui");
   // clear the actions
   QList actions(navigationWidget->actions());
   for (const auto& action : actions) {
@@ -187,6 +199,7 @@ void pvui::MainWindow::pageChanged() {
 }
 
 void pvui::MainWindow::closeEvent(QCloseEvent* event) {
+  autosaver.flush();
   settings.setValue("State", saveState());
   settings.setValue("Geometry", saveGeometry());
   settings.setValue("SplitterState", splitter.saveState());
@@ -296,7 +309,7 @@ void pvui::MainWindow::fileNew() {
   }
 
   try {
-    dataFileManager.setDataFile(pv::DataFile(file));
+    dataFileManager.setDataFile(pv::DataFile(file, -1, dataFileManager.dataFileOptions()));
     settings.setValue(QStringLiteral("LastOpenedFile"), fileQStr);
   } catch (...) {
     QMessageBox::critical(this, tr("Failed to Create File"),
@@ -321,9 +334,9 @@ void pvui::MainWindow::fileOpen() {
 }
 
 void pvui::MainWindow::fileOpen_(const std::string& location) {
-  dataFileManager.setDataFile(
-      pv::DataFile(location, SQLITE_OPEN_READWRITE)); // unset SQLITE_OPEN_CREATE, because we don't want to create a
-                                                      // new file if it doesn't already exist
+  dataFileManager.setDataFile(pv::DataFile(
+      location, SQLITE_OPEN_READWRITE, // unset SQLITE_OPEN_CREATE, because we don't want to create a new file if it
+      dataFileManager.dataFileOptions())); // doesn't already exist
   settings.setValue(QStringLiteral("LastOpenedFile"), QString::fromStdString(location));
   contentLayout->setCurrentWidget(noPageOpen);
   updateWindowFileLocation();
@@ -396,6 +409,7 @@ void pvui::MainWindow::helpAbout() {
 void pvui::MainWindow::setupNavigation() {
   contentLayout->addWidget(accountPage);
   contentLayout->addWidget(securityPage);
+  contentLayout->addWidget(diagnosticsPage);
   contentLayout->addWidget(noPageOpen);
 
   for (auto* report : reports) {
@@ -421,6 +435,14 @@ void pvui::MainWindow::setupNavigation() {
   accountsDeleteAction.setShortcut(QKeySequence::Delete);
   accountsDeleteAction.setShortcutContext(Qt::WidgetShortcut);
   navigationWidget->setContextMenuPolicy(Qt::ActionsContextMenu);
+
+  // The diagnostics page is for developers, so it is only reachable with a shortcut
+  auto* diagnosticsShortcut =
+      new QShortcut(QKeySequence(QKeyCombination(Qt::ControlModifier | Qt::ShiftModifier, Qt::Key_D)), this);
+  QObject::connect(diagnosticsShortcut, &QShortcut::activated, this, [this] {
+    navigationWidget->selectionModel()->clearCurrentIndex();
+    contentLayout->setCurrentWidget(diagnosticsPage);
+  });
 }
 
 bool pvui::MainWindow::nativeEvent(const QByteArray& eventType, void* message, qintptr* result) {
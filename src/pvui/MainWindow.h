@@ -17,7 +17,10 @@
 #include <QMenu>
 #include "SettingsDialog.h"
 #include "AccountPage.h"
+#include "Autosaver.h"
+#include "DailyValuationsUpdater.h"
 #include "DataFileManager.h"
+#include "DiagnosticsPage.h"
 #include "NavigationModel.h"
 #include "SecurityPage.h"
 #include "StandardReportFactory.h"
@@ -35,6 +38,8 @@ private:
 
   QSettings settings;
   DataFileManager dataFileManager;
+  Autosaver autosaver = Autosaver(dataFileManager);
+  DailyValuationsUpdater dailyValuationsUpdater = DailyValuationsUpdater(dataFileManager);
   QTreeView* navigationWidget = new QTreeView;
   QSplitter splitter;
 
@@ -49,6 +54,7 @@ private:
   QStackedLayout* contentLayout = new QStackedLayout(content);
   AccountPageWidget* accountPage = new AccountPageWidget(dataFileManager);
   SecurityPageWidget* securityPage = new SecurityPageWidget(dataFileManager);
+  DiagnosticsPageWidget* diagnosticsPage = new DiagnosticsPageWidget(dataFileManager);
   QProgressBar securityPriceDownloadProgressBar;
 
   dialogs::SettingsDialog settingsDialog;
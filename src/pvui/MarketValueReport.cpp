@@ -1,10 +1,12 @@
 #include "MarketValueReport.h"
 #include <QwtDateScaleEngine>
 #include "DateUtils.h"
-#include "pv/Algorithms.h"
 #include "pv/Integer64.h"
 #include "GroupBy.h"
+#include "pv/DailyValuations.h"
 #include "pv/Security.h"
+#include "pv/TimeSeries.h"
+#include "pv/Trace.h"
 #include <QColor>
 #include <QDate>
 #include <QDateTime>
@@ -22,7 +24,10 @@
 #include <QwtText>
 #include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <map>
 #include <sqlite3.h>
+#include <utility>
 #include <vector>
 
 namespace pvui {
@@ -109,65 +114,86 @@ void MarketValueReport::setupGroupBySelection() {
                    });
 }
 
-void MarketValueReport::drawPlot() noexcept {
-  assert(dataFileManager.has());
-  // todo improve efficiency of this function
-  std::map<QString, QMap<QDate, double>> values;
-  //        ^ group       ^ date   ^ market value
-  // Populate cashBalances and values
-
-  { // Begin new scope because we declare variables here that are not needed later
-    QVector<double> costBasisXData;
-    QVector<double> costBasisYData;
+MarketValueReport::PlotData MarketValueReport::calculatePlot(ReportExecutor::Task& task, std::vector<pv::i64> dates,
+                                                             GroupBy groupBy) {
+  pv::trace::Span span("MarketValueReport::calculatePlot", "report");
+  constexpr int steps = 3;
+  auto& dataFile = task.dataFile();
+  PlotData data;
+
+  task.setProgress(0, steps);
+  std::vector<pv::i64> securities;
+  auto* securityListStmt = dataFile.cachedQuery("SELECT Id FROM Securities");
+  while (sqlite3_step(securityListStmt) == SQLITE_ROW) {
+    securities.push_back(sqlite3_column_int64(securityListStmt, 0));
+  }
 
-    QVector<double> marketValueXData;
-    QVector<double> marketValueYData;
+  std::vector<pv::i64> accounts;
+  auto* accountListStmt = dataFile.cachedQuery("SELECT Id FROM Accounts");
+  while (sqlite3_step(accountListStmt) == SQLITE_ROW) {
+    accounts.push_back(sqlite3_column_int64(accountListStmt, 0));
+  }
+  if (task.isCanceled()) {
+    return data;
+  }
 
-    auto* securityListStmt = dataFileManager->cachedQuery("SELECT Id FROM Securities");
-    std::vector<pv::i64> securities;
+  // Reads the stored daily valuations if they are up to date, otherwise calculates every series in one pass over the
+  // ledger
+  task.setProgress(1, steps);
+  auto stored = pv::algorithms::storedTimeSeries(dataFile, securities, dates);
+  auto series = stored.has_value() ? std::move(*stored)
+                                   : pv::algorithms::timeSeries(dataFile, securities, accounts, std::move(dates));
+  const std::size_t dateCount = series.dates.size();
+  if (task.isCanceled()) {
+    return data;
+  }
 
-    while (sqlite3_step(securityListStmt) == SQLITE_ROW) {
-      securities.push_back(sqlite3_column_int64(securityListStmt, 0));
+  task.setProgress(2, steps);
+  data.costBasis.assign(dateCount, 0);
+  data.marketValue.assign(dateCount, 0);
+  for (const auto& securitySeries : series.securities) {
+    auto& groupValues = data.groups[pvui::group(dataFile, securitySeries.security, groupBy)];
+    groupValues.resize(dateCount, 0);
+
+    for (std::size_t i = 0; i < dateCount; ++i) {
+      groupValues[i] += securitySeries.marketValue[i];
+      data.marketValue[i] += securitySeries.marketValue[i];
+      data.costBasis[i] += securitySeries.costBasis[i];
     }
+  }
+  data.dates = std::move(series.dates);
+  data.cashBalance = std::move(series.cashBalance);
 
-    for (QDate date = start(), endDate = end(); date <= endDate; date = date.addDays(interval)) {
-      pv::i64 costBasis = 0;
-      pv::i64 marketValue = 0;
-      pv::i64 epochDay = toEpochDate(date);
-      for (const auto security : securities) {
-        QString group = pvui::group(*dataFileManager, security, currentGroupBy());
-
-        pv::i64 marketValueForSecurity = pv::algorithms::marketValue(*dataFileManager, security, epochDay).value_or(0);
-        marketValue += marketValueForSecurity;
-
-        auto iter = values[group].find(date); // Automatically create values[sector] if needed
-        if (iter == values[group].end()) {
-          values[group][date] = marketValueForSecurity;
-        } else {
-          // Add to existing value
-          iter.value() += marketValueForSecurity;
-        }
-
-        costBasis += pv::algorithms::costBasis(*dataFileManager, security, epochDay);
-      }
+  task.setProgress(steps, steps);
+  return data;
+}
 
-      double qwtDate = QwtDate::toDouble(QDateTime(date, QTime(0, 0, 0)));
+void MarketValueReport::drawPlot(const PlotData& data) noexcept {
+  pv::trace::Span span("MarketValueReport::drawPlot", "ui");
+  const std::size_t dateCount = data.dates.size();
+  QVector<double> qwtDates;
+  qwtDates.reserve(static_cast<int>(dateCount));
+  for (auto date : data.dates) {
+    qwtDates += QwtDate::toDouble(QDateTime(toQDate(date), QTime(0, 0, 0)));
+  }
 
-      costBasisXData += qwtDate;
-      costBasisYData += costBasis / 100.;
+  { // Begin new scope because we declare variables here that are not needed later
+    QVector<double> costBasisYData;
+    QVector<double> marketValueYData;
 
-      marketValueXData += qwtDate;
-      marketValueYData += marketValue / 100.;
+    for (std::size_t i = 0; i < dateCount; ++i) {
+      costBasisYData += data.costBasis[i] / 100.;
+      marketValueYData += data.marketValue[i] / 100.;
     }
 
-    costBasisCurve.setSamples(costBasisXData, costBasisYData);
-    marketValueCurve.setSamples(marketValueXData, marketValueYData);
+    costBasisCurve.setSamples(qwtDates, costBasisYData);
+    marketValueCurve.setSamples(qwtDates, marketValueYData);
   }
 
   QList<QwtText> titles;
   QVector<QwtSetSample> samples;
 
-  for (const auto& pair : values) {
+  for (const auto& pair : data.groups) {
     titles += QwtText(pair.first);
   }
 
@@ -175,25 +201,16 @@ void MarketValueReport::drawPlot() noexcept {
 
   double largestLabelSize = 0;
   QFont xAxisFont = plot->axisFont(QwtAxis::XBottom);
-  for (auto date = start(); date <= end(); date = date.addDays(interval)) {
-    auto pvDate = toEpochDate(date); 
+  for (std::size_t i = 0; i < dateCount; ++i) {
     QVector<double> samplesForDate;
     samplesForDate.reserve(titles.size() + 1);
-    for (const auto& pair : values) {
-      assert(pair.second.contains(date));
-      samplesForDate += pair.second.value(date) / 100.; 
-    }
-
-    pv::i64 cashBalance = 0;
-
-    auto accountQuery = dataFileManager->query("SELECT Id FROM Accounts");
-    while (sqlite3_step(accountQuery.get()) == SQLITE_ROW) {
-      cashBalance += pv::algorithms::cashBalance(*dataFileManager, sqlite3_column_int64(accountQuery.get(), 0), pvDate);
+    for (const auto& pair : data.groups) {
+      samplesForDate += pair.second[i] / 100.;
     }
 
-    samplesForDate += cashBalance / 100.;
+    samplesForDate += data.cashBalance[i] / 100.;
 
-    auto qwtDate = QwtDate::toDouble(QDateTime(date, QTime(0, 0, 0)));
+    auto qwtDate = qwtDates[static_cast<int>(i)];
     samples += QwtSetSample(qwtDate, samplesForDate);
 
     // Ensure the spacing is large enough to fit labels
@@ -204,8 +221,8 @@ void MarketValueReport::drawPlot() noexcept {
   }
   plot->axisScaleDraw(QwtAxis::XBottom)->setSpacing(largestLabelSize);
 
-  for (std::size_t i = 0; i < values.size() + 1 + 1;
-       i++) { // values.size + 1 because there is also the cash balance series
+  for (std::size_t i = 0; i < data.groups.size() + 1 + 1;
+       i++) { // groups.size + 1 because there is also the cash balance series
 
     auto* symbol = new QwtColumnSymbol(QwtColumnSymbol::Box);
     symbol->setFrameStyle(QwtColumnSymbol::NoFrame);
@@ -235,23 +252,38 @@ QwtScaleDiv MarketValueReport::createScaleDiv() const noexcept {
   scaleDiv.setTicks(QwtScaleDiv::MajorTick, ticks);
   return scaleDiv;
 }
+
 void MarketValueReport::reload() noexcept {
+  pv::trace::Span span("MarketValueReport::reload", "ui");
   if (currentGroupBy() != static_cast<GroupBy>(groupBySelector->currentData().toInt())) {
     groupBySelector->setCurrentIndex(groupBySelector->findData(static_cast<int>(pvui::currentGroupBy())));
   }
-  drawPlot();
-
-  plot->setAxisScaleDiv(QwtAxis::XBottom, createScaleDiv());
 
-  // Workaround, ensure that the bar size is large enough for single-sample charts
-  if (chart.data()->size() == 1) {
-    chart.setLayoutHint(200);
-  } else {
-    chart.setLayoutHint(0);
+  std::vector<pv::i64> dates;
+  for (QDate date = start(), endDate = end(); date <= endDate; date = date.addDays(interval)) {
+    dates.push_back(toEpochDate(date));
   }
 
-  plot->insertLegend(new QwtLegend);
-  plot->replot();
+  executor().run<PlotData>(
+      [dates = std::move(dates), groupBy = currentGroupBy()](ReportExecutor::Task& task) {
+        return calculatePlot(task, dates, groupBy);
+      },
+      [this](PlotData data) {
+        drawPlot(data);
+
+        plot->setAxisScaleDiv(QwtAxis::XBottom, createScaleDiv());
+
+        // Workaround, ensure that the bar size is large enough for single-sample charts
+        if (chart.data()->size() == 1) {
+          chart.setLayoutHint(200);
+        } else {
+          chart.setLayoutHint(0);
+        }
+
+        plot->insertLegend(new QwtLegend);
+        pv::trace::Span replotSpan("QwtPlot::replot", "ui");
+        plot->replot();
+      });
 }
 
 } // namespace reports
@@ -1,7 +1,10 @@
 #ifndef PVUI_REPORTS_MARKETVALUEREPORT_H
 #define PVUI_REPORTS_MARKETVALUEREPORT_H
 
+#include "GroupBy.h"
 #include "Report.h"
+#include "ReportExecutor.h"
+#include "pv/Integer64.h"
 #include <QComboBox>
 #include <QDate>
 #include <QHBoxLayout>
@@ -12,7 +15,9 @@
 #include <QwtPlotMultiBarChart>
 #include <QwtScaleDiv>
 #include <functional>
+#include <map>
 #include <memory>
+#include <vector>
 #include <QSettings>
 
 namespace pvui {
@@ -35,7 +40,18 @@ private:
 
   QwtScaleDiv* div;
 
-  void drawPlot() noexcept;
+  /// \brief The values drawn by drawPlot(), which are calculated on a background thread.
+  struct PlotData {
+    std::vector<pv::i64> dates;
+    std::vector<pv::i64> costBasis;
+    std::vector<pv::i64> marketValue;
+    std::vector<pv::i64> cashBalance;
+    std::map<QString, std::vector<pv::i64>> groups;
+    //       ^ group  ^ market value at each date
+  };
+
+  static PlotData calculatePlot(ReportExecutor::Task& task, std::vector<pv::i64> dates, GroupBy groupBy);
+  void drawPlot(const PlotData& data) noexcept;
 
   QwtScaleDiv createScaleDiv() const noexcept;
 public:
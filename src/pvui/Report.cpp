@@ -5,6 +5,57 @@
 #include <QwtPlotLayout>
 #include <array>
 #include <QwtScaleWidget>
+#include <QTimer>
+#include <QHBoxLayout>
+
+void pvui::Report::handleDataFileChanged() {
+  executor_->cancel(); // It was computing from the previous data file
+  if (dataFileManager.has()) {
+    changeSetConnection = dataFileManager->onChangeSet([this](const pv::ChangeSet&) { queueReload(); });
+    rollbackConnection = dataFileManager->onRollback([this] { queueReload(); });
+  } else {
+    changeSetConnection.disconnect();
+    rollbackConnection.disconnect();
+  }
+}
+
+void pvui::Report::setupProgress() {
+  auto* progressLayout = new QHBoxLayout;
+  progressLayout->addWidget(progressBar, 1);
+  progressLayout->addWidget(cancelButton);
+  layout()->addLayout(progressLayout);
+
+  progressBar->setRange(0, 0); // Busy indicator until the computation reports its progress
+  progressBar->setTextVisible(false);
+  progressBar->hide();
+  cancelButton->setText(tr("Cancel"));
+  cancelButton->hide();
+
+  QObject::connect(cancelButton, &QToolButton::clicked, executor_, &ReportExecutor::cancel);
+  QObject::connect(executor_, &ReportExecutor::progressChanged, this, [this](int value, int maximum) {
+    progressBar->setRange(0, maximum);
+    progressBar->setValue(value);
+  });
+  QObject::connect(executor_, &ReportExecutor::runningChanged, this, [this](bool running) {
+    progressBar->setRange(0, 0);
+    progressBar->setVisible(running);
+    cancelButton->setVisible(running);
+  });
+}
+
+void pvui::Report::queueReload() {
+  if (reloadQueued) {
+    return;
+  }
+  reloadQueued = true;
+  QTimer::singleShot(0, this, [this] {
+    reloadQueued = false;
+    // Hidden reports are reloaded by MainWindow when they are shown
+    if (isVisible() && dataFileManager.has()) {
+      reload();
+    }
+  });
+}
 
 QwtPlot* pvui::Report::createPlot(QWidget* parent) noexcept {
   QwtPlot* plot = new QwtPlot(parent);
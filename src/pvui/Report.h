@@ -3,8 +3,12 @@
 
 #include "DataFileManager.h"
 #include "Page.h"
+#include "ReportExecutor.h"
+#include "pv/Signals.h"
 #include <QList>
 #include <QColor>
+#include <QProgressBar>
+#include <QToolButton>
 #include <QwtPlot>
 #include <cstddef>
 
@@ -14,14 +18,36 @@ namespace pvui {
 /// you have a null \c DataFileManager.
 class Report : public PageWidget {
   Q_OBJECT
+private:
+  pv::ScopedConnection changeSetConnection;
+  pv::ScopedConnection rollbackConnection;
+  bool reloadQueued = false;
+
+  ReportExecutor* executor_;
+  QProgressBar* progressBar = new QProgressBar;
+  QToolButton* cancelButton = new QToolButton;
+
+  void handleDataFileChanged();
+  void setupProgress();
+
+  /// \brief Reloads the report (if it is visible) once control returns to the event loop, so that
+  /// several commits in a row only cause one reload.
+  void queueReload();
 protected:
   DataFileManager& dataFileManager;
   QString name_;
+
+  /// \brief Runs the report's computations in the background. Its progress is shown below the title.
+  ReportExecutor& executor() noexcept { return *executor_; }
 public:
   Report(QString name, DataFileManager& dataFileManager, QWidget* parent = nullptr)
-      : PageWidget(parent), dataFileManager(dataFileManager), name_(name) {
+      : PageWidget(parent), executor_(new ReportExecutor(dataFileManager, this)), dataFileManager(dataFileManager),
+        name_(name) {
     setTitle(name);
+    setupProgress();
     QObject::connect(this, &Report::nameChanged, this, &Report::setTitle);
+    QObject::connect(&dataFileManager, &DataFileManager::dataFileChanged, this, &Report::handleDataFileChanged);
+    handleDataFileChanged();
   }
 
   QString name() const noexcept { return name_; }
@@ -0,0 +1,107 @@
+#include "ReportExecutor.h"
+#include "pv/Trace.h"
+#include <QMetaObject>
+#include <Qt>
+#include <exception>
+
+namespace pvui {
+
+void ReportExecutor::Task::setProgress(int value, int maximum) {
+  QMetaObject::invokeMethod(
+      executor,
+      [task = shared_from_this(), value, maximum] {
+        if (task->executor->current == task) {
+          emit task->executor->progressChanged(value, maximum);
+        }
+      },
+      Qt::QueuedConnection);
+}
+
+ReportExecutor::ReportExecutor(DataFileManager& dataFileManager, QObject* parent)
+    : QObject(parent), dataFileManager(dataFileManager) {
+  // Canceled computations are interrupted, so there is rarely more than one to wait for
+  pool.setMaxThreadCount(1);
+}
+
+ReportExecutor::~ReportExecutor() {
+  cancel();
+  pool.waitForDone();
+}
+
+std::shared_ptr<ReportExecutor::Task> ReportExecutor::createTask() {
+  bool wasRunning = isRunning();
+  if (current != nullptr) {
+    current->canceled = true;
+    if (current->connection != nullptr) {
+      current->connection->interrupt();
+    }
+  }
+
+  std::unique_ptr<pv::DataFile> connection = nullptr;
+  try {
+    connection = std::make_unique<pv::DataFile>(dataFileManager->openReadOnlyConnection());
+  } catch (...) {
+    connection = nullptr; // Run on the main connection instead
+  }
+  pv::DataFile& dataFile = connection != nullptr ? *connection : *dataFileManager;
+  current = std::make_shared<Task>(this, std::move(connection), dataFile);
+
+  if (!wasRunning) {
+    emit runningChanged(true);
+  }
+  return current;
+}
+
+void ReportExecutor::start(const std::shared_ptr<Task>& task, std::function<bool()> work,
+                           std::function<void()> deliver) {
+  auto safeWork = [work = std::move(work)] {
+    pv::trace::Span span("ReportExecutor::compute", "report");
+    try {
+      return work();
+    } catch (...) {
+      return false;
+    }
+  };
+
+  if (task->connection == nullptr) {
+    bool succeeded = safeWork();
+    finish(task, succeeded ? deliver : nullptr);
+    return;
+  }
+
+  pool.start([this, task, safeWork = std::move(safeWork), deliver = std::move(deliver)] {
+    pv::trace::setThreadName("Reports");
+    bool succeeded = !task->isCanceled() && safeWork();
+    QMetaObject::invokeMethod(
+        this, [this, task, succeeded, deliver] { finish(task, succeeded ? deliver : nullptr); },
+        Qt::QueuedConnection);
+  });
+}
+
+void ReportExecutor::finish(const std::shared_ptr<Task>& task, const std::function<void()>& deliver) {
+  if (task != current) {
+    return; // Canceled
+  }
+  current = nullptr;
+  if (deliver && !task->isCanceled()) {
+    pv::trace::Span span("ReportExecutor::deliver", "ui");
+    deliver();
+  }
+  if (!isRunning()) { // deliver() may have started another computation
+    emit runningChanged(false);
+  }
+}
+
+void ReportExecutor::cancel() {
+  if (current == nullptr) {
+    return;
+  }
+  current->canceled = true;
+  if (current->connection != nullptr) {
+    current->connection->interrupt();
+  }
+  current = nullptr;
+  emit runningChanged(false);
+}
+
+} // namespace pvui
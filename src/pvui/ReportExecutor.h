@@ -0,0 +1,89 @@
+#ifndef PVUI_REPORTEXECUTOR_H
+#define PVUI_REPORTEXECUTOR_H
+
+#include "DataFileManager.h"
+#include "pv/DataFile.h"
+#include <QObject>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace pvui {
+
+/// \brief Runs report computations on a background thread, so that large data files don't freeze the window.
+///
+/// Each computation reads from its own read-only connection to the data file (see
+/// \c pv::DataFile::openReadOnlyConnection()), and its result is handed back on the GUI thread. Only the latest
+/// computation matters: starting one cancels the one that is running, and the result of a canceled computation is
+/// never delivered.
+///
+/// In-memory data files can't be shared between connections, so their computations run synchronously instead.
+class ReportExecutor : public QObject {
+  Q_OBJECT
+public:
+  /// \brief A single computation, which is shared between its thread and the GUI thread.
+  class Task : public std::enable_shared_from_this<Task> {
+  private:
+    friend class ReportExecutor;
+
+    ReportExecutor* executor;
+    std::unique_ptr<pv::DataFile> connection; ///< nullptr when running synchronously on the main connection
+    pv::DataFile* dataFile_;
+    std::atomic<bool> canceled{false};
+  public:
+    Task(ReportExecutor* executor, std::unique_ptr<pv::DataFile> connection, pv::DataFile& dataFile)
+        : executor(executor), connection(std::move(connection)), dataFile_(&dataFile) {}
+
+    /// \brief The data file to read from. It must not be modified.
+    pv::DataFile& dataFile() noexcept { return *dataFile_; }
+
+    /// \brief Checks if the result is no longer wanted, in which case the computation should return early.
+    bool isCanceled() const noexcept { return canceled; }
+
+    /// \brief Reports how far along the computation is. This may be called from the computation's thread.
+    void setProgress(int value, int maximum);
+  };
+private:
+  DataFileManager& dataFileManager;
+  std::shared_ptr<Task> current = nullptr;
+  QThreadPool pool;
+
+  std::shared_ptr<Task> createTask();
+  void start(const std::shared_ptr<Task>& task, std::function<bool()> work, std::function<void()> deliver);
+  void finish(const std::shared_ptr<Task>& task, const std::function<void()>& deliver);
+public:
+  explicit ReportExecutor(DataFileManager& dataFileManager, QObject* parent = nullptr);
+  ~ReportExecutor() override;
+
+  /// \brief Starts a computation, canceling the one that is running.
+  ///
+  /// \param compute called on a background thread to compute the result
+  /// \param finished called on the GUI thread with the result, unless the computation was canceled or threw
+  template <typename Result>
+  void run(std::function<Result(Task&)> compute, std::function<void(Result)> finished) {
+    auto task = createTask();
+    auto result = std::make_shared<std::optional<Result>>();
+    start(
+        task,
+        [task, result, compute = std::move(compute)] {
+          *result = compute(*task);
+          return true;
+        },
+        [result, finished = std::move(finished)] { finished(std::move(**result)); });
+  }
+
+  /// \brief Cancels the running computation, if there is one.
+  void cancel();
+
+  bool isRunning() const noexcept { return current != nullptr; }
+signals:
+  void progressChanged(int value, int maximum);
+  void runningChanged(bool running);
+};
+
+} // namespace pvui
+
+#endif // PVUI_REPORTEXECUTOR_H
@@ -4,10 +4,14 @@
 #include "SecurityModel.h"
 #include "SecurityPriceDialog.h"
 #include "SecurityUtils.h"
+#include "pv/Algorithms.h"
+#include "pv/PriceRefresh.h"
+#include "pv/QuoteCache.h"
 #include "pv/Security.h"
 #include "pvui/SecurityInsertionWidget.h"
 #include <QCheckBox>
 #include <QDateEdit>
+#include <QDateTime>
 #include <QDialog>
 #include <QDialogButtonBox>
 #include <QFormLayout>
@@ -21,6 +25,7 @@
 #include <Qt>
 #include <cassert>
 #include <optional>
+#include <utility>
 #include <qcheckbox.h>
 #include <qmessagebox.h>
 #include <qnamespace.h>
@@ -94,6 +99,18 @@ public:
   }
 };
 
+pv::PriceConflictPolicy conflictPolicy(int onConflictBehaviour) {
+  switch (static_cast<OnConflictBehaviour>(onConflictBehaviour)) {
+  case OnConflictBehaviour::SKIP:
+    return pv::PriceConflictPolicy::Ignore;
+  case OnConflictBehaviour::REPLACE:
+    return pv::PriceConflictPolicy::Replace;
+  case OnConflictBehaviour::REPLACE_IF_TODAY:
+    break;
+  }
+  return pv::PriceConflictPolicy::ReplaceFrom; // Replace today's price, which may be from before closing
+}
+
 } // namespace
 
 SecurityPageWidget::SecurityPageWidget(DataFileManager& dataFileManager, QWidget* parent)
@@ -299,35 +316,61 @@ QList<pv::i64> SecurityPageWidget::selectedSecurities() {
   return output;
 }
 
-void SecurityPageWidget::beginUpdateSecurityPrices(QDate begin, int onConflictBehaviour) {
+std::vector<pv::i64> SecurityPageWidget::securitiesToUpdate() {
+  std::vector<pv::i64> securities;
+  const auto selected = selectedSecurities();
+  if (!selected.isEmpty()) {
+    securities.assign(selected.cbegin(), selected.cend());
+  } else {
+    auto listSecuritiesQuery = dataFileManager_->query("SELECT Id From Securities");
+    while (sqlite3_step(&*listSecuritiesQuery) == SQLITE_ROW) {
+      securities.push_back(sqlite3_column_int64(&*listSecuritiesQuery, 0));
+    }
+  }
+  return securities;
+}
+
+SecurityPriceDownloader::Request SecurityPageWidget::priceRequest(const pv::PriceRefresh& refresh) {
+  // Securities that are held matter most to valuations, so they're downloaded first
+  auto held = pv::algorithms::sharesHeld(*dataFileManager_, refresh.security, currentEpochDate()) > 0;
+  return {QString::fromStdString(refresh.symbol), toQDate(refresh.from), held ? 1 : 0};
+}
+
+void SecurityPageWidget::beginUpdateSecurityPrices(std::vector<pv::PriceRefresh> refreshes, int onConflictBehaviour) {
   if (currentPriceDownload != nullptr) {
     return; // Only 1 download at a time
   }
 
-  auto endDate = QDate::currentDate().addDays(1);
+  // Prices another data file downloaded recently don't need to be downloaded again
+  if (auto* quoteCache = dataFileManager_.quoteCache(); quoteCache != nullptr) {
+    refreshes = pv::refreshFromQuoteCache(*dataFileManager_, *quoteCache, refreshes, currentEpochDate(),
+                                          QDateTime::currentSecsSinceEpoch(), conflictPolicy(onConflictBehaviour));
+  }
 
-  QList securities = selectedSecurities();
-  QStringList symbols;
+  std::vector<SecurityPriceDownloader::Request> downloads;
+  downloads.reserve(refreshes.size());
+  downloadBegins.clear();
+  for (const auto& refresh : refreshes) {
+    downloads.push_back(priceRequest(refresh));
+    downloadBegins.insert(QString::fromStdString(refresh.symbol), refresh.from);
+  }
 
-  if (!securities.isEmpty()) {
-    for (pv::i64 security : securities) {
-      symbols += QString::fromStdString(pv::security::symbol(*dataFileManager_, security));
-    }
-  } else {
-    auto listSecuritiesQuery = dataFileManager_->query("SELECT Id From Securities");
-    while (sqlite3_step(&*listSecuritiesQuery) == SQLITE_ROW) {
-      std::string symbol = pv::security::symbol(*dataFileManager_, sqlite3_column_int64(&*listSecuritiesQuery, 0));
-      symbols += QString::fromStdString(symbol);
-    }
+  if (downloads.empty()) {
+    // Everything is already up to date
+    emit securityPriceDownloadStarted(0);
+    emit securityPriceDownloadCompleted();
+    return;
   }
 
-  currentPriceDownload = priceDownloader_.download(symbols, begin, endDate, this);
+  auto endDate = QDate::currentDate().addDays(1);
+
+  currentPriceDownload = priceDownloader_.download(downloads, endDate, this);
   emit securityPriceDownloadStarted(currentPriceDownload->numberOfSecurities());
   currentPriceDownload->setParent(this);
 
   QObject::connect(currentPriceDownload, &SecurityPriceDownload::success, this,
-                   [=](const std::map<QDate, pv::i64>& data, QString symbol) {
-                     updateSecurityPrices(data, symbol, onConflictBehaviour);
+                   [=](const pv::PriceHistory& prices, QString symbol) {
+                     updateSecurityPrices(prices, symbol, onConflictBehaviour);
                    });
   QObject::connect(currentPriceDownload, &SecurityPriceDownload::error, this,
                    &SecurityPageWidget::updateSecurityPricesError);
@@ -340,23 +383,36 @@ void SecurityPageWidget::beginUpdateSecurityPrices(QDate begin, int onConflictBe
 }
 
 void SecurityPageWidget::beginBasicUpdateSecurityPrices() {
-  beginUpdateSecurityPrices(QDate::currentDate().addMonths(-3), static_cast<int>(defaultOnConflictBehaviour));
+  if (currentPriceDownload != nullptr || !dataFileManager_.has()) {
+    return;
+  }
+
+  // Only what's missing since the last download (or the last price) is downloaded, and securities downloaded in the
+  // last few minutes are skipped
+  auto refreshes = pv::planPriceRefresh(*dataFileManager_, securitiesToUpdate(), currentEpochDate(),
+                                        QDateTime::currentSecsSinceEpoch(),
+                                        toEpochDate(QDate::currentDate().addMonths(-3)));
+  beginUpdateSecurityPrices(std::move(refreshes), static_cast<int>(defaultOnConflictBehaviour));
 }
 
 void SecurityPageWidget::beginAdvancedUpdateSecurityPrices() {
   AdvancedSecurityPriceDownloadDialog* dialog = new AdvancedSecurityPriceDownloadDialog(this);
   dialog->setAttribute(Qt::WA_DeleteOnClose);
   QObject::connect(dialog, &AdvancedSecurityPriceDownloadDialog::accepted, this, [this, dialog]() {
-    if (dialog->duration() == 0) {
+    if (dialog->duration() == 0 || !dataFileManager_.has()) {
       return;
     }
-    beginUpdateSecurityPrices(QDate::currentDate().addDays(-(dialog->duration())),
-                              static_cast<int>(dialog->onConflictBehaviour()));
+    auto begin = toEpochDate(QDate::currentDate().addDays(-(dialog->duration())));
+    std::vector<pv::PriceRefresh> refreshes;
+    for (auto security : securitiesToUpdate()) {
+      refreshes.push_back({security, pv::security::symbol(*dataFileManager_, security), begin});
+    }
+    beginUpdateSecurityPrices(std::move(refreshes), static_cast<int>(dialog->onConflictBehaviour()));
   });
   dialog->open();
 }
 
-void SecurityPageWidget::updateSecurityPrices(const std::map<QDate, pv::i64>& prices, QString symbol,
+void SecurityPageWidget::updateSecurityPrices(const pv::PriceHistory& prices, QString symbol,
                                               int onConflictBehaviour) {
   if (!dataFileManager_.has()) {
     return;
@@ -364,39 +420,30 @@ void SecurityPageWidget::updateSecurityPrices(const std::map<QDate, pv::i64>& pr
 
   pv::i64 security = *pv::security::securityForSymbol(*dataFileManager_, symbol.toStdString());
 
-  bool transactionCreated = dataFileManager_->beginTransaction() == pv::ResultCode::Ok;
-  for (const auto& pair : prices) {
-    pv::i64 date = toEpochDate(pair.first);
-    if (static_cast<OnConflictBehaviour>(onConflictBehaviour) == OnConflictBehaviour::REPLACE ||
-        !pv::security::price(*dataFileManager_, security, date).has_value() ||
-        (static_cast<OnConflictBehaviour>(onConflictBehaviour) == OnConflictBehaviour::REPLACE_IF_TODAY && date == currentEpochDate())) {
-      // Only do it if no existing price on pvDate
-      dataFileManager_->setSecurityPrice(security, date, pair.second);
+  auto policy = conflictPolicy(onConflictBehaviour);
+  if (dataFileManager_->setSecurityPrices(security, prices, policy, currentEpochDate()) == pv::ResultCode::Ok) {
+    // Every download ends with today's prices
+    auto now = QDateTime::currentSecsSinceEpoch();
+    dataFileManager_->setPriceFetch(security, {currentEpochDate(), now});
+    if (auto* quoteCache = dataFileManager_.quoteCache(); quoteCache != nullptr) {
+      quoteCache->store(symbol.toStdString(), prices,
+                        {downloadBegins.value(symbol, currentEpochDate()), currentEpochDate(), now});
     }
   }
-  if (transactionCreated) {
-    dataFileManager_->commitTransaction();
-  }
 }
 
 void SecurityPageWidget::updateSecurityPricesError(QNetworkReply::NetworkError err, QString symbol) {
   assert(err != QNetworkReply::NoError && "No error occured, but still called error slot?");
 
-  if (err == QNetworkReply::ContentNotFoundError) {
+  // The download has already retried what might succeed later, so only stop everything if nothing else can succeed
+  if (err != QNetworkReply::HostNotFoundError && err != QNetworkReply::UnknownNetworkError) {
     failedSecurityDownloadsSymbols += symbol;
     return;
   }
 
   currentPriceDownload->abort();
   resetSecurityPriceUpdateDialog();
-  if (err == QNetworkReply::TimeoutError) {
-    securityPriceUpdateDialog.setText(tr("The connection timed out."));
-  } else if (err == QNetworkReply::HostNotFoundError || err == QNetworkReply::UnknownNetworkError) {
-    securityPriceUpdateDialog.setText(tr("pView could not connect to the internet."));
-  } else {
-    securityPriceUpdateDialog.setText(tr("Sorry, a network error occured."));
-    securityPriceUpdateDialog.setDetailedText(tr("Error Code: 0x%1").arg(err, 0, 16));
-  }
+  securityPriceUpdateDialog.setText(tr("pView could not connect to the internet."));
   securityPriceUpdateDialog.show();
 }
 
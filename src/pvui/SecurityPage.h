@@ -7,14 +7,18 @@
 #include "SecurityModel.h"
 #include "SecurityPriceDownloader.h"
 #include "pv/Integer64.h"
+#include "pv/PriceRefresh.h"
 #include "pv/Security.h"
 #include <QAction>
+#include <QHash>
 #include <QMessageBox>
 #include <QSettings>
 #include <QSortFilterProxyModel>
 #include <QTableView>
 #include <memory>
 #include <optional>
+#include <utility>
+#include <vector>
 #include <QList>
 
 class QToolBar;
@@ -30,6 +34,8 @@ private:
   pvui::SecurityPriceDownload* currentPriceDownload = nullptr;
 
   QStringList failedSecurityDownloadsSymbols;
+  /// \brief The first date downloaded of each symbol being downloaded, which the quote cache records.
+  QHash<QString, pv::i64> downloadBegins;
 
   QToolBar* toolBar_;
   QTableView* table = new QTableView;
@@ -52,6 +58,13 @@ private:
   void setupActions();
 
   QList<pv::i64> selectedSecurities();
+  /// \brief The selected securities, or every security if none are selected.
+  std::vector<pv::i64> securitiesToUpdate();
+
+  /// \brief The download of \c refresh, prioritized if its security is held.
+  SecurityPriceDownloader::Request priceRequest(const pv::PriceRefresh& refresh);
+  /// \brief Refreshes what it can from the quote cache, and downloads the rest.
+  void beginUpdateSecurityPrices(std::vector<pv::PriceRefresh> refreshes, int onConflictBehaviour);
 
   void setToolBarLabel(std::optional<pv::i64> security);
 private slots:
@@ -66,10 +79,9 @@ private slots:
 
   void handleSecuritySubmitted(pv::i64 security);
 
-  void beginUpdateSecurityPrices(QDate begin, int onConflictBehaviour);
   void beginBasicUpdateSecurityPrices();
   void beginAdvancedUpdateSecurityPrices();
-  void updateSecurityPrices(const std::map<QDate, pv::i64>& data, QString symbol, int onConflictBehaviour);
+  void updateSecurityPrices(const pv::PriceHistory& prices, QString symbol, int onConflictBehaviour);
   void updateSecurityPricesError(QNetworkReply::NetworkError err, QString symbol);
   void endUpdateSecurityPrices();
 signals:
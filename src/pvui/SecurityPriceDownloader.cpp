@@ -1,141 +1,339 @@
 #include "SecurityPriceDownloader.h"
+#include "DateUtils.h"
+#include "pv/BulkPriceFiles.h"
+#include "pv/Date.h"
+#include <QCoreApplication>
+#include <QDateTime>
 #include <QNetworkRequest>
-#include <cassert>
-#include <cmath>
+#include <QPointer>
+#include <QThreadPool>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <string_view>
 #include <utility>
 
 namespace pvui {
 
 namespace {
 
-QUrl generateDownloadUrl(const QString& symbol, const QDate& begin, const QDate& end) {
-  static QString base = "https://query1.finance.yahoo.com/v7/finance/download/"
-                        "%1?period1=%2&period2=%3&interval=1d&events=history&includeAdjustedClose=true";
-  auto beginSecs =
-      QDateTime(begin, QTime(23, 59, 59, 999), Qt::LocalTime).toSecsSinceEpoch(); // Inclusive on begin date
-  auto endSecs = QDateTime(end.addDays(-1), QTime(23, 59, 59, 999), Qt::LocalTime)
-                     .toSecsSinceEpoch(); // subtract 1 day because exclusive on end date
-  return base.arg(symbol, QString::number(beginSecs), QString::number(endSecs));
+/// \internal Checks if a download that failed with \c error (and \c status, if the server responded) might succeed if
+/// it was made again.
+bool retryable(QNetworkReply::NetworkError error, int status) {
+  if (status != 0) {
+    // Timed out, too many requests, and server errors, but not (for example) an unknown symbol
+    return status == 408 || status == 429 || status >= 500;
+  }
+  switch (error) {
+  case QNetworkReply::HostNotFoundError:
+  case QNetworkReply::ContentNotFoundError:
+    return false;
+  default:
+    return true;
+  }
+}
+
+/// \internal Parses a \c Retry-After header given in seconds (servers may also give a date, which is ignored).
+std::optional<pv::RequestScheduler::Clock::duration> retryAfter(const QNetworkReply& reply) {
+  bool ok = false;
+  auto seconds = reply.rawHeader("Retry-After").trimmed().toLongLong(&ok);
+  if (!ok || seconds < 0) {
+    return std::nullopt;
+  }
+  return std::chrono::seconds(seconds);
 }
 
-std::map<QDate, pv::i64> parse(QIODevice& data) {
-  constexpr int dateColumn = 0;
-  constexpr int priceColumn = 4; // Closing price
-  constexpr unsigned int skipHeaderRows = 1;
+/// \internal Returns the date of \c date in \c pv::dates' calendar (not the date used by data files, see
+/// \c toEpochDate()).
+pv::i64 calendarDate(const QDate& date) { return pv::dates::fromYearMonthDay(date.year(), date.month(), date.day()); }
 
-  std::map<QDate, pv::i64> output;
+} // namespace
+
+struct SecurityPriceDownload::Parse {
+  const QString symbol;
+  const QDate endDate;
+
+  std::mutex mutex;
+  QByteArray pending;
+  bool scheduled = false;
+  bool last = false;
 
-  QStringList currentLine;
+  /// \internal Only used by the running task.
+  pv::PriceCsvParser parser;
 
-  for (unsigned int i = 0; i < skipHeaderRows; ++i) {
-    data.readLine();
+  Parse(QString symbol, QDate endDate) : symbol(std::move(symbol)), endDate(endDate) {}
+};
+
+SecurityPriceDownload::SecurityPriceDownload(QNetworkAccessManager& manager, std::vector<Download> downloads,
+                                             pv::RequestSchedulerOptions options, QObject* parent)
+    : QObject(parent), manager(&manager), downloads(std::move(downloads)), scheduler(options) {
+  for (std::size_t i = 0; i < this->downloads.size(); ++i) {
+    scheduler.add(i, this->downloads[i].priority);
   }
+  startTimer.setSingleShot(true);
+  QObject::connect(&startTimer, &QTimer::timeout, this, &SecurityPriceDownload::startDownloads);
 
-  while (data.bytesAvailable()) {
-    // use bytesAvailable() instead of canReadLine(), because canReadLine() needs complete lines, and the last line
-    // might not be complete (end with \n)
-    currentLine = QString::fromUtf8(data.readLine()).split(',');
-    if (priceColumn >= currentLine.size()) {
-      assert(false && "Could not parse security prices, not enough commas!");
-      continue;
-    }
+  // Start from the event loop, so that the caller can connect to the signals first
+  QTimer::singleShot(0, this, &SecurityPriceDownload::startDownloads);
+}
 
-    QDate date = QDate::fromString(currentLine.at(dateColumn), Qt::ISODate); // Make sure to use ISO format (yyyy-MM-dd)
+SecurityPriceDownload::SecurityPriceDownload(std::shared_ptr<pv::PriceProvider> provider,
+                                             std::vector<Download> downloads, QObject* parent)
+    : QObject(parent), provider(std::move(provider)), downloads(std::move(downloads)) {
+  QTimer::singleShot(0, this, &SecurityPriceDownload::startProvider);
+}
 
-    if (!date.isValid()) {
-      continue;
+void SecurityPriceDownload::startProvider() {
+  if (aborted) {
+    return;
+  }
+  std::vector<pv::PriceQuery> queries;
+  queries.reserve(downloads.size());
+  for (const auto& download : downloads) {
+    queries.push_back(
+        {download.symbol.toStdString(), calendarDate(download.beginDate), calendarDate(download.endDate)});
+  }
+  parsing = numberOfSecurities();
+
+  QPointer<SecurityPriceDownload> self(this);
+  QThreadPool::globalInstance()->start([self, provider = provider, queries = std::move(queries)]() {
+    static std::mutex mutex; // Providers only answer one call at a time
+    std::vector<std::optional<pv::PriceHistory>> results;
+    {
+      std::lock_guard lock(mutex);
+      results = provider->prices(queries);
+    }
+    for (auto& prices : results) {
+      if (prices.has_value()) {
+        for (auto& date : prices->dates) {
+          date = toEpochDate(QDate(1970, 1, 1).addDays(date));
+        }
+      }
     }
 
-    bool priceOk;
-    double priceDouble = currentLine.at(priceColumn).toDouble(&priceOk);
-    if (!priceOk) {
+    QMetaObject::invokeMethod(
+        QCoreApplication::instance(),
+        [self, results = std::move(results)]() {
+          if (self != nullptr) {
+            self->provided(results);
+          }
+        },
+        Qt::QueuedConnection);
+  });
+}
+
+void SecurityPriceDownload::provided(const std::vector<std::optional<pv::PriceHistory>>& results) {
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    auto symbol = downloads[i].symbol;
+    if (results[i].has_value()) {
+      parsed(*results[i], symbol);
       continue;
     }
+    --parsing;
+    if (aborted) {
+      completeIfDone();
+    } else {
+      emit error(QNetworkReply::ContentNotFoundError, symbol); // Like a download of an unknown symbol
+      finishSecurity();
+    }
+  }
+}
 
-    pv::i64 price = static_cast<pv::i64>(std::llround(priceDouble * 100));
+void SecurityPriceDownload::startDownloads() {
+  if (aborted) {
+    return;
+  }
+  auto now = pv::RequestScheduler::Clock::now();
+  for (auto i : scheduler.start(now)) {
+    const auto& download = downloads[i];
+    auto* reply = manager->get(download.request);
+    auto parse = std::make_shared<Parse>(download.symbol, download.endDate); // Each attempt starts over
+    replies.emplace(reply, i);
+    reply->setParent(this);
 
-    output.insert({std::move(date), price});
+    QObject::connect(reply, &QIODevice::readyRead, this,
+                     [this, parse, reply]() { queue(parse, reply->readAll(), false); });
+    // finished is emitted after errorOccurred too, so failures are handled here as well
+    QObject::connect(reply, &QNetworkReply::finished, this,
+                     [this, parse, reply, i]() { handleFinished(reply, i, parse); });
   }
 
-  return output;
+  if (auto next = scheduler.nextStart(now)) {
+    auto wait = std::chrono::ceil<std::chrono::milliseconds>(*next - now);
+    startTimer.start(std::max(wait, std::chrono::milliseconds(0)));
+  }
 }
 
-} // namespace
+void SecurityPriceDownload::handleFinished(QNetworkReply* reply, std::size_t download,
+                                           const std::shared_ptr<Parse>& parse) {
+  if (replies.erase(reply) == 0) {
+    return;
+  }
+  reply->deleteLater();
 
-SecurityPriceDownload::SecurityPriceDownload(Download download, QObject* parent)
-    : SecurityPriceDownload(std::vector<Download>({download}), parent) {}
+  auto err = reply->error();
+  if (err == QNetworkReply::NoError) {
+    scheduler.succeeded(download);
+    ++parsing;
+    queue(parse, reply->readAll(), true);
+    startDownloads();
+    return;
+  }
 
-SecurityPriceDownload::SecurityPriceDownload(std::vector<Download> downloads, QObject* parent) : QObject(parent) {
-  numberOfSecurities_ = static_cast<int>(downloads.size());
-  replies.reserve(downloads.size());
-  for (auto& download : downloads) {
-    const auto& symbol = download.symbol;
-    auto* reply = download.reply;
+  // Whatever was parsed of a failed attempt is dropped with it
+  auto status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+  bool retrying =
+      scheduler.failed(download, pv::RequestScheduler::Clock::now(), retryable(err, status), retryAfter(*reply));
+  startDownloads();
+  if (!retrying) {
+    // Last, because the download may be aborted or deleted in response
+    emit error(err, downloads[download].symbol);
+    finishSecurity();
+  }
+}
 
-    QDate endDate = download.endDate;
-    replies.insert(reply);
+void SecurityPriceDownload::queue(const std::shared_ptr<Parse>& parse, QByteArray data, bool last) {
+  {
+    std::lock_guard lock(parse->mutex);
+    parse->pending += data;
+    parse->last = parse->last || last;
+    if (parse->scheduled) {
+      return;
+    }
+    parse->scheduled = true;
+  }
 
-    assert(reply->isOpen() && "SecurityPriceDownload replies must be open");
-    reply->setParent(this);
+  QPointer<SecurityPriceDownload> self(this);
+  QThreadPool::globalInstance()->start([parse, self]() {
+    while (true) {
+      QByteArray chunk;
+      {
+        std::lock_guard lock(parse->mutex);
+        chunk.swap(parse->pending);
+        if (chunk.isEmpty()) {
+          parse->scheduled = false;
+          if (!parse->last) {
+            return; // The next chunk starts another task
+          }
+        }
+      }
+      if (!chunk.isEmpty()) {
+        parse->parser.feed(std::string_view(chunk.constData(), static_cast<std::size_t>(chunk.size())));
+        continue;
+      }
 
-    QObject::connect(reply, &QNetworkReply::errorOccurred, this,
-                     [this, symbol, reply](QNetworkReply::NetworkError err) {
-                       emit error(err, symbol);
-                       reply->deleteLater();
-
-                       replies.erase(reply);
-                       ++finishedSecurities_;
-                       emit progressChanged(finishedSecurities_, numberOfSecurities_);
-                       if (replies.empty()) {
-                         emit complete();
-                       }
-                     });
-
-    
-    QObject::connect(reply, &QNetworkReply::finished, this, [this, symbol, reply, endDate]() {
-      auto data = parse(*reply);
-      // Sometimes, Yahoo returns a data after the ending date
+      auto prices = parse->parser.finish();
+      // Sometimes, Yahoo returns data after the ending date
       // We remove that data here
-      auto firstDateAfterEnd = data.lower_bound(endDate);
-      if (firstDateAfterEnd != data.cend()) {
-        data.erase(firstDateAfterEnd, data.cend());
-      }
-      emit success(data, symbol);
-      reply->deleteLater();
-
-      replies.erase(reply);
-      ++finishedSecurities_;
-      emit progressChanged(finishedSecurities_, numberOfSecurities_);
-      if (replies.empty()) {
-        emit complete();
+      prices.eraseFrom(calendarDate(parse->endDate));
+      for (auto& date : prices.dates) {
+        date = toEpochDate(QDate(1970, 1, 1).addDays(date));
       }
-    });
+
+      // The download may be deleted by the time this runs, which QPointer (only read on the GUI thread) tells
+      QMetaObject::invokeMethod(
+          QCoreApplication::instance(),
+          [self, prices = std::move(prices), symbol = parse->symbol]() {
+            if (self != nullptr) {
+              self->parsed(prices, symbol);
+            }
+          },
+          Qt::QueuedConnection);
+      return;
+    }
+  });
+}
+
+void SecurityPriceDownload::parsed(const pv::PriceHistory& prices, const QString& symbol) {
+  --parsing;
+  if (aborted) {
+    completeIfDone();
+    return;
+  }
+  emit success(prices, symbol);
+  finishSecurity();
+}
+
+void SecurityPriceDownload::finishSecurity() {
+  ++finishedSecurities_;
+  emit progressChanged(finishedSecurities_, numberOfSecurities());
+  completeIfDone();
+}
+
+void SecurityPriceDownload::completeIfDone() {
+  if (!completed && (aborted || scheduler.done()) && parsing == 0) {
+    completed = true;
+    emit complete();
   }
 }
 
 void SecurityPriceDownload::abort() {
-  for (auto* reply : replies) {
+  aborted = true; // Replies that are still being parsed are dropped when they're done
+  startTimer.stop();
+  for (const auto& entry : replies) {
+    auto* reply = entry.first;
     reply->blockSignals(true);
     reply->abort();
     reply->deleteLater(); // Don't delete now, the reply might still be being read
   }
 
   replies.clear();
+
+  // If nothing is being parsed, nothing else completes the download. This waits, since abort() is usually called in
+  // response to one of this download's signals, and complete's handlers may delete it.
+  QTimer::singleShot(0, this, &SecurityPriceDownload::completeIfDone);
 }
 
-SecurityPriceDownload* SecurityPriceDownloader::download(QString symbol, QDate begin, QDate end, QObject* parent) {
-  auto* reply = manager.get(QNetworkRequest(generateDownloadUrl(symbol, begin, end)));
+const QString SecurityPriceDownloader::defaultUrlTemplate =
+    QStringLiteral("https://query1.finance.yahoo.com/v7/finance/download/"
+                   "%1?period1=%2&period2=%3&interval=1d&events=history&includeAdjustedClose=true");
 
-  return new SecurityPriceDownload({symbol, reply, end}, parent == nullptr ? this : parent);
+SecurityPriceDownloader::SecurityPriceDownloader(QObject* parent)
+    : QObject(parent), urlTemplate(qEnvironmentVariable("PVIEW_PRICE_URL_TEMPLATE", defaultUrlTemplate)) {
+  auto source = qEnvironmentVariable("PVIEW_PRICE_SOURCE");
+  if (!source.isEmpty()) {
+    provider = pv::openPriceFiles(source.toStdString());
+  }
+}
+
+QNetworkRequest SecurityPriceDownloader::networkRequest(const QString& symbol, const QDate& begin,
+                                                        const QDate& end) const {
+  auto beginSecs =
+      QDateTime(begin, QTime(23, 59, 59, 999), Qt::LocalTime).toSecsSinceEpoch(); // Inclusive on begin date
+  auto endSecs = QDateTime(end.addDays(-1), QTime(23, 59, 59, 999), Qt::LocalTime)
+                     .toSecsSinceEpoch(); // subtract 1 day because exclusive on end date
+  QNetworkRequest request(QUrl(urlTemplate.arg(symbol, QString::number(beginSecs), QString::number(endSecs))));
+  // A stalled download is retried rather than holding up the others
+  request.setTransferTimeout(transferTimeout);
+  return request;
+}
+
+SecurityPriceDownload* SecurityPriceDownloader::download(QString symbol, QDate begin, QDate end, QObject* parent) {
+  return download(std::vector<Request>{{std::move(symbol), begin}}, end, parent);
 }
 
 SecurityPriceDownload* SecurityPriceDownloader::download(QStringList symbols, QDate begin, QDate end, QObject* parent) {
-  std::vector<SecurityPriceDownload::Download> downloads;
+  std::vector<Request> requests;
+  requests.reserve(static_cast<std::size_t>(symbols.size()));
   for (const auto& symbol : symbols) {
-    auto* reply = manager.get(QNetworkRequest(generateDownloadUrl(symbol, begin, end)));
-    downloads.push_back(SecurityPriceDownload::Download{symbol, reply, end});
+    requests.push_back(Request{symbol, begin});
+  }
+  return download(requests, end, parent);
+}
+
+SecurityPriceDownload* SecurityPriceDownloader::download(const std::vector<Request>& requests, QDate end,
+                                                         QObject* parent) {
+  std::vector<SecurityPriceDownload::Download> downloads;
+  downloads.reserve(requests.size());
+  for (const auto& request : requests) {
+    downloads.push_back(SecurityPriceDownload::Download{
+        request.symbol, networkRequest(request.symbol, request.begin, end), request.begin, end, request.priority});
+  }
+  if (provider != nullptr) {
+    return new SecurityPriceDownload(provider, std::move(downloads), parent == nullptr ? this : parent);
   }
-  return new SecurityPriceDownload(std::move(downloads), parent == nullptr ? this : parent);
+  return new SecurityPriceDownload(manager, std::move(downloads), schedulerOptions, parent == nullptr ? this : parent);
 }
 
 } // namespace pvui
@@ -1,59 +1,149 @@
 #ifndef PVUI_SECURITYPRICEDOWNLOADER_H
 #define PVUI_SECURITYPRICEDOWNLOADER_H
 
+#include "pv/PriceCsvParser.h"
+#include "pv/PriceProvider.h"
+#include "pv/RequestScheduler.h"
 #include "pv/Security.h"
 #include <QDate>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
+#include <QNetworkRequest>
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include <QTimer>
 #include <QUrl>
-#include <unordered_set>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace pvui {
 
+/// \brief The downloads of one or more securities' prices.
+///
+/// Requests are made as a \c pv::RequestScheduler allows: a few at a time, at a limited rate, higher priorities
+/// first. Failures that may be temporary (such as timeouts, server errors, and being told to slow down) are retried
+/// with backoff, and \c error is only emitted once a security is given up on.
+///
+/// Each reply is parsed (with \c pv::PriceCsvParser) on the global thread pool as its data arrives, so the GUI thread
+/// only moves chunks around. A reply's chunks are parsed in order by one task at a time.
+///
+/// Prices can also come from a \c pv::PriceProvider instead of the network, which is asked for every security at once
+/// on the global thread pool.
 class SecurityPriceDownload : public QObject {
   Q_OBJECT
 public:
   struct Download {
     QString symbol;
-    QNetworkReply* reply;
+    QNetworkRequest request;
+    QDate beginDate;
     QDate endDate;
+    int priority = 0;
   };
 
 private:
-  std::unordered_set<QNetworkReply*> replies;
+  struct Parse;
+
+  QNetworkAccessManager* manager = nullptr;
+  std::shared_ptr<pv::PriceProvider> provider;
+  std::vector<Download> downloads;
+  pv::RequestScheduler scheduler;
+  QTimer startTimer;
+
+  std::unordered_map<QNetworkReply*, std::size_t> replies;
+  int parsing = 0;
+  bool aborted = false;
+  bool completed = false;
   int finishedSecurities_ = 0;
-  int numberOfSecurities_;
+
+  /// \internal Makes the requests that the scheduler allows now, and schedules the next ones.
+  void startDownloads();
+  /// \internal Asks the provider for every security's prices.
+  void startProvider();
+  void provided(const std::vector<std::optional<pv::PriceHistory>>& results);
+  void handleFinished(QNetworkReply* reply, std::size_t download, const std::shared_ptr<Parse>& parse);
+  /// \internal Queues \c data to be parsed, starting a task if none is running. \c last finishes the parse.
+  void queue(const std::shared_ptr<Parse>& parse, QByteArray data, bool last);
+  void parsed(const pv::PriceHistory& prices, const QString& symbol);
+  void finishSecurity();
+  /// \internal Emits \c complete (only once) if nothing is left to download or parse.
+  void completeIfDone();
 public:
-  SecurityPriceDownload(Download download , QObject* parent = nullptr);
-  SecurityPriceDownload(std::vector<Download> downloads, QObject* parent = nullptr);
+  SecurityPriceDownload(QNetworkAccessManager& manager, std::vector<Download> downloads,
+                        pv::RequestSchedulerOptions options, QObject* parent = nullptr);
+  /// \brief Creates a download from \c provider, which ignores the downloads' requests.
+  SecurityPriceDownload(std::shared_ptr<pv::PriceProvider> provider, std::vector<Download> downloads,
+                        QObject* parent = nullptr);
 
   int finishedSecurities() const noexcept { return finishedSecurities_; }
-  int numberOfSecurities() const noexcept { return numberOfSecurities_; }
+  int numberOfSecurities() const noexcept { return static_cast<int>(downloads.size()); }
 public slots:
   void abort();
 signals:
-  void success(const std::map<QDate, pv::i64>& data, QString symbol);
+  /// \brief Emitted with the prices of \c symbol, by date (as used by \c pv::DataFile) and before the end date.
+  void success(const pv::PriceHistory& prices, QString symbol);
   void error(QNetworkReply::NetworkError error, QString symbol);
+  /// \brief Emitted once every security has succeeded or failed, or once the download is aborted and the replies
+  /// still being parsed are done.
   void complete();
   void progressChanged(int progress, int numberOfDownloads);
 };
 
 class SecurityPriceDownloader : public QObject {
   Q_OBJECT
+public:
+  /// \brief The prices of one symbol to download, beginning with \c begin (inclusive).
+  struct Request {
+    QString symbol;
+    QDate begin;
+    /// \brief Requests with higher priorities are made first.
+    int priority = 0;
+  };
+
 private:
   QNetworkAccessManager manager;
+  QString urlTemplate;
+  pv::RequestSchedulerOptions schedulerOptions;
+  int transferTimeout = 30000;
+  std::shared_ptr<pv::PriceProvider> provider;
 
+  QNetworkRequest networkRequest(const QString& symbol, const QDate& begin, const QDate& end) const;
 public:
+  /// \brief The URL of Yahoo Finance's price history downloads, where \c %1 is the symbol, and \c %2 and \c %3 are
+  /// the beginning and end, in seconds since 1970-01-01 UTC.
+  static const QString defaultUrlTemplate;
+
+  /// \brief Creates a downloader that downloads from \c defaultUrlTemplate, or from the \c PVIEW_PRICE_URL_TEMPLATE
+  /// environment variable if it is set (for example, to test against a local server).
+  ///
+  /// If the \c PVIEW_PRICE_SOURCE environment variable is set, prices are read from the files it names instead (see
+  /// \c pv::openPriceFiles()).
+  explicit SecurityPriceDownloader(QObject* parent = nullptr);
+
+  void setUrlTemplate(QString urlTemplate) { this->urlTemplate = std::move(urlTemplate); }
+
+  /// \brief Gets prices from \c provider instead of downloading them, or downloads them again if it is \c nullptr.
+  void setPriceProvider(std::shared_ptr<pv::PriceProvider> provider) { this->provider = std::move(provider); }
+
+  /// \brief Sets how many downloads are made at once, how quickly, and how failures are retried, for the downloads
+  /// created afterwards.
+  void setSchedulerOptions(const pv::RequestSchedulerOptions& options) { schedulerOptions = options; }
+
+  /// \brief Sets how long a download may go without receiving anything before it is given up on (and retried), in
+  /// milliseconds, for the downloads created afterwards. The default is 30 seconds.
+  void setTransferTimeout(int milliseconds) { transferTimeout = milliseconds; }
+
   /// \brief creates a SecurityPriceDownload object which downloads security prices for \c symbol,
   /// beginning with \c begin (inclusive) and ending with \c end (exclusive).
   ///
   /// The returned SecurityPriceDownload will have this SecurityPriceDownloader as a parent if no parent is supplied.
   SecurityPriceDownload* download(QString symbol, QDate begin, QDate end, QObject* parent = nullptr);
   SecurityPriceDownload* download(QStringList symbol, QDate begin, QDate end, QObject* parent = nullptr);
+  /// \brief Like the other overloads, but each symbol's prices begin on their own date.
+  SecurityPriceDownload* download(const std::vector<Request>& requests, QDate end, QObject* parent = nullptr);
 };
 
 } // namespace pvui
@@ -5,6 +5,9 @@
 #include <QDate>
 #include <sqlite3.h>
 #include <QThread>
+#include <cstddef>
+#include <iterator>
+#include <limits>
 #include <optional>
 #include "DateUtils.h"
 #include "pv/Security.h"
@@ -19,6 +22,9 @@ constexpr int dateColumnIndex = 0;
 constexpr int priceColumnIndex = 1;
 constexpr int modelColumnCount = 2;
 
+/// Changes to more prices than this at once reset the model instead of updating each row
+constexpr std::ptrdiff_t maxIncrementalUpdates = 16;
+
 } // namespace
 
 SecurityPriceModel::SecurityPriceModel(pv::DataFile& dataFile, pv::i64 security, QObject* parent)
@@ -44,7 +50,7 @@ SecurityPriceModel::SecurityPriceModel(pv::DataFile& dataFile, pv::i64 security,
     if (iter == dates.cend())
       return;
 
-    int index = static_cast<int>(dates.cbegin() - dates.cbegin());
+    int index = static_cast<int>(iter - dates.cbegin());
     beginRemoveRows(QModelIndex(), index, index);
     dates.erase(iter);
     endRemoveRows();
@@ -56,15 +62,26 @@ SecurityPriceModel::SecurityPriceModel(pv::DataFile& dataFile, pv::i64 security,
     endResetModel();
   });
 
-  securityPriceUpdatedConnection = dataFile.onSecurityPriceUpdated([&](pv::i64 security, pv::i64 date) {
-    if (security == this->security) {
-      emit dateUpdated(date);
+  changeSetConnection = dataFile.onChangeSet([&](const pv::ChangeSet& changes) {
+    if (!changes.hasSecurityPrices(this->security)) {
+      return;
+    }
+
+    auto begin = changes.securityPrices.lower_bound({this->security, std::numeric_limits<pv::i64>::min()});
+    auto end = changes.securityPrices.upper_bound({this->security, std::numeric_limits<pv::i64>::max()});
+    if (std::distance(begin, end) > maxIncrementalUpdates) {
+      // Cheaper than inserting rows one at a time, e.g. after downloading prices
+      emit reset();
+      return;
     }
-  });
 
-  securityPriceRemovedConnection = dataFile.onSecurityPriceRemoved([&](pv::i64 security, pv::i64 date) {
-    if (security == this->security) {
-      emit dateRemoved(date);
+    for (auto iter = begin; iter != end; ++iter) {
+      pv::i64 date = iter->second;
+      if (pv::security::price(this->dataFile, this->security, date).has_value()) {
+        emit dateUpdated(date);
+      } else {
+        emit dateRemoved(date);
+      }
     }
   });
 
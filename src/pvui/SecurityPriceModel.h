@@ -21,8 +21,7 @@ private:
   std::vector<pv::i64> dates;
   pv::i64 security;
 
-  pv::ScopedConnection securityPriceUpdatedConnection;
-  pv::ScopedConnection securityPriceRemovedConnection;
+  pv::ScopedConnection changeSetConnection;
   pv::ScopedConnection resetConnection;
 
   void repopulate();
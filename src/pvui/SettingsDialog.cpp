@@ -1,4 +1,5 @@
 #include "SettingsDialog.h"
+#include "Autosaver.h"
 #include "ThemeManager.h"
 #include <QCheckBox>
 #include <QComboBox>
@@ -67,6 +68,22 @@ root->addWidget(container, 1); // make sure to stretch it out
   });
   appearanceLayout->addRow(new QLabel(tr("Theme:")), theme);
 
+  // SAVING SECTION
+  savingGroupBox = new QGroupBox(tr("&Saving"));
+  mainLayout.addWidget(savingGroupBox);
+  savingLayout = new QFormLayout(savingGroupBox);
+  durabilityWindow = new QComboBox();
+  durabilityWindow->addItem(tr("Immediately"), 0);
+  durabilityWindow->addItem(tr("Within 1 second"), 1000);
+  durabilityWindow->addItem(tr("Within 5 seconds"), 5000);
+  durabilityWindow->addItem(tr("Within 30 seconds"), 30000);
+  durabilityWindow->setToolTip(tr("Saving changes in groups is faster, but the changes that haven't been saved yet "
+                                  "are lost if pView crashes or the computer loses power."));
+  QObject::connect(durabilityWindow, qOverload<int>(&QComboBox::currentIndexChanged), this, [this]() {
+    set(Autosaver::durabilityWindowKey, durabilityWindow->currentData());
+  });
+  savingLayout->addRow(new QLabel(tr("Save changes:")), durabilityWindow);
+
   // WARNINGS SECTION
   warningsGroupBox = new QGroupBox(tr("&Warnings"));
   mainLayout.addWidget(warningsGroupBox);
@@ -113,6 +130,9 @@ void SettingsDialog::set(const QString& key, const QVariant& value) {
 
 void SettingsDialog::refresh() {
   theme->setCurrentIndex(theme->findData(static_cast<int>(ThemeManager::currentTheme())));
+  int window = durabilityWindow->findData(
+      settings.value(Autosaver::durabilityWindowKey, Autosaver::defaultDurabilityWindow).toInt());
+  durabilityWindow->setCurrentIndex(window != -1 ? window : durabilityWindow->findData(Autosaver::defaultDurabilityWindow));
   warnOnTransactionDeletion->setChecked(settings.value(QStringLiteral("AccountPage/WarnOnTransactionDeletion"), true).toBool());
   warnOnSecurityDeletion->setChecked(settings.value(QStringLiteral("SecurityPage/WarnOnSecurityDeletion"), true).toBool());
   warnOnSecurityPriceDownloadFailure->setChecked(settings.value(QStringLiteral("SecurityPage/WarnOnSecurityPriceDownloadFailure"), true).toBool());
@@ -121,6 +141,7 @@ void SettingsDialog::refresh() {
 
 void SettingsDialog::resetToDefaults() {
   ThemeManager::setTheme(ThemeManager::defaultTheme());
+  set(Autosaver::durabilityWindowKey, Autosaver::defaultDurabilityWindow);
   set(QStringLiteral("AccountPage/WarnOnTransactionDeletion"), true);
   set(QStringLiteral("SecurityPage/WarnOnSecurityDeletion"), true);
   set(QStringLiteral("SecurityPage/WarnOnSecurityPriceDownloadFailure"), true);
@@ -37,6 +37,10 @@ private:
   QFormLayout* appearanceLayout;
   QComboBox* theme;
 
+  QGroupBox* savingGroupBox;
+  QFormLayout* savingLayout;
+  QComboBox* durabilityWindow;
+
   QGroupBox* warningsGroupBox;
   QVBoxLayout* warningsLayout;
   QCheckBox* warnOnTransactionDeletion;
@@ -1,18 +1,25 @@
 #include "TransactionModel.h"
 #include "DateUtils.h"
 #include "ModelUtils.h"
+#include "pv/ChangeSet.h"
 #include "pv/DataFile.h"
 #include "pv/Integer64.h"
-#include "pv/Security.h"
+#include "pv/Trace.h"
 #include "pv/Transaction.h"
 #include <QAbstractTableModel>
 #include <QDate>
 #include <QStringLiteral>
 #include <Qt>
+#include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <cstddef>
 #include <optional>
 #include <sqlite3.h>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
 
 namespace {
 
@@ -25,6 +32,107 @@ constexpr int commissionColumn = 5;
 constexpr int totalAmountColumn = 6;
 constexpr int columnCount = 7;
 
+/// \internal The number of rows read by each \c fetchMore()
+constexpr int pageSize = 256;
+
+/// \internal Joins the columns used by the sort keys of the share columns
+const char* buySellJoins = R"(
+  LEFT JOIN BuyTransactions ON Transactions.Id = BuyTransactions.TransactionId
+  LEFT JOIN SellTransactions ON Transactions.Id = SellTransactions.TransactionId
+)";
+
+/// \internal Joins every column that a sort key may need
+const char* allJoins = R"(
+  LEFT JOIN BuyTransactions ON Transactions.Id = BuyTransactions.TransactionId
+  LEFT JOIN SellTransactions ON Transactions.Id = SellTransactions.TransactionId
+  LEFT JOIN DepositTransactions ON Transactions.Id = DepositTransactions.TransactionId
+  LEFT JOIN WithdrawTransactions ON Transactions.Id = WithdrawTransactions.TransactionId
+  LEFT JOIN DividendTransactions ON Transactions.Id = DividendTransactions.TransactionId
+  LEFT JOIN InterestTransactions ON Transactions.Id = InterestTransactions.TransactionId
+  LEFT JOIN Securities ON Securities.Id = COALESCE(BuyTransactions.SecurityId, SellTransactions.SecurityId,
+    DepositTransactions.SecurityId, WithdrawTransactions.SecurityId, DividendTransactions.SecurityId,
+    InterestTransactions.SecurityId)
+)";
+
+const char* securityFilter = R"(
+Transactions.Id IN (
+  SELECT TransactionId FROM BuyTransactions WHERE SecurityId = :Security UNION ALL
+  SELECT TransactionId FROM SellTransactions WHERE SecurityId = :Security UNION ALL
+  SELECT TransactionId FROM DepositTransactions WHERE SecurityId = :Security UNION ALL
+  SELECT TransactionId FROM WithdrawTransactions WHERE SecurityId = :Security UNION ALL
+  SELECT TransactionId FROM DividendTransactions WHERE SecurityId = :Security UNION ALL
+  SELECT TransactionId FROM InterestTransactions WHERE SecurityId = :Security)
+)";
+
+/// \internal The joins needed by \c sortKey(column). Sorting by date is the only sort that doesn't need to
+/// read every transaction in the account, since it uses TransactionsAccountIndex.
+const char* sortJoins(int column) {
+  switch (column) {
+  case dateColumn:   // Fall through
+  case actionColumn:
+    return "";
+  case numberOfSharesColumn: // Fall through
+  case sharePriceColumn:     // Fall through
+  case commissionColumn:
+    return buySellJoins;
+  default:
+    return allJoins;
+  }
+}
+
+/// \internal The SQL expression that \c column is sorted by.
+///
+/// These match what \c data() shows (empty cells sort first), and are never NULL, so that they can be
+/// compared as row values when paging.
+const char* sortKey(int column) {
+  switch (column) {
+  case actionColumn:
+    return "Transactions.Action";
+  case securityColumn:
+    return "COALESCE(Securities.Symbol, '')";
+  case numberOfSharesColumn:
+    return "COALESCE(BuyTransactions.NumberOfShares, SellTransactions.NumberOfShares, -9223372036854775807 - 1)";
+  case sharePriceColumn:
+    return "COALESCE(BuyTransactions.SharePrice, SellTransactions.SharePrice, -9223372036854775807 - 1)";
+  case commissionColumn:
+    return "COALESCE(BuyTransactions.Commission, SellTransactions.Commission, -9223372036854775807 - 1)";
+  case totalAmountColumn:
+    return "COALESCE(BuyTransactions.Amount, SellTransactions.Amount, DepositTransactions.Amount, "
+           "WithdrawTransactions.Amount, DividendTransactions.Amount, -9223372036854775807 - 1)";
+  default:
+    return "Transactions.Date";
+  }
+}
+
+void bindNamed(sqlite3_stmt* stmt, const char* name, pv::i64 value) {
+  int index = sqlite3_bind_parameter_index(stmt, name);
+  if (index != 0) {
+    sqlite3_bind_int64(stmt, index, static_cast<sqlite3_int64>(value));
+  }
+}
+
+/// \internal Binds a sort key (see \c columnKey())
+void bindKey(sqlite3_stmt* stmt, const char* name, const std::variant<pv::i64, std::string>& key) {
+  int index = sqlite3_bind_parameter_index(stmt, name);
+  if (index == 0) {
+    return;
+  }
+  if (const auto* text = std::get_if<std::string>(&key)) {
+    sqlite3_bind_text(stmt, index, text->data(), static_cast<int>(text->size()), SQLITE_TRANSIENT);
+  } else {
+    sqlite3_bind_int64(stmt, index, static_cast<sqlite3_int64>(std::get<pv::i64>(key)));
+  }
+}
+
+/// \internal Reads a sort key, which is text when sorting by security and an integer otherwise
+std::variant<pv::i64, std::string> columnKey(sqlite3_stmt* stmt, int column) {
+  if (sqlite3_column_type(stmt, column) == SQLITE_TEXT) {
+    return std::string(reinterpret_cast<const char*>(sqlite3_column_text(stmt, column)),
+                       static_cast<std::size_t>(sqlite3_column_bytes(stmt, column)));
+  }
+  return static_cast<pv::i64>(sqlite3_column_int64(stmt, column));
+}
+
 QString nameOfAction(pv::Action action) {
   switch (action) {
     case pv::Action::DEPOSIT:
@@ -43,70 +151,44 @@ QString nameOfAction(pv::Action action) {
   }
 }
 
-std::optional<pv::i64> getSecurity(pv::DataFile& dataFile, pv::i64 transaction) {
-  switch (pv::transaction::action(dataFile, transaction)) {
-  case pv::Action::BUY:
-    return pv::transaction::buySecurity(dataFile, transaction);
-  case pv::Action::SELL:
-    return pv::transaction::sellSecurity(dataFile, transaction);
-  case pv::Action::DEPOSIT:
-    return pv::transaction::depositSecurity(dataFile, transaction);
-  case pv::Action::WITHDRAW:
-    return pv::transaction::withdrawSecurity(dataFile, transaction);
-  case pv::Action::DIVIDEND:
-    return pv::transaction::dividendSecurity(dataFile, transaction);
-  case pv::Action::INTEREST:
-    return pv::transaction::interestSecurity(dataFile, transaction);
-  default:
-    return std::nullopt;
-  }
-}
-
-std::optional<pv::i64> getNumberOfShares(pv::DataFile& dataFile, pv::i64 transaction) {
-  switch (pv::transaction::action(dataFile, transaction)) {
-  case pv::Action::BUY:
-    return pv::transaction::buyNumberOfShares(dataFile, transaction);
+std::optional<pv::i64> getNumberOfShares(const pv::transaction::Record& record) {
+  switch (record.action) {
+  case pv::Action::BUY: // Fall through
   case pv::Action::SELL:
-    return pv::transaction::sellNumberOfShares(dataFile, transaction);
+    return record.numberOfShares;
   default:
     return std::nullopt;
   }
 }
 
-std::optional<pv::i64> getSharePrice(pv::DataFile& dataFile, pv::i64 transaction) {
-  switch (pv::transaction::action(dataFile, transaction)) {
-  case pv::Action::BUY:
-    return pv::transaction::buySharePrice(dataFile, transaction);
+std::optional<pv::i64> getSharePrice(const pv::transaction::Record& record) {
+  switch (record.action) {
+  case pv::Action::BUY: // Fall through
   case pv::Action::SELL:
-    return pv::transaction::sellSharePrice(dataFile, transaction);
+    return record.sharePrice;
   default:
     return std::nullopt;
   }
 }
 
-std::optional<pv::i64> getCommission(pv::DataFile& dataFile, pv::i64 transaction) {
-  switch (pv::transaction::action(dataFile, transaction)) {
-  case pv::Action::BUY:
-    return pv::transaction::buyCommission(dataFile, transaction);
+std::optional<pv::i64> getCommission(const pv::transaction::Record& record) {
+  switch (record.action) {
+  case pv::Action::BUY: // Fall through
   case pv::Action::SELL:
-    return pv::transaction::sellCommission(dataFile, transaction);
+    return record.commission;
   default:
     return std::nullopt;
   }
 }
 
-std::optional<pv::i64> getTotalAmount(pv::DataFile& dataFile, pv::i64 transaction) {
-  switch (pv::transaction::action(dataFile, transaction)) {
-  case pv::Action::BUY:
-    return pv::transaction::buyAmount(dataFile, transaction);
-  case pv::Action::SELL:
-    return pv::transaction::sellAmount(dataFile, transaction);
-  case pv::Action::DEPOSIT:
-    return pv::transaction::depositAmount(dataFile, transaction);
-  case pv::Action::WITHDRAW:
-    return pv::transaction::withdrawAmount(dataFile, transaction);
+std::optional<pv::i64> getTotalAmount(const pv::transaction::Record& record) {
+  switch (record.action) {
+  case pv::Action::BUY:      // Fall through
+  case pv::Action::SELL:     // Fall through
+  case pv::Action::DEPOSIT:  // Fall through
+  case pv::Action::WITHDRAW: // Fall through
   case pv::Action::DIVIDEND:
-    return pv::transaction::dividendAmount(dataFile, transaction);
+    return record.amount;
   default:
     return std::nullopt;
   }
@@ -181,12 +263,23 @@ pvui::models::TransactionModel::TransactionModel(pv::DataFile& dataFile, pv::i64
   transactionRemovedConnection =
       dataFile.onTransactionRemoved([this](pv::i64 transaction) { emit transactionRemoved(transaction); });
 
+  // A bulk import may add many rows at once, which is cheaper to handle as a single reset
+  transactionsAddedConnection = dataFile.onTransactionsAdded([this](const std::vector<pv::i64>&) { emit reset(); });
+
   resetConnection = dataFile.onRollback([this] { emit reset(); });
 
+  // Cached rows include the symbol of their security
+  securitiesChangedConnection = dataFile.onChangeSet([this](const pv::ChangeSet& changes) {
+    if (!changes.securities.empty()) {
+      emit securitiesChanged();
+    }
+  });
+
   QObject::connect(this, &TransactionModel::transactionAdded, this, &TransactionModel::handleTransactionAdded);
   QObject::connect(this, &TransactionModel::transactionUpdated, this, &TransactionModel::handleTransactionUpdated);
   QObject::connect(this, &TransactionModel::transactionRemoved, this, &TransactionModel::handleTransactionRemoved);
   QObject::connect(this, &TransactionModel::reset, this, &TransactionModel::handleReset);
+  QObject::connect(this, &TransactionModel::securitiesChanged, this, &TransactionModel::handleSecuritiesChanged);
 }
 
 int pvui::models::TransactionModel::indexOfTransaction(pv::i64 transaction) {
@@ -207,39 +300,349 @@ pv::i64 pvui::models::TransactionModel::transactionOfIndex(int rowIndex) {
 }
 
 void pvui::models::TransactionModel::repopulate() {
+  pv::trace::Span span("TransactionModel::repopulate", "ui");
   transactions.clear();
-  auto* query = dataFile.cachedQuery("SELECT Id FROM Transactions WHERE AccountId = ?");
-  sqlite3_bind_int64(query, 1, static_cast<sqlite3_int64>(account));
-  while (sqlite3_step(query) == SQLITE_ROW) {
-    transactions.push_back(sqlite3_column_int64(query, 0));
+  keys.clear();
+  unfetched.clear();
+  fetchedAll = false;
+  hasCursor = false;
+  if (!indexed()) {
+    materialize();
+  }
+  for (auto& row : fetchPage()) {
+    transactions.push_back(row.transaction);
+    keys.push_back(std::move(row.key));
   }
 }
 
-void pvui::models::TransactionModel::handleTransactionAdded(pv::i64 id) {
-  beginInsertRows(QModelIndex(), rowCount(), rowCount());
-  transactions.push_back(id);
+std::string pvui::models::TransactionModel::fromClause() const {
+  return std::string("Transactions") + sortJoins(sortColumn);
+}
+
+std::string pvui::models::TransactionModel::whereClause() const {
+  std::string where = "Transactions.AccountId = :Account";
+  if (filter_.startDate.has_value()) {
+    where += " AND Transactions.Date >= :StartDate";
+  }
+  if (filter_.endDate.has_value()) {
+    where += " AND Transactions.Date <= :EndDate";
+  }
+  if (filter_.action.has_value()) {
+    where += " AND Transactions.Action = :Action";
+  }
+  if (filter_.security.has_value()) {
+    where += std::string(" AND ") + securityFilter;
+  }
+  return where;
+}
+
+void pvui::models::TransactionModel::bindFilter(sqlite3_stmt* stmt) const {
+  bindNamed(stmt, ":Account", account);
+  bindNamed(stmt, ":StartDate", filter_.startDate.value_or(0));
+  bindNamed(stmt, ":EndDate", filter_.endDate.value_or(0));
+  bindNamed(stmt, ":Action", static_cast<pv::i64>(filter_.action.value_or(pv::Action::BUY)));
+  bindNamed(stmt, ":Security", filter_.security.value_or(0));
+}
+
+bool pvui::models::TransactionModel::indexed() const noexcept { return sortColumn == dateColumn; }
+
+bool pvui::models::TransactionModel::before(const SortKey& lhs, pv::i64 lhsTransaction, const SortKey& rhs,
+                                            pv::i64 rhsTransaction) const {
+  if (sortOrder == Qt::AscendingOrder) {
+    return lhs < rhs || (lhs == rhs && lhsTransaction < rhsTransaction);
+  }
+  return rhs < lhs || (lhs == rhs && rhsTransaction < lhsTransaction);
+}
+
+void pvui::models::TransactionModel::materialize() {
+  pv::trace::Span span("TransactionModel::materialize", "ui");
+
+  // Sorted the opposite way, so that the first rows end up at the back
+  const std::string key = sortKey(sortColumn);
+  const char* direction = sortOrder == Qt::AscendingOrder ? " DESC" : " ASC";
+  auto stmt = dataFile.query("SELECT Transactions.Id, " + key + " FROM " + fromClause() + " WHERE " + whereClause() +
+                             " ORDER BY " + key + direction + ", Transactions.Id" + direction);
+  if (!stmt) {
+    return;
+  }
+  bindFilter(stmt.get());
+  while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+    unfetched.push_back({columnKey(stmt.get(), 1), sqlite3_column_int64(stmt.get(), 0)});
+  }
+}
+
+std::vector<pvui::models::TransactionModel::Row> pvui::models::TransactionModel::fetchPage() {
+  pv::trace::Span span("TransactionModel::fetchPage", "ui");
+  std::vector<Row> page;
+  if (fetchedAll) {
+    return page;
+  }
+
+  if (!indexed()) {
+    auto count = std::min(unfetched.size(), static_cast<std::size_t>(pageSize));
+    page.assign(std::make_move_iterator(unfetched.rbegin()), std::make_move_iterator(unfetched.rbegin() + count));
+    unfetched.resize(unfetched.size() - count);
+    fetchedAll = unfetched.empty();
+    return page;
+  }
+
+  // Keyset pagination: continue after the (key, id) of the last fetched row, which (unlike OFFSET) doesn't
+  // have to skip over every row that was already fetched
+  const std::string key = sortKey(sortColumn);
+  const char* direction = sortOrder == Qt::AscendingOrder ? " ASC" : " DESC";
+  std::string sql = "SELECT Transactions.Id, " + key + " FROM " + fromClause() + " WHERE " + whereClause();
+  if (hasCursor) {
+    sql += " AND (" + key + ", Transactions.Id) " + (sortOrder == Qt::AscendingOrder ? ">" : "<") +
+           " (:Key, :KeyTransaction)";
+  }
+  sql += " ORDER BY " + key + direction + ", Transactions.Id" + direction + " LIMIT :Limit";
+
+  auto stmt = dataFile.query(sql);
+  if (!stmt) {
+    fetchedAll = true;
+    return page;
+  }
+  bindFilter(stmt.get());
+  bindKey(stmt.get(), ":Key", cursor.key);
+  bindNamed(stmt.get(), ":KeyTransaction", cursor.transaction);
+  bindNamed(stmt.get(), ":Limit", static_cast<pv::i64>(pageSize));
+
+  page.reserve(pageSize);
+  while (sqlite3_step(stmt.get()) == SQLITE_ROW) {
+    page.push_back({columnKey(stmt.get(), 1), sqlite3_column_int64(stmt.get(), 0)});
+  }
+
+  if (static_cast<int>(page.size()) < pageSize) {
+    fetchedAll = true;
+  } else {
+    hasCursor = true;
+    cursor = page.back();
+  }
+  return page;
+}
+
+std::optional<pvui::models::TransactionModel::Row> pvui::models::TransactionModel::rowOf(pv::i64 transaction) const {
+  auto stmt = dataFile.query("SELECT " + std::string(sortKey(sortColumn)) + " FROM " + fromClause() +
+                             " WHERE Transactions.Id = :Transaction AND " + whereClause());
+  if (!stmt) {
+    return std::nullopt;
+  }
+  bindFilter(stmt.get());
+  bindNamed(stmt.get(), ":Transaction", transaction);
+  if (sqlite3_step(stmt.get()) != SQLITE_ROW) {
+    return std::nullopt; // Filtered out
+  }
+  return Row{columnKey(stmt.get(), 0), transaction};
+}
+
+bool pvui::models::TransactionModel::isFetched(const Row& row) const {
+  if (!indexed()) {
+    return unfetched.empty() || before(row.key, row.transaction, unfetched.back().key, unfetched.back().transaction);
+  }
+  return fetchedAll || !hasCursor || !before(cursor.key, cursor.transaction, row.key, row.transaction);
+}
+
+int pvui::models::TransactionModel::positionOf(const Row& row, int ignoredRow) const {
+  // The fetched rows are still sorted by the keys they were fetched (or last updated) with, including the ignored one
+  int first = 0;
+  int last = rowCount();
+  while (first < last) {
+    int middle = first + (last - first) / 2;
+    if (before(keys[middle], transactions[middle], row.key, row.transaction)) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+  return ignoredRow >= 0 && ignoredRow < first ? first - 1 : first;
+}
+
+void pvui::models::TransactionModel::insertTransaction(int rowIndex, Row row) {
+  beginInsertRows(QModelIndex(), rowIndex, rowIndex);
+  transactions.insert(transactions.begin() + rowIndex, row.transaction);
+  keys.insert(keys.begin() + rowIndex, std::move(row.key));
   endInsertRows();
 }
 
+void pvui::models::TransactionModel::removeTransaction(int rowIndex) {
+  beginRemoveRows(QModelIndex(), rowIndex, rowIndex);
+  transactions.erase(transactions.begin() + rowIndex);
+  keys.erase(keys.begin() + rowIndex);
+  endRemoveRows();
+}
+
+void pvui::models::TransactionModel::insertUnfetched(Row row) {
+  if (indexed()) {
+    return; // A later page will read it
+  }
+  // Last first, so the rows that sort after this one are at the front
+  auto iter = std::lower_bound(unfetched.begin(), unfetched.end(), row, [this](const Row& lhs, const Row& rhs) {
+    return before(rhs.key, rhs.transaction, lhs.key, lhs.transaction);
+  });
+  unfetched.insert(iter, std::move(row));
+  fetchedAll = false;
+}
+
+void pvui::models::TransactionModel::removeUnfetched(pv::i64 transaction) {
+  auto iter = std::find_if(unfetched.begin(), unfetched.end(),
+                           [transaction](const Row& row) { return row.transaction == transaction; });
+  if (iter != unfetched.end()) {
+    unfetched.erase(iter);
+    fetchedAll = unfetched.empty();
+  }
+}
+
+void pvui::models::TransactionModel::sort(int column, Qt::SortOrder order) {
+  if (column < 0 || column >= ::columnCount) {
+    return;
+  }
+  sortColumn = column;
+  sortOrder = order;
+  handleReset();
+}
+
+void pvui::models::TransactionModel::setFilter(Filter filter) {
+  filter_ = std::move(filter);
+  handleReset();
+}
+
+bool pvui::models::TransactionModel::canFetchMore(const QModelIndex& parent) const {
+  return !parent.isValid() && !fetchedAll;
+}
+
+void pvui::models::TransactionModel::fetchMore(const QModelIndex& parent) {
+  if (parent.isValid()) {
+    return;
+  }
+  auto page = fetchPage();
+  if (page.empty()) {
+    return;
+  }
+  beginInsertRows(QModelIndex(), rowCount(), rowCount() + static_cast<int>(page.size()) - 1);
+  for (auto& row : page) {
+    transactions.push_back(row.transaction);
+    keys.push_back(std::move(row.key));
+  }
+  endInsertRows();
+}
+
+const pv::transaction::Record* pvui::models::TransactionModel::record(int rowIndex) const {
+  pv::i64 transaction = transactions.at(rowIndex);
+  auto iter = rowCacheIndex.find(transaction);
+  if (iter != rowCacheIndex.end()) {
+    rowCache.splice(rowCache.begin(), rowCache, iter->second); // Mark as most recently used
+    return &*iter->second;
+  }
+
+  auto record = pv::transaction::record(dataFile, transaction);
+  if (!record.has_value()) {
+    return nullptr;
+  }
+  if (rowCache.size() >= rowCacheCapacity) {
+    rowCacheIndex.erase(rowCache.back().id);
+    rowCache.pop_back();
+  }
+  rowCache.push_front(std::move(*record));
+  rowCacheIndex.emplace(transaction, rowCache.begin());
+  return &rowCache.front();
+}
+
+void pvui::models::TransactionModel::invalidateRecord(pv::i64 transaction) {
+  auto iter = rowCacheIndex.find(transaction);
+  if (iter != rowCacheIndex.end()) {
+    rowCache.erase(iter->second);
+    rowCacheIndex.erase(iter);
+  }
+}
+
+void pvui::models::TransactionModel::invalidateRecords() {
+  rowCache.clear();
+  rowCacheIndex.clear();
+}
+
+void pvui::models::TransactionModel::handleTransactionAdded(pv::i64 id) {
+  auto row = rowOf(id);
+  if (!row.has_value()) {
+    return;
+  }
+  if (isFetched(*row)) {
+    int rowIndex = positionOf(*row, -1);
+    insertTransaction(rowIndex, std::move(*row));
+  } else {
+    insertUnfetched(std::move(*row));
+  }
+}
+
 void pvui::models::TransactionModel::handleTransactionUpdated(pv::i64 id) {
-  int rowIndex = static_cast<int>(std::find(transactions.cbegin(), transactions.cend(), id) - transactions.cbegin());
+  invalidateRecord(id);
+  removeUnfetched(id);
+  auto row = rowOf(id); // The sort key or the filter may have changed
+  auto iter = std::find(transactions.cbegin(), transactions.cend(), id);
+  if (iter == transactions.cend()) {
+    if (!row.has_value()) {
+      return;
+    }
+    if (isFetched(*row)) {
+      int rowIndex = positionOf(*row, -1);
+      insertTransaction(rowIndex, std::move(*row));
+    } else {
+      insertUnfetched(std::move(*row));
+    }
+    return;
+  }
+
+  int rowIndex = static_cast<int>(iter - transactions.cbegin());
+  if (!row.has_value() || !isFetched(*row)) {
+    removeTransaction(rowIndex);
+    if (row.has_value()) {
+      insertUnfetched(std::move(*row));
+    }
+    return;
+  }
+  int position = positionOf(*row, rowIndex);
+  keys[rowIndex] = std::move(row->key);
+  if (position != rowIndex) {
+    beginMoveRows(QModelIndex(), rowIndex, rowIndex, QModelIndex(), position > rowIndex ? position + 1 : position);
+    SortKey key = std::move(keys[rowIndex]);
+    transactions.erase(transactions.begin() + rowIndex);
+    keys.erase(keys.begin() + rowIndex);
+    transactions.insert(transactions.begin() + position, id);
+    keys.insert(keys.begin() + position, std::move(key));
+    endMoveRows();
+    rowIndex = position;
+  }
   emit dataChanged(index(rowIndex, 0), index(rowIndex, columnCount(QModelIndex()) - 1));
 }
 
 void pvui::models::TransactionModel::handleTransactionRemoved(pv::i64 id) {
+  invalidateRecord(id);
+  removeUnfetched(id);
   auto iter = std::find(transactions.cbegin(), transactions.cend(), id);
-  int rowIndex = static_cast<int>(iter - transactions.cbegin());
-  beginRemoveRows(QModelIndex(), rowIndex, rowIndex);
-  transactions.erase(iter);
-  endRemoveRows();
+  if (iter == transactions.cend()) {
+    return; // Removed from another account, filtered out, or not fetched yet
+  }
+  removeTransaction(static_cast<int>(iter - transactions.cbegin()));
 }
 
 void pvui::models::TransactionModel::handleReset() {
   beginResetModel();
+  invalidateRecords();
   repopulate();
   endResetModel();
 }
 
+void pvui::models::TransactionModel::handleSecuritiesChanged() {
+  // The symbols that rows are sorted by (or the security they're filtered by) may have changed along with them
+  if (sortColumn == securityColumn || filter_.security.has_value()) {
+    handleReset();
+    return;
+  }
+  invalidateRecords();
+  if (!transactions.empty()) {
+    emit dataChanged(index(0, securityColumn), index(rowCount() - 1, securityColumn));
+  }
+}
+
 int pvui::models::TransactionModel::columnCount(const QModelIndex&) const { return ::columnCount; }
 
 QVariant pvui::models::TransactionModel::data(const QModelIndex& index, int role) const {
@@ -254,32 +657,34 @@ QVariant pvui::models::TransactionModel::data(const QModelIndex& index, int role
   if (role != Qt::DisplayRole && role != Qt::EditRole && role != Qt::AccessibleTextRole && role != modelutils::SortRole) {
     return QVariant();
   }
-  pv::i64 transaction = transactions.at(index.row());
+  const auto* record = this->record(index.row());
+  if (record == nullptr) {
+    return QVariant();
+  }
 
   switch (index.column()) {
   case dateColumn:
-    return toQDate(pv::transaction::date(dataFile, transaction));
+    return toQDate(record->date);
   case actionColumn: {
-    return modelutils::stringData(nameOfAction(pv::transaction::action(dataFile, transaction)), role);
+    return modelutils::stringData(nameOfAction(record->action), role);
   }
   case securityColumn: {
-    std::optional<pv::i64> securityId = getSecurity(dataFile, transaction);
-    return modelutils::stringData(securityId ? QString::fromStdString(pv::security::symbol(dataFile, *securityId)) : QString(), role);
+    return modelutils::stringData(QString::fromStdString(record->symbol), role);
   }
   case numberOfSharesColumn: {
-    std::optional<pv::i64> numberOfShares = getNumberOfShares(dataFile, transaction);
+    std::optional<pv::i64> numberOfShares = getNumberOfShares(*record);
     return numberOfShares ? modelutils::numberData(*numberOfShares, role) : (role == modelutils::SortRole ? modelutils::lowestData() : QVariant());
   }
   case sharePriceColumn: {
-    std::optional<pv::i64> sharePrice = getSharePrice(dataFile, transaction);
+    std::optional<pv::i64> sharePrice = getSharePrice(*record);
     return sharePrice ? modelutils::moneyData(*sharePrice, role) : (role == modelutils::SortRole ? modelutils::lowestData() : QVariant());
   }
   case commissionColumn: {
-    std::optional<pv::i64> commission = getCommission(dataFile, transaction);
+    std::optional<pv::i64> commission = getCommission(*record);
     return commission ? modelutils::moneyData(*commission, role) : (role == modelutils::SortRole ? modelutils::lowestData() : QVariant());
   }
   case totalAmountColumn: {
-    std::optional<pv::i64> totalAmount = getTotalAmount(dataFile, transaction);
+    std::optional<pv::i64> totalAmount = getTotalAmount(*record);
     return totalAmount ? modelutils::moneyData(*totalAmount, role) : (role == modelutils::SortRole ? modelutils::lowestData() : QVariant());
   }
   default:
@@ -291,7 +696,12 @@ Qt::ItemFlags pvui::models::TransactionModel::flags(const QModelIndex& index) co
   static const Qt::ItemFlags NonEditable = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
   static const Qt::ItemFlags Editable = NonEditable | Qt::ItemIsEditable;
 
-  switch (pv::transaction::action(dataFile, transactions.at(index.row()))) {
+  const auto* record = this->record(index.row());
+  if (record == nullptr) {
+    return NonEditable;
+  }
+
+  switch (record->action) {
   case pv::Action::BUY: // Fall through
   case pv::Action::SELL: {
     if (index.column() == numberOfSharesColumn || index.column() == sharePriceColumn ||
@@ -8,25 +8,107 @@
 #include <QAbstractTableModel>
 #include <QDate>
 #include <QObject>
+#include <QVariant>
+#include <cstddef>
+#include <list>
 #include <optional>
 #include <qabstractitemmodel.h>
+#include <string>
+#include <unordered_map>
+#include <variant>
 #include <vector>
 
 namespace pvui::models {
+
+/// \brief The transactions of a single account.
+///
+/// Sorting and filtering are done by SQLite, and rows are fetched a page at a time in sorted order (with
+/// \c canFetchMore() and \c fetchMore()), so large accounts open quickly. Use this model directly instead of
+/// through a \c QSortFilterProxyModel.
 class TransactionModel : public QAbstractTableModel {
   Q_OBJECT
+public:
+  /// \brief Restricts which transactions of the account are shown. Unset fields don't filter anything.
+  struct Filter {
+    std::optional<pv::i64> startDate; ///< inclusive
+    std::optional<pv::i64> endDate;   ///< inclusive
+    std::optional<pv::Action> action;
+    std::optional<pv::i64> security;
+  };
 private:
   pv::DataFile& dataFile;
   pv::i64 account;
 
+  Filter filter_;
+  int sortColumn = 0;
+  Qt::SortOrder sortOrder = Qt::AscendingOrder;
+
+  /// \internal What a column is sorted by: an integer, or the UTF-8 text of a symbol (which compares byte by byte,
+  /// like SQLite does).
+  using SortKey = std::variant<pv::i64, std::string>;
+
+  /// \internal A transaction with its sort key. Ties between equal keys are broken by the transaction.
+  struct Row {
+    SortKey key;
+    pv::i64 transaction = 0;
+  };
+
+  /// \internal The fetched transactions and their sort keys, in sorted order. These are exactly the transactions
+  /// that pass the filter and sort before (or at) the cursor, unless everything has been fetched.
   std::vector<pv::i64> transactions;
+  std::vector<SortKey> keys;
+  bool fetchedAll = false;
+  bool hasCursor = false;
+  Row cursor; ///< the last fetched row
+
+  /// \internal Only the date column has an index to page through. Sorting by any other column reads every row that
+  /// passes the filter once, and later pages are fetched from the rest of them, which are kept here (last first).
+  std::vector<Row> unfetched;
+
+  /// \internal The most recently read rows, so that painting a row doesn't query the data file once per cell.
+  /// Ordered from most to least recently used.
+  mutable std::list<pv::transaction::Record> rowCache;
+  mutable std::unordered_map<pv::i64, std::list<pv::transaction::Record>::iterator> rowCacheIndex;
+  static constexpr std::size_t rowCacheCapacity = 1024;
 
   pv::ScopedConnection transactionAddedConnection;
   pv::ScopedConnection transactionRemovedConnection;
   pv::ScopedConnection transactionUpdatedConnection;
+  pv::ScopedConnection transactionsAddedConnection;
   pv::ScopedConnection resetConnection;
+  pv::ScopedConnection securitiesChangedConnection;
 
   void repopulate();
+
+  std::string fromClause() const;
+  std::string whereClause() const;
+  void bindFilter(sqlite3_stmt* stmt) const;
+  bool indexed() const noexcept;
+  /// \internal Whether \c lhs sorts before \c rhs.
+  bool before(const SortKey& lhs, pv::i64 lhsTransaction, const SortKey& rhs, pv::i64 rhsTransaction) const;
+  /// \internal Reads every row that passes the filter into \c unfetched, when sorting by a column without an index.
+  void materialize();
+  /// \internal Fetches the next page after the cursor and moves the cursor to its end.
+  std::vector<Row> fetchPage();
+  /// \internal Reads the sort key of \c transaction.
+  /// \returns the row, or \c std::nullopt if it doesn't pass the filter
+  std::optional<Row> rowOf(pv::i64 transaction) const;
+  /// \internal Whether \c row belongs with the fetched rows rather than a later page.
+  bool isFetched(const Row& row) const;
+  /// \internal Finds the index that the fetched \c row belongs at, ignoring the row at \c ignoredRow (-1 for none).
+  /// This is a binary search of \c keys, so it doesn't query the data file.
+  int positionOf(const Row& row, int ignoredRow) const;
+  void insertTransaction(int rowIndex, Row row);
+  void removeTransaction(int rowIndex);
+  /// \internal Keeps \c unfetched up to date (neither does anything when paging through the index).
+  void insertUnfetched(Row row);
+  void removeUnfetched(pv::i64 transaction);
+
+  /// \internal Reads a row through the row cache.
+  /// \returns the row, or \c nullptr if the transaction no longer exists
+  const pv::transaction::Record* record(int rowIndex) const;
+  void invalidateRecord(pv::i64 transaction);
+  void invalidateRecords();
 public:
   TransactionModel(pv::DataFile& dataFile, pv::i64 account, QObject* parent = nullptr);
 
@@ -44,16 +126,26 @@ public:
   Qt::ItemFlags flags(const QModelIndex& index) const override;
 
   bool setData(const QModelIndex& index, const QVariant& value, int role) override;
+
+  void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+  bool canFetchMore(const QModelIndex& parent) const override;
+  void fetchMore(const QModelIndex& parent) override;
+
+  const Filter& filter() const noexcept { return filter_; }
+  void setFilter(Filter filter);
 private slots:
   void handleTransactionAdded(pv::i64 id);
   void handleTransactionUpdated(pv::i64 id);
   void handleTransactionRemoved(pv::i64 id);
   void handleReset();
+  void handleSecuritiesChanged();
 signals:
   void transactionAdded(pv::i64 id);
   void transactionUpdated(pv::i64 id);
   void transactionRemoved(pv::i64 id);
   void reset();
+  void securitiesChanged();
 };
 } // namespace pvui::models
 
@@ -2,9 +2,12 @@
 #include "ThemeManager.h"
 #include <QtGlobal>
 #include "MacWindowList.h"
+#include "pv/Trace.h"
 #include <QApplication>
 #include <QCoreApplication>
 #include <QIcon>
+#include <cstdlib>
+#include <fstream>
 
 namespace {
 void installFallbackIcons() {
@@ -25,6 +28,12 @@ int main(int argc, char* argv[]) {
   QCoreApplication::setOrganizationDomain("pviewapp.github.io");
   QCoreApplication::setApplicationName("pView");
 
+  // PVIEW_TRACE=trace.json records the whole session, to be loaded into a trace viewer afterwards
+  const char* tracePath = std::getenv("PVIEW_TRACE");
+  pv::trace::setThreadName("Main");
+  bool traceSession = tracePath != nullptr && *tracePath != '\0';
+  pv::trace::setEnabled(traceSession);
+
   installFallbackIcons();
   QApplication app(argc, argv);
 
@@ -35,5 +44,10 @@ int main(int argc, char* argv[]) {
   window->show();
   window->setAttribute(Qt::WA_DeleteOnClose);
 
-  return app.exec();
+  int result = app.exec();
+  if (traceSession) {
+    std::ofstream traceFile(tracePath);
+    pv::trace::writeChromeTrace(traceFile);
+  }
+  return result;
 }